@@ -24,6 +24,7 @@ XSCALE := n
 ARMV5 = n
 ARMV6 = n
 ARMV7 := n
+NEON := n
 X86 := n
 MIPS := n
 FAT_BINARY := n
@@ -240,7 +241,12 @@ ifeq ($(TARGET),ANDROID)
   endif
 
   ifeq ($(ARMV7),y)
-    TARGET_ARCH += -march=armv7-a -mfloat-abi=softfp -mfpu=vfp -mthumb-interwork
+    ifeq ($(NEON),y)
+      # not all ARMv7 CPUs have NEON (e.g. Tegra 2), so it is optional
+      TARGET_ARCH += -march=armv7-a -mfloat-abi=softfp -mfpu=neon -mthumb-interwork
+    else
+      TARGET_ARCH += -march=armv7-a -mfloat-abi=softfp -mfpu=vfp -mthumb-interwork
+    endif
     HAVE_FPU := y
   endif
 
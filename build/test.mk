@@ -11,7 +11,8 @@ TESTFAST = \
 	test_automc \
 	test_acfilter \
 	test_trees \
-	test_vopt
+	test_vopt \
+	test_airspace_warnings
 
 TESTSLOW = \
 	test_bestcruisetrack \
@@ -25,7 +26,10 @@ TESTSLOW = \
 	test_aat \
 	test_replay_olc
 
-HARNESS_PROGRAMS = $(TESTFAST) $(TESTSLOW)
+HARNESS_PROGRAMS = $(TESTFAST) $(TESTSLOW) \
+	BenchmarkAirspaces \
+	BenchmarkAirspaceWarnings \
+	BenchmarkAirspaceRoute
 
 build-harness: $(call name-to-bin,$(HARNESS_PROGRAMS))
 
@@ -77,12 +81,15 @@ TEST_NAMES = \
 	TestWaypoints \
 	test_pressure \
 	test_task \
+	test_airspace_warnings \
 	TestOverwritingRingBuffer \
 	TestDateTime \
 	TestMathTables \
 	TestAngle TestUnits TestEarth TestSunEphemeris \
 	TestValidity TestUTM TestProfile \
 	TestRadixTree TestGeoBounds TestGeoClip \
+	TestLabelBlock TestPolygonInteriorIndex \
+	TestHeightMatrix \
 	TestLogger TestDriver TestClimbAvCalc \
 	TestWaypointReader TestThermalBase \
 	TestFlarmNet \
@@ -232,7 +239,7 @@ TEST_TROUTE_SOURCES = \
 	$(TEST_SRC_DIR)/Printing.cpp \
 	$(TEST_SRC_DIR)/tap.c \
 	$(TEST_SRC_DIR)/test_troute.cpp
-TEST_TROUTE_DEPENDS = JASPER IO ZZIP OS ROUTE GLIDE GEO MATH UTIL
+TEST_TROUTE_DEPENDS = JASPER IO ZZIP OS THREAD ROUTE GLIDE GEO MATH UTIL
 $(eval $(call link-program,test_troute,TEST_TROUTE))
 
 TEST_REACH_SOURCES = \
@@ -246,7 +253,7 @@ TEST_REACH_SOURCES = \
 	$(TEST_SRC_DIR)/Printing.cpp \
 	$(TEST_SRC_DIR)/tap.c \
 	$(TEST_SRC_DIR)/test_reach.cpp
-TEST_REACH_DEPENDS = JASPER IO ZZIP OS ROUTE GLIDE GEO MATH UTIL
+TEST_REACH_DEPENDS = JASPER IO ZZIP OS THREAD ROUTE GLIDE GEO MATH UTIL
 $(eval $(call link-program,test_reach,TEST_REACH))
 
 TEST_ROUTE_SOURCES = \
@@ -267,7 +274,7 @@ TEST_ROUTE_SOURCES = \
 	$(TEST_SRC_DIR)/harness_airspace.cpp \
 	$(TEST_SRC_DIR)/tap.c \
 	$(TEST_SRC_DIR)/test_route.cpp
-TEST_ROUTE_DEPENDS = JASPER IO ZZIP OS ROUTE AIRSPACE GLIDE GEO MATH UTIL
+TEST_ROUTE_DEPENDS = JASPER IO ZZIP OS THREAD ROUTE AIRSPACE GLIDE GEO MATH UTIL
 $(eval $(call link-program,test_route,TEST_ROUTE))
 
 TEST_REPLAY_TASK_SOURCES = \
@@ -338,6 +345,34 @@ TEST_GEO_CLIP_SOURCES = \
 TEST_GEO_CLIP_DEPENDS = GEO MATH
 $(eval $(call link-program,TestGeoClip,TEST_GEO_CLIP))
 
+TEST_POLYGON_INTERIOR_INDEX_SOURCES = \
+	$(TEST_SRC_DIR)/tap.c \
+	$(TEST_SRC_DIR)/TestPolygonInteriorIndex.cpp
+TEST_POLYGON_INTERIOR_INDEX_DEPENDS = GEO MATH
+$(eval $(call link-program,TestPolygonInteriorIndex,TEST_POLYGON_INTERIOR_INDEX))
+
+TEST_LABEL_BLOCK_SOURCES = \
+	$(SRC)/Screen/LabelBlock.cpp \
+	$(TEST_SRC_DIR)/tap.c \
+	$(TEST_SRC_DIR)/TestLabelBlock.cpp
+TEST_LABEL_BLOCK_CPPFLAGS = $(SCREEN_CPPFLAGS)
+$(eval $(call link-program,TestLabelBlock,TEST_LABEL_BLOCK))
+
+TEST_HEIGHT_MATRIX_SOURCES = \
+	$(SRC)/Terrain/RasterTile.cpp \
+	$(SRC)/Terrain/RasterTileCache.cpp \
+	$(SRC)/Terrain/RasterBuffer.cpp \
+	$(SRC)/Terrain/RasterProjection.cpp \
+	$(SRC)/Terrain/RasterMap.cpp \
+	$(SRC)/Terrain/HeightMatrix.cpp \
+	$(SRC)/Projection/Projection.cpp \
+	$(SRC)/Projection/WindowProjection.cpp \
+	$(SRC)/Operation/Operation.cpp \
+	$(TEST_SRC_DIR)/tap.c \
+	$(TEST_SRC_DIR)/TestHeightMatrix.cpp
+TEST_HEIGHT_MATRIX_DEPENDS = GEO MATH IO OS THREAD JASPER ZZIP UTIL
+$(eval $(call link-program,TestHeightMatrix,TEST_HEIGHT_MATRIX))
+
 TEST_CLIMB_AV_CALC_SOURCES = \
 	$(SRC)/ClimbAverageCalculator.cpp \
 	$(TEST_SRC_DIR)/tap.c \
@@ -634,6 +669,15 @@ DEBUG_PROGRAM_NAMES = \
 	RunOLCAnalysis \
 	FlightPath \
 	BenchmarkProjection \
+	BenchmarkSlopeShading \
+	BenchmarkTerrainHeights \
+	BenchmarkTerrainIntersection \
+	BenchmarkTerrain \
+	BenchmarkLabelBlock \
+	BenchmarkAirspaces \
+	BenchmarkAirspaceInside \
+	BenchmarkAirspaceWarnings \
+	BenchmarkAirspaceRoute \
 	DumpTextFile DumpTextZip WriteTextFile RunTextWriter \
 	DumpHexColor \
 	RunXMLParser \
@@ -644,7 +688,7 @@ DEBUG_PROGRAM_NAMES = \
 	ReadGRecord VerifyGRecord AppendGRecord \
 	AddChecksum \
 	KeyCodeDumper \
-	LoadTopography LoadTerrain \
+	LoadTopography LoadTerrain TerrainToDEM \
 	RunHeightMatrix \
 	RunInputParser \
 	RunWaypointParser RunAirspaceParser \
@@ -775,6 +819,19 @@ BENCHMARK_PROJECTION_DEPENDS = MATH
 BENCHMARK_PROJECTION_CPPFLAGS = $(SCREEN_CPPFLAGS)
 $(eval $(call link-program,BenchmarkProjection,BENCHMARK_PROJECTION))
 
+BENCHMARK_SLOPE_SHADING_SOURCES = \
+	$(SRC)/Terrain/SlopeShader.cpp \
+	$(TEST_SRC_DIR)/BenchmarkSlopeShading.cpp
+BENCHMARK_SLOPE_SHADING_DEPENDS = OS MATH
+$(eval $(call link-program,BenchmarkSlopeShading,BENCHMARK_SLOPE_SHADING))
+
+BENCHMARK_LABEL_BLOCK_SOURCES = \
+	$(SRC)/Screen/LabelBlock.cpp \
+	$(TEST_SRC_DIR)/BenchmarkLabelBlock.cpp
+BENCHMARK_LABEL_BLOCK_DEPENDS = OS
+BENCHMARK_LABEL_BLOCK_CPPFLAGS = $(SCREEN_CPPFLAGS)
+$(eval $(call link-program,BenchmarkLabelBlock,BENCHMARK_LABEL_BLOCK))
+
 DUMP_TEXT_FILE_SOURCES = \
 	$(SRC)/Util/UTF8.cpp \
 	$(TEST_SRC_DIR)/DumpTextFile.cpp
@@ -961,12 +1018,15 @@ $(eval $(call link-program,KeyCodeDumper,KEY_CODE_DUMPER))
 LOAD_TOPOGRAPHY_SOURCES = \
 	$(SRC)/Topography/TopographyStore.cpp \
 	$(SRC)/Topography/TopographyFile.cpp \
+	$(SRC)/Topography/ShapeIndex.cpp \
+	$(SRC)/Topography/ShapeArena.cpp \
+	$(SRC)/Topography/CompiledShapes.cpp \
 	$(SRC)/Topography/XShape.cpp \
 	$(SRC)/Projection/Projection.cpp \
 	$(SRC)/Projection/WindowProjection.cpp \
 	$(SRC)/Operation/Operation.cpp \
 	$(TEST_SRC_DIR)/LoadTopography.cpp
-LOAD_TOPOGRAPHY_DEPENDS = MATH IO UTIL SHAPELIB ZZIP
+LOAD_TOPOGRAPHY_DEPENDS = THREAD MATH IO OS UTIL SHAPELIB ZZIP
 LOAD_TOPOGRAPHY_CPPFLAGS = $(SCREEN_CPPFLAGS)
 $(eval $(call link-program,LoadTopography,LOAD_TOPOGRAPHY))
 
@@ -979,9 +1039,61 @@ LOAD_TERRAIN_SOURCES = \
 	$(SRC)/Util/UTF8.cpp \
 	$(TEST_SRC_DIR)/LoadTerrain.cpp
 LOAD_TERRAIN_CPPFLAGS = $(SCREEN_CPPFLAGS)
-LOAD_TERRAIN_DEPENDS = GEO MATH IO OS JASPER ZZIP
+LOAD_TERRAIN_DEPENDS = GEO MATH IO OS THREAD JASPER ZZIP
 $(eval $(call link-program,LoadTerrain,LOAD_TERRAIN))
 
+TERRAIN_TO_DEM_SOURCES = \
+	$(SRC)/Terrain/RasterTile.cpp \
+	$(SRC)/Terrain/RasterTileCache.cpp \
+	$(SRC)/Terrain/RasterBuffer.cpp \
+	$(SRC)/Terrain/RasterProjection.cpp \
+	$(SRC)/Operation/Operation.cpp \
+	$(SRC)/Util/UTF8.cpp \
+	$(TEST_SRC_DIR)/TerrainToDEM.cpp
+TERRAIN_TO_DEM_CPPFLAGS = $(SCREEN_CPPFLAGS)
+TERRAIN_TO_DEM_DEPENDS = GEO MATH IO OS THREAD JASPER ZZIP
+$(eval $(call link-program,TerrainToDEM,TERRAIN_TO_DEM))
+
+BENCHMARK_TERRAIN_HEIGHTS_SOURCES = \
+	$(SRC)/Terrain/RasterTile.cpp \
+	$(SRC)/Terrain/RasterTileCache.cpp \
+	$(SRC)/Terrain/RasterBuffer.cpp \
+	$(SRC)/Terrain/RasterProjection.cpp \
+	$(SRC)/Terrain/RasterMap.cpp \
+	$(SRC)/Operation/Operation.cpp \
+	$(TEST_SRC_DIR)/BenchmarkTerrainHeights.cpp
+BENCHMARK_TERRAIN_HEIGHTS_DEPENDS = GEO MATH IO OS THREAD JASPER ZZIP UTIL
+$(eval $(call link-program,BenchmarkTerrainHeights,BENCHMARK_TERRAIN_HEIGHTS))
+
+BENCHMARK_TERRAIN_INTERSECTION_SOURCES = \
+	$(SRC)/Terrain/RasterTile.cpp \
+	$(SRC)/Terrain/RasterTileCache.cpp \
+	$(SRC)/Terrain/RasterBuffer.cpp \
+	$(SRC)/Terrain/RasterProjection.cpp \
+	$(SRC)/Terrain/RasterMap.cpp \
+	$(SRC)/Operation/Operation.cpp \
+	$(TEST_SRC_DIR)/BenchmarkTerrainIntersection.cpp
+BENCHMARK_TERRAIN_INTERSECTION_DEPENDS = GEO MATH IO OS THREAD JASPER ZZIP UTIL
+$(eval $(call link-program,BenchmarkTerrainIntersection,BENCHMARK_TERRAIN_INTERSECTION))
+
+BENCHMARK_TERRAIN_SOURCES = \
+	$(SRC)/Terrain/RasterTile.cpp \
+	$(SRC)/Terrain/RasterTileCache.cpp \
+	$(SRC)/Terrain/RasterBuffer.cpp \
+	$(SRC)/Terrain/RasterProjection.cpp \
+	$(SRC)/Terrain/RasterMap.cpp \
+	$(SRC)/Terrain/HeightMatrix.cpp \
+	$(SRC)/Terrain/RasterRenderer.cpp \
+	$(SRC)/Terrain/SlopeShader.cpp \
+	$(SRC)/Screen/Ramp.cpp \
+	$(SRC)/Projection/Projection.cpp \
+	$(SRC)/Projection/WindowProjection.cpp \
+	$(SRC)/Operation/Operation.cpp \
+	$(TEST_SRC_DIR)/BenchmarkTerrain.cpp
+BENCHMARK_TERRAIN_CPPFLAGS = $(SCREEN_CPPFLAGS)
+BENCHMARK_TERRAIN_DEPENDS = SCREEN GEO MATH IO OS THREAD JASPER ZZIP UTIL
+$(eval $(call link-program,BenchmarkTerrain,BENCHMARK_TERRAIN))
+
 RUN_HEIGHT_MATRIX_SOURCES = \
 	$(SRC)/Terrain/RasterTile.cpp \
 	$(SRC)/Terrain/RasterTileCache.cpp \
@@ -994,7 +1106,7 @@ RUN_HEIGHT_MATRIX_SOURCES = \
 	$(SRC)/Operation/Operation.cpp \
 	$(TEST_SRC_DIR)/RunHeightMatrix.cpp
 RUN_HEIGHT_MATRIX_CPPFLAGS = $(SCREEN_CPPFLAGS)
-RUN_HEIGHT_MATRIX_DEPENDS = GEO MATH IO OS JASPER ZZIP UTIL
+RUN_HEIGHT_MATRIX_DEPENDS = GEO MATH IO OS THREAD JASPER ZZIP UTIL
 $(eval $(call link-program,RunHeightMatrix,RUN_HEIGHT_MATRIX))
 
 RUN_INPUT_PARSER_SOURCES = \
@@ -1055,6 +1167,7 @@ $(eval $(call link-program,NearestWaypoints,NEAREST_WAYPOINTS))
 
 RUN_AIRSPACE_PARSER_SOURCES = \
 	$(SRC)/Airspace/AirspaceParser.cpp \
+	$(SRC)/Airspace/AirspaceCache.cpp \
 	$(SRC)/Units/Descriptor.cpp \
 	$(SRC)/Units/System.cpp \
 	$(SRC)/Operation/Operation.cpp \
@@ -1067,6 +1180,20 @@ RUN_AIRSPACE_PARSER_LDADD = $(FAKE_LIBS)
 RUN_AIRSPACE_PARSER_DEPENDS = IO OS AIRSPACE ZZIP GEO MATH UTIL
 $(eval $(call link-program,RunAirspaceParser,RUN_AIRSPACE_PARSER))
 
+BENCHMARK_AIRSPACE_INSIDE_SOURCES = \
+	$(SRC)/Airspace/AirspaceParser.cpp \
+	$(SRC)/Units/Descriptor.cpp \
+	$(SRC)/Units/System.cpp \
+	$(SRC)/Operation/Operation.cpp \
+	$(SRC)/Atmosphere/Pressure.cpp \
+	$(TEST_SRC_DIR)/FakeDialogs.cpp \
+	$(TEST_SRC_DIR)/FakeTerrain.cpp \
+	$(TEST_SRC_DIR)/FakeLanguage.cpp \
+	$(TEST_SRC_DIR)/BenchmarkAirspaceInside.cpp
+BENCHMARK_AIRSPACE_INSIDE_LDADD = $(FAKE_LIBS)
+BENCHMARK_AIRSPACE_INSIDE_DEPENDS = IO OS AIRSPACE ZZIP GEO MATH UTIL
+$(eval $(call link-program,BenchmarkAirspaceInside,BENCHMARK_AIRSPACE_INSIDE))
+
 READ_PORT_SOURCES = \
 	$(SRC)/Device/Port/ConfiguredPort.cpp \
 	$(SRC)/OS/LogError.cpp \
@@ -1521,6 +1648,7 @@ RUN_MAP_WINDOW_SOURCES = \
 	$(SRC)/Terrain/RasterWeather.cpp \
 	$(SRC)/Terrain/HeightMatrix.cpp \
 	$(SRC)/Terrain/RasterRenderer.cpp \
+	$(SRC)/Terrain/SlopeShader.cpp \
 	$(SRC)/Terrain/TerrainRenderer.cpp \
 	$(SRC)/Terrain/TerrainSettings.cpp \
 	$(SRC)/Terrain/WeatherTerrainRenderer.cpp \
@@ -1558,6 +1686,9 @@ RUN_MAP_WINDOW_SOURCES = \
 	$(SRC)/Task/ProtectedRoutePlanner.cpp \
 	$(SRC)/Task/RoutePlannerGlue.cpp \
 	$(SRC)/Topography/TopographyFile.cpp \
+	$(SRC)/Topography/ShapeIndex.cpp \
+	$(SRC)/Topography/ShapeArena.cpp \
+	$(SRC)/Topography/CompiledShapes.cpp \
 	$(SRC)/Topography/TopographyStore.cpp \
 	$(SRC)/Topography/TopographyFileRenderer.cpp \
 	$(SRC)/Topography/TopographyRenderer.cpp \
@@ -1969,6 +2100,7 @@ RUN_ANALYSIS_SOURCES = \
 	$(SRC)/Airspace/ProtectedAirspaceWarningManager.cpp \
 	$(SRC)/Airspace/AirspaceParser.cpp \
 	$(SRC)/Airspace/AirspaceGlue.cpp \
+	$(SRC)/Airspace/AirspaceCache.cpp \
 	$(SRC)/Airspace/AirspaceVisibility.cpp \
 	$(SRC)/Airspace/AirspaceComputerSettings.cpp \
 	$(SRC)/Renderer/AirspaceRendererSettings.cpp \
@@ -0,0 +1,285 @@
+/*
+Copyright_License {
+
+  XCSoar Glide Computer - http://www.xcsoar.org/
+  Copyright (C) 2000-2012 The XCSoar Project
+  A detailed list of copyright holders can be found in the file "AUTHORS".
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+}
+*/
+
+#include "Airspace/AirspaceCache.hpp"
+#include "Airspace/Airspaces.hpp"
+#include "Airspace/AirspacePolygon.hpp"
+#include "Airspace/AirspaceCircle.hpp"
+#include "IO/FileCache.hpp"
+#include "Util/tstring.hpp"
+
+#include <vector>
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * The file starts with this header, followed by the path of the
+ * source file, and by one record per airspace.  Values are stored in
+ * their in-memory representation, and files written by a build with a
+ * different layout are rejected.
+ */
+struct AirspaceCacheHeader {
+  enum {
+    MAGIC = 0x50534158, /* "XASP" */
+    VERSION = 2,
+  };
+
+  uint32_t magic, version, layout;
+
+  uint32_t num_airspaces;
+
+  uint32_t path_length;
+};
+
+/**
+ * An airspace record is followed by its name, its radio frequency
+ * and, for polygons, the data written by AirspacePolygon::SaveCache().
+ */
+struct AirspaceCacheRecord {
+  AirspaceAltitude base, top;
+  AirspaceActivity days;
+
+  /**
+   * The center and radius of a circle.
+   */
+  GeoPoint center;
+  fixed radius;
+
+  uint16_t name_length, radio_length;
+
+  AbstractAirspace::Shape shape;
+  AirspaceClass type;
+};
+
+/**
+ * Limits which protect from allocating huge buffers when reading a
+ * corrupt file.
+ */
+static const unsigned MAX_STRING_LENGTH = 1024;
+
+static uint32_t
+GetLayout()
+{
+  return sizeof(AirspaceCacheRecord)
+    | sizeof(GeoPoint) << 8
+    | sizeof(TCHAR) << 16
+#ifdef FIXED_MATH
+    | 1 << 20
+#endif
+    ;
+}
+
+static bool
+ReadString(FILE *file, unsigned length, tstring &value)
+{
+  if (length > MAX_STRING_LENGTH)
+    return false;
+
+  TCHAR buffer[MAX_STRING_LENGTH];
+  if (length > 0 && fread(buffer, sizeof(buffer[0]), length, file) != length)
+    return false;
+
+  value.assign(buffer, length);
+  return true;
+}
+
+static bool
+IsValid(const AirspaceAltitude &altitude)
+{
+  return altitude.type <= AirspaceAltitude::Type::FL;
+}
+
+static AbstractAirspace *
+ReadRecord(FILE *file)
+{
+  AirspaceCacheRecord record;
+  if (fread(&record, sizeof(record), 1, file) != 1 ||
+      record.type >= AIRSPACECLASSCOUNT ||
+      !IsValid(record.base) || !IsValid(record.top))
+    return NULL;
+
+  tstring name, radio;
+  if (!ReadString(file, record.name_length, name) ||
+      !ReadString(file, record.radio_length, radio))
+    return NULL;
+
+  AbstractAirspace *as;
+  switch (record.shape) {
+  case AbstractAirspace::Shape::CIRCLE:
+    as = new AirspaceCircle(record.center, record.radius);
+    break;
+
+  case AbstractAirspace::Shape::POLYGON: {
+    AirspacePolygon *polygon = new AirspacePolygon();
+    if (!polygon->LoadCache(file)) {
+      delete polygon;
+      return NULL;
+    }
+
+    as = polygon;
+    break;
+  }
+
+  default:
+    return NULL;
+  }
+
+  as->SetProperties(name, record.type, record.base, record.top);
+  as->SetRadio(radio);
+  as->SetDays(record.days);
+  return as;
+}
+
+static bool
+ReadAirspaces(FILE *file, const TCHAR *path,
+              std::vector<AbstractAirspace *> &result)
+{
+  AirspaceCacheHeader header;
+  if (fread(&header, sizeof(header), 1, file) != 1 ||
+      header.magic != AirspaceCacheHeader::MAGIC ||
+      header.version != AirspaceCacheHeader::VERSION ||
+      header.layout != GetLayout())
+    return false;
+
+  /* the cache file may belong to another file with the same size
+     and modification time */
+  tstring cached_path;
+  if (!ReadString(file, header.path_length, cached_path) ||
+      cached_path != path)
+    return false;
+
+  for (unsigned i = 0; i < header.num_airspaces; ++i) {
+    AbstractAirspace *as = ReadRecord(file);
+    if (as == NULL)
+      return false;
+
+    result.push_back(as);
+  }
+
+  return true;
+}
+
+bool
+LoadAirspaceCache(Airspaces &airspaces, FileCache &cache,
+                  const TCHAR *name, const TCHAR *path)
+{
+  FILE *file = cache.Load(name, path);
+  if (file == NULL)
+    return false;
+
+  std::vector<AbstractAirspace *> result;
+  const bool success = ReadAirspaces(file, path, result);
+  fclose(file);
+
+  if (!success) {
+    for (auto i = result.begin(), end = result.end(); i != end; ++i)
+      delete *i;
+
+    cache.Flush(name);
+    return false;
+  }
+
+  for (auto i = result.begin(), end = result.end(); i != end; ++i)
+    airspaces.Add(*i);
+
+  return true;
+}
+
+static bool
+WriteString(FILE *file, const tstring &value)
+{
+  return value.empty() ||
+    fwrite(value.data(), sizeof(value[0]), value.length(),
+           file) == value.length();
+}
+
+static bool
+WriteRecord(FILE *file, const AbstractAirspace &as)
+{
+  const tstring name(as.GetName());
+  const tstring &radio = as.GetRadio();
+  if (name.length() > MAX_STRING_LENGTH || radio.length() > MAX_STRING_LENGTH)
+    return false;
+
+  AirspaceCacheRecord record;
+  memset((void *)&record, 0, sizeof(record));
+  record.base = as.GetBase();
+  record.top = as.GetTop();
+  record.days = as.GetDays();
+  record.name_length = name.length();
+  record.radio_length = radio.length();
+  record.shape = as.GetShape();
+  record.type = as.GetType();
+
+  if (as.GetShape() == AbstractAirspace::Shape::CIRCLE) {
+    const AirspaceCircle &circle = (const AirspaceCircle &)as;
+    record.center = circle.GetCenter();
+    record.radius = circle.GetRadius();
+  }
+
+  if (fwrite(&record, sizeof(record), 1, file) != 1 ||
+      !WriteString(file, name) || !WriteString(file, radio))
+    return false;
+
+  return as.GetShape() != AbstractAirspace::Shape::POLYGON ||
+    ((const AirspacePolygon &)as).SaveCache(file);
+}
+
+bool
+SaveAirspaceCache(const Airspaces &airspaces, unsigned first,
+                  FileCache &cache, const TCHAR *name, const TCHAR *path)
+{
+  const std::deque<AbstractAirspace *> &pending = airspaces.GetPending();
+  assert(first <= pending.size());
+
+  const tstring source(path);
+  if (source.length() > MAX_STRING_LENGTH)
+    return false;
+
+  FILE *file = cache.Save(name, path);
+  if (file == NULL)
+    return false;
+
+  AirspaceCacheHeader header;
+  memset(&header, 0, sizeof(header));
+  header.magic = AirspaceCacheHeader::MAGIC;
+  header.version = AirspaceCacheHeader::VERSION;
+  header.layout = GetLayout();
+  header.num_airspaces = pending.size() - first;
+  header.path_length = source.length();
+
+  bool success = fwrite(&header, sizeof(header), 1, file) == 1 &&
+    WriteString(file, source);
+  for (auto i = pending.begin() + first, end = pending.end();
+       success && i != end; ++i)
+    success = WriteRecord(file, **i);
+
+  if (!success) {
+    cache.Cancel(name, file);
+    return false;
+  }
+
+  return cache.Commit(name, file);
+}
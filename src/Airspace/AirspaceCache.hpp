@@ -0,0 +1,57 @@
+/*
+Copyright_License {
+
+  XCSoar Glide Computer - http://www.xcsoar.org/
+  Copyright (C) 2000-2012 The XCSoar Project
+  A detailed list of copyright holders can be found in the file "AUTHORS".
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+}
+*/
+
+#ifndef XCSOAR_AIRSPACE_CACHE_HPP
+#define XCSOAR_AIRSPACE_CACHE_HPP
+
+#include <tchar.h>
+
+class Airspaces;
+class FileCache;
+
+/**
+ * Load the airspaces which were parsed from the specified file from
+ * a binary cache file, and add them to the container.  The cache
+ * contains the final shapes (the arcs are already evaluated),
+ * altitudes, classes and names; it is stale when the size or the
+ * modification time of the file has changed.
+ *
+ * @param name the name of the cache file
+ * @return false if the cache file is missing, stale or corrupt; the
+ * container is not modified in this case
+ */
+bool
+LoadAirspaceCache(Airspaces &airspaces, FileCache &cache,
+                  const TCHAR *name, const TCHAR *path);
+
+/**
+ * Write the airspaces which were just parsed from the specified file
+ * to a binary cache file.  These are the pending airspaces of the
+ * container (see Airspaces::GetPending()), starting at the specified
+ * index.
+ */
+bool
+SaveAirspaceCache(const Airspaces &airspaces, unsigned first,
+                  FileCache &cache, const TCHAR *name, const TCHAR *path);
+
+#endif
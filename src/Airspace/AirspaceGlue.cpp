@@ -23,6 +23,7 @@ Copyright_License {
 
 #include "Airspace/AirspaceGlue.hpp"
 #include "Airspace/AirspaceParser.hpp"
+#include "Airspace/AirspaceCache.hpp"
 #include "Engine/Airspace/Airspaces.hpp"
 #include "Profile/ProfileKeys.hpp"
 #include "Terrain/RasterTerrain.hpp"
@@ -53,10 +54,36 @@ ParseAirspaceFile(AirspaceParser &parser, const TCHAR *path,
   return true;
 }
 
+/**
+ * Load an airspace file from the cache, or parse it and write a new
+ * cache file.
+ */
+static bool
+LoadAirspaceFile(Airspaces &airspaces, AirspaceParser &parser,
+                 FileCache *cache, const TCHAR *cache_name,
+                 const TCHAR *path, OperationEnvironment &operation)
+{
+  if (cache == NULL)
+    return ParseAirspaceFile(parser, path, operation);
+
+  if (LoadAirspaceCache(airspaces, *cache, cache_name, path))
+    return true;
+
+  const unsigned first = airspaces.GetPending().size();
+  if (!ParseAirspaceFile(parser, path, operation))
+    return false;
+
+  if (!SaveAirspaceCache(airspaces, first, *cache, cache_name, path))
+    LogStartUp(_T("Failed to write airspace cache: %s"), path);
+
+  return true;
+}
+
 void
 ReadAirspace(Airspaces &airspaces,
              RasterTerrain *terrain,
              const AtmosphericPressure &press,
+             FileCache *cache,
              OperationEnvironment &operation)
 {
   LogStartUp(_T("ReadAirspace"));
@@ -69,14 +96,17 @@ ReadAirspace(Airspaces &airspaces,
   // Read the airspace filenames from the registry
   TCHAR path[MAX_PATH];
   if (Profile::GetPath(szProfileAirspaceFile, path))
-    airspace_ok |= ParseAirspaceFile(parser, path, operation);
+    airspace_ok |= LoadAirspaceFile(airspaces, parser, cache,
+                                    _T("airspace-1"), path, operation);
 
   if (Profile::GetPath(szProfileAdditionalAirspaceFile, path))
-    airspace_ok |= ParseAirspaceFile(parser, path, operation);
+    airspace_ok |= LoadAirspaceFile(airspaces, parser, cache,
+                                    _T("airspace-2"), path, operation);
 
   if (Profile::GetPath(szProfileMapFile, path)) {
     _tcscat(path, _T("/airspace.txt"));
-    airspace_ok |= ParseAirspaceFile(parser, path, operation);
+    airspace_ok |= LoadAirspaceFile(airspaces, parser, cache,
+                                    _T("airspace-map"), path, operation);
   }
 
   if (airspace_ok) {
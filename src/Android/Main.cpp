@@ -55,6 +55,7 @@ Copyright_License {
 #include "Compiler.h"
 #include "org_xcsoar_NativeView.h"
 #include "IO/Async/GlobalIOThread.hpp"
+#include "Thread/ThreadPool.hpp"
 
 #ifdef IOIOLIB
 #include "Android/IOIOHelper.hpp"
@@ -96,6 +97,7 @@ Java_org_xcsoar_NativeView_initializeNative(JNIEnv *env, jobject obj,
                                             jint sdk_version, jstring product)
 {
   InitialiseIOThread();
+  InitialiseSharedThreadPool();
 
   Java::Init(env);
   Java::File::Initialise(env);
@@ -201,6 +203,7 @@ Java_org_xcsoar_NativeView_deinitializeNative(JNIEnv *env, jobject obj)
   Environment::Deinitialise(env);
   Java::URL::Deinitialise(env);
 
+  DeinitialiseSharedThreadPool();
   DeinitialiseIOThread();
 }
 
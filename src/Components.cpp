@@ -52,6 +52,7 @@ Copyright_License {
 #include "Logger/GlueFlightLogger.hpp"
 #include "Waypoint/WaypointDetailsReader.hpp"
 #include "Screen/Fonts.hpp"
+#include "Screen/Layout.hpp"
 #include "Blackboard/DeviceBlackboard.hpp"
 #include "MapWindow/GlueMapWindow.hpp"
 #include "Markers/Markers.hpp"
@@ -368,8 +369,8 @@ XCSoarInterface::Startup()
   task_manager->SetGlidePolar(gp);
 
   // Read the topography file(s)
-  topography = new TopographyStore();
-  LoadConfiguredTopography(*topography, operation);
+  topography = new TopographyStore(Layout::Scale(1));
+  LoadConfiguredTopography(*topography, file_cache, operation);
 
   // Read the waypoint files
   WaypointGlue::LoadWaypoints(way_points, terrain, operation);
@@ -391,7 +392,7 @@ XCSoarInterface::Startup()
 
   // Reads the airspace files
   ReadAirspace(airspace_database, terrain, GetComputerSettings().pressure,
-               operation);
+               file_cache, operation);
 
   {
     const AircraftState aircraft_state =
@@ -593,6 +594,17 @@ XCSoarInterface::Shutdown()
   // Clear terrain database
   LogStartUp(_T("CloseTerrain"));
 
+  if (terrain != NULL) {
+    const RasterTileCache::Statistics stats = terrain->GetTileStatistics();
+    LogStartUp(_T("Terrain tiles: %u hits, %u misses, %u restored, %u evicted, ")
+               _T("%u prefetched (%u used), ")
+               _T("%u ms decoding, %u tiles (%u kB) resident"),
+               stats.hits, stats.misses, stats.restored, stats.evictions,
+               stats.prefetched, stats.prefetch_hits,
+               (unsigned)(stats.decode_us / 1000),
+               stats.resident_tiles, (unsigned)(stats.resident_bytes >> 10));
+  }
+
   delete terrain;
 
   LogStartUp(_T("CloseTopography"));
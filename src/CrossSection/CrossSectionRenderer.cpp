@@ -104,15 +104,8 @@ CrossSectionRenderer::UpdateTerrain(short *elevations) const
   if (terrain == NULL)
     return;
 
-  const GeoPoint point_diff = vec.EndPoint(start) - start;
-
   RasterTerrain::Lease map(*terrain);
-  for (unsigned i = 0; i < NUM_SLICES; ++i) {
-    const fixed slice_distance_factor = fixed(i) / (NUM_SLICES - 1);
-    const GeoPoint slice_point = start + point_diff * slice_distance_factor;
-
-    elevations[i] = map->GetHeight(slice_point);
-  }
+  map->GetHeights(start, vec.EndPoint(start), elevations, NUM_SLICES);
 }
 
 void
@@ -39,9 +39,13 @@ AbstractAirspace::~AbstractAirspace() {}
 bool
 AbstractAirspace::Inside(const AircraftState &state) const
 {
-  return altitude_base.IsBelow(state) &&
-         altitude_top.IsAbove(state) &&
-         Inside(state.location);
+  return InsideVertical(state) && Inside(state.location);
+}
+
+bool
+AbstractAirspace::InsideVertical(const AircraftState &state) const
+{
+  return altitude_base.IsBelow(state) && altitude_top.IsAbove(state);
 }
 
 void 
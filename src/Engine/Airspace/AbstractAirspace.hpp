@@ -133,6 +133,15 @@ public:
   gcc_pure
   virtual bool Inside(const AircraftState &state) const;
 
+  /**
+   * Checks whether an observer is between the base and the top of the
+   * airspace (the lateral boundary is not taken into account)
+   *
+   * @param state State about which to test inclusion
+   */
+  gcc_pure
+  bool InsideVertical(const AircraftState &state) const;
+
   /** 
    * Checks whether a line intersects with the airspace.
    * Can be approximate by using flat-earth representation internally.
@@ -222,6 +231,10 @@ public:
     days_of_operation = mask;
   }
 
+  const AirspaceActivity &GetDays() const {
+    return days_of_operation;
+  }
+
   /** 
    * Get type of airspace
    * 
@@ -324,6 +337,10 @@ public:
   gcc_pure
   const tstring GetRadioText() const;
 
+  const tstring &GetRadio() const {
+    return radio;
+  }
+
   /**
    * Accessor for airspace shape
    *
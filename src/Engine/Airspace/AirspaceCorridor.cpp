@@ -0,0 +1,96 @@
+/* Copyright_License {
+
+  XCSoar Glide Computer - http://www.xcsoar.org/
+  Copyright (C) 2000-2012 The XCSoar Project
+  A detailed list of copyright holders can be found in the file "AUTHORS".
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+}
+ */
+
+#include "AirspaceCorridor.hpp"
+
+class CandidateCollector {
+  AirspacesInterface::AirspaceVector &candidates;
+
+public:
+  CandidateCollector(AirspacesInterface::AirspaceVector &_candidates)
+    :candidates(_candidates) {}
+
+  void operator()(const Airspace &as) {
+    candidates.push_back(as);
+  }
+};
+
+void
+AirspaceCorridor::Clear()
+{
+  defined = false;
+  have_required = false;
+  have_inside = false;
+  candidates.clear();
+}
+
+void
+AirspaceCorridor::Require(const AirspacesInterface::AirspaceTree &tree,
+                          Serial _serial,
+                          const FlatBoundingBox &query, unsigned margin)
+{
+  if (_serial != serial) {
+    /* the airspaces have been modified; the candidates may be
+       dangling */
+    serial = _serial;
+    defined = false;
+  }
+
+  if (have_required)
+    required.Merge(query);
+  else {
+    required = query;
+    have_required = true;
+  }
+
+  if (defined && box.IsInside(query))
+    return;
+
+  box = required;
+  box.Grow(margin);
+  defined = true;
+
+  candidates.clear();
+  CandidateCollector collector(candidates);
+  tree.VisitOverlapping(box, collector);
+  have_inside = false;
+
+  ++n_refreshes;
+}
+
+const AirspacesInterface::AirspaceVector &
+AirspaceCorridor::FindLateralInside(const GeoPoint &location,
+                                    const FlatBoundingBox &query)
+{
+  if (have_inside && location == inside_location)
+    return inside;
+
+  inside.clear();
+  n_tested += candidates.size();
+  for (auto i = candidates.begin(), end = candidates.end(); i != end; ++i)
+    if (i->Overlaps(query) && i->IsInside(location))
+      inside.push_back(*i);
+
+  inside_location = location;
+  have_inside = true;
+  return inside;
+}
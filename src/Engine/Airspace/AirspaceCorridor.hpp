@@ -0,0 +1,154 @@
+/* Copyright_License {
+
+  XCSoar Glide Computer - http://www.xcsoar.org/
+  Copyright (C) 2000-2012 The XCSoar Project
+  A detailed list of copyright holders can be found in the file "AUTHORS".
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+}
+ */
+#ifndef AIRSPACE_CORRIDOR_HPP
+#define AIRSPACE_CORRIDOR_HPP
+
+#include "AirspacesInterface.hpp"
+#include "Util/Serial.hpp"
+
+/**
+ * A cached set of candidate airspaces for a series of queries which
+ * move only a little between calls, e.g. the predictions of the
+ * #AirspaceWarningManager.
+ *
+ * The candidates are all airspaces whose envelope overlaps a
+ * corridor box, which covers all query boxes of one cycle plus a
+ * margin.  They are collected from the #Airspaces tree only when a
+ * query leaves the corridor, or when the #Airspaces have been
+ * modified.  The candidates are kept in the order in which the tree
+ * visits them, so a query on the corridor visits the same airspaces
+ * in the same order as a query on the tree.
+ */
+class AirspaceCorridor {
+  /**
+   * The #Airspaces serial at the time the candidates were collected.
+   */
+  Serial serial;
+
+  bool defined;
+
+  /**
+   * The area covered by #candidates.
+   */
+  FlatBoundingBox box;
+
+  /**
+   * The union of all query boxes since BeginCycle().
+   */
+  FlatBoundingBox required;
+  bool have_required;
+
+  AirspacesInterface::AirspaceVector candidates;
+
+  /**
+   * The candidates whose lateral boundary encloses #inside_location,
+   * which is the location of all "inside" queries of one cycle.
+   */
+  AirspacesInterface::AirspaceVector inside;
+  GeoPoint inside_location;
+  bool have_inside;
+
+  unsigned n_refreshes;
+  mutable unsigned n_tested;
+
+public:
+  /**
+   * The margin [m] added around the query boxes when the candidates
+   * are collected.
+   */
+  static const unsigned MARGIN = 2000;
+
+  AirspaceCorridor()
+    :defined(false), have_required(false), have_inside(false),
+     n_refreshes(0), n_tested(0) {}
+
+  /**
+   * Discard the candidates.  They will be collected again by the
+   * next query.
+   */
+  void Clear();
+
+  /**
+   * Start a new cycle of queries.  The next refresh will cover only
+   * the query boxes of this cycle.
+   */
+  void BeginCycle() {
+    have_required = false;
+    n_tested = 0;
+  }
+
+  /**
+   * Ensure that the candidates cover the specified query box,
+   * collecting them again from the tree if necessary.
+   *
+   * @param serial the current serial of the #Airspaces owning the
+   * tree
+   * @param margin the margin in flat projected units
+   */
+  void Require(const AirspacesInterface::AirspaceTree &tree, Serial serial,
+               const FlatBoundingBox &query, unsigned margin);
+
+  /**
+   * Invoke the visitor with each candidate whose envelope overlaps
+   * the specified box.  The box must have been passed to Require()
+   * before.
+   */
+  template<typename V>
+  void VisitOverlapping(const FlatBoundingBox &query, V &visitor) const {
+    n_tested += candidates.size();
+
+    for (auto i = candidates.begin(), end = candidates.end(); i != end; ++i)
+      if (i->Overlaps(query))
+        visitor(*i);
+  }
+
+  /**
+   * Returns the candidates whose lateral boundary encloses the
+   * location, in the same order as VisitOverlapping().  The result of
+   * the previous call is reused if the location has not changed.
+   *
+   * @param box the envelope of the location, which must have been
+   * passed to Require() before
+   */
+  const AirspacesInterface::AirspaceVector &
+  FindLateralInside(const GeoPoint &location, const FlatBoundingBox &box);
+
+  /**
+   * The number of times the candidates were collected from the tree.
+   */
+  unsigned GetRefreshCount() const {
+    return n_refreshes;
+  }
+
+  unsigned GetCandidateCount() const {
+    return candidates.size();
+  }
+
+  /**
+   * The number of airspace envelopes tested since BeginCycle().
+   */
+  unsigned GetTestedCount() const {
+    return n_tested;
+  }
+};
+
+#endif
@@ -27,6 +27,13 @@
 #include "AirspaceIntersectionVector.hpp"
 
 #include <assert.h>
+#include <stdint.h>
+
+/**
+ * Limit for the number of border points in a cache file, which
+ * protects from allocating a huge buffer for a corrupt file.
+ */
+static const unsigned MAX_CACHE_POINTS = 1 << 20;
 
 AirspacePolygon::AirspacePolygon(const std::vector<GeoPoint> &pts,
                                  const bool prune)
@@ -54,7 +61,53 @@ AirspacePolygon::AirspacePolygon(const std::vector<GeoPoint> &pts,
     } else {
       m_is_convex = m_border.IsConvex();
     }
+
+    index.Build(m_border);
+  }
+}
+
+bool
+AirspacePolygon::SaveCache(FILE *file) const
+{
+  const uint32_t num_points = m_border.size();
+  const uint8_t convex = m_is_convex;
+  if (fwrite(&num_points, sizeof(num_points), 1, file) != 1 ||
+      fwrite(&convex, sizeof(convex), 1, file) != 1)
+    return false;
+
+  for (auto i = m_border.begin(), end = m_border.end(); i != end; ++i) {
+    const GeoPoint &location = i->get_location();
+    if (fwrite(&location, sizeof(location), 1, file) != 1)
+      return false;
   }
+
+  return index.SaveCache(file);
+}
+
+bool
+AirspacePolygon::LoadCache(FILE *file)
+{
+  uint32_t num_points;
+  uint8_t convex;
+  if (fread(&num_points, sizeof(num_points), 1, file) != 1 ||
+      num_points > MAX_CACHE_POINTS ||
+      fread(&convex, sizeof(convex), 1, file) != 1)
+    return false;
+
+  std::vector<GeoPoint> points(num_points);
+  if (num_points > 0 &&
+      fread(points.data(), sizeof(points.front()), num_points,
+            file) != num_points)
+    return false;
+
+  m_border.clear();
+  m_border.reserve(num_points);
+  for (auto i = points.begin(), end = points.end(); i != end; ++i)
+    m_border.push_back(SearchPoint(*i));
+
+  m_is_convex = convex != 0;
+
+  return index.LoadCache(file, num_points);
 }
 
 const GeoPoint 
@@ -69,6 +122,9 @@ AirspacePolygon::GetCenter() const
 bool 
 AirspacePolygon::Inside(const GeoPoint &loc) const
 {
+  if (index.IsDefined())
+    return index.IsInside(loc, m_border);
+
   return m_border.IsInside(loc);
 }
 
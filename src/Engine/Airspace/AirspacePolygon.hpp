@@ -24,8 +24,12 @@
 #define AIRSPACEPOLYGON_HPP
 
 #include "AbstractAirspace.hpp"
+#include "Geo/ConvexHull/PolygonInteriorIndex.hpp"
+
 #include <vector>
 
+#include <stdio.h>
+
 #ifdef DO_PRINT
 #include <iostream>
 #endif
@@ -34,6 +38,11 @@
 class AirspacePolygon: 
   public AbstractAirspace 
 {
+  /**
+   * Speeds up Inside() for polygons with many vertices.
+   */
+  PolygonInteriorIndex index;
+
 public:
   /** 
    * Constructor.  For testing, pts vector is a cloud of points,
@@ -46,6 +55,25 @@ public:
    */
   AirspacePolygon(const std::vector<GeoPoint> &pts, const bool prune = false);
 
+  /**
+   * Constructor for an empty polygon, to be filled by LoadCache().
+   */
+  AirspacePolygon():AbstractAirspace(Shape::POLYGON) {
+    m_is_convex = true;
+  }
+
+  /**
+   * Write the border, its convexity and the interior index to a
+   * cache file.  The other attributes are not saved.
+   */
+  bool SaveCache(FILE *file) const;
+
+  /**
+   * Restore the border which was saved by SaveCache(), without
+   * calculating the convexity and the interior index again.
+   */
+  bool LoadCache(FILE *file);
+
   /**
    * Get arbitrary center or reference point for use in determining
    * overall center location of all airspaces
@@ -0,0 +1,117 @@
+/* Copyright_License {
+
+  XCSoar Glide Computer - http://www.xcsoar.org/
+  Copyright (C) 2000-2012 The XCSoar Project
+  A detailed list of copyright holders can be found in the file "AUTHORS".
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+}
+ */
+
+#include "AirspaceRTree.hpp"
+
+#include <math.h>
+#include <assert.h>
+
+struct CompareCenterLongitude {
+  bool operator()(const Airspace &a, const Airspace &b) const {
+    return a.GetCenter().Longitude < b.GetCenter().Longitude;
+  }
+};
+
+struct CompareCenterLatitude {
+  bool operator()(const Airspace &a, const Airspace &b) const {
+    return a.GetCenter().Latitude < b.GetCenter().Latitude;
+  }
+};
+
+void
+AirspaceRTree::Build(std::vector<Airspace> &new_items)
+{
+  items.clear();
+  items.swap(new_items);
+
+  SortTileRecursive();
+  BuildNodes();
+}
+
+void
+AirspaceRTree::clear()
+{
+  items.clear();
+  nodes.clear();
+  levels.clear();
+}
+
+void
+AirspaceRTree::SortTileRecursive()
+{
+  const unsigned n = items.size();
+  if (n <= NODE_SIZE)
+    return;
+
+  /* cut the area into vertical slices of roughly sqrt(n/NODE_SIZE)
+     nodes each, and then cut each slice into nodes */
+
+  const unsigned n_leaves = (n + NODE_SIZE - 1) / NODE_SIZE;
+  const unsigned n_slices = (unsigned)ceil(sqrt((double)n_leaves));
+  const unsigned slice_size = ((n_leaves + n_slices - 1) / n_slices) * NODE_SIZE;
+
+  std::sort(items.begin(), items.end(), CompareCenterLongitude());
+
+  for (unsigned i = 0; i < n; i += slice_size) {
+    const auto begin = items.begin() + i;
+    const auto end = items.begin() + std::min(i + slice_size, n);
+    std::sort(begin, end, CompareCenterLatitude());
+  }
+}
+
+void
+AirspaceRTree::BuildNodes()
+{
+  nodes.clear();
+  levels.clear();
+
+  unsigned level_size = items.size(), total = 0;
+  while (level_size > NODE_SIZE) {
+    level_size = (level_size + NODE_SIZE - 1) / NODE_SIZE;
+    total += level_size;
+  }
+
+  nodes.reserve(total);
+
+  for (unsigned level = 0; GetLevelSize(level) > NODE_SIZE; ++level) {
+    const unsigned child_size = GetLevelSize(level);
+
+    Level parent;
+    parent.start = nodes.size();
+    parent.size = 0;
+
+    for (unsigned i = 0; i < child_size; i += NODE_SIZE) {
+      const unsigned end = std::min(i + NODE_SIZE, child_size);
+
+      FlatBoundingBox box = GetBox(level, i);
+      for (unsigned j = i + 1; j < end; ++j)
+        box.Merge(GetBox(level, j));
+
+      nodes.push_back(box);
+      ++parent.size;
+    }
+
+    levels.append(parent);
+  }
+
+  assert(nodes.size() == total);
+}
@@ -0,0 +1,236 @@
+/* Copyright_License {
+
+  XCSoar Glide Computer - http://www.xcsoar.org/
+  Copyright (C) 2000-2012 The XCSoar Project
+  A detailed list of copyright holders can be found in the file "AUTHORS".
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+}
+ */
+#ifndef AIRSPACE_RTREE_HPP
+#define AIRSPACE_RTREE_HPP
+
+#include "Airspace.hpp"
+#include "Util/NonCopyable.hpp"
+#include "Util/StaticArray.hpp"
+#include "Compiler.h"
+
+#include <vector>
+#include <algorithm>
+
+#include <stddef.h>
+
+/**
+ * A static R-tree of #Airspace envelopes.  It is bulk-loaded with
+ * the Sort-Tile-Recursive algorithm, and cannot be modified
+ * afterwards; call Build() again to change the contents.
+ *
+ * The envelopes are stored in one contiguous array, which doubles as
+ * the leaf level of the tree.  Each inner node covers up to
+ * #NODE_SIZE consecutive entries of the level below, so no child
+ * pointers are needed.
+ */
+class AirspaceRTree : private NonCopyable {
+  static const unsigned NODE_SIZE = 16;
+
+  /**
+   * Enough levels for 2^32 airspaces.
+   */
+  static const unsigned MAX_LEVELS = 8;
+
+  typedef std::vector<Airspace> ItemVector;
+
+  /**
+   * A level of inner nodes, stored in #nodes.
+   */
+  struct Level {
+    unsigned start, size;
+  };
+
+  /**
+   * A range of up to #NODE_SIZE entries on one level, which remains
+   * to be visited.  Level 0 is #items.
+   */
+  struct Range {
+    unsigned level, begin;
+  };
+
+  typedef StaticArray<Range, NODE_SIZE * (MAX_LEVELS + 1)> RangeStack;
+
+  ItemVector items;
+
+  /**
+   * The bounding boxes of all inner nodes, the lowest level first.
+   */
+  std::vector<FlatBoundingBox> nodes;
+
+  /**
+   * The inner levels, the lowest first.  The top level has no more
+   * than #NODE_SIZE nodes.
+   */
+  StaticArray<Level, MAX_LEVELS> levels;
+
+public:
+  typedef ItemVector::const_iterator const_iterator;
+  typedef ItemVector::size_type size_type;
+
+  /**
+   * Replace the contents of the tree.  The specified vector is moved
+   * into the tree, and will be empty afterwards.
+   */
+  void Build(std::vector<Airspace> &new_items);
+
+  void clear();
+
+  bool empty() const {
+    return items.empty();
+  }
+
+  size_type size() const {
+    return items.size();
+  }
+
+  const_iterator begin() const {
+    return items.begin();
+  }
+
+  const_iterator end() const {
+    return items.end();
+  }
+
+  /**
+   * Returns the approximate amount of memory allocated by this
+   * object.
+   */
+  gcc_pure
+  size_t GetMemoryUsage() const {
+    return items.capacity() * sizeof(items.front()) +
+      nodes.capacity() * sizeof(nodes.front());
+  }
+
+  /**
+   * Invoke the visitor with each airspace whose envelope overlaps the
+   * specified box (including its border), in no particular order.
+   */
+  template<typename V>
+  void VisitOverlapping(const FlatBoundingBox &box, V &visitor) const {
+    if (items.empty())
+      return;
+
+    RangeStack stack;
+    PushTop(stack);
+
+    do {
+      const Range range = stack.last();
+      stack.shrink(stack.size() - 1);
+
+      const unsigned end = GetRangeEnd(range);
+      for (unsigned i = range.begin; i < end; ++i) {
+        if (!GetBox(range.level, i).Overlaps(box))
+          continue;
+
+        if (range.level == 0)
+          visitor(items[i]);
+        else
+          PushChildren(stack, range.level, i);
+      }
+    } while (!stack.empty());
+  }
+
+  /**
+   * Find the airspace whose envelope is nearest to the specified box,
+   * and which matches the predicate.
+   *
+   * @param max_distance ignore airspaces which are farther away
+   * @param distance_r on success, the distance is returned here
+   * @return the airspace or NULL if none was found
+   */
+  template<typename P>
+  const Airspace *FindNearest(const FlatBoundingBox &box,
+                              unsigned max_distance, const P &predicate,
+                              unsigned &distance_r) const {
+    if (items.empty())
+      return NULL;
+
+    const Airspace *nearest = NULL;
+    unsigned nearest_distance = max_distance;
+
+    RangeStack stack;
+    PushTop(stack);
+
+    do {
+      const Range range = stack.last();
+      stack.shrink(stack.size() - 1);
+
+      const unsigned end = GetRangeEnd(range);
+      for (unsigned i = range.begin; i < end; ++i) {
+        const unsigned distance = GetBox(range.level, i).Distance(box);
+        if (distance > nearest_distance ||
+            (nearest != NULL && distance == nearest_distance))
+          continue;
+
+        if (range.level > 0)
+          PushChildren(stack, range.level, i);
+        else if (predicate(items[i])) {
+          nearest = &items[i];
+          nearest_distance = distance;
+        }
+      }
+    } while (!stack.empty());
+
+    if (nearest != NULL)
+      distance_r = nearest_distance;
+    return nearest;
+  }
+
+private:
+  gcc_pure
+  unsigned GetLevelSize(unsigned level) const {
+    return level == 0 ? items.size() : levels[level - 1].size;
+  }
+
+  gcc_pure
+  const FlatBoundingBox &GetBox(unsigned level, unsigned i) const {
+    return level == 0 ? items[i] : nodes[levels[level - 1].start + i];
+  }
+
+  gcc_pure
+  unsigned GetRangeEnd(const Range &range) const {
+    return std::min(range.begin + NODE_SIZE, GetLevelSize(range.level));
+  }
+
+  void PushTop(RangeStack &stack) const {
+    const Range top = { levels.size(), 0 };
+    stack.append(top);
+  }
+
+  static void PushChildren(RangeStack &stack, unsigned level, unsigned i) {
+    const Range children = { level - 1, i * NODE_SIZE };
+    stack.append(children);
+  }
+
+  /**
+   * Sort #items so each group of #NODE_SIZE consecutive items is
+   * compact.
+   */
+  void SortTileRecursive();
+
+  /**
+   * Build the inner levels on top of the sorted #items.
+   */
+  void BuildNodes();
+};
+
+#endif
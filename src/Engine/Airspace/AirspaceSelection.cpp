@@ -0,0 +1,118 @@
+/* Copyright_License {
+
+  XCSoar Glide Computer - http://www.xcsoar.org/
+  Copyright (C) 2000-2012 The XCSoar Project
+  A detailed list of copyright holders can be found in the file "AUTHORS".
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+}
+ */
+
+#include "AirspaceSelection.hpp"
+#include "Airspaces.hpp"
+#include "AbstractAirspace.hpp"
+#include "AirspaceVisitor.hpp"
+#include "AirspaceIntersectionVisitor.hpp"
+#include "Geo/Flat/FlatRay.hpp"
+
+#include <algorithm>
+
+static bool
+CompareAirspace(const Airspace &a, const Airspace &b)
+{
+  return a.GetAirspace() < b.GetAirspace();
+}
+
+bool
+AirspaceSelection::Update(const Airspaces &master,
+                          const GeoPoint &location, fixed range,
+                          const AirspacePredicate &condition)
+{
+  const Airspaces::AirspaceVector contents =
+    master.ScanRange(location, range, condition);
+
+  std::vector<Airspace> selected;
+  selected.reserve(contents.size());
+  for (auto i = contents.begin(), end = contents.end(); i != end; ++i)
+    if (i->GetAirspace()->IsActive())
+      selected.push_back(*i);
+
+  std::sort(selected.begin(), selected.end(), CompareAirspace);
+
+  if (master.GetSerial() != serial) {
+    /* the container has been modified: the old items may have been
+       deleted, and the projection of the envelopes and the
+       clearances may have changed */
+    serial = master.GetSerial();
+    projection = master.GetProjection();
+
+    for (auto i = selected.begin(), end = selected.end(); i != end; ++i)
+      i->ClearClearance();
+
+    items.swap(selected);
+    return true;
+  }
+
+  if (selected == items)
+    return false;
+
+  /* discard the clearances of the airspaces which are no longer
+     selected */
+  for (auto i = items.begin(), end = items.end(); i != end; ++i)
+    if (!std::binary_search(selected.begin(), selected.end(), *i,
+                            CompareAirspace))
+      i->ClearClearance();
+
+  items.swap(selected);
+  return true;
+}
+
+void
+AirspaceSelection::Clear(const Airspaces &master)
+{
+  if (master.GetSerial() == serial)
+    for (auto i = items.begin(), end = items.end(); i != end; ++i)
+      i->ClearClearance();
+
+  items.clear();
+}
+
+void
+AirspaceSelection::VisitWithinRange(const GeoPoint &location, fixed range,
+                                    AirspaceVisitor &visitor) const
+{
+  if (items.empty())
+    return;
+
+  const Airspace bb_target(location, projection, range);
+  for (auto i = items.begin(), end = items.end(); i != end; ++i)
+    if (i->Overlaps(bb_target))
+      visitor.Visit(*i);
+}
+
+void
+AirspaceSelection::VisitIntersecting(const GeoPoint &location,
+                                     const GeoPoint &end,
+                                     AirspaceIntersectionVisitor &visitor) const
+{
+  if (items.empty())
+    return;
+
+  const FlatRay ray(projection.project(location), projection.project(end));
+  for (auto i = items.begin(), e = items.end(); i != e; ++i)
+    if (i->Intersects(ray) &&
+        visitor.SetIntersections(i->Intersects(location, end, projection)))
+      visitor.Visit(*i);
+}
@@ -0,0 +1,117 @@
+/* Copyright_License {
+
+  XCSoar Glide Computer - http://www.xcsoar.org/
+  Copyright (C) 2000-2012 The XCSoar Project
+  A detailed list of copyright holders can be found in the file "AUTHORS".
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+}
+ */
+#ifndef AIRSPACE_SELECTION_HPP
+#define AIRSPACE_SELECTION_HPP
+
+#include "Airspace.hpp"
+#include "Predicate/AirspacePredicate.hpp"
+#include "Util/Serial.hpp"
+#include "Geo/Flat/TaskProjection.hpp"
+#include "Math/fixed.hpp"
+#include "Compiler.h"
+
+#include <vector>
+
+class Airspaces;
+class AirspaceVisitor;
+class AirspaceIntersectionVisitor;
+struct GeoPoint;
+
+/**
+ * A snapshot of a subset of the airspaces of an #Airspaces container,
+ * e.g. those relevant to the #AirspaceRoute.  Unlike a copied
+ * #Airspaces instance, it does not build a tree of its own: it copies
+ * only the envelopes of the selected objects and the container's
+ * projection, and queries scan this list.  They never touch the
+ * container's tree, which may be rebuilt by another thread in the
+ * meantime.
+ *
+ * Modifications of the container are detected with its serial.
+ * After a modification, the old selection may refer to deleted
+ * objects, which are then never dereferenced.
+ */
+class AirspaceSelection {
+  /**
+   * The #Airspaces serial at the time the selection was made.
+   */
+  Serial serial;
+
+  /**
+   * The container's projection at the time the selection was made;
+   * the envelopes were calculated with it.
+   */
+  TaskProjection projection;
+
+  /**
+   * The envelopes of the selected airspaces, sorted by address of
+   * the airspace.
+   */
+  std::vector<Airspace> items;
+
+public:
+  /**
+   * Select all active airspaces within range of the location which
+   * match the specified condition.  The clearance polygons of
+   * airspaces which are no longer selected are discarded.
+   *
+   * This is the only method which reads the container.
+   *
+   * @return true if the selection has changed
+   */
+  bool Update(const Airspaces &master,
+              const GeoPoint &location, fixed range,
+              const AirspacePredicate &condition);
+
+  /**
+   * Empty the selection, and discard the clearance polygons of the
+   * selected airspaces.  Call this before the container is modified.
+   */
+  void Clear(const Airspaces &master);
+
+  unsigned size() const {
+    return items.size();
+  }
+
+  bool empty() const {
+    return items.empty();
+  }
+
+  const TaskProjection &GetProjection() const {
+    return projection;
+  }
+
+  /**
+   * Call the visitor on the selected airspaces within range of the
+   * location.  Works like Airspaces::VisitWithinRange().
+   */
+  void VisitWithinRange(const GeoPoint &location, fixed range,
+                        AirspaceVisitor &visitor) const;
+
+  /**
+   * Call the visitor on the selected airspaces intersected by the
+   * line.  Works like Airspaces::VisitIntersecting().
+   */
+  void VisitIntersecting(const GeoPoint &location, const GeoPoint &end,
+                         AirspaceIntersectionVisitor &visitor) const;
+};
+
+#endif
@@ -39,7 +39,8 @@ AirspaceWarningManager::AirspaceWarningManager(const Airspaces &_airspaces,
    cruise_filter(prediction_time_filter * CRUISE_FILTER_FACT),
    circling_filter(prediction_time_filter),
    perf_cruise(cruise_filter),
-   perf_circling(circling_filter)
+   perf_circling(circling_filter),
+   coherent(true)
 {
 }
 
@@ -53,6 +54,7 @@ void
 AirspaceWarningManager::SetConfig(const AirspaceWarningConfig &_config)
 {
   config = _config;
+  corridor.Clear();
 
   SetPredictionTimeGlide(fixed(config.warning_time));
   SetPredictionTimeFilter(fixed(config.warning_time));
@@ -62,6 +64,7 @@ void
 AirspaceWarningManager::Reset(const AircraftState &state)
 {
   warnings.clear();
+  corridor.Clear();
   cruise_filter.Reset(state);
   circling_filter.Reset(state);
 }
@@ -119,6 +122,8 @@ AirspaceWarningManager::Update(const AircraftState& state,
     return false;
   }
 
+  corridor.BeginCycle();
+
   // save old state
   for (auto it = warnings.begin(), end = warnings.end(); it != end; ++it)
     it->SaveState();
@@ -288,10 +293,17 @@ AirspaceWarningManager::UpdatePredicted(const AircraftState& state,
                                              warning_state, max_time_limit,
                                              ceiling);
 
-  airspaces.VisitIntersecting(state.location, location_predicted, visitor);
+  if (coherent)
+    airspaces.VisitIntersecting(state.location, location_predicted, visitor,
+                                corridor);
+  else
+    airspaces.VisitIntersecting(state.location, location_predicted, visitor);
 
   visitor.SetMode(true);
-  airspaces.VisitInside(state.location, visitor);
+  if (coherent)
+    airspaces.VisitInside(state.location, visitor, corridor);
+  else
+    airspaces.VisitInside(state.location, visitor);
 
   return visitor.Found();
 }
@@ -373,7 +385,12 @@ AirspaceWarningManager::UpdateInside(const AircraftState& state,
 
   AirspacePredicateAircraftInside condition(state);
 
-  Airspaces::AirspaceVector results = airspaces.FindInside(state, condition);
+  /* FindInside() checks the aircraft position itself; in the coherent
+     mode, the condition would only repeat the lateral test which is
+     shared with the predictions */
+  Airspaces::AirspaceVector results = coherent
+    ? airspaces.FindInside(state, AirspacePredicate::always_true, corridor)
+    : airspaces.FindInside(state, condition);
   for (auto it = results.begin(); it != results.end(); ++it) {
     const AbstractAirspace& airspace = *it->GetAirspace();
 
@@ -388,7 +405,8 @@ AirspaceWarningManager::UpdateInside(const AircraftState& state,
     if (warning.IsStateAccepted(AirspaceWarning::WARNING_INSIDE)) {
       GeoPoint c = airspace.ClosestPoint(state.location, GetProjection());
       const AirspaceAircraftPerformanceGlide perf_glide(glide_polar);
-      AirspaceInterceptSolution solution;
+      AirspaceInterceptSolution solution =
+        AirspaceInterceptSolution::Invalid();
       airspace.Intercept(state, c, GetProjection(), perf_glide, solution);
 
       warning.UpdateSolution(AirspaceWarning::WARNING_INSIDE, solution);
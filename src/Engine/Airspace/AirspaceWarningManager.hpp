@@ -26,6 +26,7 @@
 #include "AirspaceWarning.hpp"
 #include "AirspaceWarningConfig.hpp"
 #include "AirspaceAircraftPerformance.hpp"
+#include "AirspaceCorridor.hpp"
 #include "Compiler.h"
 
 #include <list>
@@ -65,6 +66,19 @@ class AirspaceWarningManager:
 
   AirspaceWarningList warnings;
 
+  /**
+   * Use the #corridor instead of querying the whole airspace tree in
+   * each update?
+   */
+  bool coherent;
+
+  /**
+   * The candidates for the queries of the coherent mode.  They are
+   * collected again only when a prediction leaves the corridor, when
+   * the airspaces are modified or when the configuration changes.
+   */
+  AirspaceCorridor corridor;
+
 public:
   typedef AirspaceWarningList::const_iterator const_iterator;
 
@@ -114,6 +128,23 @@ public:
               const TaskStats &task_stats,
               const bool circling, const unsigned dt);
 
+  /**
+   * Enable or disable the coherent mode.  The warnings are the same
+   * in both modes.
+   */
+  void SetCoherent(bool _coherent) {
+    coherent = _coherent;
+    corridor.Clear();
+  }
+
+  /**
+   * Returns the candidate set of the coherent mode, e.g. for its
+   * statistics.
+   */
+  const AirspaceCorridor &GetCorridor() const {
+    return corridor;
+  }
+
   /**
    * Adjust time of glide predictor
    *
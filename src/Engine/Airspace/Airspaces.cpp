@@ -23,9 +23,14 @@
 #include "Airspaces.hpp"
 #include "AirspaceVisitor.hpp"
 #include "AirspaceIntersectionVisitor.hpp"
+#include "AirspaceCorridor.hpp"
 #include "Atmosphere/Pressure.hpp"
 #include "Navigation/Aircraft.hpp"
 
+#include <algorithm>
+
+#include <limits.h>
+
 #ifdef INSTRUMENT_TASK
 extern unsigned n_queries;
 extern long count_intersections;
@@ -40,7 +45,7 @@ public:
                                   AirspaceVisitor &_visitor)
     :predicate(&_predicate), visitor(&_visitor) {}
 
-  void operator()(Airspace as) {
+  void operator()(const Airspace &as) {
     AbstractAirspace &aas = *as.GetAirspace();
     if (predicate->operator()(aas))
       visitor->Visit(as);
@@ -56,10 +61,9 @@ Airspaces::VisitWithinRange(const GeoPoint &location, fixed range,
     // nothing to do
     return;
 
-  Airspace bb_target(location, task_projection);
-  int projected_range = task_projection.project_range(location, range);
+  const Airspace bb_target(location, task_projection, range);
   AirspacePredicateVisitorAdapter adapter(predicate, visitor);
-  airspace_tree.visit_within_range(bb_target, -projected_range, adapter);
+  airspace_tree.VisitOverlapping(bb_target, adapter);
 
 #ifdef INSTRUMENT_TASK
   n_queries++;
@@ -71,18 +75,21 @@ class IntersectingAirspaceVisitorAdapter {
   const TaskProjection *projection;
   FlatRay ray;
   AirspaceIntersectionVisitor *visitor;
+  const AirspacePredicate *predicate;
 
 public:
   IntersectingAirspaceVisitorAdapter(const GeoPoint &_loc,
                                      const GeoPoint &_end,
                                      const TaskProjection &_projection,
-                                     AirspaceIntersectionVisitor &_visitor)
+                                     AirspaceIntersectionVisitor &_visitor,
+                                     const AirspacePredicate &_predicate =
+                                           AirspacePredicate::always_true)
     :start(_loc), end(_end), projection(&_projection),
      ray(projection->project(start), projection->project(end)),
-     visitor(&_visitor) {}
+     visitor(&_visitor), predicate(&_predicate) {}
 
-  void operator()(Airspace as) {
-    if (as.Intersects(ray) &&
+  void operator()(const Airspace &as) {
+    if (as.Intersects(ray) && predicate->operator()(*as.GetAirspace()) &&
         visitor->SetIntersections(as.Intersects(start, end, *projection)))
       visitor->Visit(as);
   }
@@ -90,25 +97,68 @@ public:
 
 void 
 Airspaces::VisitIntersecting(const GeoPoint &loc, const GeoPoint &end,
-                             AirspaceIntersectionVisitor& visitor) const
+                             AirspaceIntersectionVisitor& visitor,
+                             const AirspacePredicate &predicate) const
 {
   if (empty())
     // nothing to do
     return;
 
   const GeoPoint c = loc.Middle(end);
-  Airspace bb_target(c, task_projection);
-  int projected_range = task_projection.project_range(c, loc.Distance(end) / 2);
-  IntersectingAirspaceVisitorAdapter adapter(loc, end, task_projection, visitor);
-  airspace_tree.visit_within_range(bb_target, -projected_range, adapter);
+  const Airspace bb_target(c, task_projection, loc.Distance(end) / 2);
+  IntersectingAirspaceVisitorAdapter adapter(loc, end, task_projection,
+                                             visitor, predicate);
+  airspace_tree.VisitOverlapping(bb_target, adapter);
 
 #ifdef INSTRUMENT_TASK
   n_queries++;
 #endif
 }
 
+void
+Airspaces::VisitIntersecting(const GeoPoint &loc, const GeoPoint &end,
+                             AirspaceIntersectionVisitor &visitor,
+                             AirspaceCorridor &corridor) const
+{
+  if (empty())
+    // nothing to do
+    return;
+
+  const GeoPoint c = loc.Middle(end);
+  const Airspace bb_target(c, task_projection, loc.Distance(end) / 2);
+  RequireCorridor(corridor, c, bb_target);
+
+  IntersectingAirspaceVisitorAdapter adapter(loc, end, task_projection, visitor);
+  corridor.VisitOverlapping(bb_target, adapter);
+}
+
+void
+Airspaces::RequireCorridor(AirspaceCorridor &corridor,
+                           const GeoPoint &location,
+                           const FlatBoundingBox &box) const
+{
+  const unsigned margin =
+    task_projection.project_range(location, fixed(AirspaceCorridor::MARGIN));
+  corridor.Require(airspace_tree, serial, box, margin);
+}
+
 // SCAN METHODS
 
+/**
+ * Copies all visited airspaces into a vector.
+ */
+class AirspaceCollector {
+  Airspaces::AirspaceVector &vectors;
+
+public:
+  AirspaceCollector(Airspaces::AirspaceVector &_vectors)
+    :vectors(_vectors) {}
+
+  void operator()(const Airspace &as) {
+    vectors.push_back(as);
+  }
+};
+
 struct AirspacePredicateAdapter {
   const AirspacePredicate &condition;
 
@@ -130,11 +180,9 @@ Airspaces::FindNearest(const GeoPoint &location,
   const Airspace bb_target(location, task_projection);
   int projected_range = task_projection.project_range(location, fixed(30000));
   const AirspacePredicateAdapter predicate(condition);
-  std::pair<AirspaceTree::const_iterator, AirspaceTree::distance_type> found =
-    airspace_tree.find_nearest_if(bb_target, BBDist(0, projected_range),
-                                  predicate);
-
-  return found.first != airspace_tree.end() ? &*found.first : NULL;
+  unsigned distance;
+  return airspace_tree.FindNearest(bb_target, projected_range, predicate,
+                                   distance);
 }
 
 const Airspaces::AirspaceVector
@@ -147,22 +195,25 @@ Airspaces::ScanNearest(const GeoPoint &location,
 
   Airspace bb_target(location, task_projection);
 
-  std::pair<AirspaceTree::const_iterator, AirspaceTree::distance_type>
-    found = airspace_tree.find_nearest(bb_target);
+  unsigned distance;
+  const Airspace *found =
+    airspace_tree.FindNearest(bb_target, UINT_MAX,
+                              AirspacePredicateAdapter(AirspacePredicate::always_true),
+                              distance);
 
 #ifdef INSTRUMENT_TASK
   n_queries++;
 #endif
 
   AirspaceVector res;
-  if (found.first != airspace_tree.end()) {
+  if (found != NULL) {
     // also should do scan_range with range = 0 since there
     // could be more than one with zero dist
-    if (found.second.is_zero())
+    if (distance == 0)
       return ScanRange(location, fixed_zero, condition);
 
-    if (condition(*found.first->GetAirspace()))
-      res.push_back(*found.first);
+    if (condition(*found->GetAirspace()))
+      res.push_back(*found);
   }
 
   return res;
@@ -177,11 +228,11 @@ Airspaces::ScanRange(const GeoPoint &location, fixed range,
     return AirspaceVector();
 
   Airspace bb_target(location, task_projection);
-  int projected_range = task_projection.project_range(location, range);
-  
-  std::deque< Airspace > vectors;
-  airspace_tree.find_within_range(bb_target, -projected_range,
-                                  std::back_inserter(vectors));
+  const Airspace bb_range(location, task_projection, range);
+
+  AirspaceVector vectors;
+  AirspaceCollector collector(vectors);
+  airspace_tree.VisitOverlapping(bb_range, collector);
 
 #ifdef INSTRUMENT_TASK
   n_queries++;
@@ -210,7 +261,8 @@ Airspaces::FindInside(const AircraftState &state,
   Airspace bb_target(state.location, task_projection);
 
   AirspaceVector vectors;
-  airspace_tree.find_within_range(bb_target, 0, std::back_inserter(vectors));
+  AirspaceCollector collector(vectors);
+  airspace_tree.VisitOverlapping(bb_target, collector);
 
 #ifdef INSTRUMENT_TASK
   n_queries++;
@@ -231,9 +283,33 @@ Airspaces::FindInside(const AircraftState &state,
   return vectors;
 }
 
+const Airspaces::AirspaceVector
+Airspaces::FindInside(const AircraftState &state,
+                      const AirspacePredicate &condition,
+                      AirspaceCorridor &corridor) const
+{
+  Airspace bb_target(state.location, task_projection);
+  RequireCorridor(corridor, state.location, bb_target);
+
+  /* the lateral test is shared with VisitInside() */
+  const AirspaceVector &lateral =
+    corridor.FindLateralInside(state.location, bb_target);
+
+  AirspaceVector vectors;
+  for (auto v = lateral.begin(); v != lateral.end(); ++v) {
+    const AbstractAirspace &airspace = *v->GetAirspace();
+    if (condition(airspace) && airspace.InsideVertical(state))
+      vectors.push_back(*v);
+  }
+
+  return vectors;
+}
+
 void 
 Airspaces::Optimise()
 {
+  AirspaceVector items;
+
   if (!owns_children || task_projection.update_fast()) {
     // dont update task_projection if not owner!
 
@@ -244,15 +320,20 @@ Airspaces::Optimise()
       tmp_as.push_back(it->GetAirspace());
 
     airspace_tree.clear();
-  }
+  } else if (!tmp_as.empty())
+    /* the tree is static; rebuild it with the existing envelopes
+       and the new ones */
+    items.assign(airspace_tree.begin(), airspace_tree.end());
 
   if (!tmp_as.empty()) {
+    items.reserve(items.size() + tmp_as.size());
     while (!tmp_as.empty()) {
-      Airspace as(*tmp_as.front(), task_projection);
-      airspace_tree.insert(as);
+      items.push_back(Airspace(*tmp_as.front(), task_projection));
       tmp_as.pop_front();
     }
-    airspace_tree.optimise();
+
+    airspace_tree.Build(items);
+    ++serial;
   }
 }
 
@@ -303,6 +384,7 @@ Airspaces::clear()
 
   // then delete the tree
   airspace_tree.clear();
+  ++serial;
 }
 
 unsigned
@@ -372,63 +454,64 @@ Airspaces::ClearClearances()
 }
 
 
+static bool
+CompareAirspace(const Airspace &a, const Airspace &b)
+{
+  return a.GetAirspace() < b.GetAirspace();
+}
+
 bool
 Airspaces::SynchroniseInRange(const Airspaces& master,
                                 const GeoPoint &location,
                                 const fixed range,
                                 const AirspacePredicate &condition)
 {
-  bool changed = false;
   const AirspaceVector contents_master = master.ScanRange(location, range, condition);
-  AirspaceVector contents_self;
-  contents_self.reserve(max(airspace_tree.size(), contents_master.size()));
 
   task_projection = master.task_projection; // ensure these are up to date
 
-  for (auto t = airspace_tree.begin(); t != airspace_tree.end(); ++t)
-    contents_self.push_back(*t);
+  // sorted, so the master's items can be looked up quickly
+  AirspaceVector contents_self(airspace_tree.begin(), airspace_tree.end());
+  std::sort(contents_self.begin(), contents_self.end(), CompareAirspace);
+  std::vector<bool> kept(contents_self.size(), false);
 
-  // find items to add
+  /* the new tree contents: all items which are still in range, and
+     the active new ones; the master's envelopes were calculated
+     with the same task projection */
+  AirspaceVector items;
+  items.reserve(contents_master.size());
+
+  bool added = false;
   for (auto v = contents_master.begin(); v != contents_master.end(); ++v) {
-    const AbstractAirspace* other = v->GetAirspace();
-
-    bool found = false;
-    for (auto s = contents_self.begin(); s != contents_self.end(); ++s) {
-      const AbstractAirspace* self = s->GetAirspace();
-      if (self == other) {
-        found = true;
-        contents_self.erase(s);
-        break;
-      }
-    }
-    if (!found && other->IsActive()) {
-      Add(v->GetAirspace());
-      changed = true;
+    const auto s = std::lower_bound(contents_self.begin(), contents_self.end(),
+                                    *v, CompareAirspace);
+    if (s != contents_self.end() && *s == *v) {
+      kept[s - contents_self.begin()] = true;
+      items.push_back(*v);
+    } else if (v->GetAirspace()->IsActive()) {
+      items.push_back(*v);
+      added = true;
     }
   }
-  // anything left in the self list are items that were not in the query,
-  // so delete them --- including the clearances!
-  for (auto v = contents_self.begin(); v != contents_self.end();) {
-    bool found = false;
-    for (auto t = airspace_tree.begin(); t != airspace_tree.end(); ) {
-      if (t->GetAirspace() == v->GetAirspace()) {
-        AirspaceTree::const_iterator new_t = t;
-        ++new_t;
-        airspace_tree.erase_exact(*t);
-        t = new_t;
-        found = true;
-      } else {
-        ++t;
-      }
-    }
-    assert(found);
-    v->ClearClearance();
-    v = contents_self.erase(v);
-    changed = true;
+
+  if (!added && items.size() == contents_self.size())
+    return false;
+
+  if (added) {
+    // trigger set_pressure_levels and set_activity on the next update
+    qnh = AtmosphericPressure::Zero();
+    activity_mask.SetAll();
   }
-  if (changed)
-    Optimise();
-  return changed;
+
+  // anything not kept was not in the query, so delete the clearances
+  for (unsigned i = 0; i < contents_self.size(); ++i)
+    if (!kept[i])
+      contents_self[i].ClearClearance();
+
+  /* the tree is static; build it once with the new contents */
+  airspace_tree.Build(items);
+  ++serial;
+  return true;
 }
 
 void
@@ -439,7 +522,8 @@ Airspaces::VisitInside(const GeoPoint &loc,
 
   Airspace bb_target(loc, task_projection);
   AirspaceVector vectors;
-  airspace_tree.find_within_range(bb_target, 0, std::back_inserter(vectors));
+  AirspaceCollector collector(vectors);
+  airspace_tree.VisitOverlapping(bb_target, collector);
 
   for (auto v = vectors.begin(); v != vectors.end(); ++v) {
     if ((*v).IsInside(loc))
@@ -447,3 +531,16 @@ Airspaces::VisitInside(const GeoPoint &loc,
   }
 }
 
+void
+Airspaces::VisitInside(const GeoPoint &loc, AirspaceVisitor &visitor,
+                       AirspaceCorridor &corridor) const
+{
+  if (empty()) return; // nothing to do
+
+  Airspace bb_target(loc, task_projection);
+  RequireCorridor(corridor, loc, bb_target);
+
+  const AirspaceVector &lateral = corridor.FindLateralInside(loc, bb_target);
+  for (auto v = lateral.begin(); v != lateral.end(); ++v)
+    visitor.Visit(*v);
+}
@@ -26,6 +26,7 @@
 #include "AirspaceActivity.hpp"
 #include "Predicate/AirspacePredicate.hpp"
 #include "Util/NonCopyable.hpp"
+#include "Util/Serial.hpp"
 #include "Geo/Flat/TaskProjection.hpp"
 #include "Atmosphere/Pressure.hpp"
 #include "Compiler.h"
@@ -35,23 +36,24 @@
 class RasterTerrain;
 class AirspaceVisitor;
 class AirspaceIntersectionVisitor;
+class AirspaceCorridor;
 
 /**
- * Container for airspaces using kd-tree representation internally for fast 
+ * Container for airspaces using a packed R-tree internally for fast
  * geospatial lookups.
  *
- * Complexity analysis (with kdtree):
- *   
+ * Complexity analysis (with R-tree):
+ *
  *    Find within range (k points found):
- *     O(n^(3/4) + k)
+ *     O(log(n) + k)
  *
  *    Find intersecting:
- *     O(n^(3/4) + k)
+ *     O(log(n) + k)
  *
  *    Find nearest:
  *     O(log(n))
  *
- *  Without kd-tree:
+ *  Without R-tree:
  *
  *    Find within range:
  *     O(n)
@@ -70,6 +72,11 @@ class Airspaces:
 
   bool owns_children;
 
+  /**
+   * This gets incremented each time the tree is modified.
+   */
+  Serial serial;
+
   AirspaceTree airspace_tree;
   TaskProjection task_projection;
 
@@ -98,6 +105,10 @@ public:
    */
   ~Airspaces();
 
+  const Serial &GetSerial() const {
+    return serial;
+  }
+
   /** 
    * Add airspace to the internal airspace tree.  
    * The airspace is not copied; ownership is transferred to this class if
@@ -108,9 +119,9 @@ public:
   void Add(AbstractAirspace *asp);
 
   /** 
-   * Re-organise the internal airspace tree after inserting/deleting.
-   * Should be called after inserting/deleting airspaces prior to performing
-   * any searches, but can be done once after a batch insert/delete.
+   * Rebuild the internal airspace tree after inserting/deleting.
+   * Must be called after inserting/deleting airspaces prior to performing
+   * any searches, and should be done once after a batch insert/delete.
    */
   void Optimise();
 
@@ -178,9 +189,20 @@ public:
    * @param loc location of origin of search
    * @param end end of line along with to search for intersections
    * @param visitor visitor class to call on airspaces intersected by line
+   * @param predicate condition to be applied to matches
    */
   void VisitIntersecting(const GeoPoint &location, const GeoPoint &end,
-                         AirspaceIntersectionVisitor &visitor) const;
+                         AirspaceIntersectionVisitor &visitor,
+                         const AirspacePredicate &predicate =
+                               AirspacePredicate::always_true) const;
+
+  /**
+   * Like VisitIntersecting(), but tests only the candidates of the
+   * specified corridor, which is refreshed if necessary.
+   */
+  void VisitIntersecting(const GeoPoint &location, const GeoPoint &end,
+                         AirspaceIntersectionVisitor &visitor,
+                         AirspaceCorridor &corridor) const;
 
   /**
    * Call visitor class on airspaces this location is inside
@@ -191,6 +213,13 @@ public:
    */
   void VisitInside(const GeoPoint &location, AirspaceVisitor &visitor) const;
 
+  /**
+   * Like VisitInside(), but tests only the candidates of the
+   * specified corridor, which is refreshed if necessary.
+   */
+  void VisitInside(const GeoPoint &location, AirspaceVisitor &visitor,
+                   AirspaceCorridor &corridor) const;
+
   /**
    * Find the nearest airspace that matches the specified condition.
    */
@@ -239,6 +268,22 @@ public:
                                   const AirspacePredicate &condition =
                                         AirspacePredicate::always_true) const;
 
+  /**
+   * Like FindInside(), but tests only the candidates of the specified
+   * corridor, which is refreshed if necessary.
+   */
+  const AirspaceVector FindInside(const AircraftState &state,
+                                  const AirspacePredicate &condition,
+                                  AirspaceCorridor &corridor) const;
+
+  /**
+   * Returns the airspaces which were added since the last call to
+   * Optimise(), in the order of Add().  They are not in the tree yet.
+   */
+  const std::deque<AbstractAirspace *> &GetPending() const {
+    return tmp_as;
+  }
+
   /**
    * Access first airspace in store, for use in iterators.
    *
@@ -278,6 +323,14 @@ public:
                           const GeoPoint &location, fixed range,
                           const AirspacePredicate &condition =
                                 AirspacePredicate::always_true);
+
+private:
+  /**
+   * Ensure that the corridor covers the specified query box near the
+   * location.
+   */
+  void RequireCorridor(AirspaceCorridor &corridor, const GeoPoint &location,
+                       const FlatBoundingBox &box) const;
 };
 
 #endif
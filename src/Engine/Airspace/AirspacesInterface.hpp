@@ -22,10 +22,10 @@
 #ifndef AIRSPACESINTERFACE_HPP
 #define AIRSPACESINTERFACE_HPP
 
-#include "Util/SliceAllocator.hpp"
 #include "Airspace.hpp"
+#include "AirspaceRTree.hpp"
 
-#include <kdtree++/kdtree.hpp>
+#include <vector>
 
 /**
  * Abstract class for interface to #Airspaces database.
@@ -37,15 +37,9 @@ public:
   typedef std::vector<Airspace> AirspaceVector; /**< Vector of airspaces (used internally) */
 
   /**
-   * Type of KD-tree data structure for airspace container
+   * Type of the spatial index for the airspace container
    */
-  typedef KDTree::KDTree<4, 
-                         Airspace, 
-                         FlatBoundingBox::kd_get_bounds,
-                         FlatBoundingBox::kd_distance,
-                         std::less<FlatBoundingBox::kd_get_bounds::result_type>,
-                         SliceAllocator<KDTree::_Node<Airspace>, 256>
-                         > AirspaceTree;
+  typedef AirspaceRTree AirspaceTree;
 };
 
 #endif
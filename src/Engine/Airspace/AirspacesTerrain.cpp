@@ -23,19 +23,32 @@
 #include "Airspaces.hpp"
 #include "Terrain/RasterTerrain.hpp"
 
+#include <vector>
+
 void 
 Airspaces::SetGroundLevels(const RasterTerrain &terrain)
 {
-  for (auto v = airspace_tree.begin(); v != airspace_tree.end(); ++v) {
+  /* collect the locations first, to look them all up at once */
+  std::vector<GeoPoint> locations;
+  for (auto v = airspace_tree.begin(); v != airspace_tree.end(); ++v)
     // If we don't need the ground level we don't have to calculate it
+    if (v->NeedGroundLevel())
+      locations.push_back(task_projection.unproject(v->GetCenter()));
+
+  if (locations.empty())
+    return;
+
+  std::vector<short> heights(locations.size());
+  terrain.GetTerrainHeights(&locations.front(), &heights.front(),
+                            locations.size());
+
+  auto h = heights.begin();
+  for (auto v = airspace_tree.begin(); v != airspace_tree.end(); ++v) {
     if (!v->NeedGroundLevel())
       continue;
 
-    FlatGeoPoint c_flat = v->GetCenter();
-    GeoPoint g = task_projection.unproject(c_flat);
-    short h = terrain.GetTerrainHeight(g);
-    if (!RasterBuffer::IsSpecial(h))
-      v->SetGroundLevel((fixed)h);
+    if (!RasterBuffer::IsSpecial(*h))
+      v->SetGroundLevel((fixed)*h);
+    ++h;
   }
 }
-
@@ -21,6 +21,7 @@
  */
 
 #include "AirspaceRoute.hpp"
+#include "Airspace/Airspaces.hpp"
 #include "Geo/SearchPointVector.hpp"
 #include "Airspace/AirspaceIntersectionVisitor.hpp"
 #include "Airspace/AirspaceCircle.hpp"
@@ -28,6 +29,8 @@
 #include "Airspace/Predicate/AirspacePredicateHeightRange.hpp"
 #include "Math/FastMath.h"
 
+#include <assert.h>
+
 // Airspace query helpers
 
 /**
@@ -216,8 +219,8 @@ AirspaceRoute::AirspaceSize() const
   return m_airspaces.size();
 }
 
-AirspaceRoute::AirspaceRoute(const Airspaces& master):
-  m_airspaces(master, false)
+AirspaceRoute::AirspaceRoute(const Airspaces& _master):
+  master(_master)
 {
   Reset();
 }
@@ -225,31 +228,32 @@ AirspaceRoute::AirspaceRoute(const Airspaces& master):
 AirspaceRoute::~AirspaceRoute()
 {
   // clean up, we dont need the clearances any more
-  m_airspaces.ClearClearances();
+  m_airspaces.Clear(master);
 }
 
 void
 AirspaceRoute::Reset()
 {
   RoutePlanner::Reset();
-  m_airspaces.ClearClearances();
-  m_airspaces.clear();
+  m_airspaces.Clear(master);
 }
 
 void
-AirspaceRoute::Synchronise(const Airspaces& master,
+AirspaceRoute::Synchronise(const Airspaces& _master,
                            const AGeoPoint& origin,
                            const AGeoPoint& destination)
 {
+  assert(&_master == &master);
+
   // @todo: also synchronise with AirspaceWarningManager to filter out items that are
   // acknowledged.
   h_min = std::min(origin.altitude, std::min(destination.altitude, h_min));
   h_max = std::max(origin.altitude, std::max(destination.altitude, h_max));
   // @todo: have margin for h_max to allow for climb
   AirspacePredicateHeightRangeExcludeTwo condition(h_min, h_max, origin, destination);
-  if (m_airspaces.SynchroniseInRange(master, origin.Middle(destination),
-                                       half(origin.Distance(destination)),
-                                       condition))
+  if (m_airspaces.Update(master, origin.Middle(destination),
+                         half(origin.Distance(destination)),
+                         condition))
   {
     if (m_airspaces.size())
       dirty = true;
@@ -23,10 +23,20 @@
 #define AIRSPACE_ROUTE_HPP
 
 #include "RoutePlanner.hpp"
-#include "Airspace/Airspaces.hpp"
+#include "Airspace/AirspaceSelection.hpp"
+
+class Airspaces;
 
 class AirspaceRoute: public RoutePlanner {
-  Airspaces m_airspaces;
+  const Airspaces &master;
+
+  /**
+   * The airspaces of the #master container which are relevant to the
+   * current route.  The master is read only by Synchronise(); the
+   * queries run on this snapshot, because they may be called from
+   * other threads while the master is being rebuilt.
+   */
+  AirspaceSelection m_airspaces;
 
   struct RouteAirspaceIntersection {
     const AbstractAirspace *airspace;
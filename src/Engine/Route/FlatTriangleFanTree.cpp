@@ -24,6 +24,7 @@
 #include "Terrain/RasterMap.hpp"
 #include "ReachFanParms.hpp"
 #include "Util/GlobalSliceAllocator.hpp"
+#include "Util/Macros.hpp"
 
 #define REACH_BUFFER 1
 #define REACH_SWEEP (ROUTEPOLAR_Q1-REACH_BUFFER)
@@ -209,17 +210,27 @@ FlatTriangleFanTree::UpdateTerrainBase(const FlatGeoPoint &o,
     return;
   }
 
-  for (auto x = vs.cbegin(), end = vs.cend(); x != end; ++x) {
-    const FlatGeoPoint av = (o + (*x)) * fixed_half;
-    const GeoPoint p = parms.task_proj.unproject(av);
-    short h = parms.terrain->GetHeight(p);
-
-    if (RasterBuffer::IsWater(h))
-      /* water: assume 0m MSL */
-      parms.terrain_counter++;
-    else if (!RasterBuffer::IsInvalid(h)) {
-      parms.terrain_counter++;
-      parms.terrain_base += h;
+  /* look up the heights in chunks, to keep the stack usage bounded */
+  GeoPoint locations[64];
+  short heights[ARRAY_SIZE(locations)];
+
+  for (auto x = vs.cbegin(), end = vs.cend(); x != end;) {
+    unsigned n = 0;
+    for (; x != end && n < ARRAY_SIZE(locations); ++x, ++n)
+      locations[n] = parms.task_proj.unproject((o + *x) * fixed_half);
+
+    parms.terrain->GetHeights(locations, heights, n);
+
+    for (unsigned i = 0; i < n; ++i) {
+      const short h = heights[i];
+
+      if (RasterBuffer::IsWater(h))
+        /* water: assume 0m MSL */
+        parms.terrain_counter++;
+      else if (!RasterBuffer::IsInvalid(h)) {
+        parms.terrain_counter++;
+        parms.terrain_base += h;
+      }
     }
   }
 
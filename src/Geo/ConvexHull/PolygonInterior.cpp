@@ -58,6 +58,26 @@ isLeft( const FlatGeoPoint &P0, const FlatGeoPoint &P1, const FlatGeoPoint &P2 )
   return 0;
 }
 
+/**
+ * The winding number contribution of the edge from P0 to P1.
+ */
+inline static int
+EdgeWinding(const GeoPoint &P, const GeoPoint &P0, const GeoPoint &P1)
+{
+  if (P0.latitude <= P.latitude) {         // start y <= P.Latitude
+    if (P1.latitude > P.latitude)      // an upward crossing
+      if (isLeft(P0, P1, P) > 0)  // P left of edge
+        return 1;            // have a valid up intersect
+  }
+  else {                       // start y > P.Latitude (no test needed)
+    if (P1.latitude <= P.latitude)     // a downward crossing
+      if (isLeft(P0, P1, P) < 0)  // P right of edge
+        return -1;            // have a valid down intersect
+  }
+
+  return 0;
+}
+
 //===================================================================
 
 // PolygonInterior(): winding number interior test for a point in a polygon
@@ -76,21 +96,23 @@ PolygonInterior( const GeoPoint &P, const std::vector<SearchPoint>& V)
   int    wn = 0;    // the winding number counter
 
   // loop through all edges of the polygon
-  for (int i=0; i<n; ++i) {   // edge from V[i] to V[i+1]
-    if (V[i].get_location().latitude <= P.latitude) {         // start y <= P.Latitude
-      if (V[i+1].get_location().latitude > P.latitude)      // an upward crossing
-        if (isLeft( V[i].get_location(), V[i+1].get_location(), P)>0)  // P left of edge
-          ++wn;            // have a valid up intersect
-    }
-    else {                       // start y > P.Latitude (no test needed)
-      if (V[i+1].get_location().latitude <= P.latitude)     // a downward crossing
-        if (isLeft( V[i].get_location(), V[i+1].get_location(), P)<0)  // P right of edge
-          --wn;            // have a valid down intersect
-    }
-  }
+  for (int i=0; i<n; ++i)    // edge from V[i] to V[i+1]
+    wn += EdgeWinding(P, V[i].get_location(), V[i+1].get_location());
+
   return wn != 0;
 }
 
+int
+PolygonWindingNumber(const GeoPoint &P, const std::vector<SearchPoint> &V,
+                     const unsigned *edges, const unsigned *end)
+{
+  int wn = 0;
+  for (; edges != end; ++edges)
+    wn += EdgeWinding(P, V[*edges].get_location(),
+                      V[*edges + 1].get_location());
+  return wn;
+}
+
 
 bool
 PolygonInterior( const FlatGeoPoint &P, const std::vector<SearchPoint>& V)
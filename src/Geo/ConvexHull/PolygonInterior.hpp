@@ -36,4 +36,14 @@ PolygonInterior( const GeoPoint &P, const std::vector<SearchPoint>& V);
 gcc_pure bool
 PolygonInterior( const FlatGeoPoint &P, const std::vector<SearchPoint>& V);
 
+/**
+ * Calculate the winding number of a point, considering only the
+ * specified edges (edge i goes from V[i] to V[i+1]).  If the list
+ * contains all edges which cross the latitude of P, the result is
+ * the same as the full test.
+ */
+gcc_pure int
+PolygonWindingNumber(const GeoPoint &P, const std::vector<SearchPoint> &V,
+                     const unsigned *edges, const unsigned *end);
+
 #endif
@@ -0,0 +1,337 @@
+/* Copyright_License {
+
+  XCSoar Glide Computer - http://www.xcsoar.org/
+  Copyright (C) 2000-2012 The XCSoar Project
+  A detailed list of copyright holders can be found in the file "AUTHORS".
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+}
+ */
+
+#include "PolygonInteriorIndex.hpp"
+#include "PolygonInterior.hpp"
+#include "Math/FastMath.h"
+
+#include <algorithm>
+
+#include <assert.h>
+
+/**
+ * The smallest margin around the edges, in grid units.  It covers the
+ * rounding of GetFlatPoint() and of the edge clipping in MarkEdge().
+ */
+static const int MIN_MARGIN = 2;
+
+FlatGeoPoint
+PolygonInteriorIndex::GetFlatPoint(const GeoPoint &p)
+{
+  return FlatGeoPoint(iround(p.longitude.Degrees() * UNITS_PER_DEGREE),
+                      iround(p.latitude.Degrees() * UNITS_PER_DEGREE));
+}
+
+void
+PolygonInteriorIndex::Clear()
+{
+  columns = rows = 0;
+  cells.clear();
+  row_start.clear();
+  edges.clear();
+}
+
+unsigned
+PolygonInteriorIndex::GetColumn(int x) const
+{
+  if (x <= origin_x)
+    return 0;
+
+  const unsigned column = ((unsigned)x - (unsigned)origin_x) / cell_width;
+  return std::min(column, columns - 1);
+}
+
+unsigned
+PolygonInteriorIndex::GetRow(int y) const
+{
+  if (y <= origin_y)
+    return 0;
+
+  const unsigned row = ((unsigned)y - (unsigned)origin_y) / cell_height;
+  return std::min(row, rows - 1);
+}
+
+void
+PolygonInteriorIndex::MarkEdge(const FlatGeoPoint &a, const FlatGeoPoint &b,
+                               int margin_x, int margin_y)
+{
+  const int64_t dx = (int64_t)b.Longitude - a.Longitude;
+  const int64_t dy = (int64_t)b.Latitude - a.Latitude;
+  const int min_y = std::min(a.Latitude, b.Latitude);
+  const int max_y = std::max(a.Latitude, b.Latitude);
+
+  const unsigned first_row = GetRow(min_y - margin_y);
+  const unsigned last_row = GetRow(max_y + margin_y);
+
+  for (unsigned row = first_row; row <= last_row; ++row) {
+    int x0 = a.Longitude, x1 = b.Longitude;
+    if (dy != 0) {
+      /* clip the edge to this row's latitude band; the truncating
+         division is off by less than one unit */
+      const int64_t top = origin_y + (int64_t)row * cell_height - margin_y;
+      const int64_t bottom = top + cell_height + 2 * margin_y;
+      const int64_t y0 = std::max(top, (int64_t)min_y);
+      const int64_t y1 = std::min(bottom, (int64_t)max_y);
+      x0 = a.Longitude + (int)(dx * (y0 - a.Latitude) / dy);
+      x1 = a.Longitude + (int)(dx * (y1 - a.Latitude) / dy);
+    }
+
+    const unsigned first_column = GetColumn(std::min(x0, x1) - margin_x);
+    const unsigned last_column = GetColumn(std::max(x0, x1) + margin_x);
+
+    Cell *p = &cells[row * columns];
+    std::fill(p + first_column, p + last_column + 1, Cell::BOUNDARY);
+  }
+}
+
+void
+PolygonInteriorIndex::Build(const std::vector<SearchPoint> &V)
+{
+  Clear();
+
+  if (V.size() < MIN_VERTICES)
+    return;
+
+  const unsigned n_edges = V.size() - 1;
+
+  std::vector<FlatGeoPoint> points;
+  points.reserve(V.size());
+  for (auto i = V.begin(), end = V.end(); i != end; ++i)
+    points.push_back(GetFlatPoint(i->get_location()));
+
+  int min_x = points.front().Longitude, max_x = min_x;
+  int min_y = points.front().Latitude, max_y = min_y;
+  for (auto i = points.begin(), end = points.end(); i != end; ++i) {
+    min_x = std::min(min_x, i->Longitude);
+    max_x = std::max(max_x, i->Longitude);
+    min_y = std::min(min_y, i->Latitude);
+    max_y = std::max(max_y, i->Latitude);
+  }
+
+  /* about 4 cells per vertex (2 * sqrt(n) columns and rows), which
+     leaves most cells free of edges */
+  unsigned size = 1;
+  while (size < MAX_GRID_SIZE && (size + 1) * (size + 1) <= 4 * n_edges)
+    ++size;
+  columns = rows = size;
+
+  /* the margin keeps classified cells safely away from rounding
+     errors near the edges */
+  const int width = std::max(max_x - min_x, 1);
+  const int height = std::max(max_y - min_y, 1);
+  const int margin_x = std::max(width / (int)columns / 64, MIN_MARGIN);
+  const int margin_y = std::max(height / (int)rows / 64, MIN_MARGIN);
+  origin_x = min_x - margin_x;
+  origin_y = min_y - margin_y;
+  cell_width = (width + 2 * margin_x + columns - 1) / columns;
+  cell_height = (height + 2 * margin_y + rows - 1) / rows;
+
+  cells.resize(columns * rows, Cell::OUTSIDE);
+  for (unsigned i = 0; i < n_edges; ++i)
+    MarkEdge(points[i], points[i + 1], margin_x, margin_y);
+
+  /* collect the edges crossing each row; horizontal edges never
+     contribute to the winding number */
+  row_start.assign(rows + 1, 0);
+  for (unsigned pass = 0; pass < 2; ++pass) {
+    for (unsigned i = 0; i < n_edges; ++i) {
+      const GeoPoint &a = V[i].get_location(), &b = V[i + 1].get_location();
+      if (a.latitude == b.latitude)
+        continue;
+
+      const FlatGeoPoint &fa = points[i], &fb = points[i + 1];
+      const unsigned first_row =
+        GetRow(std::min(fa.Latitude, fb.Latitude) - margin_y);
+      const unsigned last_row =
+        GetRow(std::max(fa.Latitude, fb.Latitude) + margin_y);
+      for (unsigned row = first_row; row <= last_row; ++row) {
+        if (pass == 0)
+          ++row_start[row + 1];
+        else
+          edges[row_start[row]++] = i;
+      }
+    }
+
+    if (pass == 0) {
+      for (unsigned row = 0; row < rows; ++row)
+        row_start[row + 1] += row_start[row];
+      edges.resize(row_start[rows]);
+    } else {
+      /* the second pass has advanced each start to the next row's
+         start */
+      for (unsigned row = rows; row > 0; --row)
+        row_start[row] = row_start[row - 1];
+      row_start[0] = 0;
+    }
+  }
+
+  /* classify the cells which are not crossed by an edge, using the
+     exact test at their center */
+  for (unsigned row = 0; row < rows; ++row) {
+    const int y = origin_y + row * cell_height + cell_height / 2;
+    for (unsigned column = 0; column < columns; ++column) {
+      Cell &cell = cells[row * columns + column];
+      if (cell == Cell::BOUNDARY)
+        continue;
+
+      const int x = origin_x + column * cell_width + cell_width / 2;
+      const GeoPoint center(Angle::Degrees(fixed(x) / UNITS_PER_DEGREE),
+                            Angle::Degrees(fixed(y) / UNITS_PER_DEGREE));
+      if (IsInsideRow(center, row, V))
+        cell = Cell::INSIDE;
+    }
+  }
+}
+
+bool
+PolygonInteriorIndex::IsInsideRow(const GeoPoint &P, unsigned row,
+                                  const std::vector<SearchPoint> &V) const
+{
+  const unsigned *begin = edges.data();
+  return PolygonWindingNumber(P, V, begin + row_start[row],
+                              begin + row_start[row + 1]) != 0;
+}
+
+bool
+PolygonInteriorIndex::IsInside(const GeoPoint &P,
+                               const std::vector<SearchPoint> &V) const
+{
+  assert(IsDefined());
+
+  /* the unsigned offsets of points left of or below the grid wrap
+     around to huge values */
+  const FlatGeoPoint p = GetFlatPoint(P);
+  const unsigned x = (unsigned)p.Longitude - (unsigned)origin_x;
+  const unsigned y = (unsigned)p.Latitude - (unsigned)origin_y;
+  if (x > columns * cell_width || y > rows * cell_height)
+    /* outside of the polygon's bounds */
+    return false;
+
+  const unsigned row = std::min(y / cell_height, rows - 1);
+  const unsigned column = std::min(x / cell_width, columns - 1);
+  switch (cells[row * columns + column]) {
+  case Cell::OUTSIDE:
+    return false;
+
+  case Cell::INSIDE:
+    return true;
+
+  case Cell::BOUNDARY:
+    break;
+  }
+
+  return IsInsideRow(P, row, V);
+}
+
+struct PolygonInteriorIndexHeader {
+  int32_t origin_x, origin_y;
+  uint32_t cell_width, cell_height;
+
+  uint32_t columns, rows;
+
+  uint32_t num_edges;
+};
+
+bool
+PolygonInteriorIndex::SaveCache(FILE *file) const
+{
+  PolygonInteriorIndexHeader header;
+  header.origin_x = origin_x;
+  header.origin_y = origin_y;
+  header.cell_width = cell_width;
+  header.cell_height = cell_height;
+  header.columns = columns;
+  header.rows = rows;
+  header.num_edges = edges.size();
+
+  if (fwrite(&header, sizeof(header), 1, file) != 1)
+    return false;
+
+  if (!IsDefined())
+    return true;
+
+  return fwrite(cells.data(), sizeof(cells.front()), cells.size(),
+                file) == cells.size() &&
+    fwrite(row_start.data(), sizeof(row_start.front()), row_start.size(),
+           file) == row_start.size() &&
+    (edges.empty() ||
+     fwrite(edges.data(), sizeof(edges.front()), edges.size(),
+            file) == edges.size());
+}
+
+bool
+PolygonInteriorIndex::LoadCache(FILE *file, unsigned num_vertices)
+{
+  Clear();
+
+  PolygonInteriorIndexHeader header;
+  if (fread(&header, sizeof(header), 1, file) != 1)
+    return false;
+
+  if (header.columns == 0 && header.rows == 0)
+    /* not indexed */
+    return header.num_edges == 0;
+
+  if (header.columns == 0 || header.columns > MAX_GRID_SIZE ||
+      header.rows == 0 || header.rows > MAX_GRID_SIZE ||
+      num_vertices < MIN_VERTICES ||
+      header.num_edges > header.rows * (num_vertices - 1) ||
+      header.cell_width == 0 || header.cell_height == 0)
+    return false;
+
+  origin_x = header.origin_x;
+  origin_y = header.origin_y;
+  cell_width = header.cell_width;
+  cell_height = header.cell_height;
+  columns = header.columns;
+  rows = header.rows;
+
+  cells.resize(columns * rows);
+  row_start.resize(rows + 1);
+  edges.resize(header.num_edges);
+
+  if (fread(cells.data(), sizeof(cells.front()), cells.size(),
+            file) != cells.size() ||
+      fread(row_start.data(), sizeof(row_start.front()), row_start.size(),
+            file) != row_start.size() ||
+      (!edges.empty() &&
+       fread(edges.data(), sizeof(edges.front()), edges.size(),
+             file) != edges.size())) {
+    Clear();
+    return false;
+  }
+
+  /* validate everything IsInside() relies on */
+  bool valid = row_start.front() == 0 && row_start.back() == edges.size();
+  for (unsigned row = 0; valid && row < rows; ++row)
+    valid = row_start[row] <= row_start[row + 1];
+  for (auto i = cells.begin(), end = cells.end(); valid && i != end; ++i)
+    valid = *i == Cell::OUTSIDE || *i == Cell::INSIDE ||
+      *i == Cell::BOUNDARY;
+  for (auto i = edges.begin(), end = edges.end(); valid && i != end; ++i)
+    valid = *i + 1 < num_vertices;
+
+  if (!valid)
+    Clear();
+
+  return valid;
+}
@@ -0,0 +1,153 @@
+/* Copyright_License {
+
+  XCSoar Glide Computer - http://www.xcsoar.org/
+  Copyright (C) 2000-2012 The XCSoar Project
+  A detailed list of copyright holders can be found in the file "AUTHORS".
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+}
+ */
+#ifndef POLYGON_INTERIOR_INDEX_HPP
+#define POLYGON_INTERIOR_INDEX_HPP
+
+#include "Geo/SearchPoint.hpp"
+#include "Geo/Flat/FlatGeoPoint.hpp"
+#include "Compiler.h"
+
+#include <vector>
+
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * Accelerates PolygonInterior() for polygons with many vertices.
+ *
+ * The bounding box of the polygon is divided into a grid.  Each cell
+ * which is not touched by an edge is entirely inside or entirely
+ * outside, which is determined once with the exact test.  For cells
+ * on the boundary, each grid row has a list of the edges which cross
+ * its latitude band, and only these are passed to the winding number
+ * test.
+ *
+ * Edges are rasterised with a small margin, so a cell which is not
+ * marked as boundary is safely away from all edges, and the result is
+ * the same as PolygonInterior().
+ *
+ * The grid uses integer coordinates (see GetFlatPoint()), because
+ * floating point is emulated in software on some targets.
+ */
+class PolygonInteriorIndex {
+  enum class Cell : uint8_t {
+    OUTSIDE,
+    INSIDE,
+    BOUNDARY,
+  };
+
+  /**
+   * Polygons with fewer vertices are not indexed, because the plain
+   * test is fast enough.
+   */
+  static const unsigned MIN_VERTICES = 32;
+
+  static const unsigned MAX_GRID_SIZE = 64;
+
+  /**
+   * The number of grid units per degree.  One unit is about 1 cm, and
+   * a longitude of 180 degrees still fits in an int.
+   */
+  static const int UNITS_PER_DEGREE = 10000000;
+
+  /**
+   * The origin and cell size of the grid, in grid units.  The grid
+   * covers the bounds of the polygon plus a small margin.
+   */
+  int origin_x, origin_y;
+  unsigned cell_width, cell_height;
+
+  unsigned columns, rows;
+
+  std::vector<Cell> cells;
+
+  /**
+   * For each row, the position of its first edge in #edges; the last
+   * element is the end of the last row.
+   */
+  std::vector<unsigned> row_start;
+
+  /**
+   * Edge numbers, grouped by row.  Edge i goes from V[i] to V[i+1].
+   */
+  std::vector<unsigned> edges;
+
+public:
+  PolygonInteriorIndex():columns(0), rows(0) {}
+
+  bool IsDefined() const {
+    return !cells.empty();
+  }
+
+  /**
+   * Build the index for the specified closed polygon.  Does nothing
+   * if the polygon is too small to benefit.
+   */
+  void Build(const std::vector<SearchPoint> &V);
+
+  void Clear();
+
+  /**
+   * Is the point inside the polygon?  The polygon must be the one
+   * passed to Build(), and the index must be defined.
+   */
+  gcc_pure
+  bool IsInside(const GeoPoint &P, const std::vector<SearchPoint> &V) const;
+
+  /**
+   * Write the index to a cache file.
+   */
+  bool SaveCache(FILE *file) const;
+
+  /**
+   * Restore the index which was saved by SaveCache().
+   *
+   * @param num_vertices the size of the polygon, for validating the
+   * edge numbers
+   */
+  bool LoadCache(FILE *file, unsigned num_vertices);
+
+private:
+  /**
+   * Convert a location to grid units.
+   */
+  gcc_pure
+  static FlatGeoPoint GetFlatPoint(const GeoPoint &p);
+
+  gcc_pure
+  unsigned GetColumn(int x) const;
+
+  gcc_pure
+  unsigned GetRow(int y) const;
+
+  gcc_pure
+  bool IsInsideRow(const GeoPoint &P, unsigned row,
+                   const std::vector<SearchPoint> &V) const;
+
+  /**
+   * Mark all cells touched by the edge from a to b as boundary.
+   */
+  void MarkEdge(const FlatGeoPoint &a, const FlatGeoPoint &b,
+                int margin_x, int margin_y);
+};
+
+#endif
@@ -129,3 +129,9 @@ FlatBoundingBox::IsInside(const FlatGeoPoint& loc) const
 
   return true;
 }
+
+bool
+FlatBoundingBox::IsInside(const FlatBoundingBox &interior) const
+{
+  return IsInside(interior.bb_ll) && IsInside(interior.bb_ur);
+}
@@ -164,6 +164,12 @@ public:
   gcc_pure
   bool Overlaps(const FlatBoundingBox& other) const;
 
+  /**
+   * Is the specified bounding box completely inside this one?
+   */
+  gcc_pure
+  bool IsInside(const FlatBoundingBox &interior) const;
+
   /**
    * Expand the bounding box to include this point
    */
@@ -201,6 +207,16 @@ public:
     bb_ll.Latitude--;
     bb_ur.Latitude++;
   }
+
+  /**
+   * Expand the border by the specified amount on each side
+   */
+  void Grow(int amount) {
+    bb_ll.Longitude -= amount;
+    bb_ur.Longitude += amount;
+    bb_ll.Latitude -= amount;
+    bb_ur.Latitude += amount;
+  }
 };
 
 #endif
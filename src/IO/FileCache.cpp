@@ -24,9 +24,14 @@ Copyright_License {
 #include "FileCache.hpp"
 #include "OS/FileUtil.hpp"
 #include "OS/PathName.hpp"
+#include "OS/FileMapping.hpp"
 #include "Compatibility/path.h"
+#include "Util/StaticString.hpp"
 #include "Compiler.h"
 
+#include <algorithm>
+#include <vector>
+
 #include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
@@ -115,6 +120,61 @@ FileCache::Flush(const TCHAR *name)
   File::Delete(MakeCachePath(buffer, name));
 }
 
+void
+FileCache::Touch(const TCHAR *name)
+{
+  TCHAR buffer[PathBufferSize(name)];
+  File::Touch(MakeCachePath(buffer, name));
+}
+
+struct CacheFileInfo {
+  StaticString<MAX_PATH> path;
+  uint64_t mtime;
+  uint64_t size;
+
+  bool operator<(const CacheFileInfo &other) const {
+    return mtime < other.mtime;
+  }
+};
+
+class CacheFileCollector : public File::Visitor {
+  std::vector<CacheFileInfo> &files;
+
+public:
+  CacheFileCollector(std::vector<CacheFileInfo> &_files):files(_files) {}
+
+  virtual void Visit(const TCHAR *path, const TCHAR *filename) {
+    CacheFileInfo info;
+    info.path = path;
+    info.mtime = File::GetLastModification(path);
+    info.size = File::GetSize(path);
+    files.push_back(info);
+  }
+};
+
+void
+FileCache::Trim(const TCHAR *filter, uint64_t max_size)
+{
+  std::vector<CacheFileInfo> files;
+  CacheFileCollector collector(files);
+  Directory::VisitSpecificFiles(cache_path, filter, collector);
+
+  uint64_t total = 0;
+  for (auto i = files.begin(), end = files.end(); i != end; ++i)
+    total += i->size;
+
+  if (total <= max_size)
+    return;
+
+  /* delete the oldest files first */
+  std::sort(files.begin(), files.end());
+
+  for (auto i = files.begin(), end = files.end();
+       i != end && total > max_size; ++i)
+    if (File::Delete(i->path))
+      total -= i->size;
+}
+
 FILE *
 FileCache::Load(const TCHAR *name, const TCHAR *original_path)
 {
@@ -156,6 +216,27 @@ FileCache::Load(const TCHAR *name, const TCHAR *original_path)
   return file;
 }
 
+FileMapping *
+FileCache::Map(const TCHAR *name, const TCHAR *original_path,
+               size_t &offset)
+{
+  FILE *file = Load(name, original_path);
+  if (file == NULL)
+    return NULL;
+
+  offset = ftell(file);
+  fclose(file);
+
+  TCHAR path[PathBufferSize(name)];
+  FileMapping *mapping = new FileMapping(MakeCachePath(path, name));
+  if (mapping->error()) {
+    delete mapping;
+    return NULL;
+  }
+
+  return mapping;
+}
+
 FILE *
 FileCache::Save(const TCHAR *name, const TCHAR *original_path)
 {
@@ -25,8 +25,12 @@ Copyright_License {
 #define XCSOAR_FILE_CACHE_HPP
 
 #include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <tchar.h>
 
+class FileMapping;
+
 class FileCache {
   TCHAR *cache_path;
   size_t cache_path_length;
@@ -41,8 +45,33 @@ protected:
 
 public:
   void Flush(const TCHAR *name);
+
+  /**
+   * Mark the cache file as recently used, so Trim() deletes it last.
+   */
+  void Touch(const TCHAR *name);
+
+  /**
+   * Delete the least recently used cache files matching the given
+   * pattern until their total size does not exceed the given limit.
+   *
+   * @param filter a file name pattern, e.g. "terrain-*"
+   * @param max_size the maximum total size [bytes]
+   */
+  void Trim(const TCHAR *filter, uint64_t max_size);
   FILE *Load(const TCHAR *name, const TCHAR *original_path);
 
+  /**
+   * Like Load(), but map the cache file into memory.
+   *
+   * @param offset returns the position of the data which was
+   * written after Save()
+   * @return the mapping, which must be deleted by the caller, or
+   * NULL if the cache file is missing or stale
+   */
+  FileMapping *Map(const TCHAR *name, const TCHAR *original_path,
+                   size_t &offset);
+
   FILE *Save(const TCHAR *name, const TCHAR *original_path);
   bool Commit(const TCHAR *name, FILE *file);
   void Cancel(const TCHAR *name, FILE *file);
@@ -31,7 +31,7 @@ Copyright_License {
 GlueMapWindow::GlueMapWindow(const Look &look)
   :MapWindow(look.map, look.traffic),
    logger(NULL),
-   idle_robin(2),
+   idle_robin(1),
    drag_mode(DRAG_NONE),
    ignore_single_click(false),
    arm_mapitem_list(false),
@@ -159,30 +159,29 @@ GlueMapWindow::QuickRedraw()
 bool
 GlueMapWindow::Idle()
 {
+  /* the topography is loaded by a background thread; just tell it
+     about the current projection */
+  UpdateTopography();
+
   bool still_dirty;
-  bool topography_dirty = true; /* scan topography in every Idle() call */
   bool terrain_dirty = true;
   bool weather_dirty = true;
 
   // StartTimer();
 
   do {
-    idle_robin = (idle_robin + 1) % 3;
+    idle_robin = (idle_robin + 1) % 2;
     switch (idle_robin) {
     case 0:
-      topography_dirty = UpdateTopography(1) > 0;
-      break;
-
-    case 1:
       terrain_dirty = UpdateTerrain();
       break;
 
-    case 2:
+    case 1:
       weather_dirty = UpdateWeather();
       break;
     }
 
-    still_dirty = terrain_dirty || topography_dirty || weather_dirty;
+    still_dirty = terrain_dirty || weather_dirty;
   } while (RenderTimeAvailable() &&
 #ifndef ENABLE_OPENGL
            !draw_thread->IsTriggered() &&
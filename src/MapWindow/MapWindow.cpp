@@ -29,8 +29,15 @@ Copyright_License {
 #include "Terrain/RasterTerrain.hpp"
 #include "Terrain/RasterWeather.hpp"
 #include "Computer/GlideComputer.hpp"
+#include "Task/ProtectedTaskManager.hpp"
+#include "Engine/Task/Ordered/OrderedTask.hpp"
+#include "Engine/Task/Ordered/Points/OrderedTaskPoint.hpp"
+#include "Geo/Math.hpp"
 #include "Units/Units.hpp"
 #include "Operation/Operation.hpp"
+#include "Util/Macros.hpp"
+
+#include <algorithm>
 
 #include <tchar.h>
 
@@ -119,13 +126,65 @@ MapWindow::ReadBlackboard(const MoreData &nmea_info,
   ReadMapSettings(settings_map);
 }
 
-unsigned
-MapWindow::UpdateTopography(unsigned max_update)
+void
+MapWindow::UpdateTopography()
 {
   if (topography != NULL && GetMapSettings().topography_enabled)
-    return topography->ScanVisibility(visible_projection, max_update);
-  else
+    topography->ScanVisibilityAsync(visible_projection);
+}
+
+/**
+ * How far ahead on the current track shall terrain be prefetched?
+ * [seconds of flight]
+ */
+static const unsigned TERRAIN_PREFETCH_TIME = 300;
+
+/**
+ * The maximum number of prefetch locations on the current track.
+ */
+static const unsigned TERRAIN_PREFETCH_TRACK_POINTS = 3;
+
+unsigned
+MapWindow::CollectTerrainPrefetch(fixed radius,
+                                  GeoPoint *dest, unsigned max) const
+{
+  const MoreData &basic = Basic();
+  if (!IsNearSelf() || !basic.location_available)
     return 0;
+
+  unsigned n = 0;
+
+  if (basic.track_available && basic.MovementDetected()) {
+    /* ahead on the current track; points which are on the screen
+       already are skipped */
+    const fixed lookahead = basic.ground_speed * TERRAIN_PREFETCH_TIME;
+    const fixed step = std::max(radius,
+                                lookahead / TERRAIN_PREFETCH_TRACK_POINTS);
+    for (fixed distance = step; distance <= lookahead && n < max;
+         distance += step)
+      dest[n++] = FindLatitudeLongitude(basic.location, basic.track,
+                                        distance);
+  }
+
+  if (task != NULL && n < max) {
+    /* the active leg and the following one: their middle and their
+       end */
+    ProtectedTaskManager::Lease task_manager(*task);
+    if (task_manager->GetMode() == TaskManager::MODE_ORDERED) {
+      const OrderedTask &ordered_task = task_manager->GetOrderedTask();
+      GeoPoint previous = basic.location;
+      for (unsigned i = ordered_task.GetActiveIndex(),
+             end = std::min(i + 2, ordered_task.TaskSize());
+           i < end && n + 2 <= max; ++i) {
+        const GeoPoint &location = ordered_task.GetTaskPoint(i).GetLocation();
+        dest[n++] = previous.Middle(location);
+        dest[n++] = location;
+        previous = location;
+      }
+    }
+  }
+
+  return n;
 }
 
 bool
@@ -140,18 +199,22 @@ MapWindow::UpdateTerrain()
       terrain_center.Distance(location) < fixed(1000))
     return false;
 
+  GeoPoint prefetch[RasterTileCache::MAX_PREFETCH];
+  const unsigned n_prefetch =
+    CollectTerrainPrefetch(radius, prefetch, ARRAY_SIZE(prefetch));
+
   // always service terrain even if it's not used by the map,
   // because it's used by other calculations
-  RasterTerrain::ExclusiveLease lease(*terrain);
-  lease->SetViewCenter(location, radius);
-  if (lease->IsDirty())
+  const bool dirty = terrain->UpdateTiles(location, radius,
+                                          prefetch, n_prefetch);
+  if (dirty)
     terrain_radius = fixed_zero;
   else {
     terrain_radius = radius;
     terrain_center = location;
   }
 
-  return lease->IsDirty();
+  return dirty;
 }
 
 bool
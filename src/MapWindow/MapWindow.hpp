@@ -260,7 +260,23 @@ public:
   virtual void Render(Canvas &canvas, const PixelRect &rc);
 
 protected:
-  unsigned UpdateTopography(unsigned max_update=1024);
+  /**
+   * Start loading the topography around the visible area in
+   * background.  The renderer picks up the new shapes when it draws
+   * the next frame.
+   */
+  void UpdateTopography();
+
+  /**
+   * Determine the locations where terrain will probably be needed
+   * soon: ahead on the current track, and along the active legs of
+   * the ordered task.
+   *
+   * @param radius the radius of the visible area [m]
+   * @return the number of locations written to the buffer
+   */
+  unsigned CollectTerrainPrefetch(fixed radius,
+                                  GeoPoint *dest, unsigned max) const;
 
   /**
    * @return true if UpdateTerrain() should be called again
@@ -135,6 +135,7 @@ const TCHAR szProfileMenuTimeout[] = _T("MenuTimeout");
 const TCHAR szProfileTerrainContrast[] = _T("TerrainContrast");
 const TCHAR szProfileTerrainBrightness[] = _T("TerrainBrightness");
 const TCHAR szProfileTerrainRamp[] = _T("TerrainRamp");
+const TCHAR szProfileTerrainCacheSize[] = _T("TerrainCacheSize");
 const TCHAR szProfileEnableFLARMMap[] = _T("EnableFLARMDisplay");
 const TCHAR szProfileEnableFLARMGauge[] = _T("EnableFLARMGauge");
 const TCHAR szProfileAutoCloseFlarmDialog[] = _T("AutoCloseFlarmDialog");
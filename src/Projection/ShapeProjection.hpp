@@ -0,0 +1,52 @@
+/*
+Copyright_License {
+
+  XCSoar Glide Computer - http://www.xcsoar.org/
+  Copyright (C) 2000-2012 The XCSoar Project
+  A detailed list of copyright holders can be found in the file "AUTHORS".
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+}
+*/
+
+#ifndef XCSOAR_SHAPE_PROJECTION_HPP
+#define XCSOAR_SHAPE_PROJECTION_HPP
+
+#include "Topography/XShapePoint.hpp"
+#include "Geo/GeoPoint.hpp"
+#include "Geo/Constants.hpp"
+#include "Compiler.h"
+
+/**
+ * Converts a location to meters relative to the origin.  Like
+ * Projection::GeoToScreen(), the longitude difference is scaled with
+ * the cosine of the point's latitude.  The OpenGL renderers use this
+ * to build vertex arrays which are independent of the map position.
+ */
+gcc_pure
+static inline ShapePoint
+GeoToShape(const GeoPoint &origin, const GeoPoint &point)
+{
+  const GeoPoint d = point-origin;
+
+  ShapePoint pt;
+  pt.x = (ShapeScalar)fast_mult(point.latitude.fastcosine(),
+                                fast_mult(d.longitude.Radians(),
+                                          fixed_earth_r, 12), 16);
+  pt.y = (ShapeScalar)-fast_mult(d.latitude.Radians(), fixed_earth_r, 12);
+  return pt;
+}
+
+#endif
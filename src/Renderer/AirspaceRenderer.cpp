@@ -42,6 +42,14 @@ Copyright_License {
 
 #ifdef ENABLE_OPENGL
 #include "Screen/OpenGL/Scope.hpp"
+#include "Screen/OpenGL/Triangulate.hpp"
+#include "Projection/ShapeProjection.hpp"
+#include "Geo/Constants.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#include <assert.h>
 #endif
 
 class AirspaceWarningCopy
@@ -131,20 +139,218 @@ public:
 
 #ifdef ENABLE_OPENGL
 
+/**
+ * The triangulated interior of an #AirspacePolygon.  The vertices do
+ * not depend on the projection; only the transformation matrix is
+ * set up for each frame.
+ */
+struct AirspaceTessellation {
+  /**
+   * The center of the polygon's bounds.  The vertices are relative
+   * to it.
+   */
+  GeoPoint origin;
+
+  /**
+   * The largest latitude difference between a vertex and #origin
+   * [radians].
+   */
+  fixed half_height;
+
+  std::vector<ShapePoint> points;
+  std::vector<GLushort> triangles;
+
+  explicit AirspaceTessellation(const SearchPointVector &border) {
+    const unsigned num_points = border.size();
+    if (num_points < 3 || num_points > 0xffff)
+      /* nothing to fill, or too many vertices for GLushort indices */
+      return;
+
+    GeoPoint north_east = border.front().get_location();
+    GeoPoint south_west = north_east;
+    for (auto i = border.begin(), end = border.end(); i != end; ++i) {
+      const GeoPoint &p = i->get_location();
+      north_east.longitude = std::max(north_east.longitude, p.longitude);
+      north_east.latitude = std::max(north_east.latitude, p.latitude);
+      south_west.longitude = std::min(south_west.longitude, p.longitude);
+      south_west.latitude = std::min(south_west.latitude, p.latitude);
+    }
+
+    origin = north_east.Middle(south_west);
+    half_height = half((north_east.latitude - south_west.latitude).Radians());
+
+    points.reserve(num_points);
+    for (auto i = border.begin(), end = border.end(); i != end; ++i)
+      points.push_back(GeoToShape(origin, i->get_location()));
+
+    triangles.resize(3 * (num_points - 2));
+    triangles.resize(PolygonToTriangles(points.data(), num_points,
+                                        triangles.data()));
+  }
+
+  /**
+   * Has the polygon been triangulated successfully?
+   */
+  bool IsDefined() const {
+    return !triangles.empty();
+  }
+
+  /**
+   * Fill the polygon with the specified color.
+   *
+   * The outline is projected with Projection::GeoToScreen(), which
+   * scales the longitude difference to the screen center with the
+   * cosine of each vertex's own latitude.  The vertices are relative
+   * to #origin instead, and a shear adds the first-order term of that
+   * cosine relative to the latitude of #origin.  The remaining error
+   * grows with the longitude difference to the screen center and with
+   * the square of the polygon's height.
+   *
+   * @return false if that error would be visible, and nothing was
+   * drawn
+   */
+  bool Draw(const Projection &projection, const Color color) const {
+    assert(IsDefined());
+
+    const fixed scale = projection.GetScale();
+    const fixed delta_longitude =
+      (origin.longitude - projection.GetGeoLocation().longitude).Radians();
+    const fixed max_error = fabs(delta_longitude) * fixed_earth_r *
+      origin.latitude.cos() * half(half_height * half_height) * scale;
+    if (max_error > fixed_one)
+      /* more than one pixel */
+      return false;
+
+    color.Set();
+
+    glPushMatrix();
+
+    fixed angle = projection.GetScreenAngle().Degrees();
+    const RasterPoint &screen_origin = projection.GetScreenOrigin();
+    const ShapePoint translation =
+      GeoToShape(projection.GetGeoLocation(), origin);
+    const fixed shear = delta_longitude * origin.latitude.sin();
+
+#ifdef HAVE_GLES
+#ifdef FIXED_MATH
+    GLfixed fixed_angle = angle.as_glfixed();
+    GLfixed fixed_scale = scale.as_glfixed_scale();
+    GLfixed fixed_shear = shear.as_glfixed();
+#else
+    GLfixed fixed_angle = angle * (1<<16);
+    GLfixed fixed_scale = scale * (1LL<<32);
+    GLfixed fixed_shear = shear * (1<<16);
+#endif
+    const GLfixed shear_matrix[16] = {
+      1<<16, 0, 0, 0,
+      fixed_shear, 1<<16, 0, 0,
+      0, 0, 1<<16, 0,
+      0, 0, 0, 1<<16,
+    };
+
+    glTranslatex((int)screen_origin.x << 16, (int)screen_origin.y << 16, 0);
+    glRotatex(fixed_angle, 0, 0, -(1<<16));
+    glScalex(fixed_scale, fixed_scale, 1<<16);
+    glTranslatex(translation.x, translation.y, 0);
+    glMultMatrixx(shear_matrix);
+
+    glVertexPointer(2, GL_FIXED, 0, &points[0].x);
+#else
+    const GLfloat shear_matrix[16] = {
+      1, 0, 0, 0,
+      (GLfloat)shear, 1, 0, 0,
+      0, 0, 1, 0,
+      0, 0, 0, 1,
+    };
+
+    glTranslatef(screen_origin.x, screen_origin.y, 0.);
+    glRotatef((GLfloat)angle, 0., 0., -1.);
+    glScalef((GLfloat)scale, (GLfloat)scale, 1.);
+    glTranslatef(translation.x, translation.y, 0.);
+    glMultMatrixf(shear_matrix);
+
+    glVertexPointer(2, GL_INT, 0, &points[0].x);
+#endif
+
+    glDrawElements(GL_TRIANGLES, triangles.size(), GL_UNSIGNED_SHORT,
+                   triangles.data());
+
+    glPopMatrix();
+    return true;
+  }
+};
+
+void
+AirspaceTessellationCache::Clear()
+{
+  for (auto i = map.begin(), end = map.end(); i != end; ++i)
+    delete i->second;
+
+  map.clear();
+}
+
+void
+AirspaceTessellationCache::Validate(const Airspaces &_airspaces)
+{
+  if (&_airspaces == airspaces && _airspaces.GetSerial() == serial)
+    return;
+
+  /* the airspaces have been modified; the keys may be dangling */
+  Clear();
+  airspaces = &_airspaces;
+  serial = _airspaces.GetSerial();
+}
+
+const AirspaceTessellation &
+AirspaceTessellationCache::Get(const AirspacePolygon &airspace)
+{
+  auto i = map.find(&airspace);
+  if (i == map.end()) {
+    AirspaceTessellation *tessellation =
+      new AirspaceTessellation(airspace.GetPoints());
+    i = map.insert(std::make_pair(&airspace, tessellation)).first;
+  }
+
+  return *i->second;
+}
+
+/**
+ * Fills the interior of an #AirspacePolygon with the specified
+ * color, using its cached tessellation.  The clipped polygon which
+ * has been prepared on the #MapCanvas is the fallback for polygons
+ * which could not be triangulated.
+ */
+static void
+FillPolygon(MapCanvas &map_canvas, AirspaceTessellationCache &cache,
+            const AirspacePolygon &airspace, const Color color)
+{
+  const AirspaceTessellation &tessellation = cache.Get(airspace);
+  if (tessellation.IsDefined() &&
+      tessellation.Draw(map_canvas.projection, color))
+    return;
+
+  map_canvas.canvas.Select(Brush(color));
+  map_canvas.canvas.SelectNullPen();
+  map_canvas.DrawPrepared();
+}
+
 class AirspaceVisitorRenderer : public AirspaceVisitor, protected MapCanvas
 {
   const AirspaceLook &look;
   const AirspaceWarningCopy &warning_manager;
   const AirspaceRendererSettings &settings;
+  AirspaceTessellationCache &tessellation_cache;
 
 public:
   AirspaceVisitorRenderer(Canvas &_canvas, const WindowProjection &_projection,
                           const AirspaceLook &_look,
                           const AirspaceWarningCopy &_warnings,
-                          const AirspaceRendererSettings &_settings)
+                          const AirspaceRendererSettings &_settings,
+                          AirspaceTessellationCache &_tessellation_cache)
     :MapCanvas(_canvas, _projection,
                _projection.GetScreenBounds().Scale(fixed(1.1))),
-     look(_look), warning_manager(_warnings), settings(_settings)
+     look(_look), warning_manager(_warnings), settings(_settings),
+     tessellation_cache(_tessellation_cache)
   {
     glStencilMask(0xff);
     glClear(GL_STENCIL_BUFFER_BIT);
@@ -212,7 +418,8 @@ public:
       {
         SetupInterior(airspace, !fill_airspace);
         GLEnable blend(GL_BLEND);
-        DrawPrepared();
+        FillPolygon(*this, tessellation_cache, airspace,
+                    GetInteriorColor(airspace));
       }
 
       if (!fill_airspace) {
@@ -260,11 +467,14 @@ private:
     glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
     glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
 
-    Color color = settings.classes[airspace.GetType()].fill_color;
-    canvas.Select(Brush(color.WithAlpha(90)));
+    canvas.Select(Brush(GetInteriorColor(airspace)));
     canvas.SelectNullPen();
   }
 
+  Color GetInteriorColor(const AbstractAirspace &airspace) const {
+    return settings.classes[airspace.GetType()].fill_color.WithAlpha(90);
+  }
+
   void SetFillStencil() {
     glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
     glStencilFunc(GL_ALWAYS, 3, 3);
@@ -291,15 +501,18 @@ class AirspaceFillRenderer : public AirspaceVisitor, protected MapCanvas
   const AirspaceLook &look;
   const AirspaceWarningCopy &warning_manager;
   const AirspaceRendererSettings &settings;
+  AirspaceTessellationCache &tessellation_cache;
 
 public:
   AirspaceFillRenderer(Canvas &_canvas, const WindowProjection &_projection,
                        const AirspaceLook &_look,
                        const AirspaceWarningCopy &_warnings,
-                       const AirspaceRendererSettings &_settings)
+                       const AirspaceRendererSettings &_settings,
+                       AirspaceTessellationCache &_tessellation_cache)
     :MapCanvas(_canvas, _projection,
                _projection.GetScreenBounds().Scale(fixed(1.1))),
-     look(_look), warning_manager(_warnings), settings(_settings)
+     look(_look), warning_manager(_warnings), settings(_settings),
+     tessellation_cache(_tessellation_cache)
   {
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
   }
@@ -329,7 +542,8 @@ public:
       {
         SetupInterior(airspace);
         GLEnable blend(GL_BLEND);
-        DrawPrepared();
+        FillPolygon(*this, tessellation_cache, airspace,
+                    GetInteriorColor(airspace));
       }
     }
 
@@ -356,10 +570,13 @@ private:
   }
 
   void SetupInterior(const AbstractAirspace &airspace) {
-    Color color = settings.classes[airspace.GetType()].fill_color;
-    canvas.Select(Brush(color.WithAlpha(48)));
+    canvas.Select(Brush(GetInteriorColor(airspace)));
     canvas.SelectNullPen();
   }
+
+  Color GetInteriorColor(const AbstractAirspace &airspace) const {
+    return settings.classes[airspace.GetType()].fill_color.WithAlpha(48);
+  }
 };
 
 #else // !ENABLE_OPENGL
@@ -550,15 +767,17 @@ AirspaceRenderer::Draw(Canvas &canvas,
     return;
 
 #ifdef ENABLE_OPENGL
+  tessellation_cache.Validate(*airspaces);
+
   if (settings.fill_mode == AirspaceRendererSettings::FillMode::ALL) {
     AirspaceFillRenderer renderer(canvas, projection, look, awc,
-                                  settings);
+                                  settings, tessellation_cache);
     airspaces->VisitWithinRange(projection.GetGeoScreenCenter(),
                                           projection.GetScreenDistanceMeters(),
                                           renderer, visible);
   } else {
     AirspaceVisitorRenderer renderer(canvas, projection, look, awc,
-                                     settings);
+                                     settings, tessellation_cache);
     airspaces->VisitWithinRange(projection.GetGeoScreenCenter(),
                                           projection.GetScreenDistanceMeters(),
                                           renderer, visible);
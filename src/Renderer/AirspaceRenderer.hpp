@@ -27,6 +27,13 @@ Copyright_License {
 #include "Util/StaticArray.hpp"
 #include "Geo/GeoPoint.hpp"
 
+#ifdef ENABLE_OPENGL
+#include "Util/Serial.hpp"
+#include "Util/NonCopyable.hpp"
+
+#include <map>
+#endif
+
 struct AirspaceLook;
 struct MoreData;
 struct DerivedInfo;
@@ -39,6 +46,44 @@ class AirspaceWarningCopy;
 class Canvas;
 class WindowProjection;
 
+#ifdef ENABLE_OPENGL
+
+class AbstractAirspace;
+class AirspacePolygon;
+struct AirspaceTessellation;
+
+/**
+ * Remembers the triangulated interior of each #AirspacePolygon which
+ * was drawn, so it needs to be triangulated only once.  All entries
+ * are discarded when the #Airspaces object is modified.
+ */
+class AirspaceTessellationCache : private NonCopyable {
+  const Airspaces *airspaces;
+  Serial serial;
+
+  typedef std::map<const AbstractAirspace *, AirspaceTessellation *> Map;
+  Map map;
+
+public:
+  AirspaceTessellationCache():airspaces(NULL) {}
+
+  ~AirspaceTessellationCache() {
+    Clear();
+  }
+
+  void Clear();
+
+  /**
+   * Discard all entries if they were not created from the current
+   * state of the specified #Airspaces object.
+   */
+  void Validate(const Airspaces &airspaces);
+
+  const AirspaceTessellation &Get(const AirspacePolygon &airspace);
+};
+
+#endif
+
 class AirspaceRenderer
 {
   const AirspaceLook &look;
@@ -48,6 +93,10 @@ class AirspaceRenderer
 
   StaticArray<GeoPoint,32> intersections;
 
+#ifdef ENABLE_OPENGL
+  AirspaceTessellationCache tessellation_cache;
+#endif
+
 public:
   AirspaceRenderer(const AirspaceLook &_look)
     :look(_look), airspaces(NULL), warning_manager(NULL) {}
@@ -46,6 +46,7 @@ Copyright_License {
 #include "Task/ProtectedRoutePlanner.hpp"
 #include "Screen/Icon.hpp"
 #include "Screen/Canvas.hpp"
+#include "Screen/LabelBlock.hpp"
 #include "Units/Units.hpp"
 #include "Screen/Layout.hpp"
 #include "Util/StaticArray.hpp"
@@ -460,7 +461,7 @@ MapWaypointLabelRender(Canvas &canvas, UPixelScalar width, UPixelScalar height,
 {
   labels.Sort();
 
-  for (unsigned i = 0; i < labels.size(); i++) {
+  for (unsigned i = 0; i < labels.size() && !label_block.IsFull(); i++) {
     const WaypointLabelList::Label *E = &labels[i];
     TextInBox(canvas, E->Name, E->Pos.x, E->Pos.y, E->Mode,
               width, height, &label_block);
@@ -24,10 +24,11 @@ Copyright_License {
 // simple code to prevent text writing over map city names
 #include "Screen/LabelBlock.hpp"
 
-void
-LabelBlock::Bucket::Clear()
+LabelBlock::LabelBlock()
+  :frame(1), n_labels(0), n_references(0)
 {
-  blocks.clear();
+  for (unsigned i = 0; i < N_BUCKETS; ++i)
+    buckets[i].frame = 0;
 }
 
 static gcc_pure bool
@@ -38,10 +39,15 @@ CheckRectOverlap(const PixelRect& rc1, const PixelRect& rc2)
 }
 
 bool
-LabelBlock::Bucket::Check(const PixelRect rc) const
+LabelBlock::CheckBucket(unsigned i, const PixelRect &rc) const
 {
-  for (auto i = blocks.begin(), end = blocks.end(); i != end; ++i)
-    if (CheckRectOverlap(*i, rc))
+  const Bucket &bucket = buckets[i];
+  if (bucket.frame != frame)
+    /* not used in this frame */
+    return true;
+
+  for (unsigned r = bucket.head; r != NONE; r = references[r].next)
+    if (CheckRectOverlap(labels[references[r].label], rc))
       return false;
 
   return true;
@@ -49,27 +55,57 @@ LabelBlock::Bucket::Check(const PixelRect rc) const
 
 void LabelBlock::reset()
 {
-  for (unsigned i = 0; i < BUCKET_COUNT; ++i)
-    buckets[i].Clear();
+  n_labels = 0;
+  n_references = 0;
+
+  if (++frame == 0) {
+    /* wraparound: invalidate all buckets explicitly */
+    for (unsigned i = 0; i < N_BUCKETS; ++i)
+      buckets[i].frame = 0;
+    frame = 1;
+  }
 }
 
 bool LabelBlock::check(const PixelRect rc)
 {
-  unsigned top = rc.top >> BUCKET_SHIFT;
-  unsigned bottom = rc.bottom >> BUCKET_SHIFT;
-
-  if (top >= BUCKET_COUNT)
-    top = BUCKET_COUNT - 1;
-
-  if (bottom < BUCKET_COUNT && !buckets[bottom].Check(rc))
+  if (IsFull())
     return false;
 
-  if (top < bottom && !buckets[top].Check(rc))
+  /* the right and bottom edges are exclusive */
+  const int left = int(rc.left) >> CELL_WIDTH_SHIFT;
+  const int right = (int(rc.right) - 1) >> CELL_WIDTH_SHIFT;
+  const int top = int(rc.top) >> CELL_HEIGHT_SHIFT;
+  const int bottom = (int(rc.bottom) - 1) >> CELL_HEIGHT_SHIFT;
+
+  const unsigned n_cells = right >= left && bottom >= top
+    ? (right - left + 1) * (bottom - top + 1)
+    : 0;
+  if (n_cells > MAX_CELLS_PER_LABEL ||
+      n_references + n_cells > MAX_REFERENCES)
     return false;
 
-  buckets[top].Add(rc);
-  if (bottom < BUCKET_COUNT && top != bottom)
-    buckets[bottom].Add(rc);
+  for (int y = top; y <= bottom; ++y)
+    for (int x = left; x <= right; ++x)
+      if (!CheckBucket(GetBucketIndex(x, y), rc))
+        return false;
+
+  const unsigned short label = n_labels++;
+  labels[label] = rc;
+
+  for (int y = top; y <= bottom; ++y) {
+    for (int x = left; x <= right; ++x) {
+      Bucket &bucket = buckets[GetBucketIndex(x, y)];
+      if (bucket.frame != frame) {
+        bucket.frame = frame;
+        bucket.head = NONE;
+      }
+
+      Reference &reference = references[n_references];
+      reference.label = label;
+      reference.next = bucket.head;
+      bucket.head = n_references++;
+    }
+  }
 
   return true;
 }
@@ -25,52 +25,121 @@ Copyright_License {
 #define SCREEN_LABELBLOCK_HPP
 
 #include "Screen/Point.hpp"
-#include "Util/StaticArray.hpp"
 #include "Compiler.h"
 
+/**
+ * Prevents labels of all map layers from overlapping each other.
+ * Each layer passes the rectangle of a label to check() before
+ * drawing it, and the first label to claim a screen area wins.  This
+ * means that the layers which are drawn first have the higher
+ * priority, and each layer should submit its most important labels
+ * first.
+ *
+ * The accepted rectangles are stored in a uniform grid, which is
+ * addressed through a small hash table.  All storage is allocated
+ * once and reused for each frame; reset() is O(1).  The number of
+ * labels per frame is limited, so the cost of the label layout is
+ * bounded, no matter how many labels are submitted.
+ */
 class LabelBlock {
+public:
 #if defined(_WIN32_WCE) && _WIN32_WCE < 0x400
   /* PPC2000 (ancient hardware, expect small screens) */
-  static const unsigned SCREEN_HEIGHT = 1024;
-  static const unsigned BUCKET_SIZE = 32;
+  static const unsigned MAX_LABELS = 64;
 #elif defined(_WIN32_WCE) || defined(HAVE_GLES)
   /* embedded (Android or Windows CE) */
-  static const unsigned SCREEN_HEIGHT = 2048;
-  static const unsigned BUCKET_SIZE = 64;
+  static const unsigned MAX_LABELS = 128;
 #else
   /* desktop, screen may be huge, lots of memory */
-  static const unsigned SCREEN_HEIGHT = 4096;
-  static const unsigned BUCKET_SIZE = 64;
+  static const unsigned MAX_LABELS = 256;
 #endif
-  static const unsigned BUCKET_SHIFT = 7;
-  static const unsigned BUCKET_HEIGHT = 1 << BUCKET_SHIFT;
-  static const unsigned BUCKET_COUNT = SCREEN_HEIGHT / BUCKET_HEIGHT;
 
   /**
-   * A bucket is responsible for hit tests in one horizontal section
-   * of the screen.
+   * The size of one grid cell.  Labels are usually much wider than
+   * high, and so are the cells.
+   */
+  static const unsigned CELL_WIDTH_SHIFT = 7;
+  static const unsigned CELL_HEIGHT_SHIFT = 5;
+
+  /**
+   * Labels which would cover more cells than this are rejected.
+   */
+  static const unsigned MAX_CELLS_PER_LABEL = 16;
+
+  /**
+   * The number of cell references which may be stored per frame.
    */
-  class Bucket {
-    typedef StaticArray<PixelRect, BUCKET_SIZE> BlockArray;
-    BlockArray blocks;
+  static const unsigned MAX_REFERENCES = MAX_LABELS * 4;
 
-  public:
-    void Clear();
+private:
+  static const unsigned N_BUCKETS = 256;
 
-    gcc_pure
-    bool Check(const PixelRect rc) const;
+  /**
+   * Links one label into the list of one grid cell.
+   */
+  struct Reference {
+    unsigned short label;
+    unsigned short next;
+  };
 
-    void Add(const PixelRect rc) {
-      if (!blocks.full())
-        blocks.append(rc);
-    }
+  /**
+   * A hash table slot.  Several grid cells may share one slot, which
+   * only costs a few extra rectangle tests.
+   */
+  struct Bucket {
+    /**
+     * The frame number in which #head was last written.  If it is
+     * not equal to LabelBlock::frame, the bucket is empty.
+     */
+    unsigned frame;
+
+    unsigned short head;
   };
 
-  Bucket buckets[BUCKET_COUNT];
+  static const unsigned short NONE = 0xffff;
+
+  unsigned frame;
+
+  unsigned n_labels, n_references;
+
+  Bucket buckets[N_BUCKETS];
+  PixelRect labels[MAX_LABELS];
+  Reference references[MAX_REFERENCES];
 
 public:
+  LabelBlock();
+
+  /**
+   * Checks whether the given label rectangle is free, and if yes,
+   * reserves it.
+   *
+   * @return true if the label may be drawn
+   */
   bool check(const PixelRect rc);
+
+  /**
+   * Forget all labels.  Call this at the beginning of each frame.
+   */
   void reset();
+
+  /**
+   * Has the per-frame label or cell reference limit been reached?
+   * Further calls to check() will fail, and callers may skip the
+   * preparation of more labels.
+   */
+  gcc_pure
+  bool IsFull() const {
+    return n_labels >= MAX_LABELS || n_references >= MAX_REFERENCES;
+  }
+
+private:
+  gcc_const
+  static unsigned GetBucketIndex(int x, int y) {
+    return ((unsigned)x * 73856093u ^ (unsigned)y * 19349663u) % N_BUCKETS;
+  }
+
+  gcc_pure
+  bool CheckBucket(unsigned i, const PixelRect &rc) const;
 };
 
 #endif
@@ -24,9 +24,12 @@ Copyright_License {
 #include "HeightMatrix.hpp"
 #include "RasterMap.hpp"
 #include "Projection/WindowProjection.hpp"
+#include "Thread/ThreadPool.hpp"
 
 #include <algorithm>
 #include <assert.h>
+#include <stdlib.h>
+#include <string.h>
 
 void
 HeightMatrix::SetSize(size_t _size)
@@ -53,9 +56,58 @@ HeightMatrix::SetSize(unsigned width, unsigned height,
           (height + quantisation_pixels - 1) / quantisation_pixels);
 }
 
+void
+HeightMatrix::Swap(HeightMatrix &other)
+{
+  data.Swap(other.data);
+  std::swap(width, other.width);
+  std::swap(height, other.height);
+  std::swap(fill_map, other.fill_map);
+  std::swap(fill_serial, other.fill_serial);
+  std::swap(fill_projection, other.fill_projection);
+  std::swap(fill_quantisation, other.fill_quantisation);
+  std::swap(fill_interpolate, other.fill_interpolate);
+  std::swap(offset_x, other.offset_x);
+  std::swap(offset_y, other.offset_y);
+}
+
+void
+HeightMatrix::ScanCells(const RasterMap &map, int x, int y,
+                        short *buffer, unsigned size) const
+{
+  assert(size > 0);
+
+  const int q = fill_quantisation;
+  map.ScanLine(fill_projection.ScreenToGeo(x * q, y * q),
+               fill_projection.ScreenToGeo((x + (int)size - 1) * q, y * q),
+               buffer, size, fill_interpolate);
+}
+
+void
+HeightMatrix::ScanRows(const RasterMap &map, unsigned begin, unsigned end)
+{
+  for (unsigned y = begin; y < end; ++y)
+    ScanCells(map, 0, y, GetRow(y), width);
+}
+
+struct HeightMatrixFillTask : public ThreadPool::Task {
+  HeightMatrix &matrix;
+  const RasterMap &map;
+
+  HeightMatrixFillTask(HeightMatrix &_matrix, const RasterMap &_map)
+    :matrix(_matrix), map(_map) {}
+
+  virtual void RunSlice(unsigned slice, unsigned n_slices) {
+    const unsigned height = matrix.GetHeight();
+    matrix.ScanRows(map, height * slice / n_slices,
+                    height * (slice + 1) / n_slices);
+  }
+};
+
 void
 HeightMatrix::Fill(const RasterMap &map, const WindowProjection &projection,
-                   unsigned quantisation_pixels, bool interpolate)
+                   unsigned quantisation_pixels, bool interpolate,
+                   ThreadPool *pool)
 {
   const unsigned screen_width = projection.GetScreenWidth();
   const unsigned screen_height = projection.GetScreenHeight();
@@ -63,10 +115,158 @@ HeightMatrix::Fill(const RasterMap &map, const WindowProjection &projection,
   SetSize((screen_width + quantisation_pixels - 1) / quantisation_pixels,
           (screen_height + quantisation_pixels - 1) / quantisation_pixels);
 
-  for (unsigned y = 0; y < screen_height; y += quantisation_pixels) {
-    short *p = data.begin() + y * width / quantisation_pixels;
-    map.ScanLine(projection.ScreenToGeo(0, y),
-                 projection.ScreenToGeo(screen_width, y),
-                 p, width, interpolate);
+  fill_map = &map;
+  fill_serial = map.GetSerial();
+  fill_projection = projection;
+  fill_quantisation = quantisation_pixels;
+  fill_interpolate = interpolate;
+  offset_x = offset_y = 0;
+
+  if (pool != NULL && pool->GetConcurrency() > 1) {
+    /* several bands per thread, because the rows outside of the map
+       are much cheaper than the others */
+    HeightMatrixFillTask task(*this, map);
+    pool->Run(task, pool->GetConcurrency() * 4);
+  } else
+    ScanRows(map, 0, height);
+}
+
+gcc_const
+static int
+RoundedDivide(int a, int b)
+{
+  return a >= 0 ? (a + b / 2) / b : -((-a + b / 2) / b);
+}
+
+/**
+ * Like Projection::GeoToScreen(), but corrects its rounding error: of
+ * the neighbouring pixels, return the one whose location is closest
+ * to the specified one.
+ */
+gcc_pure
+static RasterPoint
+GeoToScreenNearest(const Projection &projection, const GeoPoint &location)
+{
+  const RasterPoint rounded = projection.GeoToScreen(location);
+
+  RasterPoint nearest = rounded;
+  fixed nearest_distance = projection.ScreenToGeo(rounded).Distance(location);
+
+  for (int dy = -1; dy <= 1; ++dy) {
+    for (int dx = -1; dx <= 1; ++dx) {
+      if (dx == 0 && dy == 0)
+        continue;
+
+      const int x = rounded.x + dx, y = rounded.y + dy;
+      const fixed distance = projection.ScreenToGeo(x, y).Distance(location);
+      if (distance < nearest_distance) {
+        nearest.x = x;
+        nearest.y = y;
+        nearest_distance = distance;
+      }
+    }
+  }
+
+  return nearest;
+}
+
+bool
+HeightMatrix::CanShift(const RasterMap &map,
+                       const WindowProjection &projection,
+                       unsigned quantisation_pixels, bool interpolate,
+                       int &new_offset_x, int &new_offset_y) const
+{
+  if (fill_map != &map || fill_serial != map.GetSerial() ||
+      fill_quantisation != quantisation_pixels ||
+      fill_interpolate != interpolate ||
+      projection.GetScreenWidth() != fill_projection.GetScreenWidth() ||
+      projection.GetScreenHeight() != fill_projection.GetScreenHeight() ||
+      projection.GetScale() != fill_projection.GetScale() ||
+      projection.GetScreenAngle() != fill_projection.GetScreenAngle())
+    return false;
+
+  /* where is the new screen's top left corner on the old grid? */
+  const RasterPoint origin =
+    GeoToScreenNearest(fill_projection, projection.GetGeoLocation());
+  const int x = origin.x - projection.GetScreenOrigin().x;
+  const int y = origin.y - projection.GetScreenOrigin().y;
+
+  /* don't move too far away from the original projection, because
+     its flat-earth approximation becomes inaccurate */
+  if ((unsigned)abs(x) > projection.GetScreenWidth() ||
+      (unsigned)abs(y) > projection.GetScreenHeight())
+    return false;
+
+  /* round to the nearest cell, but allow only one pixel of error;
+     beyond that, the old samples would not match the new screen */
+  const int q = quantisation_pixels;
+  new_offset_x = RoundedDivide(x, q);
+  new_offset_y = RoundedDivide(y, q);
+  if (abs(x - new_offset_x * q) > 1 || abs(y - new_offset_y * q) > 1)
+    return false;
+
+  /* only worth it if at least some cells can be reused */
+  return (unsigned)abs(new_offset_x - offset_x) < width &&
+    (unsigned)abs(new_offset_y - offset_y) < height;
+}
+
+void
+HeightMatrix::Update(const RasterMap &map, const WindowProjection &projection,
+                     unsigned quantisation_pixels, bool interpolate,
+                     ThreadPool *pool)
+{
+  int new_offset_x = 0, new_offset_y = 0;
+  if (!CanShift(map, projection, quantisation_pixels, interpolate,
+                new_offset_x, new_offset_y)) {
+    Fill(map, projection, quantisation_pixels, interpolate, pool);
+    return;
+  }
+
+  /* new cell (x,y) is old cell (x+dx,y+dy) */
+  const int dx = new_offset_x - offset_x;
+  const int dy = new_offset_y - offset_y;
+  if (dx == 0 && dy == 0)
+    return;
+
+  offset_x = new_offset_x;
+  offset_y = new_offset_y;
+
+  /* the range of columns which can be copied from the old matrix */
+  const unsigned keep_begin = std::max(-dx, 0);
+  const unsigned keep_end = width - std::max(dx, 0);
+  const unsigned keep_size = keep_end - keep_begin;
+
+  /* move the rows in an order which doesn't overwrite rows which
+     are yet to be moved */
+  const int y_begin = dy > 0 ? 0 : height - 1;
+  const int y_end = dy > 0 ? height : -1;
+  const int y_step = dy > 0 ? 1 : -1;
+
+  for (int y = y_begin; y != y_end; y += y_step) {
+    short *row = GetRow(y);
+
+    const int old_y = y + dy;
+    if (old_y < 0 || old_y >= (int)height) {
+      /* newly exposed row */
+      ScanCells(map, offset_x, offset_y + y, row, width);
+      continue;
+    }
+
+    memmove(row + keep_begin, GetRow(old_y) + keep_begin + dx,
+            keep_size * sizeof(*row));
+
+    /* newly exposed columns; RasterMap::ScanLine() needs at least
+       two samples, so one reused cell is scanned as well, and its
+       old value is restored afterwards */
+    if (dx < 0) {
+      const short reused = row[keep_begin];
+      ScanCells(map, offset_x, offset_y + y, row, keep_begin + 1);
+      row[keep_begin] = reused;
+    } else if (dx > 0) {
+      const short reused = row[keep_end - 1];
+      ScanCells(map, offset_x + keep_end - 1, offset_y + y,
+                row + keep_end - 1, width - keep_end + 1);
+      row[keep_end - 1] = reused;
+    }
   }
 }
@@ -26,17 +26,47 @@ Copyright_License {
 
 #include "Util/NonCopyable.hpp"
 #include "Util/AllocatedArray.hpp"
+#include "Util/Serial.hpp"
+#include "Projection/WindowProjection.hpp"
 #include "Compiler.h"
 
 class RasterMap;
-class WindowProjection;
+class ThreadPool;
 
 class HeightMatrix : private NonCopyable {
   AllocatedArray<short> data;
   unsigned width, height;
 
+  /**
+   * The map which was used by the last Fill() call, or NULL if the
+   * matrix contents are not valid for Update().
+   */
+  const RasterMap *fill_map;
+
+  /**
+   * The #RasterMap serial at the time of the last Fill().  If it
+   * changes, new tiles have been loaded, and the whole matrix must be
+   * rescanned.
+   */
+  Serial fill_serial;
+
+  /**
+   * The projection of the last Fill() call.  All samples are taken
+   * on its pixel grid, even after Update() has shifted the matrix.
+   */
+  WindowProjection fill_projection;
+
+  unsigned fill_quantisation;
+  bool fill_interpolate;
+
+  /**
+   * The position of the top left cell on the #fill_projection grid
+   * [cells].
+   */
+  int offset_x, offset_y;
+
 public:
-  HeightMatrix():width(0), height(0) {}
+  HeightMatrix():width(0), height(0), fill_map(NULL) {}
 
 protected:
   void SetSize(size_t _size);
@@ -46,9 +76,27 @@ protected:
 public:
   /**
    * @param interpolate true enables interpolation of sub-pixel values
+   * @param pool if not NULL, then the rows are split into bands which
+   * are scanned in parallel; the result is the same
    */
   void Fill(const RasterMap &map, const WindowProjection &map_projection,
-            unsigned quantisation_pixels, bool interpolate);
+            unsigned quantisation_pixels, bool interpolate,
+            ThreadPool *pool=NULL);
+
+  /**
+   * Like Fill(), but if the map was only panned by a whole number of
+   * cells since the previous call, move the existing samples and
+   * scan only the newly exposed rows and columns.
+   */
+  void Update(const RasterMap &map, const WindowProjection &map_projection,
+              unsigned quantisation_pixels, bool interpolate,
+              ThreadPool *pool=NULL);
+
+  /**
+   * Exchange the contents (including the state used by Update()) with
+   * another object.
+   */
+  void Swap(HeightMatrix &other);
 
   unsigned GetWidth() const {
     return width;
@@ -69,6 +117,37 @@ public:
   const short *GetDataEnd() const {
     return GetRow(height);
   }
+
+private:
+  short *GetRow(unsigned y) {
+    return data.begin() + y * width;
+  }
+
+  /**
+   * Can the current contents be reused for the specified projection?
+   * On success, returns the new position of the top left cell on the
+   * #fill_projection grid.
+   */
+  gcc_pure
+  bool CanShift(const RasterMap &map, const WindowProjection &projection,
+                unsigned quantisation_pixels, bool interpolate,
+                int &new_offset_x, int &new_offset_y) const;
+
+  /**
+   * Scan a horizontal run of cells on the #fill_projection grid.
+   *
+   * @param x the first cell, relative to the #fill_projection origin
+   * @param y the row, relative to the #fill_projection origin
+   */
+  void ScanCells(const RasterMap &map, int x, int y,
+                 short *buffer, unsigned size) const;
+
+  /**
+   * Scan the specified range of rows for Fill().
+   */
+  void ScanRows(const RasterMap &map, unsigned begin, unsigned end);
+
+  friend struct HeightMatrixFillTask;
 };
 
 #endif
@@ -35,6 +35,30 @@ RasterBuffer::Resize(unsigned _width, unsigned _height)
   data.GrowDiscard(_width, _height);
 }
 
+void
+RasterBuffer::Downsample(const RasterBuffer &src)
+{
+  assert(src.GetWidth() >= 2 && src.GetHeight() >= 2);
+
+  Resize(src.GetWidth() / 2, src.GetHeight() / 2);
+
+  const unsigned width = GetWidth(), height = GetHeight();
+  short *dest = GetData();
+
+  for (unsigned y = 0; y < height; ++y) {
+    const short *a = src.GetDataAt(0, y * 2);
+    const short *b = src.GetDataAt(0, y * 2 + 1);
+
+    for (unsigned x = 0; x < width; ++x, a += 2, b += 2) {
+      if (IsSpecial(a[0]) || IsSpecial(a[1]) ||
+          IsSpecial(b[0]) || IsSpecial(b[1]))
+        *dest++ = a[0];
+      else
+        *dest++ = (a[0] + a[1] + b[0] + b[1]) / 4;
+    }
+  }
+}
+
 short
 RasterBuffer::GetInterpolated(unsigned lx, unsigned ly,
                                unsigned ix, unsigned iy) const
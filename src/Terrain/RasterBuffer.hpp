@@ -29,6 +29,7 @@ Copyright_License {
 #include "Compiler.h"
 
 #include <cstddef>
+#include <stdint.h>
 
 class RasterBuffer : private NonCopyable {
 public:
@@ -102,8 +103,24 @@ public:
     data.Reset();
   }
 
+  /**
+   * Exchange the contents of this buffer with another one, without
+   * copying pixels.
+   */
+  void Swap(RasterBuffer &other) {
+    data.Swap(other.data);
+  }
+
   void Resize(unsigned _width, unsigned _height);
 
+  /**
+   * Fill this buffer with a copy of the specified one, reduced to
+   * half the width and height.  Each pixel is the average of a 2x2
+   * block; blocks containing special values are not averaged, but
+   * take their top left pixel.
+   */
+  void Downsample(const RasterBuffer &src);
+
   gcc_pure
   short GetInterpolated(unsigned lx, unsigned ly,
                         unsigned ix, unsigned iy) const;
@@ -25,15 +25,23 @@ Copyright_License {
 #include "Geo/GeoClip.hpp"
 #include "OS/PathName.hpp"
 #include "IO/FileCache.hpp"
+#include "Util/Macros.hpp"
 
 #include <algorithm>
 #include <assert.h>
 #include <string.h>
+#include <stdint.h>
 
 RasterMap::RasterMap(const TCHAR *_path, const TCHAR *world_file,
                      FileCache *cache, OperationEnvironment &operation)
   :path(strdup(NarrowPathName(_path)))
 {
+  if (cache != NULL && RasterTileCache::IsRawDEM(path))
+    /* a raw DEM file loads as quickly as the cache, and its tiles
+       need no decoding; besides, the cache files may have been
+       created from a JPEG2000 file in the same map file */
+    cache = NULL;
+
   bool cache_loaded = false;
   if (cache != NULL) {
     /* load the cache file */
@@ -60,6 +68,9 @@ RasterMap::RasterMap(const TCHAR *_path, const TCHAR *world_file,
     }
   }
 
+  if (cache != NULL)
+    raster_tile_cache.SetFileCache(*cache, _path);
+
   projection.set(raster_tile_cache.GetBounds(),
                  raster_tile_cache.GetWidth() * 256,
                  raster_tile_cache.GetHeight() * 256);
@@ -75,11 +86,12 @@ angle_to_pixel(Angle value, Angle start, Angle end, unsigned width)
   return unsigned((value - start).Native() * width / (end - start).Native());
 }
 
-void
-RasterMap::SetViewCenter(const GeoPoint &location, fixed radius)
+bool
+RasterMap::PrepareTiles(const GeoPoint &location, fixed radius,
+                        const GeoPoint *prefetch, unsigned n_prefetch)
 {
   if (!raster_tile_cache.GetInitialised())
-    return;
+    return false;
 
   const GeoBounds &bounds = raster_tile_cache.GetBounds();
 
@@ -89,8 +101,24 @@ RasterMap::SetViewCenter(const GeoPoint &location, fixed radius)
   int y = angle_to_pixel(location.latitude, bounds.north, bounds.south,
                          raster_tile_cache.GetHeight());
 
-  raster_tile_cache.UpdateTiles(path, x, y,
-                                projection.distance_pixels(radius) / 256);
+  /* prefetch locations outside of the map are ignored */
+  RasterLocation prefetch_pixels[RasterTileCache::MAX_PREFETCH];
+  unsigned n_prefetch_pixels = 0;
+  for (unsigned i = 0; i < n_prefetch &&
+         n_prefetch_pixels < ARRAY_SIZE(prefetch_pixels); ++i)
+    if (bounds.IsInside(prefetch[i]))
+      prefetch_pixels[n_prefetch_pixels++] =
+        RasterLocation(angle_to_pixel(prefetch[i].longitude,
+                                      bounds.west, bounds.east,
+                                      raster_tile_cache.GetWidth()),
+                       angle_to_pixel(prefetch[i].latitude,
+                                      bounds.north, bounds.south,
+                                      raster_tile_cache.GetHeight()));
+
+  return raster_tile_cache.PrepareTiles(x, y,
+                                        projection.distance_pixels(radius)
+                                        / 256,
+                                        prefetch_pixels, n_prefetch_pixels);
 }
 
 short
@@ -107,6 +135,51 @@ RasterMap::GetInterpolatedHeight(const GeoPoint &location) const
   return raster_tile_cache.GetInterpolatedHeight(pt.x, pt.y);
 }
 
+void
+RasterMap::GetHeights(const GeoPoint *locations, short *heights,
+                      unsigned n) const
+{
+  /* project in chunks, to keep the stack usage bounded */
+  RasterLocation buffer[256];
+
+  while (n > 0) {
+    const unsigned chunk = std::min(n, (unsigned)ARRAY_SIZE(buffer));
+    for (unsigned i = 0; i < chunk; ++i)
+      buffer[i] = projection.project(locations[i]) >> 8;
+
+    raster_tile_cache.GetHeights(buffer, heights, chunk);
+
+    locations += chunk;
+    heights += chunk;
+    n -= chunk;
+  }
+}
+
+void
+RasterMap::GetHeights(const GeoPoint &start, const GeoPoint &end,
+                      short *heights, unsigned n) const
+{
+  assert(n > 0);
+
+  /* the raster projection is linear, so only the end points need to
+     be projected */
+  const RasterLocation a = projection.project(start);
+  const RasterLocation b = projection.project(end);
+  const int dx = (int)b.x - (int)a.x, dy = (int)b.y - (int)a.y;
+  const int d = n > 1 ? n - 1 : 1;
+
+  RasterLocation buffer[256];
+
+  for (unsigned i = 0; i < n;) {
+    const unsigned chunk = std::min(n - i, (unsigned)ARRAY_SIZE(buffer));
+    for (unsigned j = 0; j < chunk; ++j, ++i)
+      buffer[j] = RasterLocation(a.x + (int64_t)i * dx / d,
+                                 a.y + (int64_t)i * dy / d) >> 8;
+
+    raster_tile_cache.GetHeights(buffer, heights + i - chunk, chunk);
+  }
+}
+
 void
 RasterMap::ScanLine(const GeoPoint &start, const GeoPoint &end,
                     short *buffer, unsigned size, bool interpolate) const
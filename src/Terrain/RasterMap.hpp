@@ -59,7 +59,40 @@ public:
     return raster_tile_cache.GetBounds().GetCenter();
   }
 
-  void SetViewCenter(const GeoPoint &location, fixed radius);
+  /**
+   * Determine which tiles need to be loaded for the specified view
+   * center.  This is the first step of SetViewCenter(); the caller
+   * must have exclusive access.
+   *
+   * @param prefetch locations which will probably be viewed soon,
+   * most important first (see RasterTileCache::PrepareTiles())
+   * @return true if DecodeTiles() and CommitTiles() shall be called
+   */
+  bool PrepareTiles(const GeoPoint &location, fixed radius,
+                    const GeoPoint *prefetch=NULL, unsigned n_prefetch=0);
+
+  /**
+   * Decode the tiles selected by PrepareTiles().  Other threads may
+   * read from this object meanwhile.
+   */
+  void DecodeTiles() {
+    raster_tile_cache.DecodeTiles(path);
+  }
+
+  /**
+   * Make the tiles decoded by DecodeTiles() visible.  The caller must
+   * have exclusive access.
+   */
+  void CommitTiles() {
+    raster_tile_cache.CommitTiles();
+  }
+
+  void SetViewCenter(const GeoPoint &location, fixed radius) {
+    if (PrepareTiles(location, radius)) {
+      DecodeTiles();
+      CommitTiles();
+    }
+  }
 
   /**
    * Determines if SetViewCenter() should be called again to continue
@@ -74,6 +107,18 @@ public:
     return raster_tile_cache.GetSerial();
   }
 
+  /**
+   * @see RasterTileCache::SetMemoryBudget()
+   */
+  void SetMemoryBudget(size_t bytes) {
+    raster_tile_cache.SetMemoryBudget(bytes);
+  }
+
+  gcc_pure
+  RasterTileCache::Statistics GetTileStatistics() const {
+    return raster_tile_cache.GetStatistics();
+  }
+
   /**
    * @see RasterProjection::pixel_distance()
    */
@@ -96,6 +141,20 @@ public:
   gcc_pure
   short GetInterpolatedHeight(const GeoPoint &location) const;
 
+  /**
+   * Determine the non-interpolated heights at many locations at once.
+   * This is faster than calling GetHeight() in a loop.
+   */
+  void GetHeights(const GeoPoint *locations, short *heights,
+                  unsigned n) const;
+
+  /**
+   * Determine the non-interpolated heights at evenly spaced locations
+   * on a straight line, including both end points.
+   */
+  void GetHeights(const GeoPoint &start, const GeoPoint &end,
+                  short *heights, unsigned n) const;
+
   /**
    * Scan a straight line and fill the buffer with the specified
    * number of samples along the line.
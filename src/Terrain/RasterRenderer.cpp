@@ -23,16 +23,17 @@ Copyright_License {
 
 #include "Terrain/RasterRenderer.hpp"
 #include "Terrain/RasterMap.hpp"
+#include "Terrain/SlopeShader.hpp"
 #include "Math/FastMath.h"
 #include "Screen/Ramp.hpp"
 #include "Screen/Layout.hpp"
 #include "Projection/WindowProjection.hpp"
 #include "Asset.hpp"
+#include "Thread/ThreadPool.hpp"
 
 #include <assert.h>
 #include <stdint.h>
-
-//#define FAST_RSQRT
+#include <algorithm>
 
 static inline unsigned
 MIX(unsigned x, unsigned y, unsigned i)
@@ -75,6 +76,25 @@ RasterRenderer::~RasterRenderer()
   delete image;
 }
 
+void
+RasterRenderer::Buffer::Clear()
+{
+  HeightMatrix empty;
+  height_matrix.Swap(empty);
+
+  delete image;
+  image = NULL;
+}
+
+void
+RasterRenderer::Exchange(Buffer &buffer)
+{
+  height_matrix.Swap(buffer.height_matrix);
+  std::swap(image, buffer.image);
+  std::swap(quantisation_effective, buffer.quantisation_effective);
+  std::swap(pixel_size, buffer.pixel_size);
+}
+
 void
 RasterRenderer::ScanMap(const RasterMap &map, const WindowProjection &projection)
 {
@@ -107,7 +127,8 @@ RasterRenderer::ScanMap(const RasterMap &map, const WindowProjection &projection
     /* disable slope shading when zoomed out very far (too tiny) */
     quantisation_effective = 0;
 
-  height_matrix.Fill(map, projection, quantisation_pixels, true);
+  height_matrix.Update(map, projection, quantisation_pixels, true,
+                       &GetSharedThreadPool());
 }
 
 void
@@ -134,18 +155,54 @@ RasterRenderer::GenerateImage(bool do_shading,
     GenerateUnshadedImage(height_scale);
 }
 
+/**
+ * The number of bands GenerateImage() splits the image into.  There
+ * are more bands than threads, because rows outside of the map are
+ * cheaper than the others.
+ */
+static unsigned
+CountBands(const ThreadPool &pool)
+{
+  return pool.GetConcurrency() * 4;
+}
+
+struct UnshadedImageTask : public ThreadPool::Task {
+  RasterRenderer &renderer;
+  unsigned height_scale;
+
+  UnshadedImageTask(RasterRenderer &_renderer, unsigned _height_scale)
+    :renderer(_renderer), height_scale(_height_scale) {}
+
+  virtual void RunSlice(unsigned slice, unsigned n_slices) {
+    const unsigned height = renderer.GetHeight();
+    renderer.GenerateUnshadedRows(height_scale,
+                                  height * slice / n_slices,
+                                  height * (slice + 1) / n_slices);
+  }
+};
+
 void
 RasterRenderer::GenerateUnshadedImage(unsigned height_scale)
 {
-  const short *src = height_matrix.GetData();
+  UnshadedImageTask task(*this, height_scale);
+  ThreadPool &pool = GetSharedThreadPool();
+  pool.Run(task, CountBands(pool));
+
+  image->SetDirty();
+}
+
+void
+RasterRenderer::GenerateUnshadedRows(unsigned height_scale,
+                                     unsigned begin, unsigned end)
+{
+  const unsigned width = height_matrix.GetWidth();
+  const short *src = height_matrix.GetData() + begin * width;
   const BGRColor *oColorBuf = color_table + 64 * 256;
-  BGRColor *dest = image->GetTopRow();
 
-  for (unsigned y = height_matrix.GetHeight(); y > 0; --y) {
-    BGRColor *p = dest;
-    dest = image->GetNextRow(dest);
+  for (unsigned y = begin; y < end; ++y) {
+    BGRColor *p = image->GetRow(y);
 
-    for (unsigned x = height_matrix.GetWidth(); x > 0; --x) {
+    for (unsigned x = width; x > 0; --x) {
       short h = *src++;
       if (gcc_likely(!RasterBuffer::IsSpecial(h))) {
         if (h < 0)
@@ -162,10 +219,23 @@ RasterRenderer::GenerateUnshadedImage(unsigned height_scale)
       }
     }
   }
-
-  image->SetDirty();
 }
 
+struct SlopeImageTask : public ThreadPool::Task {
+  RasterRenderer &renderer;
+  const SlopeShader &shading;
+
+  SlopeImageTask(RasterRenderer &_renderer, const SlopeShader &_shading)
+    :renderer(_renderer), shading(_shading) {}
+
+  virtual void RunSlice(unsigned slice, unsigned n_slices) {
+    const unsigned height = renderer.GetHeight();
+    renderer.GenerateSlopeRows(shading,
+                               height * slice / n_slices,
+                               height * (slice + 1) / n_slices);
+  }
+};
+
 // JMW: if zoomed right in (e.g. one unit is larger than terrain
 // grid), then increase the step size to be equal to the terrain
 // grid for purposes of calculating slope, to avoid shading problems
@@ -178,131 +248,57 @@ RasterRenderer::GenerateSlopeImage(unsigned height_scale,
 {
   assert(quantisation_effective > 0);
 
-  PixelRect border;
-  border.left = quantisation_effective;
-  border.top = quantisation_effective;
-  border.right = height_matrix.GetWidth() - quantisation_effective;
-  border.bottom = height_matrix.GetHeight() - quantisation_effective;
+  SlopeShader shading;
+  shading.sx = sx;
+  shading.sy = sy;
+  shading.sz = sz;
+  shading.contrast = contrast;
+  shading.height_scale = height_scale;
+  shading.height_slope_factor = max(1, (int)pixel_size);
+  shading.quantisation = quantisation_effective;
 
-  const unsigned height_slope_factor = max(1, (int)pixel_size);
+  SlopeImageTask task(*this, shading);
+  ThreadPool &pool = GetSharedThreadPool();
+  pool.Run(task, CountBands(pool));
 
-  const short *src = height_matrix.GetData();
-  const BGRColor *oColorBuf = color_table + 64 * 256;
-#ifdef FAST_RSQRT
-  const short szindex = sz*contrast/128;
-  const short sval_min = szindex-64;
-  const short sval_max = szindex+63;
-  const BGRColor *szColorBuf = color_table + (64- szindex) * 256;
-  const int sx_c = sx*contrast>>7;
-  const int sy_c = sy*contrast>>7;
-  const int sz_c = sz*contrast>>7;
-#endif
-
-  BGRColor *dest = image->GetTopRow();
-
-  for (unsigned y = 0; y < height_matrix.GetHeight(); ++y) {
-    const unsigned row_plus_index = y < (unsigned)border.bottom
-      ? quantisation_effective
-      : height_matrix.GetHeight() - 1 - y;
-    const unsigned row_plus_offset = height_matrix.GetWidth() * row_plus_index;
+  image->SetDirty();
+}
 
-    const unsigned row_minus_index = y >= quantisation_effective
-      ? quantisation_effective : y;
-    const unsigned row_minus_offset = height_matrix.GetWidth() * row_minus_index;
+void
+RasterRenderer::GenerateSlopeRows(const SlopeShader &shading,
+                                  unsigned begin, unsigned end)
+{
+  const unsigned width = height_matrix.GetWidth();
+  const unsigned height = height_matrix.GetHeight();
+  const unsigned border_bottom = height - quantisation_effective;
 
-    const unsigned p31 = row_plus_index + row_minus_index;
+  uint16_t indices[width];
 
-    BGRColor *p = dest;
-    dest = image->GetNextRow(dest);
+  const short *src = height_matrix.GetData() + begin * width;
 
-    for (unsigned x = 0; x < height_matrix.GetWidth(); ++x, ++src) {
-      short h = *src;
-      if (gcc_likely(!RasterBuffer::IsSpecial(h))) {
-        if (h < 0)
-          h = 0;
+  for (unsigned y = begin; y < end; ++y, src += width) {
+    const unsigned row_plus_index = y < border_bottom
+      ? quantisation_effective
+      : height - 1 - y;
+    const unsigned row_minus_index = y >= quantisation_effective
+      ? quantisation_effective : y;
 
-        h = min(254, h >> height_scale);
+    assert(src - width * row_minus_index >= height_matrix.GetData());
+    assert(src + width * row_plus_index < height_matrix.GetDataEnd());
 
-        // no need to calculate slope if undefined height or sea level
-
-        // Y direction
-        assert(src - row_minus_offset >= height_matrix.GetData());
-        assert(src + row_plus_offset >= height_matrix.GetData());
-        assert(src - row_minus_offset < height_matrix.GetDataEnd());
-        assert(src + row_plus_offset < height_matrix.GetDataEnd());
-
-        // X direction
-
-        const unsigned column_plus_index = x < (unsigned)border.right
-          ? quantisation_effective
-          : height_matrix.GetWidth() - 1 - x;
-        const unsigned column_minus_index = x >= (unsigned)border.left
-          ? quantisation_effective : x;
-
-        assert(src - column_minus_index >= height_matrix.GetData());
-        assert(src + column_plus_index >= height_matrix.GetData());
-        assert(src - column_minus_index < height_matrix.GetDataEnd());
-        assert(src + column_plus_index < height_matrix.GetDataEnd());
-
-        short h_above = src[-(int)row_minus_offset];
-        short h_below = src[row_plus_offset];
-        short h_left = src[-(int)column_minus_index];
-        short h_right = src[column_plus_index];
-
-        if (gcc_unlikely(RasterBuffer::IsSpecial(h_above) ||
-                         RasterBuffer::IsSpecial(h_below) ||
-                         RasterBuffer::IsSpecial(h_left) ||
-                         RasterBuffer::IsSpecial(h_right))) {
-          /* some "special" terrain value surrounding us (water or
-             invalid), skip slope calculation */
-          *p++ = oColorBuf[h];
-          continue;
-        }
+    shading.ShadeRow(src, width, row_minus_index, row_plus_index, indices);
 
-        const int p32 = h_above - h_below;
-        const int p22 = h_right - h_left;
-
-        const unsigned p20 = column_plus_index + column_minus_index;
-
-        const int dd0 = p22 * p31;
-        const int dd1 = p20 * p32;
-        const int dd2 = p20 * p31 * height_slope_factor;
-#ifndef FAST_RSQRT
-        const int num = (dd2 * sz + dd0 * sx + dd1 * sy);
-        const int mag = (dd0 * dd0 + dd1 * dd1 + dd2 * dd2);
-#ifdef FIXED_MATH
-        const int sval = num / (int)isqrt4(mag);
-#else
-        const int sval = num / (int)sqrt((fixed)mag);
-#endif
-        int sindex = (sval - sz) * contrast / 128;
-        if (gcc_unlikely(sindex < -64))
-          sindex = -64;
-        if (gcc_unlikely(sindex > 63))
-          sindex = 63;
-        *p++ = oColorBuf[h + 256*sindex];
-#else
-        const int num = (dd2 * sz_c + dd0 * sx_c + dd1 * sy_c);
-        const int sval = i_normalise_mag3(num, dd0, dd1, dd2);
-        if (gcc_unlikely(sval<=sval_min))
-          *p++ = color_table[h];
-        else if (gcc_unlikely(sval >= sval_max))
-          *p++ = color_table[h + 127*256];
-        else
-          *p++ = szColorBuf[h + (sval*256)];
-
-#endif
-      } else if (RasterBuffer::IsWater(h)) {
-        // we're in the water, so look up the color for water
-        *p++ = oColorBuf[255];
-      } else {
+    BGRColor *p = image->GetRow(y);
+
+    for (unsigned x = 0; x < width; ++x) {
+      const uint16_t i = indices[x];
+      if (gcc_likely(i != SlopeShader::WHITE))
+        *p++ = color_table[i];
+      else
         /* outside the terrain file bounds: white background */
         *p++ = BGRColor(0xff, 0xff, 0xff);
-      }
     }
   }
-
-  image->SetDirty();
 }
 
 void
@@ -34,8 +34,38 @@ class Canvas;
 class RasterMap;
 class WindowProjection;
 struct ColorRamp;
+class SlopeShader;
 
 class RasterRenderer : private NonCopyable {
+public:
+  /**
+   * Storage for the results of ScanMap() and GenerateImage() outside
+   * of the renderer.  A caller which switches between several maps
+   * can keep one per map, and Exchange() it instead of rendering
+   * again.
+   */
+  class Buffer : private NonCopyable {
+    friend class RasterRenderer;
+
+    HeightMatrix height_matrix;
+    RawBitmap *image;
+    unsigned quantisation_effective;
+    fixed pixel_size;
+
+  public:
+    Buffer():image(NULL), quantisation_effective(0), pixel_size(fixed_zero) {}
+
+    ~Buffer() {
+      delete image;
+    }
+
+    /**
+     * Free the stored results.
+     */
+    void Clear();
+  };
+
+private:
   /** screen dimensions in coarse pixels */
   unsigned quantisation_pixels;
 
@@ -94,12 +124,24 @@ public:
     return *image;
   }
 
+  /**
+   * Exchange the height matrix and the image with the ones stored in
+   * the #Buffer.  The color table is not affected.
+   */
+  void Exchange(Buffer &buffer);
+
 protected:
   /**
    * Convert the height matrix into the image, without shading.
    */
   void GenerateUnshadedImage(unsigned height_scale);
 
+  /**
+   * Convert the specified range of rows for GenerateUnshadedImage().
+   */
+  void GenerateUnshadedRows(unsigned height_scale,
+                            unsigned begin, unsigned end);
+
   /**
    * Convert the height matrix into the image, with slope shading.
    */
@@ -112,6 +154,15 @@ protected:
   void GenerateSlopeImage(unsigned height_scale,
                           int contrast, int brightness,
                           const Angle sunazimuth);
+
+  /**
+   * Convert the specified range of rows for GenerateSlopeImage().
+   */
+  void GenerateSlopeRows(const SlopeShader &shading,
+                         unsigned begin, unsigned end);
+
+  friend struct UnshadedImageTask;
+  friend struct SlopeImageTask;
 };
 
 #endif
@@ -28,6 +28,9 @@ Copyright_License {
 
 #include <windef.h> /* for MAX_PATH */
 
+#include <limits>
+#include <stdint.h>
+
 // General, open/close
 
 RasterTerrain *
@@ -43,7 +46,11 @@ RasterTerrain::OpenTerrain(FileCache *cache, OperationEnvironment &operation)
     _tcscat(world_file_buffer, _T(DIR_SEPARATOR_S "terrain.j2w"));
     world_file = world_file_buffer;
 
-    _tcscat(szFile, _T("/terrain.jp2"));
+    /* prefer the raw DEM, which loads faster than JPEG2000 */
+    const size_t length = _tcslen(szFile);
+    _tcscat(szFile, _T(DIR_SEPARATOR_S "terrain.dem"));
+    if (!RasterTileCache::IsRawDEM(NarrowPathName(szFile)))
+      _tcscpy(szFile + length, _T(DIR_SEPARATOR_S "terrain.jp2"));
   } else
     return NULL;
 
@@ -53,5 +60,33 @@ RasterTerrain::OpenTerrain(FileCache *cache, OperationEnvironment &operation)
     return NULL;
   }
 
+  unsigned cache_size;
+  if (Profile::Get(szProfileTerrainCacheSize, cache_size) && cache_size > 0) {
+    /* the profile value is in megabytes; saturate instead of
+       overflowing on 32 bit targets */
+    const uint64_t budget = (uint64_t)cache_size << 20;
+    const size_t max_budget = std::numeric_limits<size_t>::max();
+    rt->map.SetMemoryBudget(budget < max_budget ? (size_t)budget : max_budget);
+  }
+
   return rt;
 }
+
+bool
+RasterTerrain::UpdateTiles(const GeoPoint &location, fixed radius,
+                           const GeoPoint *prefetch, unsigned n_prefetch)
+{
+  {
+    ExclusiveLease lease(*this);
+    if (!lease->PrepareTiles(location, radius, prefetch, n_prefetch))
+      return lease->IsDirty();
+  }
+
+  /* decode without holding the lock; this does not modify anything
+     the readers may see, and we are the only writer */
+  map.DecodeTiles();
+
+  ExclusiveLease lease(*this);
+  lease->CommitTiles();
+  return lease->IsDirty();
+}
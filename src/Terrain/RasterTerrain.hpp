@@ -78,10 +78,42 @@ public:
     return lease->GetHeight(location);
   }
 
+  /**
+   * Look up many heights while holding the lock only once.
+   *
+   * @see RasterMap::GetHeights()
+   */
+  void GetTerrainHeights(const GeoPoint *locations, short *heights,
+                         unsigned n) const {
+    Lease lease(*this);
+    lease->GetHeights(locations, heights, n);
+  }
+
+  gcc_pure
+  RasterTileCache::Statistics GetTileStatistics() const {
+    Lease lease(*this);
+    return lease->GetTileStatistics();
+  }
+
   GeoPoint GetTerrainCenter() const {
     return map.GetMapCenter();
   }
 
+  /**
+   * Load the tiles around the specified location.  Unlike
+   * RasterMap::SetViewCenter(), this method holds the exclusive lock
+   * only while the tile list is being modified, and other threads
+   * may query heights while the tiles are being decoded.  Must not be
+   * called by more than one thread at a time.
+   *
+   * @param prefetch locations which will probably be viewed soon,
+   * most important first (see RasterMap::PrepareTiles())
+   * @return true if not all tiles could be loaded yet, and this
+   * method should be called again soon (see RasterMap::IsDirty())
+   */
+  bool UpdateTiles(const GeoPoint &location, fixed radius,
+                   const GeoPoint *prefetch=NULL, unsigned n_prefetch=0);
+
 };
 
 #endif
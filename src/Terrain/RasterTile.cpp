@@ -60,16 +60,6 @@ RasterTile::LoadCache(FILE *file)
   return true;
 }
 
-void
-RasterTile::Enable()
-{
-  if (!width || !height) {
-    Disable();
-  } else {
-    buffer.Resize(width, height);
-  }
-}
-
 short
 RasterTile::GetHeight(unsigned x, unsigned y) const
 {
@@ -105,6 +95,17 @@ RasterTile::GetInterpolatedHeight(unsigned lx, unsigned ly,
   return buffer.GetInterpolated(lx, ly, ix, iy);
 }
 
+unsigned
+RasterTile::CalcDistance(int x, int y) const
+{
+  const unsigned int dx1 = abs(x - (int)xstart);
+  const unsigned int dx2 = abs((int)xend - x);
+  const unsigned int dy1 = abs(y - (int)ystart);
+  const unsigned int dy2 = abs((int)yend - y);
+
+  return std::max(std::min(dx1, dx2), std::min(dy1, dy2));
+}
+
 bool
 RasterTile::CheckTileVisibility(int view_x, int view_y, unsigned view_radius)
 {
@@ -113,12 +114,7 @@ RasterTile::CheckTileVisibility(int view_x, int view_y, unsigned view_radius)
     return false;
   }
 
-  const unsigned int dx1 = abs(view_x - (int)xstart);
-  const unsigned int dx2 = abs((int)xend - view_x);
-  const unsigned int dy1 = abs(view_y - (int)ystart);
-  const unsigned int dy2 = abs((int)yend - view_y);
-
-  distance = std::max(std::min(dx1, dx2), std::min(dy1, dy2));
+  distance = CalcDistance(view_x, view_y);
   return distance <= view_radius || IsEnabled();
 }
 
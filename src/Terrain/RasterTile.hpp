@@ -27,6 +27,7 @@ Copyright_License {
 #include "Terrain/RasterBuffer.hpp"
 #include "Util/NonCopyable.hpp"
 
+#include <assert.h>
 #include <stdio.h>
 
 class RasterTile : private NonCopyable {
@@ -44,14 +45,34 @@ public:
    */
   unsigned distance;
 
+  /**
+   * The RasterTileCache::PollTiles() stamp of the last call which
+   * found this tile in range.  Tiles which have not been used for a
+   * long time are discarded first.
+   */
+  unsigned last_used;
+
+  /**
+   * Why was this tile in range at #last_used?  0 means it was near
+   * the screen center, and higher values are prefetch locations in
+   * decreasing order of priority.
+   */
+  unsigned priority;
+
   bool request;
 
+  /**
+   * Was this tile loaded by the prefetcher, and has not been used
+   * near the screen center yet?
+   */
+  bool prefetched;
+
   RasterBuffer buffer;
 
 public:
   RasterTile()
     :xstart(0), ystart(0), xend(0), yend(0),
-     width(0), height(0) {}
+     width(0), height(0), last_used(0), priority(0), prefetched(false) {}
 
   void Set(unsigned _xstart, unsigned _ystart,
            unsigned _xend, unsigned _yend) {
@@ -79,6 +100,13 @@ public:
     return distance;
   }
 
+  /**
+   * Returns the size of the height buffer when this tile is loaded.
+   */
+  size_t GetBufferSize() const {
+    return width * height * sizeof(short);
+  }
+
   bool IsRequested() const {
     return request;
   }
@@ -94,13 +122,29 @@ public:
   bool SaveCache(FILE *file) const;
   bool LoadCache(FILE *file);
 
+  /**
+   * Calculate the distance of the specified location to this tile,
+   * in the metric used by #distance.
+   */
+  gcc_pure
+  unsigned CalcDistance(int x, int y) const;
+
   bool CheckTileVisibility(int view_x, int view_y, unsigned view_radius);
 
   void Disable() {
     buffer.Reset();
   }
 
-  void Enable();
+  /**
+   * Enable this tile with a buffer which was decoded elsewhere.  The
+   * previous (undefined) buffer is returned in the parameter.
+   */
+  void Enable(RasterBuffer &_buffer) {
+    assert(_buffer.GetWidth() == width);
+    assert(_buffer.GetHeight() == height);
+
+    buffer.Swap(_buffer);
+  }
   bool IsEnabled() const {
     return buffer.IsDefined();
   }
@@ -28,21 +28,45 @@ Copyright_License {
 #include "IO/ZipLineReader.hpp"
 #include "Operation/Operation.hpp"
 #include "Math/FastMath.h"
+#include "Thread/Local.hpp"
+#include "Thread/Mutex.hpp"
+#include "IO/FileCache.hpp"
+#include "OS/FileMapping.hpp"
+#include "Util/StringUtil.hpp"
+#include "OS/Clock.hpp"
+#include "OS/ByteOrder.hpp"
+
+#include <zzip/zzip.h>
+#include <zlib/zlib.h>
+
+extern "C" {
+#include "jasper/jpc/jpc_t1cod.h"
+}
 
 #include <stdlib.h>
+#include <string.h>
 #include <algorithm>
 #include <limits.h>
 
 using std::min;
 using std::max;
 
-short*
-RasterTileCache::GetImageBuffer(unsigned index)
-{
-  if (TileRequest(index))
-    return tiles.GetLinear(index).GetImageBuffer();
+static Mutex jasper_mutex;
+static bool jasper_initialised = false;
 
-  return NULL;
+/**
+ * Fill libjasper's global lookup tables.  This must be done before
+ * the first decoder runs, and never while another thread may be
+ * decoding.
+ */
+static void
+InitialiseJasper()
+{
+  ScopeLock protect(jasper_mutex);
+  if (!jasper_initialised) {
+    jpc_initluts();
+    jasper_initialised = true;
+  }
 }
 
 void
@@ -56,21 +80,33 @@ RasterTileCache::SetTile(unsigned index,
   tiles.GetLinear(index).Set(xstart, ystart, xend, yend);
 }
 
-struct RTDistanceSort {
+/**
+ * Sort tiles by the time they were last in range, most recent first.
+ * Tiles which are in range now are sorted by priority and distance.
+ */
+struct RTUsageSort {
   const RasterTileCache &rtc;
 
-  RTDistanceSort(RasterTileCache &_rtc):rtc(_rtc) {}
+  RTUsageSort(RasterTileCache &_rtc):rtc(_rtc) {}
 
   bool operator()(unsigned short ai, unsigned short bi) const {
     const RasterTile &a = rtc.tiles.GetLinear(ai);
     const RasterTile &b = rtc.tiles.GetLinear(bi);
 
+    if (a.last_used != b.last_used)
+      return (int)(a.last_used - b.last_used) > 0;
+
+    if (a.priority != b.priority)
+      return a.priority < b.priority;
+
     return a.GetDistance() < b.GetDistance();
   }
 };
 
 bool
-RasterTileCache::PollTiles(int x, int y, unsigned radius)
+RasterTileCache::PollTiles(int x, int y, unsigned radius,
+                           const RasterLocation *prefetch,
+                           unsigned n_prefetch)
 {
   if (scan_overview)
     return false;
@@ -81,69 +117,112 @@ RasterTileCache::PollTiles(int x, int y, unsigned radius)
      the screen will be loaded in advance */
   radius += 256;
 
-  enum {
-    /**
-     * Maximum number of tiles loaded at a time, to reduce system load
-     * peaks.
-    */
-    MAX_ACTIVATE = MAX_ACTIVE_TILES > 32 ? 16 : MAX_ACTIVE_TILES / 2,
-  };
+  ++poll_stamp;
 
-  /* query all tiles; all tiles which are either in range or already
-     loaded are added to RequestTiles */
+  /* query all tiles; all tiles which are either in range of the
+     view or of a prefetch location, or already loaded are added to
+     RequestTiles */
 
   request_tiles.clear();
-  for (int i = tiles.GetSize() - 1; i >= 0 && !request_tiles.full(); --i)
-    if (tiles.GetLinear(i).VisibilityChanged(x, y, radius))
+  size_t total_size = 0;
+  for (int i = tiles.GetSize() - 1; i >= 0 && !request_tiles.full(); --i) {
+    RasterTile &tile = tiles.GetLinear(i);
+    bool wanted = tile.VisibilityChanged(x, y, radius);
+    if (wanted && (unsigned)tile.GetDistance() <= radius) {
+      tile.last_used = poll_stamp;
+      tile.priority = 0;
+    } else if (tile.IsDefined()) {
+      for (unsigned j = 0; j < n_prefetch; ++j) {
+        if (tile.CalcDistance(prefetch[j].x, prefetch[j].y) <= radius) {
+          tile.last_used = poll_stamp;
+          tile.priority = j + 1;
+          wanted = true;
+          break;
+        }
+      }
+    }
+
+    if (wanted) {
       request_tiles.append(i);
+      total_size += tile.GetBufferSize();
+    }
+  }
+
+  /* sort by last use, and then by priority and distance; this puts
+     the tiles which are needed now before the prefetched ones */
+  const RTUsageSort sort(*this);
+  std::sort(request_tiles.begin(), request_tiles.end(), sort);
 
-  /* reduce if there are too many */
+  /* reduce if they do not fit in the memory budget */
 
-  if (request_tiles.size() > MAX_ACTIVE_TILES) {
-    /* sort by distance */
-    const RTDistanceSort sort(*this);
-    std::sort(request_tiles.begin(), request_tiles.end(), sort);
+  if (total_size > memory_budget) {
+    unsigned n = 0;
+    size_t size = 0;
+    while (n < request_tiles.size()) {
+      size += tiles.GetLinear(request_tiles[n]).GetBufferSize();
+      if (size > memory_budget)
+        break;
 
-    /* dispose all tiles which are out of range */
-    for (unsigned i = MAX_ACTIVE_TILES; i < request_tiles.size(); ++i) {
+      ++n;
+    }
+
+    /* dispose all tiles which do not fit */
+    for (unsigned i = n; i < request_tiles.size(); ++i) {
       RasterTile &tile = tiles.GetLinear(request_tiles[i]);
-      tile.Disable();
+      if (tile.IsEnabled()) {
+        tile.Disable();
+        ++statistics.evictions;
+      }
     }
 
-    request_tiles.shrink(MAX_ACTIVE_TILES);
+    request_tiles.shrink(n);
   }
 
   /* fill ActiveTiles and request new tiles */
 
   dirty = false;
 
-  unsigned num_activate = 0;
+  unsigned num_activate = 0, num_prefetch = 0;
   for (unsigned i = 0; i < request_tiles.size(); ++i) {
     RasterTile &tile = tiles.GetLinear(request_tiles[i]);
-    if (tile.IsEnabled())
-      continue;
+    const bool needed = tile.last_used == poll_stamp && tile.priority == 0;
 
-    if (++num_activate <= MAX_ACTIVATE)
-      /* request the tile in the current iteration */
-      tile.SetRequest();
-    else
-      /* this tile will be loaded in the next iteration */
-      dirty = true;
-  }
+    if (tile.IsEnabled()) {
+      if (needed) {
+        ++statistics.hits;
 
-  return num_activate > 0;
-}
+        if (tile.prefetched) {
+          ++statistics.prefetch_hits;
+          tile.prefetched = false;
+        }
+      }
 
-bool
-RasterTileCache::TileRequest(unsigned index)
-{
-  RasterTile &tile = tiles.GetLinear(index);
+      continue;
+    }
 
-  if (!tile.IsRequested())
-    return false;
+    if (needed) {
+      if (++num_activate <= MAX_ACTIVATE) {
+        /* request the tile in the current iteration */
+        tile.SetRequest();
+        tile.prefetched = false;
+        ++statistics.misses;
+      } else
+        /* this tile will be loaded in the next iteration */
+        dirty = true;
+    } else {
+      /* prefetch only when all needed tiles have been loaded (the
+         needed ones are sorted first) */
+      if (num_activate == 0 && num_prefetch < MAX_PREFETCH_ACTIVATE) {
+        tile.SetRequest();
+        tile.prefetched = true;
+        ++num_prefetch;
+        ++statistics.prefetched;
+      } else
+        dirty = true;
+    }
+  }
 
-  tile.Enable();
-  return true; // want to load this one!
+  return num_activate > 0 || num_prefetch > 0;
 }
 
 short
@@ -162,6 +241,41 @@ RasterTileCache::GetHeight(unsigned px, unsigned py) const
                                    py << (SUBPIXEL_BITS - OVERVIEW_BITS));
 }
 
+void
+RasterTileCache::GetHeights(const RasterLocation *locations, short *heights,
+                            unsigned n) const
+{
+  /* remember the previous tile; callers usually pass locations which
+     are close to each other, and this saves the tile lookup */
+  const RasterTile *tile = NULL;
+
+  for (unsigned i = 0; i < n; ++i) {
+    const unsigned px = locations[i].x, py = locations[i].y;
+
+    if (tile != NULL &&
+        px - tile->xstart < tile->width && py - tile->ystart < tile->height) {
+      heights[i] = tile->buffer.Get(px - tile->xstart, py - tile->ystart);
+      continue;
+    }
+
+    if (px >= width || py >= height) {
+      // outside overall bounds
+      heights[i] = RasterBuffer::TERRAIN_INVALID;
+      continue;
+    }
+
+    const RasterTile &t = tiles.Get(px / tile_width, py / tile_height);
+    if (t.IsEnabled()) {
+      tile = &t;
+      heights[i] = t.GetHeight(px, py);
+    } else
+      // still not found, so go to overview
+      heights[i] =
+        overview.GetInterpolated(px << (SUBPIXEL_BITS - OVERVIEW_BITS),
+                                 py << (SUBPIXEL_BITS - OVERVIEW_BITS));
+  }
+}
+
 short
 RasterTileCache::GetInterpolatedHeight(unsigned int lx, unsigned int ly) const
 {
@@ -218,10 +332,21 @@ RasterTileCache::Reset()
   initialised = false;
   bounds_initialised = false;
   segments.clear();
+  raw_dem = false;
   scan_overview = true;
 
   overview.Reset();
 
+  statistics = Statistics();
+
+  for (unsigned i = 0; i < num_pyramid_levels; ++i)
+    overview_pyramid[i].Reset();
+  num_pyramid_levels = 0;
+
+  for (unsigned i = 0; i < num_height_levels; ++i)
+    height_index[i].Reset();
+  num_height_levels = 0;
+
   for (auto it = tiles.begin(), end = tiles.end(); it != end; ++it)
     it->Disable();
 }
@@ -237,29 +362,35 @@ RasterTileCache::FindMarkerSegment(uint32_t file_offset) const
   return NULL;
 }
 
-long
-RasterTileCache::SkipMarkerSegment(long file_offset) const
+int
+RasterTileCache::DecodeJob::Find(unsigned index) const
 {
-  if (scan_overview)
-    /* use all segments when loading the overview */
-    return 0;
+  for (unsigned i = 0; i < tile_indices.size(); ++i)
+    if (tile_indices[i] == index)
+      return cached[i] ? -1 : (int)i;
+
+  return -1;
+}
 
+long
+RasterTileCache::DecodeJob::SkipMarkerSegment(long file_offset)
+{
   if (remaining_segments > 0) {
     /* enable the follow-up segment */
     --remaining_segments;
     return 0;
   }
 
-  const MarkerSegmentInfo *segment = FindMarkerSegment(file_offset);
+  const MarkerSegmentInfo *segment = cache->FindMarkerSegment(file_offset);
   if (segment == NULL)
     /* past the end of the recorded segment list; shouldn't happen */
     return 0;
 
+  const MarkerSegmentInfo *const end = cache->segments.end();
   long skip_to = segment->file_offset;
-  while (segment->IsTileSegment() &&
-         !tiles.GetLinear(segment->tile).IsRequested()) {
+  while (segment->IsTileSegment() && Find(segment->tile) < 0) {
     ++segment;
-    if (segment >= segments.end())
+    if (segment >= end)
       /* last segment is hidden; shouldn't happen either, because we
          expect EOC there */
       break;
@@ -271,6 +402,151 @@ RasterTileCache::SkipMarkerSegment(long file_offset) const
   return skip_to - file_offset;
 }
 
+short *
+RasterTileCache::DecodeJob::GetImageBuffer(unsigned index)
+{
+  const int i = Find(index);
+  if (i < 0)
+    return NULL;
+
+  const RasterTile &tile = cache->tiles.GetLinear(index);
+  if (!tile.IsDefined())
+    return NULL;
+
+  buffers[i].Resize(tile.width, tile.height);
+  return buffers[i].GetData();
+}
+
+extern ThreadLocalObject<RasterTileCache::DecodeJob *> raster_decode_job;
+
+void
+RasterTileCache::DecodeJob::Decode(const RasterTileCache &_cache,
+                                   const char *path)
+{
+  cache = &_cache;
+  remaining_segments = 0;
+  saved_bytes = 0;
+
+  if (cache->raw_dem) {
+    DecodeRawDEM(path);
+    return;
+  }
+
+  unsigned n_missing = 0;
+  for (unsigned i = 0; i < tile_indices.size(); ++i) {
+    cached[i] = cache->LoadTileCache(tile_indices[i], buffers[i]);
+    if (!cached[i])
+      ++n_missing;
+  }
+
+  if (n_missing == 0)
+    return;
+
+  jas_stream_t *in = jas_stream_fopen(path, "rb");
+  if (in == NULL)
+    return;
+
+  raster_decode_job = this;
+  jp2_decode(in, "xcsoar=1");
+  raster_decode_job = NULL;
+
+  jas_stream_close(in);
+
+  for (unsigned i = 0; i < tile_indices.size(); ++i)
+    if (!cached[i] && buffers[i].IsDefined() &&
+        cache->SaveTileCache(tile_indices[i], buffers[i]))
+      saved_bytes += buffers[i].GetWidth() * buffers[i].GetHeight()
+        * sizeof(*buffers[i].GetData());
+}
+
+void
+RasterTileCache::DecodeJob::Commit(RasterTileCache &cache)
+{
+  for (unsigned i = 0; i < tile_indices.size(); ++i) {
+    RasterTile &tile = cache.tiles.GetLinear(tile_indices[i]);
+    if (buffers[i].IsDefined() && tile.IsDefined()) {
+      tile.Enable(buffers[i]);
+      cache.UpdateHeightIndex(tile);
+      if (cached[i])
+        ++cache.statistics.restored;
+    } else {
+      /* permanently disable the requested tiles which could not be
+         loaded, to prevent trying to reload them over and over in a
+         busy loop */
+      tile.Clear();
+      buffers[i].Reset();
+    }
+  }
+
+  tile_indices.clear();
+}
+
+void
+RasterTileCache::DecodeJob::Clear()
+{
+  for (unsigned i = 0; i < tile_indices.size(); ++i)
+    buffers[i].Reset();
+
+  tile_indices.clear();
+}
+
+void
+RasterTileCache::DecodeJob::DecodeRawDEM(const char *path)
+{
+  /* the tile index makes the file cache pointless */
+  std::fill(cached, cached + tile_indices.size(), false);
+
+  ZZIP_FILE *file = zzip_fopen(path, "rb");
+  if (file == NULL)
+    return;
+
+  for (unsigned i = 0; i < tile_indices.size(); ++i)
+    if (!ReadRawDEMTile(file, tile_indices[i], buffers[i]))
+      buffers[i].Reset();
+
+  zzip_fclose(file);
+}
+
+bool
+RasterTileCache::DecodeJob::ReadRawDEMTile(ZZIP_FILE *file, unsigned index,
+                                           RasterBuffer &buffer)
+{
+  const RasterTile &tile = cache->tiles.GetLinear(index);
+  const RawDEMTile &location = cache->raw_tiles[index];
+  if (!tile.IsDefined() || location.size == 0)
+    return false;
+
+  const size_t n = tile.width * tile.height;
+  const size_t raw_size = n * sizeof(short);
+
+  if (zzip_seek(file, location.offset, SEEK_SET) !=
+      (zzip_off_t)location.offset)
+    return false;
+
+  buffer.Resize(tile.width, tile.height);
+  short *data = buffer.GetData();
+
+  if (location.size == raw_size) {
+    if (zzip_fread(data, 1, raw_size, file) != raw_size)
+      return false;
+  } else {
+    compressed.GrowDiscard(location.size);
+
+    uLongf size = raw_size;
+    if (zzip_fread(compressed.begin(), 1, location.size,
+                   file) != location.size ||
+        uncompress((Bytef *)data, &size, compressed.begin(),
+                   location.size) != Z_OK ||
+        size != raw_size)
+      return false;
+  }
+
+  for (size_t i = 0; i < n; ++i)
+    data[i] = FromLE16(data[i]);
+
+  return true;
+}
+
 /**
  * Does this segment belong to the preceding tile?  If yes, then it
  * inherits the tile number.
@@ -321,13 +597,15 @@ RasterTileCache::MarkerSegment(long file_offset, unsigned id)
                                       MarkerSegmentInfo::NO_TILE));
 }
 
-extern RasterTileCache *raster_tile_current;
+extern ThreadLocalObject<RasterTileCache *> raster_tile_current;
 
 void
 RasterTileCache::LoadJPG2000(const char *jp2_filename)
 {
   jas_stream_t *in;
 
+  InitialiseJasper();
+
   raster_tile_current = this;
 
   in = jas_stream_fopen(jp2_filename, "rb");
@@ -339,10 +617,264 @@ RasterTileCache::LoadJPG2000(const char *jp2_filename)
   if (operation != NULL)
     operation->SetProgressRange(jas_stream_length(in) / 65536);
 
-  jp2_decode(in, scan_overview ? "xcsoar=2" : "xcsoar=1");
+  jp2_decode(in, "xcsoar=2");
   jas_stream_close(in);
 }
 
+/**
+ * Convert a double to the little-endian bit pattern stored in raw DEM
+ * files.
+ */
+gcc_const
+static uint64_t
+ExportDouble(double value)
+{
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return ToLE64(bits);
+}
+
+gcc_const
+static double
+ImportDouble(uint64_t bits)
+{
+  bits = FromLE64(bits);
+  double value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+bool
+RasterTileCache::IsRawDEM(const char *path)
+{
+  ZZIP_FILE *file = zzip_fopen(path, "rb");
+  if (file == NULL)
+    return false;
+
+  uint32_t magic;
+  const bool result = zzip_fread(&magic, sizeof(magic), 1, file) == 1 &&
+    FromLE32(magic) == RawDEMHeader::MAGIC;
+  zzip_fclose(file);
+  return result;
+}
+
+void
+RasterTileCache::LoadRawDEM(const char *path)
+{
+  ZZIP_FILE *file = zzip_fopen(path, "rb");
+  if (file == NULL)
+    return;
+
+  RawDEMHeader header;
+  if (zzip_fread(&header, sizeof(header), 1, file) != 1 ||
+      FromLE32(header.magic) != RawDEMHeader::MAGIC ||
+      FromLE32(header.version) != RawDEMHeader::VERSION ||
+      FromLE32(header.compression) > RawDEMHeader::ZLIB) {
+    zzip_fclose(file);
+    return;
+  }
+
+  const unsigned _width = FromLE32(header.width);
+  const unsigned _height = FromLE32(header.height);
+  const unsigned _tile_width = FromLE32(header.tile_width);
+  const unsigned _tile_height = FromLE32(header.tile_height);
+  const unsigned tile_columns = FromLE32(header.tile_columns);
+  const unsigned tile_rows = FromLE32(header.tile_rows);
+  const unsigned n_tiles = tile_columns * tile_rows;
+  if (_width == 0 || _width > 1024 * 1024 ||
+      _height == 0 || _height > 1024 * 1024 ||
+      n_tiles == 0 || tile_columns > MAX_RTC_TILES ||
+      tile_rows > MAX_RTC_TILES || n_tiles > MAX_RTC_TILES ||
+      /* the tile grid must cover the whole raster */
+      _tile_width == 0 || _tile_height == 0 ||
+      (uint64_t)tile_columns * _tile_width < _width ||
+      (uint64_t)tile_rows * _tile_height < _height) {
+    zzip_fclose(file);
+    return;
+  }
+
+  SetSize(_width, _height, _tile_width, _tile_height,
+          tile_columns, tile_rows);
+  SetLatLonBounds(ImportDouble(header.bounds[0]),
+                  ImportDouble(header.bounds[1]),
+                  ImportDouble(header.bounds[3]),
+                  ImportDouble(header.bounds[2]));
+
+  /* load the tile index */
+  raw_tiles.GrowDiscard(n_tiles);
+  if (zzip_fread(raw_tiles.begin(), sizeof(RawDEMTile), n_tiles,
+                 file) != n_tiles) {
+    zzip_fclose(file);
+    return;
+  }
+
+  for (unsigned i = 0; i < n_tiles; ++i) {
+    RawDEMTile &tile = raw_tiles[i];
+    tile.xstart = FromLE32(tile.xstart);
+    tile.ystart = FromLE32(tile.ystart);
+    tile.xend = FromLE32(tile.xend);
+    tile.yend = FromLE32(tile.yend);
+    tile.offset = FromLE64(tile.offset);
+    tile.size = FromLE32(tile.size);
+
+    if (tile.xstart > tile.xend || tile.xend > _width ||
+        tile.ystart > tile.yend || tile.yend > _height ||
+        tile.size > (uint64_t)(tile.xend - tile.xstart) *
+        (tile.yend - tile.ystart) * sizeof(short)) {
+      zzip_fclose(file);
+      return;
+    }
+
+    SetTile(i, tile.xstart, tile.ystart, tile.xend, tile.yend);
+  }
+
+  /* load the overview */
+  const size_t overview_size = overview.GetWidth() * overview.GetHeight();
+  short *data = overview.GetData();
+  const bool success = zzip_fread(data, sizeof(*data), overview_size,
+                                  file) == overview_size;
+  zzip_fclose(file);
+  if (!success)
+    return;
+
+  for (size_t i = 0; i < overview_size; ++i)
+    data[i] = FromLE16(data[i]);
+
+  raw_dem = true;
+  initialised = true;
+}
+
+/**
+ * Write one tile to a raw DEM file.
+ *
+ * @param scratch a buffer for the little-endian and the compressed
+ * data
+ * @param size_r the number of bytes written
+ */
+static bool
+WriteRawDEMTile(FILE *file, const RasterBuffer &buffer, bool compress,
+                AllocatedArray<uint16_t> &scratch, uint32_t &size_r)
+{
+  const size_t n = buffer.GetWidth() * buffer.GetHeight();
+  const size_t raw_size = n * sizeof(uint16_t);
+  const uLong max_compressed_size = compressBound(raw_size);
+
+  scratch.GrowDiscard(n + (max_compressed_size + 1) / sizeof(uint16_t));
+  uint16_t *raw = scratch.begin();
+  Bytef *compressed = (Bytef *)(raw + n);
+
+  const short *src = buffer.GetData();
+  for (size_t i = 0; i < n; ++i)
+    raw[i] = ToLE16(src[i]);
+
+  uLongf compressed_size = max_compressed_size;
+  if (compress &&
+      compress2(compressed, &compressed_size, (const Bytef *)raw, raw_size,
+                Z_BEST_COMPRESSION) == Z_OK &&
+      compressed_size < raw_size) {
+    size_r = compressed_size;
+    return fwrite(compressed, 1, compressed_size, file) == compressed_size;
+  }
+
+  /* not compressible: store it raw */
+  size_r = raw_size;
+  return fwrite(raw, 1, raw_size, file) == raw_size;
+}
+
+bool
+RasterTileCache::SaveRawDEM(const char *path, FILE *file, bool compress)
+{
+  assert(initialised);
+  assert(bounds_initialised);
+  assert(!raw_dem);
+  assert(n_decode_jobs == 0);
+
+  const unsigned n_tiles = tiles.GetSize();
+  const size_t overview_size = overview.GetWidth() * overview.GetHeight();
+
+  RawDEMHeader header;
+  memset(&header, 0, sizeof(header));
+  header.magic = ToLE32(RawDEMHeader::MAGIC);
+  header.version = ToLE32(RawDEMHeader::VERSION);
+  header.width = ToLE32(width);
+  header.height = ToLE32(height);
+  header.tile_width = ToLE32(tile_width);
+  header.tile_height = ToLE32(tile_height);
+  header.tile_columns = ToLE32(tiles.GetWidth());
+  header.tile_rows = ToLE32(tiles.GetHeight());
+  header.compression = ToLE32(compress
+                              ? RawDEMHeader::ZLIB : RawDEMHeader::NONE);
+  header.bounds[0] = ExportDouble((double)bounds.west.Degrees());
+  header.bounds[1] = ExportDouble((double)bounds.east.Degrees());
+  header.bounds[2] = ExportDouble((double)bounds.north.Degrees());
+  header.bounds[3] = ExportDouble((double)bounds.south.Degrees());
+
+  /* the tile index is written after the tiles, when their sizes are
+     known; reserve space for it now */
+  AllocatedArray<RawDEMTile> index(n_tiles);
+  std::fill(index.begin(), index.end(), RawDEMTile());
+
+  AllocatedArray<uint16_t> scratch(overview_size);
+  const short *src = overview.GetData();
+  for (size_t i = 0; i < overview_size; ++i)
+    scratch[i] = ToLE16(src[i]);
+
+  if (fwrite(&header, sizeof(header), 1, file) != 1 ||
+      fwrite(index.begin(), sizeof(RawDEMTile), n_tiles, file) != n_tiles ||
+      fwrite(scratch.begin(), sizeof(uint16_t), overview_size,
+             file) != overview_size)
+    return false;
+
+  uint64_t offset = sizeof(header) + n_tiles * sizeof(RawDEMTile) +
+    overview_size * sizeof(uint16_t);
+
+  /* decode the tiles in batches, using all CPU cores; each job gets
+     consecutive tiles, so they are written in file order */
+
+  const unsigned concurrency = GetSharedThreadPool().GetConcurrency();
+  bool success = true;
+  for (unsigned next = 0; success && next < n_tiles;) {
+    for (n_decode_jobs = 0; n_decode_jobs < concurrency && next < n_tiles;
+         ++n_decode_jobs)
+      for (unsigned i = 0; i < MAX_ACTIVATE && next < n_tiles; ++i)
+        decode_jobs[n_decode_jobs].Add(next++);
+
+    DecodeTiles(path);
+
+    for (unsigned j = 0; j < n_decode_jobs; ++j) {
+      DecodeJob &job = decode_jobs[j];
+
+      for (unsigned i = 0; success && i < job.GetSize(); ++i) {
+        const unsigned tile_index = job.GetTileIndex(i);
+        const RasterTile &tile = tiles.GetLinear(tile_index);
+        RawDEMTile &entry = index[tile_index];
+        entry.xstart = ToLE32(tile.xstart);
+        entry.ystart = ToLE32(tile.ystart);
+        entry.xend = ToLE32(tile.xend);
+        entry.yend = ToLE32(tile.yend);
+
+        const RasterBuffer &buffer = job.GetBuffer(i);
+        if (!buffer.IsDefined())
+          /* leave this tile out */
+          continue;
+
+        uint32_t size;
+        success = WriteRawDEMTile(file, buffer, compress, scratch, size);
+        entry.offset = ToLE64(offset);
+        entry.size = ToLE32(size);
+        offset += size;
+      }
+
+      job.Clear();
+    }
+
+    n_decode_jobs = 0;
+  }
+
+  return success && fseek(file, sizeof(header), SEEK_SET) == 0 &&
+    fwrite(index.begin(), sizeof(RawDEMTile), n_tiles, file) == n_tiles;
+}
+
 bool
 RasterTileCache::LoadWorldFile(const TCHAR *path)
 {
@@ -412,9 +944,17 @@ RasterTileCache::LoadOverview(const char *path, const TCHAR *world_file,
 
   Reset();
 
-  LoadJPG2000(path);
+  if (IsRawDEM(path))
+    LoadRawDEM(path);
+  else
+    LoadJPG2000(path);
   scan_overview = false;
 
+  if (initialised) {
+    BuildOverviewPyramid();
+    BuildHeightIndex();
+  }
+
   if (initialised && world_file != NULL)
     LoadWorldFile(world_file);
 
@@ -428,29 +968,212 @@ RasterTileCache::LoadOverview(const char *path, const TCHAR *world_file,
   return initialised;
 }
 
-void
-RasterTileCache::UpdateTiles(const char *path, int x, int y, unsigned radius)
+bool
+RasterTileCache::PrepareTiles(int x, int y, unsigned radius,
+                              const RasterLocation *prefetch,
+                              unsigned n_prefetch)
 {
-  if (!PollTiles(x, y, radius))
-    return;
+  assert(n_decode_jobs == 0);
 
-  remaining_segments = 0;
+  if (!PollTiles(x, y, radius, prefetch, n_prefetch))
+    return false;
 
-  LoadJPG2000(path);
+  /* distribute the requested tiles over the jobs, round-robin */
 
-  /* permanently disable the requested tiles which are still not
-     loaded, to prevent trying to reload them over and over in a busy
-     loop */
+  const unsigned concurrency = GetSharedThreadPool().GetConcurrency();
+  unsigned n = 0;
   for (auto it = request_tiles.begin(), end = request_tiles.end();
-      it != end; ++it) {
-    RasterTile &tile = tiles.GetLinear(*it);
-    if (tile.IsRequested() && !tile.IsEnabled())
-      tile.Clear();
+       it != end; ++it) {
+    if (!tiles.GetLinear(*it).IsRequested())
+      continue;
+
+    decode_jobs[n % concurrency].Add(*it);
+    ++n;
+  }
+
+  n_decode_jobs = std::min(n, concurrency);
+  return true;
+}
+
+struct DecodeTilesTask : public ThreadPool::Task {
+  const RasterTileCache &cache;
+  RasterTileCache::DecodeJob *jobs;
+  const char *path;
+
+  DecodeTilesTask(const RasterTileCache &_cache,
+                  RasterTileCache::DecodeJob *_jobs, const char *_path)
+    :cache(_cache), jobs(_jobs), path(_path) {}
+
+  virtual void RunSlice(unsigned slice, unsigned n_slices) {
+    jobs[slice].Decode(cache, path);
   }
+};
+
+void
+RasterTileCache::DecodeTiles(const char *path)
+{
+  if (n_decode_jobs == 0)
+    return;
+
+  InitialiseJasper();
+
+  const uint64_t start_us = MonotonicClockUS();
+
+  DecodeTilesTask task(*this, decode_jobs, path);
+  GetSharedThreadPool().Run(task, n_decode_jobs);
+
+  last_decode_us = MonotonicClockUS() - start_us;
+
+  for (unsigned i = 0; i < n_decode_jobs; ++i)
+    file_cache_written += decode_jobs[i].GetSavedBytes();
+
+  /* scanning the cache directory is expensive, don't do it after
+     every tile */
+  if (file_cache_written > file_cache_budget / 16)
+    TrimTileCache();
+}
+
+void
+RasterTileCache::CommitTiles()
+{
+  for (unsigned i = 0; i < n_decode_jobs; ++i)
+    decode_jobs[i].Commit(*this);
+
+  n_decode_jobs = 0;
+
+  statistics.decode_us += last_decode_us;
+  last_decode_us = 0;
 
   ++serial;
 }
 
+RasterTileCache::Statistics
+RasterTileCache::GetStatistics() const
+{
+  Statistics result = statistics;
+  result.resident_tiles = 0;
+  result.resident_bytes = 0;
+
+  for (auto it = tiles.begin(), end = tiles.end(); it != end; ++it) {
+    if (it->IsEnabled()) {
+      ++result.resident_tiles;
+      result.resident_bytes += it->GetBufferSize();
+    }
+  }
+
+  return result;
+}
+
+RasterTileCache::~RasterTileCache()
+{
+  free(file_cache_original);
+}
+
+void
+RasterTileCache::SetFileCache(FileCache &cache, const TCHAR *original_path,
+                              uint64_t budget)
+{
+  free(file_cache_original);
+
+  file_cache = &cache;
+  file_cache_original = _tcsdup(original_path);
+  file_cache_budget = budget;
+
+  /* the tiles of a previous run may have been saved with a larger
+     budget */
+  TrimTileCache();
+}
+
+void
+RasterTileCache::TrimTileCache()
+{
+  assert(file_cache != NULL);
+
+  file_cache->Trim(_T("terrain-*"), file_cache_budget);
+  file_cache_written = 0;
+}
+
+void
+RasterTileCache::MakeTileCacheName(TCHAR *buffer, unsigned index) const
+{
+  StringFormatUnsafe(buffer, _T("terrain-%x.%x-%ux%u-%u"),
+                     (unsigned)TileCacheHeader::VERSION,
+                     (unsigned)CacheHeader::VERSION,
+                     (unsigned)tile_width, (unsigned)tile_height, index);
+}
+
+bool
+RasterTileCache::LoadTileCache(unsigned index, RasterBuffer &buffer) const
+{
+  if (file_cache == NULL)
+    return false;
+
+  const RasterTile &tile = tiles.GetLinear(index);
+  if (!tile.IsDefined())
+    return false;
+
+  TCHAR name[64];
+  MakeTileCacheName(name, index);
+
+  size_t offset;
+  FileMapping *mapping = file_cache->Map(name, file_cache_original, offset);
+  if (mapping == NULL)
+    return false;
+
+  const size_t size = tile.width * tile.height;
+  const TileCacheHeader *header =
+    (const TileCacheHeader *)mapping->at(offset);
+  const bool success = mapping->size() >= offset + sizeof(*header) &&
+    header->version == TileCacheHeader::VERSION &&
+    header->width == tile.width && header->height == tile.height &&
+    mapping->size() - offset - sizeof(*header) >=
+    size * sizeof(*buffer.GetData());
+  if (success) {
+    buffer.Resize(tile.width, tile.height);
+    memcpy(buffer.GetData(), header + 1, size * sizeof(*buffer.GetData()));
+  }
+
+  delete mapping;
+
+  if (success)
+    /* remember that this tile is still in use, see TrimTileCache() */
+    file_cache->Touch(name);
+  else
+    file_cache->Flush(name);
+
+  return success;
+}
+
+bool
+RasterTileCache::SaveTileCache(unsigned index,
+                               const RasterBuffer &buffer) const
+{
+  if (file_cache == NULL)
+    return false;
+
+  TCHAR name[64];
+  MakeTileCacheName(name, index);
+
+  FILE *file = file_cache->Save(name, file_cache_original);
+  if (file == NULL)
+    return false;
+
+  TileCacheHeader header;
+  header.version = TileCacheHeader::VERSION;
+  header.width = buffer.GetWidth();
+  header.height = buffer.GetHeight();
+
+  const size_t size = header.width * header.height;
+  if (fwrite(&header, sizeof(header), 1, file) != 1 ||
+      fwrite(buffer.GetData(), sizeof(*buffer.GetData()),
+             size, file) != size) {
+    file_cache->Cancel(name, file);
+    return false;
+  }
+
+  return file_cache->Commit(name, file);
+}
+
 bool
 RasterTileCache::SaveCache(FILE *file) const
 {
@@ -549,11 +1272,153 @@ RasterTileCache::LoadCache(FILE *file)
             overview_size, file) != overview_size)
     return false;
 
+  BuildOverviewPyramid();
+  BuildHeightIndex();
+
   initialised = true;
   scan_overview = false;
   return true;
 }
 
+void
+RasterTileCache::BuildOverviewPyramid()
+{
+  /* the pyramid is cheap to compute, so it is not stored in the
+     cache file; it is rebuilt from the overview each time */
+
+  num_pyramid_levels = 0;
+
+  const RasterBuffer *src = &overview;
+  while (num_pyramid_levels < OVERVIEW_PYRAMID_LEVELS &&
+         src->GetWidth() >= 4 && src->GetHeight() >= 4) {
+    RasterBuffer &level = overview_pyramid[num_pyramid_levels++];
+    level.Downsample(*src);
+    src = &level;
+  }
+}
+
+void
+RasterTileCache::BuildHeightIndex()
+{
+  num_height_levels = 0;
+
+  const unsigned overview_width = overview.GetWidth();
+  const unsigned overview_height = overview.GetHeight();
+  if (overview_width == 0 || overview_height == 0)
+    return;
+
+  /* level 0 covers the whole map; the last cells may be beyond the
+     overview, which is clipped just like in GetFieldDirect() */
+  unsigned index_width = (width + (1 << OVERVIEW_BITS) - 1) >> OVERVIEW_BITS;
+  unsigned index_height =
+    (height + (1 << OVERVIEW_BITS) - 1) >> OVERVIEW_BITS;
+
+  AllocatedGrid<HeightRange> &base = height_index[0];
+  base.GrowDiscard(index_width, index_height);
+  for (unsigned y = 0; y < index_height; ++y) {
+    for (unsigned x = 0; x < index_width; ++x) {
+      const short h = overview.Get(std::min(x, overview_width - 1),
+                                   std::min(y, overview_height - 1));
+      HeightRange &range = base.Get(x, y);
+      range.minimum = range.maximum = h;
+    }
+  }
+
+  num_height_levels = 1;
+
+  while (num_height_levels < HEIGHT_INDEX_LEVELS &&
+         (index_width > 1 || index_height > 1)) {
+    index_width = (index_width + 1) / 2;
+    index_height = (index_height + 1) / 2;
+    height_index[num_height_levels].GrowDiscard(index_width, index_height);
+
+    for (unsigned y = 0; y < index_height; ++y)
+      for (unsigned x = 0; x < index_width; ++x)
+        ReduceHeightIndex(num_height_levels, x, y);
+
+    ++num_height_levels;
+  }
+}
+
+void
+RasterTileCache::UpdateHeightIndex(const RasterTile &tile)
+{
+  if (num_height_levels == 0)
+    return;
+
+  AllocatedGrid<HeightRange> &base = height_index[0];
+  for (unsigned y = tile.ystart; y < tile.yend; ++y) {
+    const short *src = tile.buffer.GetDataAt(0, y - tile.ystart);
+    for (unsigned x = tile.xstart; x < tile.xend; ++x, ++src) {
+      HeightRange &range = base.Get(x >> OVERVIEW_BITS, y >> OVERVIEW_BITS);
+      if (*src < range.minimum)
+        range.minimum = *src;
+      else if (*src > range.maximum)
+        range.maximum = *src;
+    }
+  }
+
+  for (unsigned level = 1; level < num_height_levels; ++level) {
+    const unsigned shift = OVERVIEW_BITS + level;
+    for (unsigned y = tile.ystart >> shift; y <= (tile.yend - 1) >> shift; ++y)
+      for (unsigned x = tile.xstart >> shift;
+           x <= (tile.xend - 1) >> shift; ++x)
+        ReduceHeightIndex(level, x, y);
+  }
+}
+
+void
+RasterTileCache::ReduceHeightIndex(unsigned level, unsigned x, unsigned y)
+{
+  assert(level > 0 && level < HEIGHT_INDEX_LEVELS);
+
+  const AllocatedGrid<HeightRange> &src = height_index[level - 1];
+  const unsigned x_end = std::min(x * 2 + 2, src.GetWidth());
+  const unsigned y_end = std::min(y * 2 + 2, src.GetHeight());
+
+  HeightRange range = src.Get(x * 2, y * 2);
+  for (unsigned sy = y * 2; sy < y_end; ++sy) {
+    for (unsigned sx = x * 2; sx < x_end; ++sx) {
+      const HeightRange &r = src.Get(sx, sy);
+      range.minimum = std::min(range.minimum, r.minimum);
+      range.maximum = std::max(range.maximum, r.maximum);
+    }
+  }
+
+  height_index[level].Get(x, y) = range;
+}
+
+RasterTileCache::HeightRange
+RasterTileCache::GetHeightRange(unsigned x0, unsigned y0,
+                                unsigned x1, unsigned y1) const
+{
+  assert(num_height_levels > 0);
+  assert(x0 <= x1 && x1 < width);
+  assert(y0 <= y1 && y1 < height);
+
+  /* pick the finest level where the rectangle touches no more than
+     2x2 cells */
+  unsigned level = 0, shift = OVERVIEW_BITS;
+  while (level + 1 < num_height_levels &&
+         ((x1 >> shift) - (x0 >> shift) > 1 ||
+          (y1 >> shift) - (y0 >> shift) > 1)) {
+    ++level;
+    ++shift;
+  }
+
+  const AllocatedGrid<HeightRange> &grid = height_index[level];
+  HeightRange range = grid.Get(x0 >> shift, y0 >> shift);
+  for (unsigned y = y0 >> shift; y <= y1 >> shift; ++y) {
+    for (unsigned x = x0 >> shift; x <= x1 >> shift; ++x) {
+      const HeightRange &r = grid.Get(x, y);
+      range.minimum = std::min(range.minimum, r.minimum);
+      range.maximum = std::max(range.maximum, r.maximum);
+    }
+  }
+
+  return range;
+}
+
 struct GridLocation : public RasterLocation {
   unsigned short tile_x, tile_y;
   unsigned remainder_x, remainder_y;
@@ -851,6 +1716,27 @@ RasterTileCache::ScanLine(const RasterLocation _start,
   assert(_end.y < height << 8);
   assert(size >= 2);
 
+  /* when one sample covers two or more overview pixels, scanning the
+     tiles or the overview would alias; use the pyramid level which
+     matches the distance between two samples */
+  const unsigned footprint =
+    std::max(abs((int)_end.x - (int)_start.x),
+             abs((int)_end.y - (int)_start.y)) / (size - 1);
+  unsigned level = 0;
+  while (level < num_pyramid_levels &&
+         footprint >= 1u << (SUBPIXEL_BITS + OVERVIEW_BITS + level + 1))
+    ++level;
+
+  if (level > 0) {
+    const unsigned bits = OVERVIEW_BITS + level;
+    overview_pyramid[level - 1].ScanLineChecked(_start.x >> bits,
+                                                _start.y >> bits,
+                                                _end.x >> bits,
+                                                _end.y >> bits,
+                                                buffer, size, interpolate);
+    return;
+  }
+
   const GridRay ray(tile_width << 8, tile_height << 8, _start, _end, size);
   assert(ray.size == size);
   assert(ray.start.index == 0);
@@ -869,6 +1755,151 @@ RasterTileCache::ScanLine(const RasterLocation _start,
 #include <stdio.h>
 #endif
 
+/**
+ * A closed form of the line algorithm in FirstIntersection() and
+ * Intersection().  Each iteration moves one pixel along the major
+ * axis, and the number of moves along the minor axis can be
+ * calculated from the Bresenham error term.  This allows jumping to
+ * any iteration without walking the pixels before it.
+ */
+struct LineWalk {
+  int x0, y0, dx, dy, sx, sy;
+  bool x_major;
+  int major, minor;
+
+  LineWalk(int _x0, int _y0, int _dx, int _dy, int _sx, int _sy)
+    :x0(_x0), y0(_y0), dx(_dx), dy(_dy), sx(_sx), sy(_sy),
+     x_major(dx >= dy),
+     major(x_major ? dx : dy), minor(x_major ? dy : dx) {}
+
+  /**
+   * The number of moves along the minor axis in the first j
+   * iterations.
+   */
+  gcc_pure
+  int GetMinor(int j) const {
+    assert(major > 0);
+
+    return (int)(((int64_t)2 * j * minor + major - 1) / (2 * major));
+  }
+
+  /**
+   * The value of "total_steps" after j iterations.
+   */
+  gcc_pure
+  int GetSteps(int j) const {
+    return j + GetMinor(j);
+  }
+
+  /**
+   * Find the first iteration after which "total_steps" is at least
+   * n.
+   */
+  gcc_pure
+  int FindSteps(int n) const {
+    int j = (int)((int64_t)n * major / (major + minor));
+    while (GetSteps(j) < n)
+      ++j;
+    while (j > 0 && GetSteps(j - 1) >= n)
+      --j;
+    return j;
+  }
+
+  /**
+   * The number of iterations which reached the specified pixel.
+   */
+  gcc_pure
+  int GetIteration(int x, int y) const {
+    return x_major ? abs(x - x0) : abs(y - y0);
+  }
+
+  gcc_pure
+  int GetX(int j) const {
+    return x0 + sx * (x_major ? j : GetMinor(j));
+  }
+
+  gcc_pure
+  int GetY(int j) const {
+    return y0 + sy * (x_major ? GetMinor(j) : j);
+  }
+
+  /**
+   * The error term ("err") after j iterations.
+   */
+  gcc_pure
+  int GetError(int j) const {
+    const int64_t nx = x_major ? j : GetMinor(j);
+    const int64_t ny = x_major ? GetMinor(j) : j;
+    return (int)(dx - dy - nx * dy + ny * dx);
+  }
+
+  /**
+   * Find the last sample up to iteration #end, given a sample at
+   * iteration j.  The next sample is taken after the specified
+   * number of steps.
+   */
+  gcc_pure
+  int FindLastSample(int j, int step, int end) const {
+    while (true) {
+      const int next = FindSteps(GetSteps(j) + step);
+      if (next > end)
+        return j;
+
+      j = next;
+    }
+  }
+};
+
+bool
+RasterTileCache::GetHeightRange(const LineWalk &walk, int begin, int end,
+                                HeightRange &range) const
+{
+  if (num_height_levels == 0)
+    return false;
+
+  /* the line is monotonic, so its bounding box is spanned by the two
+     end points */
+  const int xa = walk.GetX(begin), xb = walk.GetX(end);
+  const int ya = walk.GetY(begin), yb = walk.GetY(end);
+  const int x_min = std::min(xa, xb), x_max = std::max(xa, xb);
+  const int y_min = std::min(ya, yb), y_max = std::max(ya, yb);
+  if (x_min < 0 || y_min < 0 ||
+      (unsigned)x_max >= width || (unsigned)y_max >= height)
+    return false;
+
+  range = GetHeightRange(x_min, y_min, x_max, y_max);
+  return true;
+}
+
+/**
+ * Calculate the aircraft height in FirstIntersection() after the
+ * specified number of steps.
+ */
+static inline short
+ClimbHeight(int total_steps, int slope_fact,
+            short h_origin, short h_dest, bool can_climb)
+{
+  const short dh = (short)((total_steps*slope_fact)>>RASTER_SLOPE_FACT);
+
+  short h_int = dh + h_origin;
+  if (can_climb) {
+    h_int = std::min(h_int, h_dest);
+  }
+
+  return h_int;
+}
+
+/**
+ * Calculate the aircraft height in Intersection() after the
+ * specified number of steps.
+ */
+static inline short
+GlideHeight(int total_steps, int slope_fact, short h_origin)
+{
+  const short dh = (short)((total_steps*slope_fact)>>RASTER_SLOPE_FACT);
+  return h_origin - dh;
+}
+
 bool
 RasterTileCache::FirstIntersection(int x0, int y0,
                                    int x1, int y1,
@@ -915,6 +1946,10 @@ RasterTileCache::FirstIntersection(int x0, int y0,
   // number of steps since intersection
   int intersect_counter = 0;
 
+  // don't consult the height index again before this step
+  int skip_steps = 0;
+  const LineWalk walk(x0, y0, dx, dy, sx, sy);
+
 #ifdef DEBUG_TILE
   printf("# max steps %d\n", max_steps);
   printf("# step coarse %d\n", step_coarse);
@@ -951,17 +1986,51 @@ RasterTileCache::FirstIntersection(int x0, int y0,
       if ((_x >= width) || (_y >= height))
         break; // outside bounds
 
+      if (!intersect_counter && total_steps >= skip_steps &&
+          max_steps > 0) {
+        /* jump over the samples where the aircraft is known to be
+           above the terrain; GetFieldDirect() does not update
+           tile_index, so samples are always step_coarse apart */
+        const int j = walk.GetIteration(x_int, y_int);
+        int clear = j;
+        for (int length = 4 * step_coarse;; length *= 2) {
+          const int end = std::min(j + length, walk.major);
+          HeightRange range;
+          if (!GetHeightRange(walk, j, end, range))
+            break;
+
+          const short h_begin = ClimbHeight(walk.GetSteps(j), slope_fact,
+                                            h_origin, h_dest, can_climb);
+          const short h_end = ClimbHeight(walk.GetSteps(end), slope_fact,
+                                          h_origin, h_dest, can_climb);
+          if (range.minimum + h_safety < 0 ||
+              range.maximum + h_safety > std::min(h_begin, h_end) ||
+              std::max(h_begin, h_end) > h_ceiling)
+            break;
+
+          clear = end;
+          if (end == walk.major)
+            break;
+        }
+
+        if (clear > j) {
+          const int sample = walk.FindLastSample(j, step_coarse, clear);
+          x_int = walk.GetX(sample);
+          y_int = walk.GetY(sample);
+          err = walk.GetError(sample);
+          total_steps = walk.GetSteps(sample);
+        } else
+          // terrain nearby; march the next few samples one by one
+          skip_steps = walk.GetSteps(std::min(j + 4 * step_coarse,
+                                              walk.major));
+      }
+
       h_terrain = GetFieldDirect(x_int, y_int, tile_index)+h_safety;
       step_counter = tile_index<0? step_coarse: step_fine;
 
-      // calculate height of glide so far
-      const short dh = (short)((total_steps*slope_fact)>>RASTER_SLOPE_FACT);
-
       // current aircraft height
-      h_int = dh + h_origin;
-      if (can_climb) {
-        h_int = std::min(h_int, h_dest);
-      }
+      h_int = ClimbHeight(total_steps, slope_fact,
+                          h_origin, h_dest, can_climb);
 
 #ifdef DEBUG_TILE
       printf("%d %d %d %d %d # fint\n", x_int, y_int, h_int, h_terrain, h_ceiling);
@@ -1136,6 +2205,10 @@ RasterTileCache::Intersection(int x0, int y0,
   // total counter of fine steps
   int total_steps = 0;
 
+  // don't consult the height index again before this step
+  int skip_steps = 0;
+  const LineWalk walk(x0, y0, dx, dy, sx, sy);
+
 #ifdef DEBUG_TILE
   printf("# max steps %d\n", max_steps);
   printf("# step coarse %d\n", step_coarse);
@@ -1156,14 +2229,46 @@ RasterTileCache::Intersection(int x0, int y0,
       if ((_x >= width) || (_y >= height))
         break; // outside bounds
 
+      if (total_steps >= skip_steps && max_steps > 0) {
+        /* jump over the samples where the aircraft is known to be
+           above the terrain (see FirstIntersection()); the walk may
+           overshoot the destination by one iteration */
+        const int j = walk.GetIteration(_x, _y);
+        int clear = j;
+        for (int length = 4 * step_coarse;; length *= 2) {
+          const int end = std::min(j + length, walk.major + 1);
+          HeightRange range;
+          if (!GetHeightRange(walk, j, end, range))
+            break;
+
+          const short h_low =
+            std::min(GlideHeight(walk.GetSteps(j), slope_fact, h_origin),
+                     GlideHeight(walk.GetSteps(end), slope_fact, h_origin));
+          if (range.minimum < 0 || range.maximum > h_low || h_low <= 0)
+            break;
+
+          clear = end;
+          if (end == walk.major + 1)
+            break;
+        }
+
+        if (clear > j) {
+          const int sample = walk.FindLastSample(j, step_coarse, clear);
+          _x = walk.GetX(sample);
+          _y = walk.GetY(sample);
+          err = walk.GetError(sample);
+          total_steps = walk.GetSteps(sample);
+        } else
+          // terrain nearby; march the next few samples one by one
+          skip_steps = walk.GetSteps(std::min(j + 4 * step_coarse,
+                                              walk.major + 1));
+      }
+
       h_terrain = GetFieldDirect(_x, _y, tile_index);
       step_counter = tile_index<0? step_coarse: step_fine;
 
-      // calculate height of glide so far
-      const short dh = (short)((total_steps*slope_fact)>>RASTER_SLOPE_FACT);
-
       // current aircraft height
-      h_int = h_origin-dh;
+      h_int = GlideHeight(total_steps, slope_fact, h_origin);
 
       if (h_int < h_terrain) {
         if (refine_step<3) // can't refine any further
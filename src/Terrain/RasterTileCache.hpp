@@ -25,10 +25,13 @@ Copyright_License {
 #define XCSOAR_RASTERTILE_CACHE_HPP
 
 #include "RasterTile.hpp"
+#include "RawDEM.hpp"
 #include "Geo/GeoBounds.hpp"
 #include "Util/NonCopyable.hpp"
 #include "Util/StaticArray.hpp"
+#include "Util/AllocatedArray.hpp"
 #include "Util/Serial.hpp"
+#include "Thread/ThreadPool.hpp"
 
 #include <assert.h>
 #include <tchar.h>
@@ -38,16 +41,19 @@ Copyright_License {
 
 #define RASTER_SLOPE_FACT 12
 
+struct zzip_file;
 struct RasterLocation;
 struct GridLocation;
+struct LineWalk;
 class OperationEnvironment;
+class FileCache;
 
 class RasterTileCache : private NonCopyable {
   static const unsigned MAX_RTC_TILES = 4096;
 
   /**
-   * The maximum number of tiles which are loaded at a time.  This
-   * must be limited because the amount of memory is finite.
+   * The default number of (256x256) tiles which may be loaded at a
+   * time; see #DEFAULT_MEMORY_BUDGET.
    */
 #if defined(ANDROID)
   static const unsigned MAX_ACTIVE_TILES = 128;
@@ -62,12 +68,40 @@ class RasterTileCache : private NonCopyable {
   static const unsigned MAX_ACTIVE_TILES = 16;
 #endif
 
+  /**
+   * Maximum number of tiles loaded at a time, to reduce system load
+   * peaks.
+   */
+  static const unsigned MAX_ACTIVATE =
+    MAX_ACTIVE_TILES > 32 ? 16 : MAX_ACTIVE_TILES / 2;
+
+  /**
+   * Maximum number of tiles prefetched at a time.  This is lower than
+   * #MAX_ACTIVATE, because the prefetcher runs between two frames and
+   * should not delay the next one.
+   */
+  static const unsigned MAX_PREFETCH_ACTIVATE =
+    MAX_ACTIVATE >= 8 ? MAX_ACTIVATE / 4 : 1;
+
   /**
    * The width and height of the terrain bitmap is shifted by this
    * number of bits to determine the overview size.
    */
   static const unsigned OVERVIEW_BITS = 4;
 
+  /**
+   * The number of reduced copies of the overview.  Each level has
+   * half the resolution of the previous one.
+   */
+  static const unsigned OVERVIEW_PYRAMID_LEVELS = 5;
+
+  /**
+   * The maximum number of levels in the #height_index.  Level 0 has
+   * the resolution of the overview, and each further level halves
+   * it.
+   */
+  static const unsigned HEIGHT_INDEX_LEVELS = 16;
+
   /**
    * Target number of steps in intersection searches; total distance
    * is shifted by this number of bits
@@ -83,8 +117,191 @@ public:
    */
   static const unsigned SUBPIXEL_BITS = 8;
 
+  /**
+   * The default value for SetMemoryBudget().  This must be limited
+   * because the amount of memory is finite.
+   */
+  static const size_t DEFAULT_MEMORY_BUDGET =
+    MAX_ACTIVE_TILES * 256 * 256 * sizeof(short);
+
+  /**
+   * The default size limit of the on-disk cache of decoded tiles,
+   * see SetFileCache().
+   */
+  static const uint64_t DEFAULT_FILE_CACHE_BUDGET =
+    4 * (uint64_t)DEFAULT_MEMORY_BUDGET;
+
+  /**
+   * The maximum number of prefetch locations passed to
+   * PrepareTiles().  Additional locations are ignored.
+   */
+  static const unsigned MAX_PREFETCH = 8;
+
+  /**
+   * Counters which describe how well the loaded tiles match the
+   * requests.  See GetStatistics().
+   */
+  struct Statistics {
+    /**
+     * The number of tiles requested by PrepareTiles() which were
+     * already loaded.
+     */
+    unsigned hits;
+
+    /**
+     * The number of tiles requested by PrepareTiles() which had to
+     * be loaded.
+     */
+    unsigned misses;
+
+    /**
+     * The number of loaded tiles which were restored from the file
+     * cache instead of being decoded.
+     */
+    unsigned restored;
+
+    /**
+     * The number of tiles which were loaded because they were near a
+     * prefetch location; they are not counted in #misses.
+     */
+    unsigned prefetched;
+
+    /**
+     * The number of prefetched tiles which were requested later.
+     */
+    unsigned prefetch_hits;
+
+    /**
+     * The number of loaded tiles which were discarded to stay within
+     * the memory budget.
+     */
+    unsigned evictions;
+
+    /**
+     * The total wall time spent in DecodeTiles() [us].
+     */
+    uint64_t decode_us;
+
+    /**
+     * The number of tiles which are currently loaded, and the size
+     * of their height buffers.
+     */
+    unsigned resident_tiles;
+    size_t resident_bytes;
+  };
+
+  /**
+   * The lowest and the highest terrain height within a block of
+   * pixels.
+   */
+  struct HeightRange {
+    short minimum, maximum;
+  };
+
+  /**
+   * A subset of the requested tiles, which gets decoded by one
+   * thread.  The pixels are written to buffers owned by this object,
+   * and are moved to the #RasterTile objects by Commit(), so readers
+   * of the #RasterTileCache are not disturbed while decoding.
+   */
+  class DecodeJob : private NonCopyable {
+    StaticArray<uint16_t, MAX_ACTIVATE> tile_indices;
+    RasterBuffer buffers[MAX_ACTIVATE];
+
+    const RasterTileCache *cache;
+
+    /**
+     * Was the tile restored from the file cache?  These tiles are not
+     * decoded again.
+     */
+    bool cached[MAX_ACTIVATE];
+
+    /**
+     * The number of remaining segments after the current one.
+     */
+    unsigned remaining_segments;
+
+    /**
+     * A buffer for reading compressed raw DEM tiles.
+     */
+    AllocatedArray<uint8_t> compressed;
+
+    /**
+     * The number of bytes which were written to the file cache by
+     * the last Decode() call.
+     */
+    uint64_t saved_bytes;
+
+  public:
+    void Add(unsigned index) {
+      tile_indices.append(index);
+    }
+
+    unsigned GetSize() const {
+      return tile_indices.size();
+    }
+
+    unsigned GetTileIndex(unsigned i) const {
+      return tile_indices[i];
+    }
+
+    const RasterBuffer &GetBuffer(unsigned i) const {
+      return buffers[i];
+    }
+
+    uint64_t GetSavedBytes() const {
+      return saved_bytes;
+    }
+
+    /**
+     * Forget the tiles of this job without committing them.
+     */
+    void Clear();
+
+    /**
+     * Decode all tiles of this job from the specified JPEG2000 or raw
+     * DEM file, or restore them from the file cache.  Does not modify
+     * the #RasterTileCache.
+     */
+    void Decode(const RasterTileCache &cache, const char *path);
+
+    /**
+     * Move the decoded tiles into the #RasterTileCache, and
+     * permanently disable the tiles which failed to load.
+     */
+    void Commit(RasterTileCache &cache);
+
+  private:
+    /**
+     * Read the tiles of this job from a raw DEM file.
+     */
+    void DecodeRawDEM(const char *path);
+
+    /**
+     * Read one tile from a raw DEM file into the specified buffer.
+     *
+     * @return true on success
+     */
+    bool ReadRawDEMTile(zzip_file *file, unsigned index,
+                        RasterBuffer &buffer);
+
+    /**
+     * Returns the position of the specified tile within this job, or
+     * -1 if it is not part of this job or does not need to be
+     * decoded.
+     */
+    gcc_pure
+    int Find(unsigned index) const;
+
+  public:
+    /* callback methods for libjasper (via jas_rtc.cpp) */
+
+    long SkipMarkerSegment(long file_offset);
+    short *GetImageBuffer(unsigned index);
+  };
+
 protected:
-  friend struct RTDistanceSort;
+  friend struct RTUsageSort;
 
   struct MarkerSegmentInfo {
     static const uint16_t NO_TILE = (uint16_t)-1;
@@ -114,6 +331,22 @@ protected:
     }
   };
 
+  /**
+   * The header of a file in the decoded tile cache.  It is followed
+   * by the raw (host byte order) height values.  Together with the
+   * #FileCache header, its size is a multiple of 16 bytes, so the
+   * height values are aligned and the file may be mapped into
+   * memory.
+   */
+  struct TileCacheHeader {
+    enum {
+      VERSION = 0x1,
+    };
+
+    unsigned version;
+    unsigned width, height;
+  };
+
   struct CacheHeader {
     enum {
 #ifdef FIXED_MATH
@@ -148,6 +381,29 @@ protected:
   unsigned short tile_width, tile_height;
 
   RasterBuffer overview;
+
+  /**
+   * Reduced copies of the #overview, built by BuildOverviewPyramid().
+   * Level i is downsampled by (OVERVIEW_BITS + i + 1) bits.  Only the
+   * first #num_pyramid_levels are defined.
+   */
+  RasterBuffer overview_pyramid[OVERVIEW_PYRAMID_LEVELS];
+  unsigned num_pyramid_levels;
+
+  /**
+   * Lower and upper height bounds for blocks of pixels, used by
+   * FirstIntersection() and Intersection() to skip over terrain
+   * which cannot be hit.  Level i has one cell per
+   * 2^(OVERVIEW_BITS+i) pixels in each direction.  The bounds are
+   * seeded from the #overview by BuildHeightIndex(), and widened by
+   * UpdateHeightIndex() for each tile which gets loaded.  They are
+   * never narrowed when a tile is discarded, so they include all
+   * values GetFieldDirect() may return.  Only the first
+   * #num_height_levels are defined.
+   */
+  AllocatedGrid<HeightRange> height_index[HEIGHT_INDEX_LEVELS];
+  unsigned num_height_levels;
+
   bool scan_overview;
   unsigned int width, height;
   unsigned int overview_width_fine, overview_height_fine;
@@ -157,9 +413,16 @@ protected:
   StaticArray<MarkerSegmentInfo, 8192> segments;
 
   /**
-   * The number of remaining segments after the current one.
+   * Is the terrain file a raw DEM (see RawDEM.hpp) instead of
+   * JPEG2000?
+   */
+  bool raw_dem;
+
+  /**
+   * The tile index of the raw DEM file, in host byte order.  Empty
+   * for JPEG2000 files.
    */
-  mutable unsigned remaining_segments;
+  AllocatedArray<RawDEMTile> raw_tiles;
 
   /**
    * An array that is used to sort the requested tiles by distance.
@@ -168,17 +431,112 @@ protected:
    */
   StaticArray<uint16_t, MAX_RTC_TILES> request_tiles;
 
+  /**
+   * The tiles which are going to be decoded by DecodeTiles(),
+   * distributed over the worker threads.
+   */
+  DecodeJob decode_jobs[ThreadPool::MAX_CONCURRENCY];
+  unsigned n_decode_jobs;
+
+  /**
+   * The duration of the last DecodeTiles() call [us].  It is added
+   * to #statistics by CommitTiles(), which has exclusive access.
+   */
+  uint64_t last_decode_us;
+
+  /**
+   * The maximum size of all loaded tile buffers [bytes].
+   */
+  size_t memory_budget;
+
+  /**
+   * Incremented by each PollTiles() call, and copied to the tiles
+   * which are in range to remember when they were last used.
+   */
+  unsigned poll_stamp;
+
+  Statistics statistics;
+
+  /**
+   * The cache for decoded tiles; NULL if disabled.  See
+   * SetFileCache().
+   */
+  FileCache *file_cache;
+
+  /**
+   * The path of the terrain file, which is used by #file_cache to
+   * validate the cached tiles.
+   */
+  TCHAR *file_cache_original;
+
+  /**
+   * The size limit of the decoded tiles in #file_cache [bytes].
+   */
+  uint64_t file_cache_budget;
+
+  /**
+   * The number of bytes written to #file_cache since it was last
+   * trimmed to #file_cache_budget.
+   */
+  uint64_t file_cache_written;
+
   /**
    * Progress callbacks for loading the file during startup.
    */
   OperationEnvironment *operation;
 
 public:
-  RasterTileCache():operation(NULL) {
+  RasterTileCache()
+    :num_pyramid_levels(0), num_height_levels(0),
+     n_decode_jobs(0), last_decode_us(0),
+     memory_budget(DEFAULT_MEMORY_BUDGET), poll_stamp(0),
+     file_cache(NULL), file_cache_original(NULL),
+     file_cache_budget(0), file_cache_written(0),
+     operation(NULL) {
     Reset();
   }
 
+  ~RasterTileCache();
+
 protected:
+  /**
+   * Fill #overview_pyramid from #overview.
+   */
+  void BuildOverviewPyramid();
+
+  /**
+   * Fill #height_index from #overview.
+   */
+  void BuildHeightIndex();
+
+  /**
+   * Widen the #height_index with the heights of a tile which was
+   * just loaded.
+   */
+  void UpdateHeightIndex(const RasterTile &tile);
+
+  /**
+   * Recalculate one cell of the #height_index from the level below.
+   */
+  void ReduceHeightIndex(unsigned level, unsigned x, unsigned y);
+
+  /**
+   * Determine bounds for all heights in the specified pixel
+   * rectangle (inclusive).  The bounds may be wider than the actual
+   * heights.
+   */
+  gcc_pure
+  HeightRange GetHeightRange(unsigned x0, unsigned y0,
+                             unsigned x1, unsigned y1) const;
+
+  /**
+   * Determine bounds for all heights which a line walk visits
+   * between the two iterations (inclusive).  Returns false if the
+   * #height_index is not available or if the line leaves the map.
+   */
+  bool GetHeightRange(const LineWalk &walk, int begin, int end,
+                      HeightRange &range) const;
+
   void ScanTileLine(GridLocation start, GridLocation end,
                     short *buffer, unsigned size, bool interpolate) const;
 
@@ -204,6 +562,16 @@ public:
   short GetInterpolatedHeight(unsigned int lx,
                               unsigned int ly) const;
 
+  /**
+   * Determine the non-interpolated heights at many pixel locations.
+   * This is equivalent to calling GetHeight() for each of them, but
+   * consecutive locations on the same tile share the tile lookup.
+   *
+   * @param locations the pixel locations; may be out of range
+   */
+  void GetHeights(const RasterLocation *locations, short *heights,
+                  unsigned n) const;
+
   /**
    * Scan a straight line and fill the buffer with the specified
    * number of samples along the line.
@@ -231,6 +599,12 @@ public:
 protected:
   void LoadJPG2000(const char *path);
 
+  /**
+   * Load the header, the tile index and the overview of a raw DEM
+   * file.  The tiles are read on demand by DecodeTiles().
+   */
+  void LoadRawDEM(const char *path);
+
   /**
    * Load a world file (*.tfw or *.j2w).
    */
@@ -251,7 +625,93 @@ public:
   bool SaveCache(FILE *file) const;
   bool LoadCache(FILE *file);
 
-  void UpdateTiles(const char *path, int x, int y, unsigned radius);
+  /**
+   * Does the specified file look like a raw DEM file?
+   */
+  static bool IsRawDEM(const char *path);
+
+  /**
+   * Convert the loaded JPEG2000 file to the raw DEM format.  All
+   * tiles are decoded, without loading them into this object.
+   *
+   * @param path the path of the JPEG2000 file which was passed to
+   * LoadOverview()
+   * @param file the destination file, opened in binary mode
+   * @param compress compress the tiles with zlib?
+   * @return true on success
+   */
+  bool SaveRawDEM(const char *path, FILE *file, bool compress);
+
+  /**
+   * Enable the on-disk cache of decoded tiles.  Tiles which have
+   * been decoded once are saved there, and are restored from it
+   * instead of being decoded from the JPEG2000 file again.  When
+   * the cached tiles exceed the given size, the least recently used
+   * ones are deleted.
+   *
+   * @param cache the #FileCache, which must exist until this object
+   * is destructed
+   * @param original_path the path of the terrain file
+   * @param budget the size limit of the cached tiles [bytes]
+   */
+  void SetFileCache(FileCache &cache, const TCHAR *original_path,
+                    uint64_t budget=DEFAULT_FILE_CACHE_BUDGET);
+
+  /**
+   * Limit the memory used by loaded tiles.  When more tiles are
+   * needed, the ones which have not been in range for the longest
+   * time are discarded first.  Takes effect at the next
+   * PrepareTiles() call.
+   *
+   * @param bytes the maximum total size of all tile buffers
+   */
+  void SetMemoryBudget(size_t bytes) {
+    memory_budget = bytes;
+  }
+
+  /**
+   * Returns the counters collected since the map was loaded.
+   */
+  gcc_pure
+  Statistics GetStatistics() const;
+
+  /**
+   * Determine which tiles need to be loaded for the specified view
+   * location, and schedule them for DecodeTiles().  Discards tiles
+   * which are out of range.  The caller must have exclusive access.
+   *
+   * Tiles near the prefetch locations are loaded only after all
+   * tiles near the view location, and only a few at a time; until
+   * then, IsDirty() returns true.
+   *
+   * @param prefetch locations which will probably be viewed soon,
+   * most important first; each is loaded with the same radius
+   * @return true if DecodeTiles() and CommitTiles() shall be called
+   */
+  bool PrepareTiles(int x, int y, unsigned radius,
+                    const RasterLocation *prefetch=NULL,
+                    unsigned n_prefetch=0);
+
+  /**
+   * Decode the tiles scheduled by PrepareTiles() on all CPU cores.
+   * This does not modify the state which is visible to readers, so
+   * other threads may query heights concurrently; however, it must
+   * not overlap with another PrepareTiles() or CommitTiles() call.
+   */
+  void DecodeTiles(const char *path);
+
+  /**
+   * Make the tiles decoded by DecodeTiles() visible.  The caller must
+   * have exclusive access.
+   */
+  void CommitTiles();
+
+  void UpdateTiles(const char *path, int x, int y, unsigned radius) {
+    if (PrepareTiles(x, y, radius)) {
+      DecodeTiles(path);
+      CommitTiles();
+    }
+  }
 
   /**
    * Determines if there are still tiles scheduled to be loaded.  Call
@@ -283,14 +743,40 @@ private:
   const MarkerSegmentInfo *
   FindMarkerSegment(uint32_t file_offset) const;
 
+  /**
+   * Returns the name of the specified tile in the file cache.  It
+   * contains the versions of the cache formats and the tile size,
+   * so tiles of a different layout are never loaded.
+   */
+  void MakeTileCacheName(TCHAR *buffer, unsigned index) const;
+
+  /**
+   * Restore a decoded tile from the file cache.  This method is
+   * thread-safe.
+   *
+   * @return true on success
+   */
+  bool LoadTileCache(unsigned index, RasterBuffer &buffer) const;
+
+  /**
+   * Save a decoded tile to the file cache.  This method is
+   * thread-safe.
+   *
+   * @return true on success
+   */
+  bool SaveTileCache(unsigned index, const RasterBuffer &buffer) const;
+
+  /**
+   * Delete the least recently used tiles from the file cache until
+   * they fit into #file_cache_budget.
+   */
+  void TrimTileCache();
+
 public:
   /* callback methods for libjasper (via jas_rtc.cpp) */
 
-  long SkipMarkerSegment(long file_offset) const;
   void MarkerSegment(long file_offset, unsigned id);
 
-  bool TileRequest(unsigned index);
-
   short *GetOverview() {
     return overview.GetData();
   }
@@ -298,7 +784,6 @@ public:
   void SetSize(unsigned width, unsigned height,
                unsigned tile_width, unsigned tile_height,
                unsigned tile_columns, unsigned tile_rows);
-  short* GetImageBuffer(unsigned index);
   void SetLatLonBounds(double lon_min, double lon_max,
                        double lat_min, double lat_max);
   void SetTile(unsigned index, int xstart, int ystart, int xend, int yend);
@@ -308,7 +793,8 @@ public:
   }
 
 protected:
-  bool PollTiles(int x, int y, unsigned radius);
+  bool PollTiles(int x, int y, unsigned radius,
+                 const RasterLocation *prefetch, unsigned n_prefetch);
 
 public:
   short GetMaxElevation() const {
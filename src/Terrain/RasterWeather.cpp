@@ -101,9 +101,17 @@ RasterWeather::RasterWeather()
     _parameter(0),
     _weather_time(0),
     reload(true),
-    weather_map(NULL)
+    weather_map(NULL),
+    maps_parameter(0),
+    n_maps(0),
+    selected_time(0),
+    view_location(Angle::Zero(), Angle::Zero()),
+    view_radius(fixed_zero),
+    preloader(*this)
 {
   std::fill(weather_available, weather_available + MAX_WEATHER_TIMES, false);
+  std::fill(maps, maps + MAX_WEATHER_TIMES, (RasterMap *)NULL);
+  std::fill(maps_failed, maps_failed + MAX_WEATHER_TIMES, false);
 }
 
 RasterWeather::~RasterWeather() 
@@ -145,6 +153,13 @@ RasterWeather::GetMap() const
   return weather_map;
 }
 
+Serial
+RasterWeather::GetSerial() const
+{
+  Poco::ScopedRWLock protect(lock, false);
+  return serial;
+}
+
 unsigned
 RasterWeather::GetParameter() const
 {
@@ -185,7 +200,7 @@ RasterWeather::GetFilename(TCHAR *rasp_filename, const TCHAR* name,
   LocalPath(rasp_filename, fname);
 }
 
-bool
+RasterMap *
 RasterWeather::LoadItem(const TCHAR* name, unsigned time_index,
                         OperationEnvironment &operation)
 {
@@ -194,12 +209,22 @@ RasterWeather::LoadItem(const TCHAR* name, unsigned time_index,
   RasterMap *map = new RasterMap(rasp_filename, NULL, NULL, operation);
   if (!map->isMapLoaded()) {
     delete map;
-    return false;
+    return NULL;
   }
 
-  delete weather_map;
-  weather_map = map;
-  return true;
+  return map;
+}
+
+RasterMap *
+RasterWeather::LoadItem(unsigned parameter, unsigned time_index,
+                        OperationEnvironment &operation)
+{
+  RasterMap *map = LoadItem(WeatherDescriptors[parameter].name, time_index,
+                            operation);
+  if (map == NULL && parameter == 1)
+    map = LoadItem(_T("wstar_bsratio"), time_index, operation);
+
+  return map;
 }
 
 bool
@@ -283,12 +308,8 @@ RasterWeather::Reload(int day_time, OperationEnvironment &operation)
     } else {
       found = true;
 
-      _Close();
-
-      if (!LoadItem(WeatherDescriptors[_parameter].name, _weather_time,
-                    operation) &&
-          _parameter == 1)
-        LoadItem(_T("wstar_bsratio"), _weather_time, operation);
+      SelectItem(_weather_time, operation);
+      preloader.Wake();
     }
   }
 
@@ -297,9 +318,205 @@ RasterWeather::Reload(int day_time, OperationEnvironment &operation)
     _weather_time = 0;
 }
 
+/**
+ * The preloading order of a time slot, relative to the selected one.
+ * Lower values come first, and later slots are preferred over
+ * earlier ones at the same distance.
+ */
+gcc_const
+static unsigned
+PreloadRank(unsigned time_index, unsigned selected_time)
+{
+  return time_index > selected_time
+    ? (time_index - selected_time) * 2 - 1
+    : (selected_time - time_index) * 2;
+}
+
+void
+RasterWeather::SelectItem(unsigned time_index,
+                          OperationEnvironment &operation)
+{
+  if (maps_parameter != _parameter) {
+    DropMaps();
+    maps_parameter = _parameter;
+  }
+
+  selected_time = time_index;
+
+  if (maps[time_index] == NULL && !maps_failed[time_index]) {
+    maps[time_index] = LoadItem(_parameter, time_index, operation);
+    if (maps[time_index] != NULL)
+      ++n_maps;
+    else
+      maps_failed[time_index] = true;
+  }
+
+  if (maps[time_index] != weather_map) {
+    weather_map = maps[time_index];
+
+    /* let SetViewCenter() load the tiles of the new map */
+    center = GeoPoint(Angle::Zero(), Angle::Zero());
+  }
+
+  TrimMaps();
+}
+
+void
+RasterWeather::TrimMaps()
+{
+  while (n_maps > MAX_CACHED_MAPS) {
+    unsigned victim = selected_time;
+    for (unsigned i = 0; i < MAX_WEATHER_TIMES; ++i)
+      if (maps[i] != NULL && i != selected_time &&
+          (victim == selected_time ||
+           PreloadRank(i, selected_time) > PreloadRank(victim, selected_time)))
+        victim = i;
+
+    assert(victim != selected_time);
+
+    delete maps[victim];
+    maps[victim] = NULL;
+    --n_maps;
+    ++serial;
+  }
+}
+
+void
+RasterWeather::DropMaps()
+{
+  for (unsigned i = 0; i < MAX_WEATHER_TIMES; ++i) {
+    delete maps[i];
+    maps[i] = NULL;
+    maps_failed[i] = false;
+  }
+
+  n_maps = 0;
+  ++serial;
+
+  weather_map = NULL;
+  center = GeoPoint(Angle::Zero(), Angle::Zero());
+}
+
+bool
+RasterWeather::FindPreload(unsigned &parameter, unsigned &time_index,
+                           GeoPoint &location, fixed &radius) const
+{
+  Poco::ScopedRWLock protect(lock, false);
+
+  if (_parameter == 0 || maps_parameter != _parameter)
+    /* wait for Reload() */
+    return false;
+
+  /* walk through the slots which are kept by TrimMaps(), in the
+     order of PreloadRank() */
+  unsigned n_wanted = 1;
+  for (unsigned distance = 1;
+       distance < MAX_WEATHER_TIMES && n_wanted < MAX_CACHED_MAPS;
+       ++distance) {
+    const unsigned candidates[2] = {
+      selected_time + distance,
+      selected_time - distance,
+    };
+
+    for (unsigned i = 0; i < 2 && n_wanted < MAX_CACHED_MAPS; ++i) {
+      const unsigned t = candidates[i];
+      if (t >= MAX_WEATHER_TIMES || !weather_available[t])
+        continue;
+
+      ++n_wanted;
+
+      if (maps[t] == NULL && !maps_failed[t]) {
+        parameter = maps_parameter;
+        time_index = t;
+        location = view_location;
+        radius = view_radius;
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+void
+RasterWeather::StorePreload(unsigned parameter, unsigned time_index,
+                            RasterMap *map)
+{
+  Poco::ScopedRWLock protect(lock, true);
+
+  if (parameter != maps_parameter || maps[time_index] != NULL) {
+    /* another item was selected meanwhile, or Reload() has loaded
+       this slot already */
+    delete map;
+    return;
+  }
+
+  if (map == NULL) {
+    maps_failed[time_index] = true;
+    return;
+  }
+
+  maps[time_index] = map;
+  ++n_maps;
+
+  TrimMaps();
+}
+
+void
+RasterWeather::Preloader::Wake()
+{
+  ScopeLock protect(mutex);
+  if (IsBusy())
+    again = true;
+  else
+    Trigger();
+}
+
+void
+RasterWeather::Preloader::Cancel()
+{
+  ScopeLock protect(mutex);
+  Stop();
+}
+
+void
+RasterWeather::Preloader::Tick()
+{
+  do {
+    again = false;
+    mutex.Unlock();
+
+    NullOperationEnvironment operation;
+    unsigned parameter, time_index;
+    GeoPoint location;
+    fixed radius;
+    bool stopped = false;
+
+    while (!stopped &&
+           weather.FindPreload(parameter, time_index, location, radius)) {
+      RasterMap *map = LoadItem(parameter, time_index, operation);
+      if (map != NULL && positive(radius)) {
+        do {
+          map->SetViewCenter(location, radius);
+        } while (map->IsDirty());
+      }
+
+      weather.StorePreload(parameter, time_index, map);
+
+      mutex.Lock();
+      stopped = IsStopped();
+      mutex.Unlock();
+    }
+
+    mutex.Lock();
+  } while (again && !IsStopped());
+}
+
 void
 RasterWeather::Close()
 {
+  preloader.Cancel();
+
   Poco::ScopedRWLock protect(lock, true);
   _Close();
 }
@@ -307,20 +524,25 @@ RasterWeather::Close()
 void
 RasterWeather::_Close()
 {
-  delete weather_map;
-  weather_map = NULL;
-  center = GeoPoint(Angle::Zero(), Angle::Zero());
+  DropMaps();
+  maps_parameter = 0;
 }
 
 void
 RasterWeather::SetViewCenter(const GeoPoint &location, fixed radius)
 {
-  if (_parameter == 0 || weather_map == NULL)
+  if (_parameter == 0)
     // will be drawing terrain
     return;
 
   Poco::ScopedRWLock protect(lock, true);
 
+  view_location = location;
+  view_radius = radius;
+
+  if (weather_map == NULL)
+    return;
+
   /* only update the RasterMap if the center was moved far enough */
   if (center.Distance(location) < fixed(1000))
     return;
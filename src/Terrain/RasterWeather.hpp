@@ -26,6 +26,8 @@ Copyright_License {
 
 #include "Geo/GeoPoint.hpp"
 #include "Poco/RWLock.h"
+#include "Thread/StandbyThread.hpp"
+#include "Util/Serial.hpp"
 #include "Compiler.h"
 
 #include <tchar.h>
@@ -42,18 +44,101 @@ public:
   static const unsigned MAX_WEATHER_MAP = 16; /**< Max number of items stored */
   static const unsigned MAX_WEATHER_TIMES = 48; /**< Max time segments of each item */
 
+  /**
+   * The maximum number of time slots of the selected item which are
+   * kept in memory.  The ones closest to the selected time are
+   * preferred.
+   */
+  static const unsigned MAX_CACHED_MAPS = 12;
+
 private:
+  /**
+   * Loads the time slots around the selected one in background, so
+   * switching to them does not block the caller of Reload().
+   */
+  class Preloader : public StandbyThread {
+    RasterWeather &weather;
+
+    /**
+     * Was Wake() called while the thread was busy?
+     */
+    bool again;
+
+  public:
+    Preloader(RasterWeather &_weather):weather(_weather), again(false) {}
+
+    /**
+     * Start loading the time slots which are missing.
+     */
+    void Wake();
+
+    /**
+     * Stop the thread and wait for it.
+     */
+    void Cancel();
+
+  protected:
+    virtual void Tick();
+  };
+
   GeoPoint center;
 
   unsigned _parameter;
   unsigned _weather_time;
   bool reload;
+
+  /**
+   * The map of the selected time slot, i.e. maps[selected_time].
+   */
   RasterMap *weather_map;
 
+  /**
+   * The loaded maps of the item #maps_parameter, indexed by time
+   * slot.
+   */
+  RasterMap *maps[MAX_WEATHER_TIMES];
+
+  /**
+   * Did loading the map of this time slot fail?  Such slots are not
+   * retried until another item is selected.
+   */
+  bool maps_failed[MAX_WEATHER_TIMES];
+
+  /**
+   * The item which #maps belong to.  0 means none.
+   */
+  unsigned maps_parameter;
+
+  /**
+   * The number of non-NULL elements in #maps.
+   */
+  unsigned n_maps;
+
+  /**
+   * The time slot of #weather_map.  The preloader loads the slots
+   * closest to this one.
+   */
+  unsigned selected_time;
+
+  /**
+   * Incremented each time a map is deleted.  Caches which refer to
+   * the maps returned by GetMap() must be flushed when this changes.
+   */
+  Serial serial;
+
+  /**
+   * The most recent parameters of SetViewCenter().  They are used to
+   * load the tiles of the preloaded maps.
+   */
+  GeoPoint view_location;
+  fixed view_radius;
+
   mutable Poco::RWLock lock;
 
   bool weather_available[MAX_WEATHER_TIMES];
 
+  Preloader preloader;
+
 public:
   /** 
    * Default constructor
@@ -78,6 +163,12 @@ public:
   gcc_pure
   const RasterMap *GetMap() const;
 
+  /**
+   * @see #serial
+   */
+  gcc_pure
+  Serial GetSerial() const;
+
   gcc_pure
   unsigned GetParameter() const;
 
@@ -106,13 +197,55 @@ private:
   static void GetFilename(TCHAR *rasp_filename, const TCHAR *name,
                           unsigned time_index);
 
-  bool LoadItem(const TCHAR* name, unsigned time_index,
-                OperationEnvironment &operation);
+  static RasterMap *LoadItem(const TCHAR* name, unsigned time_index,
+                             OperationEnvironment &operation);
+
+  /**
+   * Load the map of the specified item and time slot.
+   *
+   * @return the new map, or NULL on error
+   */
+  static RasterMap *LoadItem(unsigned parameter, unsigned time_index,
+                             OperationEnvironment &operation);
 
   gcc_pure
   bool ExistsItem(struct zzip_dir *dir, const TCHAR* name,
                   unsigned time_index) const;
 
+  /**
+   * Make the specified time slot of the selected item current,
+   * loading it if it is not in the cache yet.
+   */
+  void SelectItem(unsigned time_index, OperationEnvironment &operation);
+
+  /**
+   * Delete the oldest maps until no more than #MAX_CACHED_MAPS are
+   * left.  The selected one is never deleted.
+   */
+  void TrimMaps();
+
+  /**
+   * Delete all maps.
+   */
+  void DropMaps();
+
+  /**
+   * Determine the next time slot which shall be preloaded.  Called
+   * by the #Preloader.
+   *
+   * @return false if there is nothing to do
+   */
+  bool FindPreload(unsigned &parameter, unsigned &time_index,
+                   GeoPoint &location, fixed &radius) const;
+
+  /**
+   * Add a map loaded by the #Preloader to the cache.
+   *
+   * @param map the new map (ownership is transferred), or NULL if it
+   * failed to load
+   */
+  void StorePreload(unsigned parameter, unsigned time_index, RasterMap *map);
+
   void _Close();
 };
 
@@ -0,0 +1,92 @@
+/*
+Copyright_License {
+
+  XCSoar Glide Computer - http://www.xcsoar.org/
+  Copyright (C) 2000-2012 The XCSoar Project
+  A detailed list of copyright holders can be found in the file "AUTHORS".
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+}
+*/
+
+
+#ifndef XCSOAR_TERRAIN_RAW_DEM_HPP
+#define XCSOAR_TERRAIN_RAW_DEM_HPP
+
+#include <stdint.h>
+
+/*
+ * The "raw DEM" terrain file format, an alternative to JPEG2000
+ * which can be loaded without scanning the whole file.  All integers
+ * are little-endian.  A file consists of:
+ *
+ * - one #RawDEMHeader
+ * - one #RawDEMTile per tile, row by row
+ * - the overview: (width >> 4) * (height >> 4) int16 heights
+ * - the tile data, at the offsets specified in the tile index
+ *
+ * Each tile contains (xend - xstart) * (yend - ystart) int16 heights,
+ * row by row.  If the file is compressed, each tile is a separate
+ * zlib stream, unless it would not be smaller than the raw data.
+ */
+
+struct RawDEMHeader {
+  static const uint32_t MAGIC = 0x4d454458; /* "XDEM" */
+  static const uint32_t VERSION = 1;
+
+  enum Compression {
+    NONE = 0,
+    ZLIB = 1,
+  };
+
+  uint32_t magic, version;
+
+  uint32_t width, height;
+  uint32_t tile_width, tile_height;
+  uint32_t tile_columns, tile_rows;
+
+  /**
+   * One of the #Compression values.
+   */
+  uint32_t compression;
+
+  uint32_t reserved;
+
+  /**
+   * The bit patterns of the IEEE 754 double precision bounds in
+   * degrees: west, east, north, south.
+   */
+  uint64_t bounds[4];
+};
+
+struct RawDEMTile {
+  uint32_t xstart, ystart, xend, yend;
+
+  /**
+   * The position of the tile data within the file.
+   */
+  uint64_t offset;
+
+  /**
+   * The size of the tile data within the file [bytes].  If it equals
+   * the size of the heights, the tile is not compressed.  Zero means
+   * the tile is not available.
+   */
+  uint32_t size;
+
+  uint32_t reserved;
+};
+
+#endif
@@ -0,0 +1,472 @@
+/*
+Copyright_License {
+
+  XCSoar Glide Computer - http://www.xcsoar.org/
+  Copyright (C) 2000-2012 The XCSoar Project
+  A detailed list of copyright holders can be found in the file "AUTHORS".
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+}
+*/
+
+#include "Terrain/SlopeShader.hpp"
+#include "Terrain/RasterBuffer.hpp"
+#include "Math/FastMath.h"
+
+#include <algorithm>
+#include <assert.h>
+
+#ifdef HAVE_SLOPE_SHADING_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef HAVE_SLOPE_SHADING_NEON
+#include <arm_neon.h>
+#endif
+
+using std::min;
+
+/**
+ * The colour table index of the non-shaded colour of height 0.
+ */
+static const int COLOR_TABLE_NEUTRAL = 64 * 256;
+
+void
+SlopeShader::ShadeColumns(const short *src, unsigned width,
+                           unsigned row_minus_index, unsigned row_plus_index,
+                           unsigned x, unsigned x_end, uint16_t *dest) const
+{
+  assert(quantisation > 0);
+  assert(x <= x_end);
+  assert(x_end <= width);
+
+  const unsigned row_plus_offset = width * row_plus_index;
+  const unsigned row_minus_offset = width * row_minus_index;
+  const unsigned p31 = row_plus_index + row_minus_index;
+
+  const unsigned border_left = quantisation;
+  const unsigned border_right = width - quantisation;
+
+#ifdef FAST_RSQRT
+  const short szindex = sz*contrast/128;
+  const short sval_min = szindex-64;
+  const short sval_max = szindex+63;
+  const int sx_c = sx*contrast>>7;
+  const int sy_c = sy*contrast>>7;
+  const int sz_c = sz*contrast>>7;
+#endif
+
+  for (src += x; x < x_end; ++x, ++src) {
+    short h = *src;
+    if (gcc_likely(!RasterBuffer::IsSpecial(h))) {
+      if (h < 0)
+        h = 0;
+
+      h = min(254, h >> height_scale);
+
+      // no need to calculate slope if undefined height or sea level
+
+      // X direction
+
+      const unsigned column_plus_index = x < border_right
+        ? quantisation
+        : width - 1 - x;
+      const unsigned column_minus_index = x >= border_left
+        ? quantisation : x;
+
+      short h_above = src[-(int)row_minus_offset];
+      short h_below = src[row_plus_offset];
+      short h_left = src[-(int)column_minus_index];
+      short h_right = src[column_plus_index];
+
+      if (gcc_unlikely(RasterBuffer::IsSpecial(h_above) ||
+                       RasterBuffer::IsSpecial(h_below) ||
+                       RasterBuffer::IsSpecial(h_left) ||
+                       RasterBuffer::IsSpecial(h_right))) {
+        /* some "special" terrain value surrounding us (water or
+           invalid), skip slope calculation */
+        *dest++ = COLOR_TABLE_NEUTRAL + h;
+        continue;
+      }
+
+      const int p32 = h_above - h_below;
+      const int p22 = h_right - h_left;
+
+      const unsigned p20 = column_plus_index + column_minus_index;
+
+      const int dd0 = p22 * p31;
+      const int dd1 = p20 * p32;
+      const int dd2 = p20 * p31 * height_slope_factor;
+#ifndef FAST_RSQRT
+      const int num = (dd2 * sz + dd0 * sx + dd1 * sy);
+      const int mag = (dd0 * dd0 + dd1 * dd1 + dd2 * dd2);
+#ifdef FIXED_MATH
+      const int sval = num / (int)isqrt4(mag);
+#else
+      const int sval = num / (int)sqrt((fixed)mag);
+#endif
+      int sindex = (sval - sz) * contrast / 128;
+      if (gcc_unlikely(sindex < -64))
+        sindex = -64;
+      if (gcc_unlikely(sindex > 63))
+        sindex = 63;
+      *dest++ = COLOR_TABLE_NEUTRAL + h + 256 * sindex;
+#else
+      const int num = (dd2 * sz_c + dd0 * sx_c + dd1 * sy_c);
+      const int sval = i_normalise_mag3(num, dd0, dd1, dd2);
+      if (gcc_unlikely(sval<=sval_min))
+        *dest++ = h;
+      else if (gcc_unlikely(sval >= sval_max))
+        *dest++ = h + 127*256;
+      else
+        *dest++ = (64 - szindex + sval) * 256 + h;
+#endif
+    } else if (RasterBuffer::IsWater(h)) {
+      // we're in the water, so look up the color for water
+      *dest++ = COLOR_TABLE_NEUTRAL + 255;
+    } else {
+      /* outside the terrain file bounds: white background */
+      *dest++ = WHITE;
+    }
+  }
+}
+
+#ifdef HAVE_SLOPE_SHADING_SSE2
+
+/**
+ * Load four heights and sign-extend them to 32 bit.
+ */
+static inline __m128i
+LoadHeights(const short *p)
+{
+  const __m128i v = _mm_loadl_epi64((const __m128i *)p);
+  return _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+}
+
+/**
+ * Multiply 32 bit integers, keeping the lower 32 bits of each
+ * product, just like the scalar multiplication does (SSE2 lacks
+ * PMULLD).
+ */
+static inline __m128i
+MultiplyLow(__m128i a, __m128i b)
+{
+  const __m128i even = _mm_mul_epu32(a, b);
+  const __m128i odd = _mm_mul_epu32(_mm_srli_si128(a, 4),
+                                    _mm_srli_si128(b, 4));
+  return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                            _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+static inline __m128i
+Select(__m128i mask, __m128i a, __m128i b)
+{
+  return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+/**
+ * Calculate (int)sqrt((double)mag) for four integers.
+ */
+static inline __m128i
+IntegerSquareRoot(__m128i mag)
+{
+  const __m128d lo = _mm_sqrt_pd(_mm_cvtepi32_pd(mag));
+  const __m128d hi =
+    _mm_sqrt_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(mag,
+                                                  _MM_SHUFFLE(1, 0, 3, 2))));
+  return _mm_unpacklo_epi64(_mm_cvttpd_epi32(lo), _mm_cvttpd_epi32(hi));
+}
+
+/**
+ * Calculate the truncating integer division a / b for four
+ * integers.  The double precision quotient of two 32 bit integers
+ * is never rounded across an integer boundary, so truncating it
+ * yields the exact result.
+ */
+static inline __m128i
+Divide(__m128i a, __m128i b)
+{
+  const __m128i a_hi = _mm_shuffle_epi32(a, _MM_SHUFFLE(1, 0, 3, 2));
+  const __m128i b_hi = _mm_shuffle_epi32(b, _MM_SHUFFLE(1, 0, 3, 2));
+  const __m128d lo = _mm_div_pd(_mm_cvtepi32_pd(a), _mm_cvtepi32_pd(b));
+  const __m128d hi = _mm_div_pd(_mm_cvtepi32_pd(a_hi),
+                                _mm_cvtepi32_pd(b_hi));
+  return _mm_unpacklo_epi64(_mm_cvttpd_epi32(lo), _mm_cvttpd_epi32(hi));
+}
+
+unsigned
+SlopeShader::ShadeColumnsSSE2(const short *src, unsigned width,
+                               unsigned row_minus_index,
+                               unsigned row_plus_index,
+                               uint16_t *dest) const
+{
+  const unsigned row_plus_offset = width * row_plus_index;
+  const unsigned row_minus_offset = width * row_minus_index;
+  const unsigned p31 = row_plus_index + row_minus_index;
+
+  /* all columns in this range have both neighbours at the full
+     quantisation distance */
+  const unsigned p20 = 2 * quantisation;
+  const int dd2 = p20 * p31 * height_slope_factor;
+
+  const __m128i v_special = _mm_set1_epi32(RasterBuffer::TERRAIN_WATER_THRESHOLD + 1);
+  const __m128i v_invalid = _mm_set1_epi32(RasterBuffer::TERRAIN_INVALID);
+  const __m128i v_p31 = _mm_set1_epi32(p31);
+  const __m128i v_p20 = _mm_set1_epi32(p20);
+  const __m128i v_dd2 = _mm_set1_epi32(dd2);
+  const __m128i v_sx = _mm_set1_epi32(sx);
+  const __m128i v_sy = _mm_set1_epi32(sy);
+  const __m128i v_sz = _mm_set1_epi32(sz);
+  const __m128i v_contrast = _mm_set1_epi32(contrast);
+  const __m128i v_zero = _mm_setzero_si128();
+  const __m128i v_254 = _mm_set1_epi16(254);
+  const __m128i v_height_scale = _mm_cvtsi32_si128(height_scale);
+  const __m128i v_127 = _mm_set1_epi32(127);
+  const __m128i v_min_sindex = _mm_set1_epi32(-64);
+  const __m128i v_max_sindex = _mm_set1_epi32(63);
+  const __m128i v_neutral = _mm_set1_epi32(COLOR_TABLE_NEUTRAL);
+  const __m128i v_water = _mm_set1_epi32(COLOR_TABLE_NEUTRAL + 255);
+  const __m128i v_white = _mm_set1_epi32(-1);
+
+  /* the scalar product dd2*sz and the square dd2*dd2 are the same
+     for all pixels of this row */
+  const __m128i v_dd2_sz = MultiplyLow(v_dd2, v_sz);
+  const __m128i v_dd2_dd2 = MultiplyLow(v_dd2, v_dd2);
+
+  unsigned x = quantisation;
+  const unsigned x_end = width - quantisation;
+  for (; x + 4 <= x_end; x += 4) {
+    const short *p = src + x;
+
+    const __m128i h = LoadHeights(p);
+    const __m128i h_above = LoadHeights(p - row_minus_offset);
+    const __m128i h_below = LoadHeights(p + row_plus_offset);
+    const __m128i h_left = LoadHeights(p - quantisation);
+    const __m128i h_right = LoadHeights(p + quantisation);
+
+    const __m128i special = _mm_cmplt_epi32(h, v_special);
+    const __m128i water = _mm_andnot_si128(_mm_cmpeq_epi32(h, v_invalid),
+                                           special);
+    const __m128i neighbour_special =
+      _mm_or_si128(_mm_or_si128(_mm_cmplt_epi32(h_above, v_special),
+                                _mm_cmplt_epi32(h_below, v_special)),
+                   _mm_or_si128(_mm_cmplt_epi32(h_left, v_special),
+                                _mm_cmplt_epi32(h_right, v_special)));
+
+    /* clip the height to the colour table (in 16 bit, because SSE2
+       has signed 16 bit min/max, but not 32 bit) */
+    __m128i h16 = _mm_packs_epi32(h, h);
+    h16 = _mm_max_epi16(h16, v_zero);
+    h16 = _mm_srl_epi16(h16, v_height_scale);
+    h16 = _mm_min_epi16(h16, v_254);
+    const __m128i hc = _mm_unpacklo_epi16(h16, v_zero);
+
+    const __m128i p32 = _mm_sub_epi32(h_above, h_below);
+    const __m128i p22 = _mm_sub_epi32(h_right, h_left);
+
+    const __m128i dd0 = MultiplyLow(p22, v_p31);
+    const __m128i dd1 = MultiplyLow(v_p20, p32);
+
+    const __m128i num =
+      _mm_add_epi32(_mm_add_epi32(v_dd2_sz, MultiplyLow(dd0, v_sx)),
+                    MultiplyLow(dd1, v_sy));
+    const __m128i mag =
+      _mm_add_epi32(_mm_add_epi32(MultiplyLow(dd0, dd0),
+                                  MultiplyLow(dd1, dd1)),
+                    v_dd2_dd2);
+
+    const __m128i sval = Divide(num, IntegerSquareRoot(mag));
+
+    /* sindex = (sval - sz) * contrast / 128, rounding towards zero */
+    __m128i sindex = MultiplyLow(_mm_sub_epi32(sval, v_sz), v_contrast);
+    sindex = _mm_add_epi32(sindex,
+                           _mm_and_si128(_mm_srai_epi32(sindex, 31), v_127));
+    sindex = _mm_srai_epi32(sindex, 7);
+    sindex = Select(_mm_cmplt_epi32(sindex, v_min_sindex),
+                    v_min_sindex, sindex);
+    sindex = Select(_mm_cmpgt_epi32(sindex, v_max_sindex),
+                    v_max_sindex, sindex);
+
+    const __m128i neutral = _mm_add_epi32(v_neutral, hc);
+    const __m128i shaded = _mm_add_epi32(neutral, _mm_slli_epi32(sindex, 8));
+
+    __m128i result = Select(neighbour_special, neutral, shaded);
+    result = Select(special, Select(water, v_water, v_white), result);
+
+    /* all values are between -1 and 32767, so signed saturation
+       does not alter them */
+    _mm_storel_epi64((__m128i *)(dest + x), _mm_packs_epi32(result, result));
+  }
+
+  return x;
+}
+
+#endif
+
+#ifdef HAVE_SLOPE_SHADING_NEON
+
+/**
+ * Load four heights and sign-extend them to 32 bit.
+ */
+static inline int32x4_t
+LoadHeights(const short *p)
+{
+  return vmovl_s16(vld1_s16(p));
+}
+
+/**
+ * Calculate num / (int)sqrt((double)mag) for four integers, exactly
+ * like the scalar code does.  ARMv7 NEON has no double precision
+ * arithmetic and 32 bit floats are not precise enough, so this is
+ * done one lane at a time on the VFP.
+ */
+static inline int32x4_t
+ShadeValue(int32x4_t num, int32x4_t mag)
+{
+  int32_t n[4], m[4];
+  vst1q_s32(n, num);
+  vst1q_s32(m, mag);
+
+  for (unsigned i = 0; i < 4; ++i)
+    n[i] /= (int)sqrt((fixed)m[i]);
+
+  return vld1q_s32(n);
+}
+
+unsigned
+SlopeShader::ShadeColumnsNEON(const short *src, unsigned width,
+                               unsigned row_minus_index,
+                               unsigned row_plus_index,
+                               uint16_t *dest) const
+{
+  const unsigned row_plus_offset = width * row_plus_index;
+  const unsigned row_minus_offset = width * row_minus_index;
+  const unsigned p31 = row_plus_index + row_minus_index;
+
+  /* all columns in this range have both neighbours at the full
+     quantisation distance */
+  const unsigned p20 = 2 * quantisation;
+  const int dd2 = p20 * p31 * height_slope_factor;
+
+  const int32x4_t v_special = vdupq_n_s32(RasterBuffer::TERRAIN_WATER_THRESHOLD + 1);
+  const int32x4_t v_invalid = vdupq_n_s32(RasterBuffer::TERRAIN_INVALID);
+  const int32x4_t v_p31 = vdupq_n_s32(p31);
+  const int32x4_t v_p20 = vdupq_n_s32(p20);
+  const int32x4_t v_sx = vdupq_n_s32(sx);
+  const int32x4_t v_sy = vdupq_n_s32(sy);
+  const int32x4_t v_sz = vdupq_n_s32(sz);
+  const int32x4_t v_contrast = vdupq_n_s32(contrast);
+  const int32x4_t v_zero = vdupq_n_s32(0);
+  const int32x4_t v_254 = vdupq_n_s32(254);
+  const int32x4_t v_height_scale = vdupq_n_s32(-(int)height_scale);
+  const int32x4_t v_127 = vdupq_n_s32(127);
+  const int32x4_t v_min_sindex = vdupq_n_s32(-64);
+  const int32x4_t v_max_sindex = vdupq_n_s32(63);
+  const int32x4_t v_neutral = vdupq_n_s32(COLOR_TABLE_NEUTRAL);
+  const int32x4_t v_water = vdupq_n_s32(COLOR_TABLE_NEUTRAL + 255);
+  const int32x4_t v_white = vdupq_n_s32(-1);
+
+  /* the scalar product dd2*sz and the square dd2*dd2 are the same
+     for all pixels of this row */
+  const int32x4_t v_dd2_sz = vdupq_n_s32(dd2 * sz);
+  const int32x4_t v_dd2_dd2 = vdupq_n_s32(dd2 * dd2);
+
+  unsigned x = quantisation;
+  const unsigned x_end = width - quantisation;
+  for (; x + 4 <= x_end; x += 4) {
+    const short *p = src + x;
+
+    const int32x4_t h = LoadHeights(p);
+    const int32x4_t h_above = LoadHeights(p - row_minus_offset);
+    const int32x4_t h_below = LoadHeights(p + row_plus_offset);
+    const int32x4_t h_left = LoadHeights(p - quantisation);
+    const int32x4_t h_right = LoadHeights(p + quantisation);
+
+    const uint32x4_t special = vcltq_s32(h, v_special);
+    const uint32x4_t water = vbicq_u32(special, vceqq_s32(h, v_invalid));
+    const uint32x4_t neighbour_special =
+      vorrq_u32(vorrq_u32(vcltq_s32(h_above, v_special),
+                          vcltq_s32(h_below, v_special)),
+                vorrq_u32(vcltq_s32(h_left, v_special),
+                          vcltq_s32(h_right, v_special)));
+
+    /* clip the height to the colour table; a negative shift count
+       shifts to the right */
+    const int32x4_t hc =
+      vminq_s32(vshlq_s32(vmaxq_s32(h, v_zero), v_height_scale), v_254);
+
+    const int32x4_t p32 = vsubq_s32(h_above, h_below);
+    const int32x4_t p22 = vsubq_s32(h_right, h_left);
+
+    const int32x4_t dd0 = vmulq_s32(p22, v_p31);
+    const int32x4_t dd1 = vmulq_s32(v_p20, p32);
+
+    const int32x4_t num =
+      vmlaq_s32(vmlaq_s32(v_dd2_sz, dd0, v_sx), dd1, v_sy);
+    const int32x4_t mag =
+      vmlaq_s32(vmlaq_s32(v_dd2_dd2, dd0, dd0), dd1, dd1);
+
+    const int32x4_t sval = ShadeValue(num, mag);
+
+    /* sindex = (sval - sz) * contrast / 128, rounding towards zero */
+    int32x4_t sindex = vmulq_s32(vsubq_s32(sval, v_sz), v_contrast);
+    sindex = vaddq_s32(sindex, vandq_s32(vshrq_n_s32(sindex, 31), v_127));
+    sindex = vshrq_n_s32(sindex, 7);
+    sindex = vminq_s32(vmaxq_s32(sindex, v_min_sindex), v_max_sindex);
+
+    const int32x4_t neutral = vaddq_s32(v_neutral, hc);
+    const int32x4_t shaded = vaddq_s32(neutral, vshlq_n_s32(sindex, 8));
+
+    int32x4_t result = vbslq_s32(neighbour_special, neutral, shaded);
+    result = vbslq_s32(special, vbslq_s32(water, v_water, v_white), result);
+
+    /* all values are between -1 and 32767, so narrowing does not
+       alter them (-1 becomes WHITE) */
+    vst1_u16(dest + x, vreinterpret_u16_s16(vmovn_s32(result)));
+  }
+
+  return x;
+}
+
+#endif
+
+void
+SlopeShader::ShadeRow(const short *src, unsigned width,
+                       unsigned row_minus_index, unsigned row_plus_index,
+                       uint16_t *dest) const
+{
+#if defined(HAVE_SLOPE_SHADING_SSE2) || defined(HAVE_SLOPE_SHADING_NEON)
+  if (width > 2 * quantisation) {
+    ShadeColumns(src, width, row_minus_index, row_plus_index,
+                 0, quantisation, dest);
+
+#ifdef HAVE_SLOPE_SHADING_SSE2
+    const unsigned x = ShadeColumnsSSE2(src, width,
+                                        row_minus_index, row_plus_index,
+                                        dest);
+#else
+    const unsigned x = ShadeColumnsNEON(src, width,
+                                        row_minus_index, row_plus_index,
+                                        dest);
+#endif
+
+    ShadeColumns(src, width, row_minus_index, row_plus_index,
+                 x, width, dest + x);
+    return;
+  }
+#endif
+
+  ShadeRowScalar(src, width, row_minus_index, row_plus_index, dest);
+}
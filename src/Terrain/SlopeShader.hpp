@@ -0,0 +1,122 @@
+/*
+Copyright_License {
+
+  XCSoar Glide Computer - http://www.xcsoar.org/
+  Copyright (C) 2000-2012 The XCSoar Project
+  A detailed list of copyright holders can be found in the file "AUTHORS".
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+}
+*/
+
+#ifndef XCSOAR_TERRAIN_SLOPE_SHADER_HPP
+#define XCSOAR_TERRAIN_SLOPE_SHADER_HPP
+
+#include <stdint.h>
+
+//#define FAST_RSQRT
+
+/**
+ * The slope shading kernel of #RasterRenderer.  It converts rows of
+ * a #HeightMatrix to indices into the renderer's colour table
+ * (256 heights times 128 illumination levels).
+ *
+ * On CPUs with SSE2 or NEON, several pixels are calculated at a
+ * time; the result is always identical to the one of
+ * ShadeRowScalar().
+ */
+struct SlopeShader {
+  /**
+   * This index is returned for pixels outside of the terrain file
+   * bounds, which have no colour table entry.
+   */
+  static const uint16_t WHITE = 0xffff;
+
+  /**
+   * The sun vector; its length is 255.
+   */
+  int sx, sy, sz;
+
+  int contrast;
+
+  unsigned height_scale;
+
+  /**
+   * The size of one height matrix pixel [m].
+   */
+  unsigned height_slope_factor;
+
+  /**
+   * The distance of the neighbours which are used to calculate the
+   * slope [height matrix pixels].  Must be positive.
+   */
+  unsigned quantisation;
+
+  /**
+   * Calculate the colour table indices of one row.
+   *
+   * @param src the first pixel of the row
+   * @param width the number of pixels in the row
+   * @param row_minus_index the distance of the upper neighbour row
+   * @param row_plus_index the distance of the lower neighbour row
+   */
+  void ShadeRow(const short *src, unsigned width,
+                unsigned row_minus_index, unsigned row_plus_index,
+                uint16_t *dest) const;
+
+  /**
+   * The portable implementation of ShadeRow(), which calculates one
+   * pixel at a time.
+   */
+  void ShadeRowScalar(const short *src, unsigned width,
+                      unsigned row_minus_index, unsigned row_plus_index,
+                      uint16_t *dest) const {
+    ShadeColumns(src, width, row_minus_index, row_plus_index,
+                 0, width, dest);
+  }
+
+private:
+  void ShadeColumns(const short *src, unsigned width,
+                    unsigned row_minus_index, unsigned row_plus_index,
+                    unsigned x, unsigned x_end, uint16_t *dest) const;
+
+#if defined(__SSE2__) && !defined(FIXED_MATH) && !defined(FAST_RSQRT)
+#define HAVE_SLOPE_SHADING_SSE2
+
+  /**
+   * Shade the columns between #quantisation and the last multiple of
+   * four before (width - #quantisation).
+   *
+   * @return the first column which was not shaded
+   */
+  unsigned ShadeColumnsSSE2(const short *src, unsigned width,
+                            unsigned row_minus_index, unsigned row_plus_index,
+                            uint16_t *dest) const;
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && \
+  !defined(FIXED_MATH) && !defined(FAST_RSQRT)
+#define HAVE_SLOPE_SHADING_NEON
+
+  /**
+   * The NEON version of ShadeColumnsSSE2().
+   *
+   * @return the first column which was not shaded
+   */
+  unsigned ShadeColumnsNEON(const short *src, unsigned width,
+                            unsigned row_minus_index, unsigned row_plus_index,
+                            uint16_t *dest) const;
+#endif
+};
+
+#endif
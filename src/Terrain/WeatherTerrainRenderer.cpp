@@ -23,6 +23,7 @@ Copyright_License {
 
 #include "Terrain/WeatherTerrainRenderer.hpp"
 #include "Terrain/RasterWeather.hpp"
+#include "Terrain/RasterMap.hpp"
 #include "Screen/Ramp.hpp"
 
 const ColorRamp weather_colors[6][NUM_COLOR_RAMP_LEVELS] = {
@@ -121,11 +122,60 @@ const ColorRamp weather_colors[6][NUM_COLOR_RAMP_LEVELS] = {
 WeatherTerrainRenderer::WeatherTerrainRenderer(const RasterTerrain *_terrain,
                                                const RasterWeather *_weather)
   :TerrainRenderer(_terrain),
-  weather(_weather)
+  weather(_weather),
+  current(0), clock(0)
 {
   assert(weather != NULL);
 }
 
+void
+WeatherTerrainRenderer::ClearImages()
+{
+  for (unsigned i = 0; i < MAX_IMAGES; ++i)
+    images[i].Clear();
+
+  /* the results in the renderer are stale, too */
+  RasterRenderer::Buffer stale;
+  raster_renderer.Exchange(stale);
+}
+
+WeatherTerrainRenderer::Image &
+WeatherTerrainRenderer::SelectImage(const RasterMap &map)
+{
+  if (images[current].map == &map)
+    return images[current];
+
+  unsigned i = 0;
+  while (i < MAX_IMAGES && images[i].map != &map)
+    ++i;
+
+  if (i == MAX_IMAGES) {
+    /* not found: reuse the least recently used image */
+    i = 0;
+    for (unsigned j = 1; j < MAX_IMAGES; ++j)
+      if (images[j].last_used < images[i].last_used)
+        i = j;
+
+    Image &image = images[i];
+    if (i != current)
+      image.Clear();
+    image.map = &map;
+    image.compare_projection.Clear();
+
+    if (i == current)
+      return image;
+  }
+
+  raster_renderer.Exchange(images[current].buffer);
+  raster_renderer.Exchange(images[i].buffer);
+  current = i;
+
+  /* the spot heights belong to the previous image */
+  ScanSpotHeights();
+
+  return images[i];
+}
+
 void
 WeatherTerrainRenderer::Generate(const WindowProjection &projection,
                                  const Angle sunazimuth)
@@ -191,16 +241,39 @@ WeatherTerrainRenderer::Generate(const WindowProjection &projection,
 
   const RasterMap *map = weather->GetMap();
   if (map == NULL) {
+    /* the renderer will be filled with terrain */
+    images[current].map = NULL;
     TerrainRenderer::Generate(projection, sunazimuth);
     return;
   }
 
+  /* the renderer will be filled with weather data, so
+     TerrainRenderer::Generate() must not reuse it */
+  compare_projection.Clear();
+
+  const Serial serial = weather->GetSerial();
+  if (serial != weather_serial) {
+    ClearImages();
+    weather_serial = serial;
+  }
+
   if (color_ramp != last_color_ramp) {
+    ClearImages();
     raster_renderer.ColorTable(color_ramp, do_water,
                                height_scale, interp_levels);
     last_color_ramp = color_ramp;
   }
 
+  Image &image = SelectImage(*map);
+  image.last_used = ++clock;
+
+  if (image.compare_projection.CompareAndUpdate(projection) &&
+      image.map_serial == map->GetSerial())
+    /* no change since this image was rendered */
+    return;
+
+  image.map_serial = map->GetSerial();
+
   raster_renderer.ScanMap(*map, projection);
 
   raster_renderer.GenerateImage(do_shading, height_scale,
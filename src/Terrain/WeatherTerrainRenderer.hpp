@@ -29,14 +29,87 @@ Copyright_License {
 class RasterWeather;
 
 class WeatherTerrainRenderer: public TerrainRenderer {
+  /**
+   * The number of RASP images which are kept, including the one being
+   * displayed.
+   */
+  static const unsigned MAX_IMAGES = 4;
+
+  /**
+   * The rendered image of one RASP time slot.
+   */
+  struct Image {
+    /**
+     * The map this image was rendered from, or NULL if this object is
+     * unused.
+     */
+    const RasterMap *map;
+
+    Serial map_serial;
+
+    CompareProjection compare_projection;
+
+    /**
+     * The value of #clock when this image was displayed the last
+     * time.
+     */
+    unsigned last_used;
+
+    /**
+     * The results of the renderer.  This is empty for the #current
+     * image, because the #raster_renderer holds its results.
+     */
+    RasterRenderer::Buffer buffer;
+
+    Image():map(NULL), last_used(0) {}
+
+    void Clear() {
+      map = NULL;
+      compare_projection.Clear();
+      buffer.Clear();
+    }
+  };
+
   const RasterWeather *weather;
 
+  Image images[MAX_IMAGES];
+
+  /**
+   * The index of the image which is in #raster_renderer.
+   */
+  unsigned current;
+
+  /**
+   * Counts Generate() calls, for finding the least recently used
+   * image.
+   */
+  unsigned clock;
+
+  /**
+   * The RasterWeather::GetSerial() value which the images belong to.
+   * The maps may have been deleted when it changes.
+   */
+  Serial weather_serial;
+
 public:
   WeatherTerrainRenderer(const RasterTerrain *_terrain,
                          const RasterWeather *_weather);
 
   virtual void Generate(const WindowProjection &map_projection,
                         const Angle sunazimuth);
+
+private:
+  /**
+   * Discard all images.
+   */
+  void ClearImages();
+
+  /**
+   * Move the image of the specified map into #raster_renderer, and
+   * the previous one out of it.  If there is no image for this map
+   * yet, then the least recently used one is discarded.
+   */
+  Image &SelectImage(const RasterMap &map);
 };
 
 #endif
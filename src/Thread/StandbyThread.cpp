@@ -43,9 +43,14 @@ StandbyThread::Trigger()
 
   if (alive)
     TriggerCommand();
-  else
+  else {
     /* start it if it's not running currently */
     alive = Start();
+    if (!alive)
+      /* the work will never be done; don't let IsBusy() claim
+         otherwise */
+      pending = false;
+  }
 }
 
 void
@@ -113,8 +113,8 @@ private:
 protected:
   /**
    * Wakes up the thread to do work, calls Tick().  If the thread is
-   * not already running, it is launched.  Must not be called while
-   * the thread is busy.
+   * not already running, it is launched; if that fails, the work is
+   * discarded.  Must not be called while the thread is busy.
    *
    * Caller must lock the mutex.
    */
@@ -130,6 +130,17 @@ protected:
     return pending || busy;
   }
 
+  /**
+   * Has the thread been asked to stop?  Tick() may check this between
+   * two pieces of work, to return early.
+   *
+   * Caller must lock the mutex.
+   */
+  gcc_pure
+  bool IsStopped() const {
+    return stop;
+  }
+
   /**
    * Send the "stop" command to the thread.
    *
@@ -161,6 +172,14 @@ protected:
     WaitStopped();
   }
 
+  /**
+   * Lower the priority of this thread.  Tick() may call this for
+   * work which must not compete with the user interface.
+   */
+  void SetLowPriority() {
+    Thread::SetLowPriority();
+  }
+
   /**
    * Implement this to do the actual work.  The mutex will be locked,
    * but you should unlock it while doing real work (and re-lock it
@@ -0,0 +1,180 @@
+/*
+Copyright_License {
+
+  XCSoar Glide Computer - http://www.xcsoar.org/
+  Copyright (C) 2000-2012 The XCSoar Project
+  A detailed list of copyright holders can be found in the file "AUTHORS".
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+}
+*/
+
+#include "Thread/ThreadPool.hpp"
+
+#include <algorithm>
+
+#ifdef HAVE_POSIX
+#include <unistd.h>
+#else
+#include <windows.h>
+#endif
+
+/**
+ * Returns the number of CPU cores which are currently online.
+ */
+static unsigned
+CountCPUs()
+{
+#if defined(HAVE_POSIX) && defined(_SC_NPROCESSORS_ONLN)
+  const long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return n > 0 ? (unsigned)n : 1;
+#elif !defined(HAVE_POSIX)
+  SYSTEM_INFO info;
+  ::GetSystemInfo(&info);
+  return info.dwNumberOfProcessors > 0
+    ? (unsigned)info.dwNumberOfProcessors
+    : 1;
+#else
+  return 1;
+#endif
+}
+
+ThreadPool::Worker::~Worker()
+{
+  StopThread();
+}
+
+void
+ThreadPool::Worker::StopThread()
+{
+  ScopeLock protect(mutex);
+  Stop();
+}
+
+void
+ThreadPool::Worker::Start(Task &_task, unsigned _first, unsigned _stride,
+                          unsigned _n_slices)
+{
+  ScopeLock protect(mutex);
+  task = &_task;
+  first = _first;
+  stride = _stride;
+  n_slices = _n_slices;
+  done = false;
+  Trigger();
+}
+
+bool
+ThreadPool::Worker::Wait()
+{
+  ScopeLock protect(mutex);
+  WaitDone();
+  return done;
+}
+
+void
+ThreadPool::Worker::Tick()
+{
+  Task &_task = *task;
+  const unsigned _first = first, _stride = stride, _n_slices = n_slices;
+
+  mutex.Unlock();
+
+  for (unsigned i = _first; i < _n_slices; i += _stride)
+    _task.RunSlice(i, _n_slices);
+
+  mutex.Lock();
+  done = true;
+}
+
+ThreadPool::ThreadPool(unsigned _concurrency)
+  :concurrency(_concurrency > 0 ? _concurrency : CountCPUs()),
+   started(false)
+{
+  if (concurrency > MAX_CONCURRENCY)
+    concurrency = MAX_CONCURRENCY;
+}
+
+void
+ThreadPool::Start()
+{
+  ScopeLock protect(mutex);
+  started = true;
+}
+
+void
+ThreadPool::Stop()
+{
+  ScopeLock protect(mutex);
+  started = false;
+
+  for (unsigned i = 0; i < MAX_CONCURRENCY - 1; ++i)
+    workers[i].StopThread();
+}
+
+void
+ThreadPool::Run(Task &task, unsigned n_slices)
+{
+  if (!mutex.TryLock()) {
+    /* another thread is using the workers; don't wait for it */
+    for (unsigned i = 0; i < n_slices; ++i)
+      task.RunSlice(i, n_slices);
+    return;
+  }
+
+  if (!started) {
+    mutex.Unlock();
+
+    for (unsigned i = 0; i < n_slices; ++i)
+      task.RunSlice(i, n_slices);
+    return;
+  }
+
+  const unsigned n_threads = std::min(concurrency, n_slices);
+
+  for (unsigned i = 1; i < n_threads; ++i)
+    workers[i - 1].Start(task, i, n_threads, n_slices);
+
+  for (unsigned i = 0; i < n_slices; i += n_threads)
+    task.RunSlice(i, n_slices);
+
+  for (unsigned i = 1; i < n_threads; ++i)
+    if (!workers[i - 1].Wait())
+      /* the thread could not be launched; do its work here */
+      for (unsigned j = i; j < n_slices; j += n_threads)
+        task.RunSlice(j, n_slices);
+
+  mutex.Unlock();
+}
+
+static ThreadPool shared_thread_pool;
+
+ThreadPool &
+GetSharedThreadPool()
+{
+  return shared_thread_pool;
+}
+
+void
+InitialiseSharedThreadPool()
+{
+  shared_thread_pool.Start();
+}
+
+void
+DeinitialiseSharedThreadPool()
+{
+  shared_thread_pool.Stop();
+}
@@ -0,0 +1,171 @@
+/*
+Copyright_License {
+
+  XCSoar Glide Computer - http://www.xcsoar.org/
+  Copyright (C) 2000-2012 The XCSoar Project
+  A detailed list of copyright holders can be found in the file "AUTHORS".
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+}
+*/
+
+#ifndef XCSOAR_THREAD_POOL_HPP
+#define XCSOAR_THREAD_POOL_HPP
+
+#include "Thread/StandbyThread.hpp"
+#include "Thread/Mutex.hpp"
+#include "Util/NonCopyable.hpp"
+#include "Compiler.h"
+
+#include <assert.h>
+
+/**
+ * A small set of threads which split a piece of work into a number
+ * of independent slices and process them in parallel.  The calling
+ * thread takes part in the work, and Run() returns only after all
+ * slices have been processed.
+ *
+ * The worker threads are used only between Start() and Stop().  They
+ * are launched on demand, and they sleep between two Run() calls.
+ * Outside of that period, Run() processes all slices in the calling
+ * thread.
+ *
+ * A pool may be shared by several threads.  Only one Run() call uses
+ * the worker threads at a time; a caller which finds the pool busy
+ * processes all of its slices by itself instead of waiting.
+ */
+class ThreadPool : private NonCopyable {
+public:
+  class Task {
+  public:
+    /**
+     * Process one slice of the work.  This method is called
+     * concurrently from several threads, each time with a different
+     * slice number.
+     */
+    virtual void RunSlice(unsigned slice, unsigned n_slices) = 0;
+  };
+
+  /**
+   * The maximum number of threads working on one Run() call,
+   * including the calling thread.
+   */
+  static const unsigned MAX_CONCURRENCY = 4;
+
+private:
+  class Worker : public StandbyThread {
+    Task *task;
+    unsigned first, stride, n_slices;
+
+    /**
+     * Has Tick() processed all slices of the current task?
+     */
+    bool done;
+
+  public:
+    ~Worker();
+
+    /**
+     * Stop the thread, if it has been launched.
+     */
+    void StopThread();
+
+    void Start(Task &task, unsigned first, unsigned stride,
+               unsigned n_slices);
+
+    /**
+     * Wait until the slices passed to Start() have been processed.
+     *
+     * @return false if the thread could not be launched, and the
+     * slices still need to be processed
+     */
+    bool Wait();
+
+  protected:
+    virtual void Tick();
+  };
+
+  Worker workers[MAX_CONCURRENCY - 1];
+
+  unsigned concurrency;
+
+  /**
+   * Locked by the Run() call which is using the #workers.
+   */
+  Mutex mutex;
+
+  /**
+   * May Run() use the #workers?  Protected by #mutex.
+   */
+  bool started;
+
+public:
+  /**
+   * @param concurrency the number of threads working on one Run()
+   * call, including the calling thread; 0 means one per CPU core
+   */
+  explicit ThreadPool(unsigned concurrency=0);
+
+#ifndef NDEBUG
+  ~ThreadPool() {
+    assert(!started);
+  }
+#endif
+
+  /**
+   * Allow Run() to use the worker threads.
+   */
+  void Start();
+
+  /**
+   * Stop all worker threads.  Waits for a Run() call which is using
+   * them.
+   */
+  void Stop();
+
+  unsigned GetConcurrency() const {
+    return concurrency;
+  }
+
+  /**
+   * Invoke Task::RunSlice() for each slice number below #n_slices,
+   * distributed over the worker threads and the calling thread.
+   * Returns after all slices have been processed.
+   */
+  void Run(Task &task, unsigned n_slices);
+};
+
+/**
+ * Returns the pool which is shared by all parts of the program which
+ * split their work over the CPU cores, so the number of threads does
+ * not grow with the number of objects doing that.  It has worker
+ * threads only between InitialiseSharedThreadPool() and
+ * DeinitialiseSharedThreadPool().
+ */
+gcc_const
+ThreadPool &
+GetSharedThreadPool();
+
+void
+InitialiseSharedThreadPool();
+
+/**
+ * Stop the worker threads of the shared pool.  Call this before
+ * leaving main(), so no thread is left for the static destructors.
+ */
+void
+DeinitialiseSharedThreadPool();
+
+#endif
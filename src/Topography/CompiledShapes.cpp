@@ -0,0 +1,160 @@
+/*
+Copyright_License {
+
+  XCSoar Glide Computer - http://www.xcsoar.org/
+  Copyright (C) 2000-2012 The XCSoar Project
+  A detailed list of copyright holders can be found in the file "AUTHORS".
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+}
+*/
+
+
+#include "Topography/CompiledShapes.hpp"
+#include "Topography/XShape.hpp"
+#include "Topography/ShapeArena.hpp"
+#include "OS/FileMapping.hpp"
+#include "Util/AllocatedArray.hpp"
+
+#include <string.h>
+
+bool
+CompiledShapes::Open(FileMapping *_mapping, size_t offset, int label_field)
+{
+  assert(mapping == NULL);
+
+  const size_t size = _mapping->size();
+  offset = (offset + 7) & ~(size_t)7;
+  if (offset + sizeof(Header) > size)
+    return false;
+
+  const Header &header = *(const Header *)_mapping->at(offset);
+  if (header.magic != Header::MAGIC || header.version != Header::VERSION ||
+      header.layout != XShape::GetCompiledLayout() ||
+      header.label_field != label_field ||
+      header.table_offset % sizeof(uint32_t) != 0 ||
+      header.table_offset > size ||
+      (size - header.table_offset) / sizeof(uint32_t) <= header.num_shapes)
+    return false;
+
+  const uint32_t *table = (const uint32_t *)_mapping->at(header.table_offset);
+
+  /* the records must be in ascending order between the header and
+     the table, and properly aligned */
+  uint32_t previous = offset + sizeof(header);
+  for (unsigned i = 0; i <= header.num_shapes; ++i) {
+    if (table[i] < previous || table[i] % 8 != 0)
+      return false;
+
+    previous = table[i];
+  }
+
+  if (previous != header.table_offset)
+    return false;
+
+  mapping = _mapping;
+  num_shapes = header.num_shapes;
+  offsets = table;
+  return true;
+}
+
+void
+CompiledShapes::Close()
+{
+  delete mapping;
+  mapping = NULL;
+  num_shapes = 0;
+  offsets = NULL;
+}
+
+const void *
+CompiledShapes::GetRecord(unsigned i) const
+{
+  assert(mapping != NULL);
+  assert(i < num_shapes);
+
+  return mapping->at(offsets[i]);
+}
+
+/**
+ * Pad the file with zeroes, so the next write starts at a multiple
+ * of 8 bytes.  Returns the new position, or -1 on error.
+ */
+static long
+Align8(FILE *file)
+{
+  static const char zero[8] = { 0 };
+
+  const long position = ftell(file);
+  if (position < 0)
+    return -1;
+
+  const size_t padding = (8 - position % 8) % 8;
+  if (fwrite(zero, 1, padding, file) != padding)
+    return -1;
+
+  return position + padding;
+}
+
+bool
+CompiledShapes::Save(FILE *file, shapefileObj &shapefile, int label_field)
+{
+  const long header_position = Align8(file);
+  if (header_position < 0)
+    return false;
+
+  Header header;
+  memset(&header, 0, sizeof(header));
+  header.magic = Header::MAGIC;
+  header.version = Header::VERSION;
+  header.layout = XShape::GetCompiledLayout();
+  header.num_shapes = shapefile.numshapes;
+  header.label_field = label_field;
+
+  /* write the header now to reserve the space; it is rewritten when
+     the table offset is known */
+  if (fwrite(&header, sizeof(header), 1, file) != 1 ||
+      Align8(file) < 0)
+    return false;
+
+  AllocatedArray<uint32_t> table(header.num_shapes + 1);
+
+  ShapeArena arena;
+  for (unsigned i = 0; i < header.num_shapes; ++i) {
+    const long position = ftell(file);
+    if (position < 0 || (unsigned long)position > 0xffffffff)
+      return false;
+
+    table[i] = position;
+
+    XShape *shape = new (arena) XShape(arena, &shapefile, i, label_field);
+    const bool success = shape->Compile(file);
+    delete shape;
+
+    if (!success)
+      return false;
+  }
+
+  const long table_position = ftell(file);
+  if (table_position < 0 || (unsigned long)table_position > 0xffffffff)
+    return false;
+
+  header.table_offset = table[header.num_shapes] = table_position;
+
+  return fwrite(table.begin(), sizeof(uint32_t), table.size(),
+                file) == table.size() &&
+    fseek(file, header_position, SEEK_SET) == 0 &&
+    fwrite(&header, sizeof(header), 1, file) == 1;
+}
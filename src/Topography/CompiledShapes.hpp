@@ -0,0 +1,132 @@
+/*
+Copyright_License {
+
+  XCSoar Glide Computer - http://www.xcsoar.org/
+  Copyright (C) 2000-2012 The XCSoar Project
+  A detailed list of copyright holders can be found in the file "AUTHORS".
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+}
+*/
+
+
+#ifndef XCSOAR_TOPOGRAPHY_COMPILED_SHAPES_HPP
+#define XCSOAR_TOPOGRAPHY_COMPILED_SHAPES_HPP
+
+#include "shapelib/mapserver.h"
+#include "Util/NonCopyable.hpp"
+#include "Compiler.h"
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+class FileMapping;
+
+/**
+ * A "compiled" copy of a shapefile, stored in the #FileCache.  It
+ * contains all shapes in the format which is used by #XShape in
+ * memory: the points are already converted (and projected in the
+ * OpenGL build), and the labels are validated UTF-8.  The file is
+ * mapped into memory, and loading a shape only needs to locate its
+ * record; the shapefile does not need to be opened at all.
+ *
+ * The layout depends on the build (see XShape::GetCompiledLayout()),
+ * and files written by a different build are rejected.
+ */
+class CompiledShapes : private NonCopyable {
+  struct Header {
+    enum {
+      MAGIC = 0x504f5458, /* "XTOP" */
+      VERSION = 1,
+    };
+
+    uint32_t magic, version, layout;
+
+    uint32_t num_shapes;
+
+    /**
+     * The label field of the shapes.  The file is rejected when the
+     * configuration selects another one.
+     */
+    int32_t label_field;
+
+    /**
+     * The position of the record offsets in the file, which is also
+     * the end of the last record.  The table contains one offset per
+     * shape, plus this value.
+     */
+    uint32_t table_offset;
+  };
+
+  FileMapping *mapping;
+
+  unsigned num_shapes;
+
+  /**
+   * The start of each record, relative to the beginning of the
+   * mapping.
+   */
+  const uint32_t *offsets;
+
+public:
+  CompiledShapes():mapping(NULL), num_shapes(0), offsets(NULL) {}
+
+  ~CompiledShapes() {
+    Close();
+  }
+
+  bool IsDefined() const {
+    return mapping != NULL;
+  }
+
+  unsigned GetNumShapes() const {
+    return num_shapes;
+  }
+
+  /**
+   * Use the specified file mapping, which was returned by
+   * FileCache::Map().  On success, this object takes over the
+   * mapping; on failure, the caller must delete it.
+   *
+   * @param offset the position of the data in the mapping
+   */
+  bool Open(FileMapping *mapping, size_t offset, int label_field);
+
+  void Close();
+
+  /**
+   * Returns a pointer to the record of the specified shape, to be
+   * passed to the #XShape constructor.
+   */
+  gcc_pure
+  const void *GetRecord(unsigned i) const;
+
+  gcc_pure
+  size_t GetRecordSize(unsigned i) const {
+    assert(i < num_shapes);
+
+    return offsets[i + 1] - offsets[i];
+  }
+
+  /**
+   * Read all shapes from the shapefile and write them to the file
+   * which was returned by FileCache::Save().
+   */
+  static bool Save(FILE *file, shapefileObj &shapefile, int label_field);
+};
+
+#endif
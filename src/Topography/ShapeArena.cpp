@@ -0,0 +1,143 @@
+/*
+Copyright_License {
+
+  XCSoar Glide Computer - http://www.xcsoar.org/
+  Copyright (C) 2000-2012 The XCSoar Project
+  A detailed list of copyright holders can be found in the file "AUTHORS".
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+}
+*/
+
+
+#include "Topography/ShapeArena.hpp"
+
+#include <new>
+
+#include <assert.h>
+
+/**
+ * Each allocation is preceded by a pointer to its chunk, padded to
+ * the alignment.
+ */
+union AllocationHeader {
+  void *chunk;
+  double align;
+};
+
+ShapeArena::~ShapeArena()
+{
+  if (current != NULL) {
+    assert(current->n_allocations == 0);
+    ::operator delete(current);
+  }
+
+  while (spare != NULL) {
+    Chunk *chunk = spare;
+    spare = chunk->next;
+    ::operator delete(chunk);
+  }
+}
+
+ShapeArena::Chunk *
+ShapeArena::NewChunk(size_t size)
+{
+  Chunk *chunk = (Chunk *)::operator new(Align(sizeof(Chunk)) + size);
+  chunk->arena = this;
+  chunk->next = NULL;
+  chunk->size = size;
+  chunk->used = 0;
+  chunk->n_allocations = 0;
+  return chunk;
+}
+
+void *
+ShapeArena::Take(Chunk *chunk, size_t size)
+{
+  assert(chunk->used + size <= chunk->size);
+
+  AllocationHeader *header =
+    (AllocationHeader *)(chunk->GetData() + chunk->used);
+  header->chunk = chunk;
+
+  chunk->used += size;
+  ++chunk->n_allocations;
+  return header + 1;
+}
+
+void *
+ShapeArena::Allocate(size_t size)
+{
+  size = Align(sizeof(AllocationHeader) + size);
+
+  if (size > CHUNK_SIZE / 4)
+    /* too large to share a chunk */
+    return Take(NewChunk(size), size);
+
+  if (current == NULL || current->used + size > current->size) {
+    if (current != NULL) {
+      /* retire the full chunk; it will be released when its last
+         allocation is freed */
+      Chunk *full = current;
+      current = NULL;
+
+      if (full->n_allocations == 0)
+        Release(full);
+    }
+
+    if (spare != NULL) {
+      current = spare;
+      spare = current->next;
+      --n_spare;
+    } else
+      current = NewChunk(CHUNK_SIZE);
+  }
+
+  return Take(current, size);
+}
+
+void
+ShapeArena::Release(Chunk *chunk)
+{
+  assert(chunk->n_allocations == 0);
+
+  if (chunk == current) {
+    /* start over */
+    chunk->used = 0;
+    return;
+  }
+
+  if (chunk->size == CHUNK_SIZE && n_spare < MAX_SPARE) {
+    chunk->used = 0;
+    chunk->next = spare;
+    spare = chunk;
+    ++n_spare;
+  } else
+    ::operator delete(chunk);
+}
+
+void
+ShapeArena::Free(void *p)
+{
+  if (p == NULL)
+    return;
+
+  const AllocationHeader *header = (const AllocationHeader *)p - 1;
+  Chunk *chunk = (Chunk *)header->chunk;
+
+  assert(chunk->n_allocations > 0);
+  if (--chunk->n_allocations == 0)
+    chunk->arena->Release(chunk);
+}
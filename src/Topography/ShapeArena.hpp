@@ -0,0 +1,131 @@
+/*
+Copyright_License {
+
+  XCSoar Glide Computer - http://www.xcsoar.org/
+  Copyright (C) 2000-2012 The XCSoar Project
+  A detailed list of copyright holders can be found in the file "AUTHORS".
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+}
+*/
+
+
+#ifndef XCSOAR_TOPOGRAPHY_SHAPE_ARENA_HPP
+#define XCSOAR_TOPOGRAPHY_SHAPE_ARENA_HPP
+
+#include "Util/NonCopyable.hpp"
+#include "Compiler.h"
+
+#include <stddef.h>
+
+/**
+ * An allocator for #XShape objects and their points and labels.  It
+ * hands out memory from large chunks with a bump pointer, and a
+ * chunk is released as a whole when the last allocation in it has
+ * been freed.  Shapes which are loaded together are therefore stored
+ * next to each other, and loading and unloading shapes while panning
+ * costs only a few heap allocations and does not fragment the heap.
+ *
+ * This class is not thread-safe.  All allocations and deallocations
+ * must be done by the same thread.
+ */
+class ShapeArena : private NonCopyable {
+  /**
+   * The size of a regular chunk.  Larger allocations get a chunk of
+   * their own.
+   */
+  static const size_t CHUNK_SIZE = 64 * 1024;
+
+  /**
+   * The maximum number of empty chunks kept for reuse.
+   */
+  static const unsigned MAX_SPARE = 4;
+
+  /**
+   * All allocations are aligned to this many bytes.
+   */
+  static const size_t ALIGNMENT = sizeof(double);
+
+  struct Chunk {
+    ShapeArena *arena;
+
+    /**
+     * The next chunk in the #spare list.
+     */
+    Chunk *next;
+
+    /**
+     * The number of bytes available after the chunk header, and the
+     * number of bytes which have been handed out.
+     */
+    size_t size, used;
+
+    /**
+     * The number of allocations in this chunk which have not been
+     * freed yet.
+     */
+    unsigned n_allocations;
+
+    gcc_pure
+    char *GetData() {
+      return (char *)this + Align(sizeof(*this));
+    }
+  };
+
+  /**
+   * The chunk which new allocations are taken from.
+   */
+  Chunk *current;
+
+  /**
+   * A linked list of empty chunks.
+   */
+  Chunk *spare;
+  unsigned n_spare;
+
+public:
+  ShapeArena():current(NULL), spare(NULL), n_spare(0) {}
+
+  /**
+   * All allocations must have been freed before.
+   */
+  ~ShapeArena();
+
+  /**
+   * Allocate memory.  Like the global operator new, this does not
+   * return NULL.
+   */
+  void *Allocate(size_t size);
+
+  /**
+   * Free memory which was returned by Allocate().  The arena is
+   * looked up from the pointer.
+   *
+   * @param p the pointer, or NULL
+   */
+  static void Free(void *p);
+
+private:
+  gcc_const
+  static size_t Align(size_t size) {
+    return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+  }
+
+  Chunk *NewChunk(size_t size);
+  void Release(Chunk *chunk);
+  void *Take(Chunk *chunk, size_t size);
+};
+
+#endif
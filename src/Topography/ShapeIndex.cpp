@@ -0,0 +1,259 @@
+/*
+Copyright_License {
+
+  XCSoar Glide Computer - http://www.xcsoar.org/
+  Copyright (C) 2000-2012 The XCSoar Project
+  A detailed list of copyright holders can be found in the file "AUTHORS".
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+}
+*/
+
+
+#include "Topography/ShapeIndex.hpp"
+
+#include <algorithm>
+
+#include <assert.h>
+
+/**
+ * Enlarge all boxes by this margin [degrees], so the rounding to
+ * single precision cannot make them smaller than the shape.  It is
+ * larger than half the float resolution at 180 degrees.
+ */
+static const double MARGIN = 1e-5;
+
+void
+ShapeIndex::Box::Extend(const Box &other)
+{
+  min_x = std::min(min_x, other.min_x);
+  min_y = std::min(min_y, other.min_y);
+  max_x = std::max(max_x, other.max_x);
+  max_y = std::max(max_y, other.max_y);
+}
+
+ShapeIndex::Box
+ShapeIndex::ToBox(const rectObj &rect)
+{
+  Box box;
+  box.min_x = (float)(rect.minx - MARGIN);
+  box.min_y = (float)(rect.miny - MARGIN);
+  box.max_x = (float)(rect.maxx + MARGIN);
+  box.max_y = (float)(rect.maxy + MARGIN);
+  return box;
+}
+
+/**
+ * Calculate the position of a point on a Hilbert curve which fills a
+ * 65536x65536 grid.
+ */
+gcc_const
+static uint32_t
+HilbertIndex(uint32_t x, uint32_t y)
+{
+  uint32_t d = 0;
+  for (uint32_t s = 1 << 15; s > 0; s >>= 1) {
+    const uint32_t rx = (x & s) != 0;
+    const uint32_t ry = (y & s) != 0;
+    d += s * s * ((3 * rx) ^ ry);
+
+    /* rotate the quadrant */
+    if (ry == 0) {
+      if (rx == 1) {
+        x = 0xffff - x;
+        y = 0xffff - y;
+      }
+
+      std::swap(x, y);
+    }
+  }
+
+  return d;
+}
+
+struct HilbertItem {
+  uint32_t hilbert;
+  uint32_t shape;
+
+  bool operator<(const HilbertItem &other) const {
+    return hilbert < other.hilbert;
+  }
+};
+
+void
+ShapeIndex::Build(shapefileObj &file)
+{
+  num_shapes = file.numshapes;
+  num_items = 0;
+  level_bounds.clear();
+
+  /* read the bounds of all shapes, which is the expensive part */
+
+  AllocatedArray<Box> shape_boxes(num_shapes);
+  AllocatedArray<HilbertItem> items(num_shapes);
+  Box extent;
+
+  for (unsigned i = 0; i < num_shapes; ++i) {
+    rectObj rect;
+    if (msSHPReadBounds(file.hSHP, i, &rect) != MS_SUCCESS)
+      /* null or empty shape, never visible */
+      continue;
+
+    shape_boxes[i] = ToBox(rect);
+    if (num_items == 0)
+      extent = shape_boxes[i];
+    else
+      extent.Extend(shape_boxes[i]);
+
+    items[num_items++].shape = i;
+  }
+
+  if (num_items == 0)
+    return;
+
+  /* sort the shapes along a Hilbert curve through the centers of
+     their bounds */
+
+  const float width = std::max(extent.max_x - extent.min_x, 1e-9f);
+  const float height = std::max(extent.max_y - extent.min_y, 1e-9f);
+  for (unsigned i = 0; i < num_items; ++i) {
+    const Box &box = shape_boxes[items[i].shape];
+    const float x = (box.min_x + box.max_x) / 2 - extent.min_x;
+    const float y = (box.min_y + box.max_y) / 2 - extent.min_y;
+    items[i].hilbert = HilbertIndex((uint32_t)(0xffff * x / width),
+                                    (uint32_t)(0xffff * y / height));
+  }
+
+  std::sort(items.begin(), items.begin() + num_items);
+
+  /* determine the size of the tree */
+
+  unsigned num_boxes = num_items, n = num_items;
+  level_bounds.append(num_boxes);
+  while (n > 1) {
+    n = (n + NODE_SIZE - 1) / NODE_SIZE;
+    num_boxes += n;
+    level_bounds.append(num_boxes);
+  }
+
+  boxes.ResizeDiscard(num_boxes);
+  indices.ResizeDiscard(num_boxes);
+
+  for (unsigned i = 0; i < num_items; ++i) {
+    boxes[i] = shape_boxes[items[i].shape];
+    indices[i] = items[i].shape;
+  }
+
+  BuildNodes();
+}
+
+void
+ShapeIndex::BuildNodes()
+{
+  uint32_t position = num_items;
+  uint32_t level_start = 0;
+  for (unsigned level = 0; level + 1 < level_bounds.size(); ++level) {
+    const uint32_t level_end = level_bounds[level];
+
+    for (uint32_t i = level_start; i < level_end; i += NODE_SIZE) {
+      const uint32_t end = std::min(i + NODE_SIZE, level_end);
+
+      Box box = boxes[i];
+      for (uint32_t j = i + 1; j < end; ++j)
+        box.Extend(boxes[j]);
+
+      boxes[position] = box;
+      indices[position] = i;
+      ++position;
+    }
+
+    level_start = level_end;
+  }
+
+  assert(position == level_bounds.last());
+}
+
+bool
+ShapeIndex::SaveCache(FILE *file) const
+{
+  CacheHeader header;
+  header.version = CacheHeader::VERSION;
+  header.num_shapes = num_shapes;
+  header.num_items = num_items;
+  header.num_boxes = num_items > 0 ? level_bounds.last() : 0;
+  header.num_levels = level_bounds.size();
+
+  return fwrite(&header, sizeof(header), 1, file) == 1 &&
+    fwrite(level_bounds.raw(), sizeof(uint32_t), header.num_levels,
+           file) == header.num_levels &&
+    fwrite(boxes.begin(), sizeof(Box), header.num_boxes,
+           file) == header.num_boxes &&
+    fwrite(indices.begin(), sizeof(uint32_t), header.num_boxes,
+           file) == header.num_boxes;
+}
+
+bool
+ShapeIndex::LoadCache(FILE *file, unsigned _num_shapes)
+{
+  num_items = 0;
+  level_bounds.clear();
+
+  CacheHeader header;
+  if (fread(&header, sizeof(header), 1, file) != 1 ||
+      header.version != CacheHeader::VERSION ||
+      header.num_shapes != _num_shapes ||
+      header.num_items > header.num_shapes ||
+      header.num_levels > level_bounds.capacity() ||
+      (header.num_items > 0) != (header.num_levels > 0))
+    return false;
+
+  level_bounds.resize(header.num_levels);
+  if (fread(level_bounds.begin(), sizeof(uint32_t), header.num_levels,
+            file) != header.num_levels)
+    return false;
+
+  /* the level bounds must be consistent with the number of items */
+  uint32_t expected = header.num_items, n = header.num_items;
+  for (unsigned i = 0; i < header.num_levels; ++i) {
+    if (level_bounds[i] != expected || (n > 1) != (i + 1 < header.num_levels))
+      return false;
+
+    n = (n + NODE_SIZE - 1) / NODE_SIZE;
+    expected += n;
+  }
+
+  if (header.num_boxes != (header.num_levels > 0 ? level_bounds.last() : 0))
+    return false;
+
+  boxes.ResizeDiscard(header.num_boxes);
+  indices.ResizeDiscard(header.num_boxes);
+  if (fread(boxes.begin(), sizeof(Box), header.num_boxes,
+            file) != header.num_boxes ||
+      fread(indices.begin(), sizeof(uint32_t), header.num_boxes,
+            file) != header.num_boxes)
+    return false;
+
+  /* each leaf must refer to a shape, and each inner node to nodes
+     below it */
+  for (unsigned i = 0; i < header.num_boxes; ++i)
+    if (i < header.num_items
+        ? indices[i] >= header.num_shapes
+        : indices[i] >= i)
+      return false;
+
+  num_shapes = header.num_shapes;
+  num_items = header.num_items;
+  return true;
+}
@@ -0,0 +1,177 @@
+/*
+Copyright_License {
+
+  XCSoar Glide Computer - http://www.xcsoar.org/
+  Copyright (C) 2000-2012 The XCSoar Project
+  A detailed list of copyright holders can be found in the file "AUTHORS".
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+}
+*/
+
+
+#ifndef XCSOAR_TOPOGRAPHY_SHAPE_INDEX_HPP
+#define XCSOAR_TOPOGRAPHY_SHAPE_INDEX_HPP
+
+#include "shapelib/mapserver.h"
+#include "Util/NonCopyable.hpp"
+#include "Util/AllocatedArray.hpp"
+#include "Util/StaticArray.hpp"
+#include "Compiler.h"
+
+#include <algorithm>
+
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * A packed R-tree over the bounds of all shapes in a shapefile.  It
+ * is built once when the file is opened, and finds the shapes which
+ * overlap a rectangle without reading each shape's bounds from the
+ * file again.
+ *
+ * The leaves are sorted along a Hilbert curve, and each node has up
+ * to #NODE_SIZE children.  All levels are stored in one array, the
+ * leaves first and the root last.
+ */
+class ShapeIndex : private NonCopyable {
+  static const unsigned NODE_SIZE = 16;
+
+  /**
+   * Enough levels for 2^32 shapes.
+   */
+  static const unsigned MAX_LEVELS = 9;
+
+  /**
+   * A bounding box in degrees.  Single precision is enough, because
+   * the boxes are enlarged by a small margin to cover rounding
+   * errors.
+   */
+  struct Box {
+    float min_x, min_y, max_x, max_y;
+
+    bool Overlaps(const Box &other) const {
+      return min_x <= other.max_x && max_x >= other.min_x &&
+        min_y <= other.max_y && max_y >= other.min_y;
+    }
+
+    void Extend(const Box &other);
+  };
+
+  struct CacheHeader {
+    enum {
+      VERSION = 0x1,
+    };
+
+    unsigned version;
+    unsigned num_shapes, num_items, num_boxes, num_levels;
+  };
+
+  /**
+   * The number of shapes in the shapefile.  Shapes without bounds
+   * (e.g. null shapes) are not in the index.
+   */
+  unsigned num_shapes;
+
+  /**
+   * The number of leaves, i.e. the number of indexed shapes.
+   */
+  unsigned num_items;
+
+  AllocatedArray<Box> boxes;
+
+  /**
+   * For leaves, the shape number; for inner nodes, the position of
+   * the first child in #boxes.
+   */
+  AllocatedArray<uint32_t> indices;
+
+  /**
+   * The end position of each level in #boxes, leaves first.
+   */
+  StaticArray<uint32_t, MAX_LEVELS> level_bounds;
+
+public:
+  ShapeIndex():num_shapes(0), num_items(0) {}
+
+  unsigned GetNumShapes() const {
+    return num_shapes;
+  }
+
+  /**
+   * Read the bounds of all shapes and build the tree.
+   */
+  void Build(shapefileObj &file);
+
+  bool SaveCache(FILE *file) const;
+
+  /**
+   * Restore the tree which was saved by SaveCache().
+   *
+   * @param num_shapes the expected number of shapes
+   */
+  bool LoadCache(FILE *file, unsigned num_shapes);
+
+  /**
+   * Invoke the visitor with the number of each shape whose bounds
+   * overlap the specified rectangle, in no particular order.
+   */
+  template<typename V>
+  void VisitOverlapping(const rectObj &rect, V &visitor) const {
+    if (num_items == 0)
+      return;
+
+    const Box query = ToBox(rect);
+
+    StaticArray<uint32_t, NODE_SIZE * MAX_LEVELS> stack;
+    uint32_t node = level_bounds.last() - 1;
+    while (true) {
+      const uint32_t end = std::min(node + NODE_SIZE, GetLevelEnd(node));
+      for (uint32_t i = node; i < end; ++i) {
+        if (!boxes[i].Overlaps(query))
+          continue;
+
+        if (node < num_items)
+          visitor(indices[i]);
+        else
+          stack.append(indices[i]);
+      }
+
+      if (stack.empty())
+        break;
+
+      node = stack.last();
+      stack.shrink(stack.size() - 1);
+    }
+  }
+
+private:
+  gcc_pure
+  static Box ToBox(const rectObj &rect);
+
+  gcc_pure
+  uint32_t GetLevelEnd(uint32_t position) const {
+    for (auto i = level_bounds.begin();; ++i)
+      if (*i > position)
+        return *i;
+  }
+
+  /**
+   * Build the inner nodes on top of the sorted leaves.
+   */
+  void BuildNodes();
+};
+
+#endif
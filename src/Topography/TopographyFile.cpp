@@ -24,39 +24,88 @@ Copyright_License {
 #include "Topography/TopographyFile.hpp"
 #include "Topography/XShape.hpp"
 #include "Projection/WindowProjection.hpp"
+#include "IO/FileCache.hpp"
+#include "OS/PathName.hpp"
+#include "OS/FileMapping.hpp"
+#include "Util/StaticString.hpp"
 
 #include <zzip/lib.h>
+#include <windef.h> /* for MAX_PATH */
 
 #include <algorithm>
 #include <stdlib.h>
 
+/**
+ * A buffer for GetCacheName().  The original is a path name, and the
+ * buffer must hold its base name plus the prefix and suffix; a
+ * truncated name might collide with the one of another shapefile.
+ */
+typedef StaticString<MAX_PATH + 32> CacheName;
+
+/**
+ * Returns the name of the cache file which stores the shape index
+ * (compiled=false) or the compiled shapes (compiled=true) of the
+ * given shapefile.
+ */
+static CacheName
+GetCacheName(const TCHAR *cache_original, bool compiled)
+{
+  CacheName name;
+  name.Format(compiled ? _T("topography-%s-compiled") : _T("topography-%s"),
+              BaseName(cache_original));
+  return name;
+}
+
 TopographyFile::TopographyFile(struct zzip_dir *_dir, const char *filename,
                                fixed _threshold,
                                fixed _label_threshold,
                                fixed _important_label_threshold,
                                const Color thecolor,
                                int _label_field, int _icon,
-                               int _pen_width)
-  :dir(_dir), first(NULL),
+                               int _pen_width,
+                               FileCache *cache,
+                               const TCHAR *cache_original,
+                               unsigned _point_distance_divisor)
+  :dir(_dir), shapefile_open(false),
    label_field(_label_field), icon(_icon),
    pen_width(_pen_width),
    color(thecolor), scale_threshold(_threshold),
    label_threshold(_label_threshold),
-   important_label_threshold(_important_label_threshold)
+   important_label_threshold(_important_label_threshold),
+   point_distance_divisor(_point_distance_divisor)
 {
-  if (msShapefileOpen(&file, "rb", dir, filename, 0) == -1)
-    return;
+  if (cache != NULL && OpenCompiled(*cache, cache_original) &&
+      LoadCachedIndex(*cache, cache_original, compiled.GetNumShapes())) {
+    /* everything is in the cache, the shapefile is not needed */
+  } else {
+    compiled.Close();
+
+    if (msShapefileOpen(&file, "rb", dir, filename, 0) == -1)
+      return;
+
+    if (file.numshapes == 0) {
+      msShapefileClose(&file);
+      return;
+    }
 
-  if (file.numshapes == 0) {
-    msShapefileClose(&file);
-    return;
-  }
+    if (cache == NULL ||
+        !LoadCachedIndex(*cache, cache_original, file.numshapes))
+      BuildIndex(cache, cache_original);
 
-  shapes.ResizeDiscard(file.numshapes);
-  std::fill(shapes.begin(), shapes.end(), ShapeList(NULL));
+    if (cache != NULL && Compile(*cache, cache_original))
+      /* from now on, the shapes are loaded from the compiled file */
+      msShapefileClose(&file);
+    else {
+      shapefile_open = true;
+
+      if (dir != NULL)
+        ++dir->refcount;
+    }
+  }
 
-  if (dir != NULL)
-    ++dir->refcount;
+  shapes.ResizeDiscard(shapefile_open
+                       ? file.numshapes : compiled.GetNumShapes());
+  std::fill(shapes.begin(), shapes.end(), (XShape *)NULL);
 
   cache_bounds.west = cache_bounds.east =
     cache_bounds.south = cache_bounds.north = Angle::Zero();
@@ -66,27 +115,106 @@ TopographyFile::TopographyFile(struct zzip_dir *_dir, const char *filename,
 
 TopographyFile::~TopographyFile()
 {
-  if (IsEmpty())
-    return;
-
   ClearCache();
-  msShapefileClose(&file);
 
-  if (dir != NULL) {
-    --dir->refcount;
-    zzip_dir_free(dir);
+  if (shapefile_open) {
+    msShapefileClose(&file);
+
+    if (dir != NULL) {
+      --dir->refcount;
+      zzip_dir_free(dir);
+    }
+  }
+}
+
+bool
+TopographyFile::LoadCachedIndex(FileCache &cache, const TCHAR *cache_original,
+                                unsigned num_shapes)
+{
+  const auto name = GetCacheName(cache_original, false);
+
+  FILE *cache_file = cache.Load(name, cache_original);
+  if (cache_file == NULL)
+    return false;
+
+  const bool success = index.LoadCache(cache_file, num_shapes);
+  fclose(cache_file);
+  if (!success)
+    cache.Flush(name);
+
+  return success;
+}
+
+void
+TopographyFile::BuildIndex(FileCache *cache, const TCHAR *cache_original)
+{
+  index.Build(file);
+
+  if (cache != NULL) {
+    const auto name = GetCacheName(cache_original, false);
+
+    FILE *cache_file = cache->Save(name, cache_original);
+    if (cache_file != NULL) {
+      if (index.SaveCache(cache_file))
+        cache->Commit(name, cache_file);
+      else
+        cache->Cancel(name, cache_file);
+    }
+  }
+}
+
+bool
+TopographyFile::OpenCompiled(FileCache &cache, const TCHAR *cache_original)
+{
+  const auto name = GetCacheName(cache_original, true);
+
+  size_t offset;
+  FileMapping *mapping = cache.Map(name, cache_original, offset);
+  if (mapping == NULL)
+    return false;
+
+  if (!compiled.Open(mapping, offset, label_field)) {
+    delete mapping;
+    cache.Flush(name);
+    return false;
+  }
+
+  return true;
+}
+
+bool
+TopographyFile::Compile(FileCache &cache, const TCHAR *cache_original)
+{
+  const auto name = GetCacheName(cache_original, true);
+
+  FILE *cache_file = cache.Save(name, cache_original);
+  if (cache_file == NULL)
+    return false;
+
+  if (!CompiledShapes::Save(cache_file, file, label_field)) {
+    cache.Cancel(name, cache_file);
+    return false;
   }
+
+  return cache.Commit(name, cache_file) &&
+    OpenCompiled(cache, cache_original);
 }
 
 void
 TopographyFile::ClearCache()
 {
-  for (auto i = shapes.begin(), end = shapes.end(); i != end; ++i) {
-    delete i->shape;
-    i->shape = NULL;
+  {
+    ScopeLock protect(mutex);
+    published.clear();
+    ++serial;
+  }
+
+  for (auto i = loaded.begin(), end = loaded.end(); i != end; ++i) {
+    delete shapes[*i];
+    shapes[*i] = NULL;
   }
 
-  first = NULL;
+  loaded.clear();
 }
 
 gcc_pure
@@ -101,6 +229,19 @@ ConvertRect(const GeoBounds &br)
   return dest;
 }
 
+/**
+ * Collects the shape numbers found by ShapeIndex::VisitOverlapping().
+ */
+struct VisibleCollector {
+  std::vector<unsigned> &visible;
+
+  VisibleCollector(std::vector<unsigned> &_visible):visible(_visible) {}
+
+  void operator()(unsigned shape) {
+    visible.push_back(shape);
+  }
+};
+
 bool
 TopographyFile::Update(const WindowProjection &map_projection)
 {
@@ -119,42 +260,58 @@ TopographyFile::Update(const WindowProjection &map_projection)
 
   cache_bounds = map_projection.GetScreenBounds().Scale(fixed_two);
 
-  rectObj deg_bounds = ConvertRect(cache_bounds);
-
-  // Test which shapes are inside the given bounds and save the
-  // status to file.status
-  msShapefileWhichShapes(&file, dir, deg_bounds, 0);
+  // Find the shapes which are inside the given bounds
+  visible.clear();
+  VisibleCollector collector(visible);
+  index.VisitOverlapping(ConvertRect(cache_bounds), collector);
+
+  std::sort(visible.begin(), visible.end());
+
+  unsigned min_distance[XShape::THINNING_LEVELS];
+  for (unsigned level = 0; level < XShape::THINNING_LEVELS; ++level)
+    min_distance[level] = GetMinimumPointDistance(level)
+      / point_distance_divisor;
+
+  // Load the shapes which have entered the bounds, and build the new
+  // list; the renderer may still be drawing the old one
+  back.clear();
+  for (auto i = visible.begin(), end = visible.end(); i != end; ++i) {
+    XShape *&shape = shapes[*i];
+    if (shape == NULL) {
+      // shape isn't cached yet -> cache the shape
+      shape = compiled.IsDefined()
+        ? new (arena) XShape(arena, compiled.GetRecord(*i),
+                             compiled.GetRecordSize(*i))
+        : new (arena) XShape(arena, &file, *i, label_field);
+
+      // simplify it here, the renderer only reads the result
+      shape->BuildThinningLevels(min_distance);
+    }
+    back.push_back(shape);
+  }
 
-  // If not a single shape is inside the bounds
-  if (!file.status) {
-    // ... clear the whole buffer
-    ClearCache();
-    return false;
+  {
+    ScopeLock protect(mutex);
+    published.swap(back);
+    ++serial;
   }
 
-  // Iterate through the shapefile entries
-  const ShapeList **current = &first;
-  auto it = shapes.begin();
-  for (int i = 0; i < file.numshapes; ++i, ++it) {
-    if (!msGetBit(file.status, i)) {
-      // If the shape is outside the bounds
-      // delete the shape from the cache
-      delete it->shape;
-      it->shape = NULL;
-    } else {
-      // is inside the bounds
-      if (it->shape == NULL)
-        // shape isn't cached yet -> cache the shape
-        it->shape = new XShape(&file, i, label_field);
-      // update list pointer
-      *current = it;
-      current = &it->next;
+  // Delete the shapes which have left the bounds; both lists are
+  // sorted by shape number.  This is safe without the lock, because
+  // the renderer checks the serial before it uses its cached pointers
+  auto v = visible.begin();
+  for (auto i = loaded.begin(), end = loaded.end(); i != end; ++i) {
+    const unsigned n = *i;
+    while (v != visible.end() && *v < n)
+      ++v;
+
+    if (v == visible.end() || *v != n) {
+      delete shapes[n];
+      shapes[n] = NULL;
     }
   }
-  // end of list marker
-  *current = NULL;
 
-  ++serial;
+  loaded.swap(visible);
   return true;
 }
 
@@ -170,8 +327,6 @@ TopographyFile::GetSkipSteps(fixed map_scale) const
   return 1;
 }
 
-#ifdef ENABLE_OPENGL
-
 unsigned
 TopographyFile::GetThinningLevel(fixed map_scale) const
 {
@@ -198,5 +353,3 @@ TopographyFile::GetMinimumPointDistance(unsigned level) const
   }
   return 1;
 }
-
-#endif
@@ -26,14 +26,21 @@ Copyright_License {
 #define TOPOGRAPHY_HPP
 
 #include "shapelib/mapserver.h"
+#include "ShapeIndex.hpp"
+#include "ShapeArena.hpp"
+#include "CompiledShapes.hpp"
 #include "Geo/GeoBounds.hpp"
 #include "Util/NonCopyable.hpp"
 #include "Util/AllocatedArray.hpp"
 #include "Util/Serial.hpp"
+#include "Thread/Mutex.hpp"
 #include "Math/fixed.hpp"
 #include "Screen/Color.hpp"
 
+#include <vector>
+
 #include <assert.h>
+#include <tchar.h>
 
 struct GeoPoint;
 class Canvas;
@@ -42,29 +49,71 @@ struct GeoBounds;
 class LabelBlock;
 struct MapSettings;
 class XShape;
+class FileCache;
 struct zzip_dir;
 
 class TopographyFile : private NonCopyable {
-  struct ShapeList {
-    const ShapeList *next;
+  struct zzip_dir *dir;
 
-    const XShape *shape;
+  /**
+   * Is #file open?  It is closed as soon as #compiled is available.
+   */
+  bool shapefile_open;
 
-    ShapeList() {}
-    ShapeList(const XShape *_shape):shape(_shape) {}
-  };
+  shapefileObj file;
 
   /**
-   * This gets incremented by Update().
+   * The shapes in the #FileCache, which are preferred over #file.
    */
-  Serial serial;
+  CompiledShapes compiled;
 
-  struct zzip_dir *dir;
+  /**
+   * The bounds of all shapes, to find the visible ones quickly.
+   */
+  ShapeIndex index;
 
-  shapefileObj file;
+  /**
+   * The memory of all loaded shapes.  It is used only by the thread
+   * which calls Update().
+   */
+  ShapeArena arena;
+
+  /**
+   * One item per shape, NULL if the shape is not loaded.  This is
+   * owned by the thread which calls Update().
+   */
+  AllocatedArray<XShape *> shapes;
 
-  AllocatedArray<ShapeList> shapes;
-  const ShapeList *first;
+  /**
+   * The numbers of the loaded shapes, in ascending order.  This is
+   * owned by the thread which calls Update().
+   */
+  std::vector<unsigned> loaded;
+
+  /**
+   * The shapes found by the last Update() call.  This is only used
+   * by Update() internally, but is stored in the class to avoid
+   * reallocating it each time.
+   */
+  std::vector<unsigned> visible;
+
+  /**
+   * Protects #serial and #published.  The renderer holds it while it
+   * accesses the shapes; Update() locks it only to publish a new
+   * list, and never while it reads the shapefile.
+   */
+  mutable Mutex mutex;
+
+  /**
+   * This gets incremented each time Update() publishes a new list.
+   */
+  Serial serial;
+
+  /**
+   * The loaded shapes in ascending shape order.  This list is never
+   * modified; Update() builds the next one in #back and swaps both.
+   */
+  std::vector<const XShape *> published, back;
 
   int label_field, icon, pen_width;
 
@@ -89,6 +138,12 @@ class TopographyFile : private NonCopyable {
    */
   fixed important_label_threshold;
 
+  /**
+   * The minimum point distances of the thinning levels are divided by
+   * this value, see GetMinimumPointDistance().
+   */
+  unsigned point_distance_divisor;
+
   /**
    * The current scope of the shape cache.  If the screen exceeds this
    * rectangle, then we need to update the cache.
@@ -96,42 +151,7 @@ class TopographyFile : private NonCopyable {
   GeoBounds cache_bounds;
 
 public:
-  class const_iterator {
-    friend class TopographyFile;
-
-    const ShapeList *current;
-
-    const_iterator(const ShapeList *p):current(p) {}
-
-  public:
-    const_iterator &operator++() {
-      assert(current != NULL);
-
-      current = current->next;
-      return *this;
-    }
-
-    const XShape &operator*() const {
-      assert(current != NULL);
-      assert(current->shape != NULL);
-
-      return *current->shape;
-    }
-
-    const XShape *operator->() const {
-      assert(current != NULL);
-
-      return current->shape;
-    }
-
-    bool operator==(const const_iterator &other) const {
-      return current == other.current;
-    }
-
-    bool operator!=(const const_iterator &other) const {
-      return !(*this == other);
-    }
-  };
+  typedef std::vector<const XShape *>::const_iterator const_iterator;
 
 public:
   /**
@@ -145,6 +165,13 @@ public:
    * @param label_threshold the zoom threshold for label rendering
    * @param important_label_threshold labels below this zoom threshold will
    * be renderd in default style
+   * @param cache a #FileCache for the spatial index and the compiled
+   * shapes, or NULL
+   * @param cache_original the path of the shapefile, which is used by
+   * #cache to validate the cached files
+   * @param point_distance_divisor the minimum point distances of the
+   * thinning levels are divided by this value, e.g. the screen's
+   * pixel scale
    * @return
    */
   TopographyFile(struct zzip_dir *dir, const char *shpname,
@@ -152,13 +179,24 @@ public:
                  fixed important_label_threshold,
                  const Color color,
                  int label_field=-1, int icon=0,
-                 int pen_width=1);
+                 int pen_width=1,
+                 FileCache *cache=NULL, const TCHAR *cache_original=NULL,
+                 unsigned point_distance_divisor=1);
 
   /**
    * The destructor clears the cache and closes the shapefile
    */
   ~TopographyFile();
 
+  /**
+   * Returns the mutex which must be locked while calling
+   * GetSerial(), begin() and end(), and while using the shapes
+   * obtained from them.
+   */
+  Mutex &GetMutex() const {
+    return mutex;
+  }
+
   const Serial &GetSerial() const {
     return serial;
   }
@@ -192,17 +230,16 @@ public:
   }
 
   const_iterator begin() const {
-    return const_iterator(first);
+    return published.begin();
   }
 
   const_iterator end() const {
-    return const_iterator(NULL);
+    return published.end();
   }
 
   gcc_pure
   unsigned GetSkipSteps(fixed map_scale) const;
 
-#ifdef ENABLE_OPENGL
   /**
    * @return thinning level, range: 0 .. XShape::THINNING_LEVELS-1
    */
@@ -210,19 +247,48 @@ public:
   unsigned GetThinningLevel(fixed map_scale) const;
 
   /**
-   * @return minimum distance between points in ShapePoint coordinates
+   * @return the tolerance of the simplification [m], which is also
+   * the minimum distance between points in ShapePoint coordinates
    */
   gcc_pure
   unsigned GetMinimumPointDistance(unsigned level) const;
-#endif
 
   /**
+   * Load the shapes around the given projection and publish the new
+   * list.  Shapes which have left the area are deleted after the
+   * renderer has released the old list.  This method must not be
+   * called by two threads at a time.
+   *
    * @return true if new data from the topography file has been loaded
    */
   bool Update(const WindowProjection &map_projection);
 
 protected:
   void ClearCache();
+
+private:
+  /**
+   * Restore the spatial index from the #FileCache.
+   */
+  bool LoadCachedIndex(FileCache &cache, const TCHAR *cache_original,
+                       unsigned num_shapes);
+
+  /**
+   * Build the spatial index from the shapefile, and save it in the
+   * #FileCache.
+   */
+  void BuildIndex(FileCache *cache, const TCHAR *cache_original);
+
+  /**
+   * Map the compiled shapes from the #FileCache.
+   */
+  bool OpenCompiled(FileCache &cache, const TCHAR *cache_original);
+
+  /**
+   * Write all shapes of the shapefile to the #FileCache, and map
+   * them.
+   */
+  bool Compile(FileCache &cache, const TCHAR *cache_original);
 };
 
 #endif
@@ -30,7 +30,6 @@ Copyright_License {
 #include "Screen/Fonts.hpp"
 #include "Screen/LabelBlock.hpp"
 #include "Screen/Features.hpp"
-#include "Screen/Layout.hpp"
 #include "Math/Matrix2D.hpp"
 #include "shapelib/mapserver.h"
 #include "Util/AllocatedArray.hpp"
@@ -61,7 +60,7 @@ TopographyFileRenderer::UpdateVisibleShapes(const WindowProjection &projection)
   visible_labels.clear();
 
   for (auto it = file.begin(), end = file.end(); it != end; ++it) {
-    const XShape &shape = *it;
+    const XShape &shape = **it;
 
     if (!visible_bounds.Overlaps(shape.get_bounds()))
       continue;
@@ -136,6 +135,10 @@ TopographyFileRenderer::Paint(Canvas &canvas,
   if (!file.IsVisible(map_scale))
     return;
 
+  /* the loader thread must not delete the shapes while we draw
+     them */
+  ScopeLock protect(file.GetMutex());
+
   UpdateVisibleShapes(projection);
 
   if (visible_shapes.empty())
@@ -155,10 +158,9 @@ TopographyFileRenderer::Paint(Canvas &canvas,
 
   // get drawing info
 
-#ifdef ENABLE_OPENGL
   const unsigned level = file.GetThinningLevel(map_scale);
-  const unsigned min_distance = file.GetMinimumPointDistance(level)
-    / Layout::Scale(1);
+
+#ifdef ENABLE_OPENGL
 
 #ifndef HAVE_GLES
   float opengl_matrix[16];
@@ -188,8 +190,6 @@ TopographyFileRenderer::Paint(Canvas &canvas,
 #else // !ENABLE_OPENGL
   const GeoClip clip(projection.GetScreenBounds().Scale(fixed(1.1)));
   AllocatedArray<GeoPoint> geo_points;
-
-  int iskip = file.GetSkipSteps(map_scale);
 #endif
 
   for (auto it = visible_shapes.begin(), end = visible_shapes.end();
@@ -243,7 +243,7 @@ TopographyFileRenderer::Paint(Canvas &canvas,
 
         const GLushort *indices, *count;
         if (level == 0 ||
-            (indices = shape.get_indices(level, min_distance, count)) == NULL) {
+            (indices = shape.get_indices(level, count)) == NULL) {
           count = shape.get_lines();
           const GLushort *end_count = count + shape.get_number_of_lines();
           for (int offset = 0; count < end_count; offset += *count++)
@@ -254,18 +254,35 @@ TopographyFileRenderer::Paint(Canvas &canvas,
             glDrawElements(GL_LINE_STRIP, *count, GL_UNSIGNED_SHORT, indices);
         }
 #else // !ENABLE_OPENGL
-      for (; lines < end_lines; ++lines) {
-        unsigned msize = *lines;
+      const unsigned short *indices, *count;
+      if (level == 0 ||
+          (indices = shape.get_indices(level, count)) == NULL) {
+        /* no simplification: use all points */
+        indices = NULL;
+        count = lines;
+      }
+
+      const unsigned short *end_count = count + shape.get_number_of_lines();
+      for (; count < end_count; ++count) {
+        const unsigned msize = *count;
         shape_renderer.Begin(msize);
 
-        const GeoPoint *end = points + msize - 1;
-        for (; points < end; ++points)
-          shape_renderer.AddPointIfDistant(projection.GeoToScreen(*points));
+        for (unsigned i = 0; i + 1 < msize; ++i) {
+          const GeoPoint &p = points[indices != NULL ? indices[i] : i];
+          shape_renderer.AddPointIfDistant(projection.GeoToScreen(p));
+        }
 
         // make sure we always draw the last point
-        shape_renderer.AddPoint(projection.GeoToScreen(*points));
+        const unsigned last = msize - 1;
+        const GeoPoint &p = points[indices != NULL ? indices[last] : last];
+        shape_renderer.AddPoint(projection.GeoToScreen(p));
 
         shape_renderer.FinishPolyline(canvas);
+
+        if (indices != NULL)
+          indices += msize;
+        else
+          points += msize;
       }
 #endif
       }
@@ -275,8 +292,7 @@ TopographyFileRenderer::Paint(Canvas &canvas,
 #ifdef ENABLE_OPENGL
       {
         const GLushort *index_count;
-        const GLushort *triangles = shape.get_indices(level, min_distance,
-                                                        index_count);
+        const GLushort *triangles = shape.get_indices(level, index_count);
 
 #ifdef HAVE_GLES
         glVertexPointer(2, GL_FIXED, 0, &points[0].x);
@@ -287,8 +303,17 @@ TopographyFileRenderer::Paint(Canvas &canvas,
                        triangles);
       }
 #else // !ENABLE_OPENGL
-      for (; lines < end_lines; ++lines) {
-        unsigned msize = *lines / iskip;
+      const unsigned short *indices, *count;
+      if (level == 0 ||
+          (indices = shape.get_indices(level, count)) == NULL) {
+        /* no simplification: use all points */
+        indices = NULL;
+        count = lines;
+      }
+
+      const unsigned short *end_count = count + shape.get_number_of_lines();
+      for (; count < end_count; ++count) {
+        unsigned msize = *count;
 
         /* copy all polygon points into the geo_points array and clip
            them, to avoid integer overflows (as RasterPoint may store
@@ -296,8 +321,14 @@ TopographyFileRenderer::Paint(Canvas &canvas,
 
         geo_points.GrowDiscard(msize * 3);
 
-        for (unsigned i = 0; i < msize; ++i)
-          geo_points[i] = points[i * iskip];
+        if (indices != NULL) {
+          for (unsigned i = 0; i < msize; ++i)
+            geo_points[i] = points[indices[i]];
+          indices += msize;
+        } else {
+          std::copy(points, points + msize, geo_points.begin());
+          points += msize;
+        }
 
         msize = clip.ClipPolygon(geo_points.begin(),
                                  geo_points.begin(), msize);
@@ -332,13 +363,15 @@ TopographyFileRenderer::PaintLabels(Canvas &canvas,
                                     const WindowProjection &projection,
                                     LabelBlock &label_block)
 {
-  if (file.IsEmpty())
+  if (file.IsEmpty() || label_block.IsFull())
     return;
 
   fixed map_scale = projection.GetMapScale();
   if (!file.IsVisible(map_scale) || !file.IsLabelVisible(map_scale))
     return;
 
+  ScopeLock protect(file.GetMutex());
+
   UpdateVisibleShapes(projection);
 
   if (visible_labels.empty())
@@ -370,6 +403,10 @@ TopographyFileRenderer::PaintLabels(Canvas &canvas,
        it != end; ++it) {
     const XShape &shape = **it;
 
+    if (label_block.IsFull())
+      /* the label budget of this frame is exhausted */
+      break;
+
     if (!projection.GetScreenBounds().Overlaps(shape.get_bounds()))
       continue;
 
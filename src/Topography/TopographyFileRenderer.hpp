@@ -67,6 +67,10 @@ class TopographyFileRenderer : private NonCopyable {
 public:
   TopographyFileRenderer(const TopographyFile &file);
 
+  const TopographyFile &GetFile() const {
+    return file;
+  }
+
   /**
    * Paints the polygons, lines and points/icons in the TopographyFile
    * @param canvas The canvas to paint on
@@ -86,6 +90,9 @@ public:
                    const WindowProjection &projection, LabelBlock &label_block);
 
 private:
+  /**
+   * Caller must lock the #TopographyFile's mutex.
+   */
   void UpdateVisibleShapes(const WindowProjection &projection);
 
 #ifdef ENABLE_OPENGL
@@ -42,7 +42,7 @@ Copyright_License {
  * directory.
  */
 static bool
-LoadConfiguredTopographyFile(TopographyStore &store,
+LoadConfiguredTopographyFile(TopographyStore &store, FileCache *cache,
                              OperationEnvironment &operation)
 {
   TCHAR file[MAX_PATH];
@@ -60,7 +60,7 @@ LoadConfiguredTopographyFile(TopographyStore &store,
   if (directory == NULL)
     return false;
 
-  store.Load(operation, reader, directory);
+  store.Load(operation, reader, directory, NULL, cache, directory);
   return true;
 }
 
@@ -69,7 +69,7 @@ LoadConfiguredTopographyFile(TopographyStore &store,
  * the same ZIP file.
  */
 static bool
-LoadConfiguredTopographyZip(TopographyStore &store,
+LoadConfiguredTopographyZip(TopographyStore &store, FileCache *cache,
                             OperationEnvironment &operation)
 {
   TCHAR path[MAX_PATH];
@@ -86,18 +86,18 @@ LoadConfiguredTopographyZip(TopographyStore &store,
     return false;
   }
 
-  store.Load(operation, reader, NULL, dir);
+  store.Load(operation, reader, NULL, dir, cache, path);
   zzip_dir_close(dir);
   return true;
 }
 
 bool
-LoadConfiguredTopography(TopographyStore &store,
+LoadConfiguredTopography(TopographyStore &store, FileCache *cache,
                          OperationEnvironment &operation)
 {
   LogStartUp(_T("Loading Topography File..."));
   operation.SetText(_("Loading Topography File..."));
 
-  return LoadConfiguredTopographyFile(store, operation) ||
-    LoadConfiguredTopographyZip(store, operation);
+  return LoadConfiguredTopographyFile(store, cache, operation) ||
+    LoadConfiguredTopographyZip(store, cache, operation);
 }
@@ -25,10 +25,17 @@ Copyright_License {
 #define TOPOGRAPHY_GLUE_H
 
 class TopographyStore;
+class FileCache;
 class OperationEnvironment;
 
+/**
+ * Load the topography.  Determines the files to load from profile
+ * settings.
+ *
+ * @param cache a #FileCache for the spatial indexes, or NULL
+ */
 bool
-LoadConfiguredTopography(TopographyStore &store,
+LoadConfiguredTopography(TopographyStore &store, FileCache *cache,
                          OperationEnvironment &operation);
 
 #endif
@@ -23,6 +23,8 @@ Copyright_License {
 
 #include "Topography/TopographyRenderer.hpp"
 #include "Topography/TopographyFileRenderer.hpp"
+#include "Topography/TopographyFile.hpp"
+#include "Projection/WindowProjection.hpp"
 
 TopographyRenderer::TopographyRenderer(const TopographyStore &_store)
   :store(_store)
@@ -50,6 +52,15 @@ TopographyRenderer::DrawLabels(Canvas &canvas,
                                const WindowProjection &projection,
                                LabelBlock &label_block) const
 {
+  const fixed map_scale = projection.GetMapScale();
+
+  /* the files with important labels claim their screen space
+     first */
+  for (auto it = files.begin(), end = files.end(); it != end; ++it)
+    if ((*it)->GetFile().IsLabelImportant(map_scale))
+      (*it)->PaintLabels(canvas, projection, label_block);
+
   for (auto it = files.begin(), end = files.end(); it != end; ++it)
-    (*it)->PaintLabels(canvas, projection, label_block);
+    if (!(*it)->GetFile().IsLabelImportant(map_scale))
+      (*it)->PaintLabels(canvas, projection, label_block);
 }
@@ -63,6 +63,58 @@ TopographyStore::ScanVisibility(const WindowProjection &m_projection,
   return num_updated;
 }
 
+void
+TopographyStore::ScanVisibilityAsync(const WindowProjection &m_projection)
+{
+  loader.Wake(m_projection);
+}
+
+void
+TopographyStore::Loader::Wake(const WindowProjection &_projection)
+{
+  ScopeLock protect(mutex);
+  projection = _projection;
+
+  if (IsBusy())
+    again = true;
+  else
+    Trigger();
+}
+
+void
+TopographyStore::Loader::Cancel()
+{
+  ScopeLock protect(mutex);
+  Stop();
+}
+
+void
+TopographyStore::Loader::Tick()
+{
+  SetLowPriority();
+
+  do {
+    again = false;
+    const WindowProjection copy = projection;
+    mutex.Unlock();
+
+    bool stopped = false;
+    for (auto it = store.files.begin(), end = store.files.end();
+         it != end && !stopped; ++it) {
+      (*it)->Update(copy);
+
+      mutex.Lock();
+      stopped = IsStopped();
+      mutex.Unlock();
+    }
+
+    mutex.Lock();
+  } while (again && !IsStopped());
+}
+
+TopographyStore::TopographyStore(unsigned _point_distance_divisor)
+  :loader(*this), point_distance_divisor(_point_distance_divisor) {}
+
 TopographyStore::~TopographyStore()
 {
   Reset();
@@ -70,7 +122,8 @@ TopographyStore::~TopographyStore()
 
 void
 TopographyStore::Load(OperationEnvironment &operation, NLineReader &reader,
-                      const TCHAR *directory, struct zzip_dir *zdir)
+                      const TCHAR *directory, struct zzip_dir *zdir,
+                      FileCache *cache, const TCHAR *cache_directory)
 {
   Reset();
 
@@ -173,13 +226,27 @@ TopographyStore::Load(OperationEnvironment &operation, NLineReader &reader,
     if (*p == _T(','))
       labelImportantRange = fixed(strtod(p + 1, &p)) * 1000;
 
+    // The path of the shapefile for validating the cached index
+    TCHAR cache_original_buffer[MAX_PATH];
+    const TCHAR *cache_original = NULL;
+    if (cache != NULL && cache_directory != NULL) {
+      _tcscpy(cache_original_buffer, cache_directory);
+      _tcscat(cache_original_buffer, _T(DIR_SEPARATOR_S));
+      _tcscat(cache_original_buffer, PathName(shape_filename_end));
+      cache_original = cache_original_buffer;
+    }
+
     // Create TopographyFile instance from parsed line
     TopographyFile *file = new TopographyFile(zdir, shape_filename,
                                               shape_range, label_range,
                                               labelImportantRange,
                                               Color(red, green, blue),
                                               shape_field, shape_icon,
-                                              pen_width);
+                                              pen_width,
+                                              cache_original != NULL
+                                              ? cache : NULL,
+                                              cache_original,
+                                              point_distance_divisor);
     if (file->IsEmpty())
       // If the shape file could not be read -> skip this line/file
       delete file;
@@ -195,6 +262,8 @@ TopographyStore::Load(OperationEnvironment &operation, NLineReader &reader,
 void
 TopographyStore::Reset()
 {
+  loader.Cancel();
+
   for (auto it = files.begin(), end = files.end(); it != end; ++it)
     delete *it;
 
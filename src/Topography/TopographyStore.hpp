@@ -26,13 +26,15 @@ Copyright_License {
 
 #include "Util/NonCopyable.hpp"
 #include "Util/StaticArray.hpp"
+#include "Thread/StandbyThread.hpp"
+#include "Projection/WindowProjection.hpp"
 
 #include <tchar.h>
 
-class WindowProjection;
 class TopographyFile;
 class NLineReader;
 class OperationEnvironment;
+class FileCache;
 struct zzip_dir;
 
 /**
@@ -46,9 +48,56 @@ public:
   };
 
 private:
+  /**
+   * Loads the shapes around the most recent projection in
+   * background, so the renderer never waits for shapefile I/O.
+   */
+  class Loader : public StandbyThread {
+    TopographyStore &store;
+
+    /**
+     * The projection which will be used by the next Tick().
+     */
+    WindowProjection projection;
+
+    /**
+     * Was Wake() called while the thread was busy?
+     */
+    bool again;
+
+  public:
+    Loader(TopographyStore &_store):store(_store), again(false) {}
+
+    /**
+     * Start loading the shapes for the given projection.
+     */
+    void Wake(const WindowProjection &_projection);
+
+    /**
+     * Stop the thread and wait for it.
+     */
+    void Cancel();
+
+  protected:
+    virtual void Tick();
+  };
+
   StaticArray<TopographyFile *, MAXTOPOGRAPHY> files;
 
+  Loader loader;
+
+  /**
+   * Passed to the #TopographyFile constructor.
+   */
+  unsigned point_distance_divisor;
+
 public:
+  /**
+   * @param point_distance_divisor the minimum point distances of the
+   * thinning levels are divided by this value, e.g. the screen's
+   * pixel scale
+   */
+  explicit TopographyStore(unsigned point_distance_divisor=1);
   ~TopographyStore();
 
   unsigned size() const {
@@ -67,8 +116,22 @@ public:
   unsigned ScanVisibility(const WindowProjection &m_projection,
                           unsigned max_update=1024);
 
+  /**
+   * Like ScanVisibility(), but load the shapes in a background
+   * thread.  The new lists are published as soon as each file is
+   * done; this method returns immediately.
+   */
+  void ScanVisibilityAsync(const WindowProjection &m_projection);
+
+  /**
+   * @param cache a #FileCache for the spatial indexes, or NULL
+   * @param cache_directory the directory or the ZIP file which
+   * contains the shapefiles; the #FileCache uses it to validate the
+   * cached indexes
+   */
   void Load(OperationEnvironment &operation, NLineReader &reader,
-            const TCHAR *directory, struct zzip_dir *zdir = NULL);
+            const TCHAR *directory, struct zzip_dir *zdir = NULL,
+            FileCache *cache = NULL, const TCHAR *cache_directory = NULL);
   void Reset();
 };
 
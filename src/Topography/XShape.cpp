@@ -22,48 +22,137 @@ Copyright_License {
 */
 
 #include "Topography/XShape.hpp"
+#include "Topography/ShapeArena.hpp"
 #include "Util/UTF8.hpp"
 #include "shapelib/mapserver.h"
+#include "Geo/Constants.hpp"
 #ifdef ENABLE_OPENGL
 #include "Projection/Projection.hpp"
 #include "Screen/OpenGL/Triangulate.hpp"
-#include "Geo/Constants.hpp"
 #endif
 
 #include <algorithm>
+#include <vector>
 #include <tchar.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
 
 #ifdef _UNICODE
 #include <windows.h>
 #endif
 
-static TCHAR *
-import_label(const char *src)
+/**
+ * Returns the label text if it shall be displayed, or NULL.
+ */
+gcc_pure
+static const char *
+check_label(const char *src)
 {
   if (src == NULL || strcmp(src, "UNK") == 0 ||
       strcmp(src, "RAILWAY STATION") == 0 ||
       strcmp(src, "RAILROAD STATION") == 0)
     return NULL;
 
+#ifndef _UNICODE
+  if (!ValidateUTF8(src))
+    return NULL;
+#endif
+
+  return src;
+}
+
+/**
+ * Returns the number of TCHARs (including the null terminator)
+ * needed to import the label, or 0 if the label is not valid.
+ */
+gcc_pure
+static size_t
+label_length(const char *src)
+{
+#ifdef _UNICODE
+  int length = ::MultiByteToWideChar(CP_UTF8, 0, src, -1, NULL, 0);
+  return length > 0 ? length : 0;
+#else
+  return strlen(src) + 1;
+#endif
+}
+
+static void
+import_label(TCHAR *dest, size_t length, const char *src)
+{
 #ifdef _UNICODE
-  size_t length = strlen(src);
-  TCHAR *dest = new TCHAR[length + 1];
-  if (::MultiByteToWideChar(CP_UTF8, 0, src, -1, dest, length + 1) <= 0) {
-    delete[] dest;
+  ::MultiByteToWideChar(CP_UTF8, 0, src, -1, dest, length);
+#else
+  memcpy(dest, src, length);
+#endif
+}
+
+/**
+ * Convert the label to UTF-8.  Returns NULL on error; the return
+ * value must be freed with free().
+ */
+static char *
+export_label(const TCHAR *src)
+{
+#ifdef _UNICODE
+  int length = ::WideCharToMultiByte(CP_UTF8, 0, src, -1, NULL, 0,
+                                     NULL, NULL);
+  if (length <= 0)
+    return NULL;
+
+  char *dest = (char *)malloc(length);
+  if (::WideCharToMultiByte(CP_UTF8, 0, src, -1, dest, length,
+                            NULL, NULL) <= 0) {
+    free(dest);
     return NULL;
   }
 
   return dest;
 #else
-  if (!ValidateUTF8(src))
-    return NULL;
-
   return strdup(src);
 #endif
 }
 
+/**
+ * The fixed-size part of a record written by XShape::Compile().  It
+ * is followed by the line lengths, the points and the UTF-8 label,
+ * each padded to 8 bytes.
+ */
+struct CompiledShapeHeader {
+  GeoBounds bounds;
+
+  uint32_t num_points;
+
+  /**
+   * The size of the label including the null terminator [bytes], 0
+   * if there is no label.
+   */
+  uint16_t label_size;
+
+  uint8_t type, num_lines;
+};
+
+static_assert(sizeof(CompiledShapeHeader) % 8 == 0,
+              "points would be misaligned");
+
+gcc_const
+static size_t
+Pad8(size_t size)
+{
+  return (size + 7) & ~(size_t)7;
+}
+
+static bool
+WritePadded(FILE *file, const void *data, size_t size)
+{
+  static const char zero[8] = { 0 };
+  const size_t padding = Pad8(size) - size;
+  return fwrite(data, 1, size, file) == size &&
+    fwrite(zero, 1, padding, file) == padding;
+}
+
 /**
  * Returns the minimum number of points for each line of this shape
  * type.  Returns -1 if the shape type is not supported.
@@ -88,13 +177,30 @@ min_points_for_type(int shapelib_type)
   }
 }
 
-XShape::XShape(shapefileObj *shpfile, int i, int label_field)
-  :label(NULL)
+void *
+XShape::operator new(size_t size, ShapeArena &arena)
+{
+  return arena.Allocate(size);
+}
+
+void
+XShape::operator delete(void *p)
+{
+  ShapeArena::Free(p);
+}
+
+void
+XShape::operator delete(void *p, ShapeArena &)
+{
+  ShapeArena::Free(p);
+}
+
+XShape::XShape(ShapeArena &arena, shapefileObj *shpfile, int i,
+               int label_field)
+  :buffer(NULL), label(NULL)
 {
-#ifdef ENABLE_OPENGL
   for (unsigned l=0; l < THINNING_LEVELS; l++)
     index_count[l] = indices[l] = NULL;
-#endif
 
   shapeObj shape;
   msInitShape(&shape);
@@ -133,6 +239,15 @@ XShape::XShape(shapefileObj *shpfile, int i, int label_field)
     ++num_lines;
   }
 
+  /* allocate the points and the label at once */
+  const char *label_src = label_field >= 0
+    ? check_label(msDBFReadStringAttribute(shpfile->hDBF, i, label_field))
+    : NULL;
+  const size_t n_label = label_src != NULL ? label_length(label_src) : 0;
+
+  buffer = arena.Allocate(num_points * sizeof(*points) +
+                          n_label * sizeof(*label));
+
 #ifdef ENABLE_OPENGL
   /* OpenGL:
    * Convert all points of all lines to ShapePoints, using a projection
@@ -145,14 +260,20 @@ XShape::XShape(shapefileObj *shpfile, int i, int label_field)
    * center of the shape and the shape has a big vertical size.
    */
 
-  points = new ShapePoint[num_points];
-  ShapePoint *p = points;
+  ShapePoint *p = (ShapePoint *)buffer;
 #else // !ENABLE_OPENGL
   /* convert all points of all lines to GeoPoints */
 
-  points = new GeoPoint[num_points];
-  GeoPoint *p = points;
+  GeoPoint *p = (GeoPoint *)buffer;
 #endif
+  points = p;
+
+  if (n_label > 0) {
+    TCHAR *dest = (TCHAR *)(p + num_points);
+    import_label(dest, n_label, label_src);
+    label = dest;
+  }
+
   for (unsigned l = 0; l < num_lines; ++l) {
     const pointObj *src = shape.line[l].point;
     num_points = lines[l];
@@ -166,26 +287,208 @@ XShape::XShape(shapefileObj *shpfile, int i, int label_field)
 #endif
   }
 
-  if (label_field >= 0) {
-    const char *src = msDBFReadStringAttribute(shpfile->hDBF, i, label_field);
-    label = import_label(src);
-  }
-
   msFreeShape(&shape);
 }
 
-XShape::~XShape()
+XShape::XShape(ShapeArena &arena, const void *record, size_t size)
+  :type(MS_SHAPE_NULL), num_lines(0),
+   buffer(NULL), points(NULL), label(NULL)
 {
-  free(label);
-  delete[] points;
+  for (unsigned l=0; l < THINNING_LEVELS; l++)
+    index_count[l] = indices[l] = NULL;
+
+  bounds.west = bounds.east = bounds.south = bounds.north = Angle::Zero();
 #ifdef ENABLE_OPENGL
+  center = bounds.GetCenter();
+#endif
+
+  const CompiledShapeHeader &header = *(const CompiledShapeHeader *)record;
+  if (size < sizeof(header) || header.num_lines > MAX_LINES)
+    return;
+
+  const char *p = (const char *)record + sizeof(header);
+  const size_t lines_size = Pad8(header.num_lines * sizeof(lines[0]));
+  const size_t points_size = Pad8(header.num_points * sizeof(*points));
+  if (sizeof(header) + lines_size + points_size + header.label_size > size)
+    return;
+
+  memcpy(lines, p, header.num_lines * sizeof(lines[0]));
+  unsigned num_points = 0;
+  for (unsigned l = 0; l < header.num_lines; ++l)
+    num_points += lines[l];
+  if (num_points != header.num_points)
+    return;
+
+  bounds = header.bounds;
+#ifdef ENABLE_OPENGL
+  center = bounds.GetCenter();
+  points = (const ShapePoint *)(p + lines_size);
+#else
+  points = (const GeoPoint *)(p + lines_size);
+#endif
+  type = header.type;
+  num_lines = header.num_lines;
+
+  const char *label_src = p + lines_size + points_size;
+  if (header.label_size == 0 || label_src[header.label_size - 1] != 0)
+    return;
+
+#ifdef _UNICODE
+  const size_t n_label = label_length(label_src);
+  if (n_label > 0) {
+    TCHAR *dest = (TCHAR *)arena.Allocate(n_label * sizeof(*dest));
+    import_label(dest, n_label, label_src);
+    buffer = dest;
+    label = dest;
+  }
+#else
+  label = label_src;
+#endif
+}
+
+XShape::~XShape()
+{
+  /* the label shares the allocation with the points; both are
+     trivially destructible */
+  ShapeArena::Free(buffer);
   // Note: index_count and indices share one buffer
   for (int i=0; i < THINNING_LEVELS; i++)
     delete[] index_count[i];
-#endif
 }
 
+unsigned
+XShape::GetCompiledLayout()
+{
+  return sizeof(CompiledShapeHeader)
 #ifdef ENABLE_OPENGL
+    | sizeof(ShapePoint) << 8
+    | 1 << 16
+#else
+    | sizeof(GeoPoint) << 8
+#endif
+#ifdef FIXED_MATH
+    | 1 << 17
+#endif
+    ;
+}
+
+bool
+XShape::Compile(FILE *file) const
+{
+  CompiledShapeHeader header;
+  memset(&header, 0, sizeof(header));
+  header.bounds = bounds;
+  header.type = type;
+  header.num_lines = num_lines;
+
+  unsigned num_points = 0;
+  for (unsigned l = 0; l < num_lines; ++l)
+    num_points += lines[l];
+  header.num_points = num_points;
+
+  char *utf8_label = label != NULL ? export_label(label) : NULL;
+  const size_t label_size = utf8_label != NULL ? strlen(utf8_label) + 1 : 0;
+  if (label_size <= 0xffff)
+    header.label_size = label_size;
+
+  const bool success =
+    fwrite(&header, sizeof(header), 1, file) == 1 &&
+    WritePadded(file, lines, num_lines * sizeof(lines[0])) &&
+    WritePadded(file, points, num_points * sizeof(*points)) &&
+    WritePadded(file, utf8_label, header.label_size);
+  free(utf8_label);
+  return success;
+}
+
+/**
+ * A point in a flat coordinate system with metres as unit, for the
+ * Douglas-Peucker simplification.
+ */
+struct FlatPoint {
+  float x, y;
+};
+
+/**
+ * Returns the square of the distance between the point and the line
+ * segment from a to b.
+ */
+gcc_pure
+static float
+SegmentDistanceSquared(const FlatPoint &p,
+                       const FlatPoint &a, const FlatPoint &b)
+{
+  const float dx = b.x - a.x, dy = b.y - a.y;
+  const float length_squared = dx * dx + dy * dy;
+
+  float t = length_squared > 0
+    ? ((p.x - a.x) * dx + (p.y - a.y) * dy) / length_squared
+    : 0;
+  t = std::max(0.f, std::min(t, 1.f));
+
+  const float ex = a.x + t * dx - p.x, ey = a.y + t * dy - p.y;
+  return ex * ex + ey * ey;
+}
+
+/**
+ * Simplify a line with the Douglas-Peucker algorithm.  The first and
+ * the last point are always kept.
+ *
+ * @param tolerance the maximum distance of a removed point from the
+ * simplified line
+ * @param dest receives the indices of the remaining points in
+ * ascending order, plus #offset; must have room for all points
+ * @return the number of remaining points
+ */
+static unsigned
+DouglasPeucker(const FlatPoint *points, unsigned n, float tolerance,
+               unsigned offset, unsigned short *dest)
+{
+  if (n < 3) {
+    /* nothing to simplify */
+    for (unsigned i = 0; i < n; ++i)
+      dest[i] = offset + i;
+    return n;
+  }
+
+  std::vector<bool> keep(n, false);
+  keep[0] = keep[n - 1] = true;
+
+  const float tolerance_squared = tolerance * tolerance;
+
+  /* an explicit stack instead of recursion, because lines may have
+     thousands of points */
+  std::vector<std::pair<unsigned, unsigned> > stack;
+  stack.push_back(std::make_pair(0u, n - 1));
+
+  while (!stack.empty()) {
+    const unsigned first = stack.back().first, last = stack.back().second;
+    stack.pop_back();
+
+    float max_distance = tolerance_squared;
+    unsigned farthest = 0;
+    for (unsigned i = first + 1; i < last; ++i) {
+      const float distance =
+        SegmentDistanceSquared(points[i], points[first], points[last]);
+      if (distance > max_distance) {
+        max_distance = distance;
+        farthest = i;
+      }
+    }
+
+    if (farthest > 0) {
+      keep[farthest] = true;
+      stack.push_back(std::make_pair(first, farthest));
+      stack.push_back(std::make_pair(farthest, last));
+    }
+  }
+
+  unsigned short *p = dest;
+  for (unsigned i = 0; i < n; ++i)
+    if (keep[i])
+      *p++ = offset + i;
+
+  return p - dest;
+}
 
 bool
 XShape::BuildIndices(unsigned thinning_level, unsigned min_distance)
@@ -198,38 +501,57 @@ XShape::BuildIndices(unsigned thinning_level, unsigned min_distance)
   for (unsigned i=0; i < num_lines; i++)
     num_points += lines[i];
 
+#ifdef ENABLE_OPENGL
   if (type == MS_SHAPE_LINE) {
+#else
+  if (type == MS_SHAPE_LINE || type == MS_SHAPE_POLYGON) {
+#endif
     if (num_points <= 2)
       return false;  // line cannot be simplified, so don't create indices
     index_count[thinning_level] = idx_count =
-      new GLushort[num_lines + num_points];
+      new unsigned short[num_lines + num_points];
     indices[thinning_level] = idx = idx_count + num_lines;
 
-    const unsigned short *end_l = lines + num_lines;
-    const ShapePoint *p = points;
-    unsigned i = 0;
-    for (const unsigned short *l = lines; l < end_l; l++) {
-      assert(*l >= 2);
-      const ShapePoint *end_p = p + *l - 1;
-      // always add first point
-      *idx++ = i;
-      p++; i++;
-      const unsigned short *after_first_idx = idx;
-      // add points if they are not too close to the previous point
-      for (; p < end_p; p++, i++)
-        if (manhattan_distance(points[idx[-1]], *p) >= min_distance)
-          *idx++ = i;
-      // remove points from behind if they are too close to the end point
-      while (idx > after_first_idx &&
-             manhattan_distance(points[idx[-1]], *p) < min_distance)
-        idx--;
-      // always add last point
-      *idx++ = i;
-      p++; i++;
-      *idx_count++ = idx - after_first_idx + 1;
+#ifndef ENABLE_OPENGL
+    /* project the points on a plane which touches the earth at the
+       center of the shape */
+    const GeoPoint center = bounds.GetCenter();
+    const float scale_x = (float)(center.latitude.cos() * fixed_earth_r);
+    const float scale_y = (float)fixed_earth_r;
+#endif
+
+    std::vector<FlatPoint> flat;
+    unsigned offset = 0;
+    for (unsigned l = 0; l < num_lines; ++l) {
+      const unsigned n = lines[l];
+
+      flat.resize(n);
+      for (unsigned i = 0; i < n; ++i) {
+#ifdef ENABLE_OPENGL
+        flat[i].x = points[offset + i].x;
+        flat[i].y = points[offset + i].y;
+#else
+        const GeoPoint d = points[offset + i] - center;
+        flat[i].x = (float)d.longitude.Radians() * scale_x;
+        flat[i].y = (float)d.latitude.Radians() * scale_y;
+#endif
+      }
+
+      /* removed points may deviate from the simplified line by
+         the minimum point distance of this level, the same
+         granularity which PolygonToTriangles() thins OpenGL
+         polygons with */
+      const unsigned count = DouglasPeucker(flat.data(), n,
+                                            (float)min_distance,
+                                            offset, idx);
+      idx += count;
+      *idx_count++ = count;
+      offset += n;
     }
+
     // TODO: free memory saved by thinning (use malloc/realloc or some class?)
     return true;
+#ifdef ENABLE_OPENGL
   } else if (type == MS_SHAPE_POLYGON) {
     index_count[thinning_level] = idx_count =
       new GLushort[1 + 3*(num_points-2) + 2*(num_lines-1)];
@@ -252,37 +574,21 @@ XShape::BuildIndices(unsigned thinning_level, unsigned min_distance)
     *idx_count = TriangleToStrip(idx, *idx_count, num_points, num_lines);
     // TODO: free memory saved by thinning (use malloc/realloc or some class?)
     return true;
+#endif
   } else {
     assert(false);
     return false;
   }
 }
 
-const unsigned short *
-XShape::get_indices(int thinning_level, unsigned min_distance,
-                    const unsigned short *&count) const
+void
+XShape::BuildThinningLevels(const unsigned min_distance[THINNING_LEVELS])
 {
-  if (indices[thinning_level] == NULL) {
-    XShape &deconst = const_cast<XShape &>(*this);
-    if (!deconst.BuildIndices(thinning_level, min_distance))
-      return NULL;
-  }
-
-  count = index_count[thinning_level];
-  return indices[thinning_level];
-}
+  if (type != MS_SHAPE_LINE && type != MS_SHAPE_POLYGON)
+    return;
 
-ShapePoint
-XShape::geo_to_shape(const GeoPoint &origin, const GeoPoint &point) const
-{
-  const GeoPoint d = point-origin;
-
-  ShapePoint pt;
-  pt.x = (ShapeScalar)fast_mult(point.latitude.fastcosine(),
-                                fast_mult(d.longitude.Radians(),
-                                          fixed_earth_r, 12), 16);
-  pt.y = (ShapeScalar)-fast_mult(d.latitude.Radians(), fixed_earth_r, 12);
-  return pt;
+  for (unsigned i = 0; i < THINNING_LEVELS; ++i)
+    if (!BuildIndices(i, min_distance[i]))
+      /* the shape cannot be simplified at all */
+      break;
 }
-
-#endif // ENABLE_OPENGL
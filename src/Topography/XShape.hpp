@@ -33,16 +33,27 @@ Copyright_License {
 #ifdef ENABLE_OPENGL
 #include "Screen/Point.hpp"
 #include "Topography/XShapePoint.hpp"
+#include "Projection/ShapeProjection.hpp"
 #endif
 
 #include <tchar.h>
 #include <assert.h>
+#include <stddef.h>
+#include <stdio.h>
 
+class ShapeArena;
+
+/**
+ * A shape loaded from a shapefile.  The object, its points and its
+ * label are allocated from the #ShapeArena of the #TopographyFile;
+ * create it with "new (arena) XShape(arena, ...)".
+ */
 class XShape : private NonCopyable {
-  enum { MAX_LINES = 32 };
-#ifdef ENABLE_OPENGL
+public:
   enum { THINNING_LEVELS = 4 };
-#endif
+
+private:
+  enum { MAX_LINES = 32 };
 
   GeoBounds bounds;
 #ifdef ENABLE_OPENGL
@@ -63,42 +74,104 @@ class XShape : private NonCopyable {
    */
   unsigned short lines[MAX_LINES];
 
+  /**
+   * The arena allocation which holds the points and the label, or
+   * NULL if they are stored elsewhere (see #CompiledShapes).
+   */
+  void *buffer;
+
   /**
    * All points of all lines.
    */
 #ifdef ENABLE_OPENGL
-  ShapePoint *points;
+  const ShapePoint *points;
+#else // !ENABLE_OPENGL
+  const GeoPoint *points;
+#endif
 
   /**
-   * Indices of polygon triangles or lines with reduced number of vertices.
+   * Indices of polygon triangles (OpenGL) or of the points of lines
+   * and polygon rings which remain after the Douglas-Peucker
+   * simplification.
    */
   unsigned short *indices[THINNING_LEVELS];
 
   /**
-   * For polygons this will contain the total number of triangle vertices
-   * for each thinning level.
-   * For lines there will be an array of size num_lines for each thinning
-   * level, which contains the number of points for each line.
+   * For OpenGL polygons this will contain the total number of
+   * triangle vertices for each thinning level.
+   * Otherwise there will be an array of size num_lines for each
+   * thinning level, which contains the number of points for each
+   * line.
    */
   unsigned short *index_count[THINNING_LEVELS];
-#else // !ENABLE_OPENGL
-  GeoPoint *points;
-#endif
 
-  TCHAR *label;
+  const TCHAR *label;
 
 public:
-  XShape(shapefileObj *shpfile, int i, int label_field=-1);
+  XShape(ShapeArena &arena, shapefileObj *shpfile, int i,
+         int label_field=-1);
+
+  /**
+   * Load a shape from a record which was written by Compile().  The
+   * points and (in UTF-8 builds) the label are not copied, so the
+   * record must stay valid as long as this object exists.  A
+   * malformed record results in an empty shape.
+   */
+  XShape(ShapeArena &arena, const void *record, size_t size);
+
   ~XShape();
 
-#ifdef ENABLE_OPENGL
+  /**
+   * Returns a number which identifies the record format of this
+   * build.  It depends on the point type and on the compile-time
+   * options.
+   */
+  gcc_const
+  static unsigned GetCompiledLayout();
+
+  /**
+   * Write a record which can be loaded by the constructor above.
+   * Its size is a multiple of 8 bytes.
+   *
+   * @return false on I/O error
+   */
+  bool Compile(FILE *file) const;
+
+  void *operator new(size_t size, ShapeArena &arena);
+  void operator delete(void *p);
+
+  /**
+   * Only called if the constructor throws.
+   */
+  void operator delete(void *p, ShapeArena &arena);
+
 protected:
   bool BuildIndices(unsigned thinning_level, unsigned min_distance);
 
 public:
-  const unsigned short *get_indices(int thinning_level, unsigned min_distance,
-                                    const unsigned short *&count) const;
-#endif
+  /**
+   * Calculate the simplified shapes of all thinning levels.  This is
+   * done by the thread which loads the shape, before it is published
+   * to the renderer.  Does nothing for point shapes.
+   *
+   * @param min_distance the tolerance of the simplification for each
+   * thinning level [m]
+   */
+  void BuildThinningLevels(const unsigned min_distance[THINNING_LEVELS]);
+
+  /**
+   * Returns the simplified shape for the specified thinning level,
+   * which was calculated by BuildThinningLevels().
+   *
+   * @return the indices, or NULL if the shape cannot be simplified
+   */
+  const unsigned short *get_indices(unsigned thinning_level,
+                                    const unsigned short *&count) const {
+    assert(thinning_level < THINNING_LEVELS);
+
+    count = index_count[thinning_level];
+    return indices[thinning_level];
+  }
 
   const GeoBounds &get_bounds() const {
     return bounds;
@@ -139,7 +212,7 @@ public:
    * Convert a GeoPoint into a ShapePoint.
    */
   ShapePoint geo_to_shape(const GeoPoint &location) const {
-    return geo_to_shape(center, location);
+    return GeoToShape(center, location);
   }
 
   /**
@@ -147,12 +220,8 @@ public:
    * scale.
    */
   ShapePoint shape_translation(const GeoPoint &screen_center) const {
-    return geo_to_shape(screen_center, center);
+    return GeoToShape(screen_center, center);
   }
-
-private:
-  gcc_pure
-  ShapePoint geo_to_shape(const GeoPoint &origin, const GeoPoint &point) const;
 #endif
 };
 
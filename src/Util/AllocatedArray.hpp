@@ -96,6 +96,15 @@ public:
     return *this;
   }
 
+  /**
+   * Exchange the contents of this array with another one, without
+   * copying elements.
+   */
+  void Swap(AllocatedArray &other) {
+    std::swap(the_size, other.the_size);
+    std::swap(data, other.data);
+  }
+
   /**
    * Returns true if no memory was allocated so far.
    */
@@ -124,6 +124,12 @@ public:
     return begin() + y * width + x;
   }
 
+  void Swap(AllocatedGrid &other) {
+    array.Swap(other.array);
+    std::swap(width, other.width);
+    std::swap(height, other.height);
+  }
+
   void Reset() {
     width = height = 0;
     array.ResizeDiscard(0);
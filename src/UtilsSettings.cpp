@@ -165,7 +165,7 @@ SettingsLeave(const UISettings &old_ui_settings)
   if (TopographyFileChanged) {
     main_window.SetTopography(NULL);
     topography->Reset();
-    LoadConfiguredTopography(*topography, operation);
+    LoadConfiguredTopography(*topography, file_cache, operation);
     main_window.SetTopography(topography);
   }
 
@@ -179,7 +179,7 @@ SettingsLeave(const UISettings &old_ui_settings)
     airspace_database.clear();
     ReadAirspace(airspace_database, terrain,
                  CommonInterface::GetComputerSettings().pressure,
-                 operation);
+                 file_cache, operation);
   }
 
   if (DevicePortChanged)
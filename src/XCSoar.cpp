@@ -45,6 +45,7 @@ Copyright_License {
 #include "Simulator.hpp"
 #include "OS/Args.hpp"
 #include "IO/Async/GlobalIOThread.hpp"
+#include "Thread/ThreadPool.hpp"
 
 #ifndef NDEBUG
 #include "Thread/Thread.hpp"
@@ -132,6 +133,7 @@ WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
   AllowLanguage();
 
   InitialiseIOThread();
+  InitialiseSharedThreadPool();
 
   // Perform application initialization and run loop
   int ret = EXIT_FAILURE;
@@ -140,6 +142,7 @@ WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
 
   CommonInterface::main_window.reset();
 
+  DeinitialiseSharedThreadPool();
   DeinitialiseIOThread();
 
   DisallowLanguage();
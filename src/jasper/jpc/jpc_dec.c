@@ -254,7 +254,9 @@ jas_image_t *jpc_decode(jas_stream_t *in, const char *optstr)
 		goto error;
 	}
 
-	jpc_initluts();
+	/* XCSoar: the lookup tables are initialised once by the caller
+	   (see jpc_initluts()), because several decoders may run in
+	   parallel */
 
 	if (!(dec = jpc_dec_create(&opts, in))) {
 		goto error;
@@ -1,46 +1,75 @@
 #include "jasper/jpc_rtc.h"
 #include "Terrain/RasterTileCache.hpp"
+#include "Thread/Local.hpp"
 
-RasterTileCache *raster_tile_current = 0;
+/**
+ * The #RasterTileCache whose overview is being loaded by the current
+ * thread.  This is thread-local, because RASP maps are loaded in
+ * background while the terrain may be loaded at the same time.
+ */
+ThreadLocalObject<RasterTileCache *> raster_tile_current;
+
+/**
+ * The tile decoder job which is being run by the current thread.  If
+ * this is NULL, then the overview of #raster_tile_current is being
+ * scanned.  While decoding tiles, all other callbacks are ignored,
+ * because the #RasterTileCache must not be modified by a job.
+ */
+ThreadLocalObject<RasterTileCache::DecodeJob *> raster_decode_job;
 
 extern "C" {
 
   long jas_rtc_SkipMarkerSegment(long file_offset) {
-    return raster_tile_current->SkipMarkerSegment(file_offset);
+    RasterTileCache::DecodeJob *job = raster_decode_job.Get();
+    if (job == NULL)
+      /* use all segments when loading the overview */
+      return 0;
+
+    return job->SkipMarkerSegment(file_offset);
   }
 
   void jas_rtc_MarkerSegment(long file_offset, unsigned id) {
-    return raster_tile_current->MarkerSegment(file_offset, id);
+    if (raster_decode_job.Get() == NULL)
+      raster_tile_current.Get()->MarkerSegment(file_offset, id);
   }
 
   void jas_rtc_SetTile(unsigned index,
                        int xstart, int ystart,
                        int xend, int yend) {
-    raster_tile_current->SetTile(index, xstart, ystart, xend, yend);
+    if (raster_decode_job.Get() == NULL)
+      raster_tile_current.Get()->SetTile(index, xstart, ystart, xend, yend);
   }
 
   short* jas_rtc_GetImageBuffer(unsigned index) {
-    return raster_tile_current->GetImageBuffer(index);
+    RasterTileCache::DecodeJob *job = raster_decode_job.Get();
+    if (job == NULL)
+      return NULL;
+
+    return job->GetImageBuffer(index);
   }
 
   void jas_rtc_SetLatLonBounds(double lon_min, double lon_max,
                                double lat_min, double lat_max) {
-    raster_tile_current->SetLatLonBounds(lon_min, lon_max, lat_min, lat_max);
+    if (raster_decode_job.Get() == NULL)
+      raster_tile_current.Get()->SetLatLonBounds(lon_min, lon_max,
+                                           lat_min, lat_max);
   }
 
   void jas_rtc_SetSize(unsigned width, unsigned height,
                        unsigned tile_width, unsigned tile_height,
                        unsigned tile_columns, unsigned tile_rows) {
-    raster_tile_current->SetSize(width, height,
-                                 tile_width, tile_height,
-                                 tile_columns, tile_rows);
+    if (raster_decode_job.Get() == NULL)
+      raster_tile_current.Get()->SetSize(width, height,
+                                   tile_width, tile_height,
+                                   tile_columns, tile_rows);
   }
 
   void jas_rtc_SetInitialised(bool val) {
-    raster_tile_current->SetInitialised(val);
+    if (raster_decode_job.Get() == NULL)
+      raster_tile_current.Get()->SetInitialised(val);
   }
 
   short* jas_rtc_GetOverview(void) {
-    return raster_tile_current->GetOverview();
+    return raster_tile_current.Get()->GetOverview();
   }
 };
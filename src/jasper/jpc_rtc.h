@@ -7,7 +7,6 @@
 extern "C" {
 #endif
 
-  gcc_const
   long jas_rtc_SkipMarkerSegment(long file_offset);
   void jas_rtc_MarkerSegment(long file_offset, unsigned id);
 
@@ -17,7 +16,6 @@ extern "C" {
   gcc_const
   bool jas_rtc_PollTiles(int viewx, int viewy);
 
-  gcc_const
   short* jas_rtc_GetImageBuffer(unsigned index);
   void jas_rtc_SetLatLonBounds(double lon_min, double lon_max, double lat_min, double lat_max);
   void jas_rtc_SetSize(unsigned width, unsigned height,
@@ -0,0 +1,149 @@
+/* Copyright_License {
+
+  XCSoar Glide Computer - http://www.xcsoar.org/
+  Copyright (C) 2000-2012 The XCSoar Project
+  A detailed list of copyright holders can be found in the file "AUTHORS".
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+}
+*/
+
+/*
+ * Loads an airspace file and compares AirspacePolygon::Inside() with
+ * the plain PolygonInterior() test: latency and results, with random
+ * points in the bounds of each polygon and points on its border.
+ */
+
+#include "Airspace/AirspaceParser.hpp"
+#include "Engine/Airspace/Airspaces.hpp"
+#include "Engine/Airspace/AbstractAirspace.hpp"
+#include "Geo/ConvexHull/PolygonInterior.hpp"
+#include "Geo/GeoBounds.hpp"
+#include "IO/FileLineReader.hpp"
+#include "Operation/Operation.hpp"
+#include "OS/Clock.hpp"
+
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <tchar.h>
+
+static const unsigned N_POINTS = 2000;
+
+static fixed
+RandomFraction()
+{
+  return fixed(rand() % 10001) / 10000;
+}
+
+static void
+MakePoints(const AbstractAirspace &as, std::vector<GeoPoint> &points)
+{
+  points.clear();
+
+  const GeoBounds bounds = as.GetGeoBounds();
+  for (unsigned i = 0; i < N_POINTS; ++i)
+    points.push_back(GeoPoint(bounds.west +
+                              (bounds.east - bounds.west) * RandomFraction(),
+                              bounds.south +
+                              (bounds.north - bounds.south) * RandomFraction()));
+
+  /* the vertices and edge midpoints are the hard cases */
+  const SearchPointVector &border = as.GetPoints();
+  for (unsigned i = 0; i + 1 < border.size(); ++i) {
+    const GeoPoint &a = border[i].get_location();
+    const GeoPoint &b = border[i + 1].get_location();
+    points.push_back(a);
+    points.push_back(a.Interpolate(b, fixed_half));
+  }
+}
+
+int main(int argc, char **argv)
+{
+  if (argc != 2) {
+    fprintf(stderr, "Usage: %s PATH\n", argv[0]);
+    return 1;
+  }
+
+  FileLineReader reader(argv[1], ConvertLineReader::AUTO);
+  if (reader.error()) {
+    fprintf(stderr, "Failed to open input file\n");
+    return 1;
+  }
+
+  Airspaces airspaces;
+  AirspaceParser parser(airspaces);
+
+  NullOperationEnvironment operation;
+  if (!parser.Parse(reader, operation)) {
+    fprintf(stderr, "Failed to parse input file\n");
+    return 1;
+  }
+
+  airspaces.Optimise();
+
+  srand(42);
+
+  unsigned n_polygons = 0, n_vertices = 0, n_tests = 0, n_inside = 0;
+  unsigned n_mismatches = 0;
+  uint64_t plain_us = 0, indexed_us = 0;
+
+  std::vector<GeoPoint> points;
+  std::vector<bool> expected;
+
+  for (auto it = airspaces.begin(), end = airspaces.end(); it != end; ++it) {
+    const AbstractAirspace &as = *it->GetAirspace();
+    if (as.GetShape() != AbstractAirspace::Shape::POLYGON)
+      continue;
+
+    const SearchPointVector &border = as.GetPoints();
+    ++n_polygons;
+    n_vertices += border.size();
+
+    MakePoints(as, points);
+    n_tests += points.size();
+
+    expected.clear();
+    uint64_t start = MonotonicClockUS();
+    for (auto p = points.begin(), p_end = points.end(); p != p_end; ++p)
+      expected.push_back(PolygonInterior(*p, border));
+    plain_us += MonotonicClockUS() - start;
+
+    unsigned i = 0;
+    start = MonotonicClockUS();
+    for (auto p = points.begin(), p_end = points.end(); p != p_end; ++p, ++i) {
+      const bool inside = as.Inside(*p);
+      n_inside += inside;
+      if (inside != expected[i])
+        ++n_mismatches;
+    }
+    indexed_us += MonotonicClockUS() - start;
+  }
+
+  printf("polygons=%u vertices=%u tests=%u inside=%u\n"
+         "  plain:   us=%u\n"
+         "  indexed: us=%u\n",
+         n_polygons, n_vertices, n_tests, n_inside,
+         (unsigned)plain_us, (unsigned)indexed_us);
+
+  if (n_mismatches > 0) {
+    printf("  %u MISMATCHES\n", n_mismatches);
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,165 @@
+/* Copyright_License {
+
+  XCSoar Glide Computer - http://www.xcsoar.org/
+  Copyright (C) 2000-2012 The XCSoar Project
+  A detailed list of copyright holders can be found in the file "AUTHORS".
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+}
+ */
+
+/*
+ * Synchronises the airspace subset of a route planner with a set of
+ * random airspaces while the aircraft moves towards its destination,
+ * and queries it with random route legs.  Compares the copied
+ * #Airspaces container with the #AirspaceSelection snapshot: latency
+ * and results.
+ */
+
+#include "harness_airspace.hpp"
+#include "Engine/Airspace/AirspaceSelection.hpp"
+#include "Engine/Airspace/AirspaceIntersectionVisitor.hpp"
+#include "Engine/Airspace/Predicate/AirspacePredicateHeightRange.hpp"
+#include "OS/Clock.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+static const unsigned N_STEPS = 500;
+static const unsigned N_LEGS = 20;
+
+/**
+ * Collects the airspaces intersected by a leg.
+ */
+class IntersectionCollector : public AirspaceIntersectionVisitor {
+  std::vector<const AbstractAirspace *> &found;
+
+public:
+  IntersectionCollector(std::vector<const AbstractAirspace *> &_found)
+    :found(_found) {}
+
+protected:
+  virtual void Visit(const AirspaceCircle &as) {
+    found.push_back((const AbstractAirspace *)&as);
+  }
+
+  virtual void Visit(const AirspacePolygon &as) {
+    found.push_back((const AbstractAirspace *)&as);
+  }
+};
+
+static GeoPoint
+RandomPoint(const GeoPoint &a, const GeoPoint &b)
+{
+  return a.Interpolate(b, fixed(rand() % 1001) / 1000);
+}
+
+static bool
+Run(Airspaces &airspaces, const GeoPoint &center)
+{
+
+  Airspaces copy(airspaces, false);
+  AirspaceSelection selection;
+
+  const AGeoPoint destination(GeoPoint(center.longitude +
+                                       Angle::Degrees(fixed(0.6)),
+                                       center.latitude),
+                              RoughAltitude(500));
+
+  uint64_t copy_us = 0, selection_us = 0;
+  unsigned n_changes = 0, n_selected = 0, n_found = 0, n_mismatches = 0;
+
+  std::vector<const AbstractAirspace *> copy_found, selection_found;
+
+  for (unsigned step = 0; step < N_STEPS; ++step) {
+    const AGeoPoint origin(GeoPoint(center.longitude -
+                                    Angle::Degrees(fixed(0.6) -
+                                                   fixed(step) / 500),
+                                    center.latitude +
+                                    Angle::Degrees(fixed(0.1))),
+                           RoughAltitude(2000 - (int)step * 2));
+
+    const AirspacePredicateHeightRangeExcludeTwo
+      condition(RoughAltitude(0), origin.altitude, origin, destination);
+    const GeoPoint middle = origin.Middle(destination);
+    const fixed range = half(origin.Distance(destination));
+
+    uint64_t start = MonotonicClockUS();
+    const bool copy_changed =
+      copy.SynchroniseInRange(airspaces, middle, range, condition);
+    copy_us += MonotonicClockUS() - start;
+
+    start = MonotonicClockUS();
+    const bool selection_changed =
+      selection.Update(airspaces, middle, range, condition);
+    selection_us += MonotonicClockUS() - start;
+
+    n_changes += selection_changed;
+    n_selected += selection.size();
+
+    if (copy_changed != selection_changed || copy.size() != selection.size())
+      ++n_mismatches;
+
+    for (unsigned i = 0; i < N_LEGS; ++i) {
+      const GeoPoint a = RandomPoint(origin, destination);
+      const GeoPoint b = RandomPoint(origin, destination);
+
+      copy_found.clear();
+      IntersectionCollector copy_collector(copy_found);
+      start = MonotonicClockUS();
+      copy.VisitIntersecting(a, b, copy_collector);
+      copy_us += MonotonicClockUS() - start;
+
+      selection_found.clear();
+      IntersectionCollector selection_collector(selection_found);
+      start = MonotonicClockUS();
+      selection.VisitIntersecting(a, b, selection_collector);
+      selection_us += MonotonicClockUS() - start;
+
+      n_found += selection_found.size();
+
+      std::sort(copy_found.begin(), copy_found.end());
+      std::sort(selection_found.begin(), selection_found.end());
+      if (copy_found != selection_found)
+        ++n_mismatches;
+    }
+  }
+
+  printf("airspaces=%u steps=%u changes=%u selected/step=%u found=%u\n"
+         "  copy:      us=%u\n"
+         "  selection: us=%u\n",
+         airspaces.size(), N_STEPS, n_changes, n_selected / N_STEPS, n_found,
+         (unsigned)copy_us, (unsigned)selection_us);
+
+  selection.Clear(airspaces);
+  copy.ClearClearances();
+
+  if (n_mismatches > 0) {
+    printf("  %u MISMATCHES\n", n_mismatches);
+    return false;
+  }
+
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  return run_with_random_airspaces(Run, { 1000, 10000 })
+    ? EXIT_SUCCESS : EXIT_FAILURE;
+}
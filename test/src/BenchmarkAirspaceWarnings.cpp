@@ -0,0 +1,96 @@
+/* Copyright_License {
+
+  XCSoar Glide Computer - http://www.xcsoar.org/
+  Copyright (C) 2000-2012 The XCSoar Project
+  A detailed list of copyright holders can be found in the file "AUTHORS".
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+}
+ */
+
+/*
+ * Flies a simulated aircraft through a set of random airspaces and
+ * updates two #AirspaceWarningManager instances, one of them in the
+ * coherent mode, and compares their update latency.  The test
+ * test_airspace_warnings checks that both produce the same warnings.
+ */
+
+#include "harness_airspace.hpp"
+#include "Task/Stats/TaskStats.hpp"
+#include "GlideSolvers/GlidePolar.hpp"
+#include "OS/Clock.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+static const unsigned N_STEPS = 2400;
+
+static bool
+Run(Airspaces &airspaces, const GeoPoint &center)
+{
+  AirspaceWarningConfig config;
+  config.SetDefaults();
+
+  AirspaceWarningManager plain(airspaces), coherent(airspaces);
+  plain.SetCoherent(false);
+  plain.SetConfig(config);
+  coherent.SetConfig(config);
+
+  const GlidePolar glide_polar(fixed_one);
+  TaskStats task_stats;
+  task_stats.reset();
+
+  AircraftState state;
+  start_airspace_flight(state, center);
+
+  plain.Reset(state);
+  coherent.Reset(state);
+
+  uint64_t plain_us = 0, coherent_us = 0;
+  unsigned n_tested = 0, n_warnings = 0;
+
+  for (unsigned t = 1; t <= N_STEPS; ++t) {
+    advance_airspace_flight(state, t);
+    const bool circling = is_airspace_flight_circling(t);
+
+    uint64_t start = MonotonicClockUS();
+    plain.Update(state, glide_polar, task_stats, circling, 1);
+    plain_us += MonotonicClockUS() - start;
+
+    start = MonotonicClockUS();
+    coherent.Update(state, glide_polar, task_stats, circling, 1);
+    coherent_us += MonotonicClockUS() - start;
+
+    n_tested += coherent.GetCorridor().GetTestedCount();
+    n_warnings += coherent.size();
+  }
+
+  printf("airspaces=%u updates=%u warnings=%u\n"
+         "  plain:    us=%u\n"
+         "  coherent: us=%u refreshes=%u tested/update=%u\n",
+         airspaces.size(), N_STEPS, n_warnings,
+         (unsigned)plain_us,
+         (unsigned)coherent_us, coherent.GetCorridor().GetRefreshCount(),
+         n_tested / N_STEPS);
+
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  return run_with_random_airspaces(Run, { 1000, 10000 })
+    ? EXIT_SUCCESS : EXIT_FAILURE;
+}
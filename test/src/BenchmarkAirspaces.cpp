@@ -0,0 +1,161 @@
+/* Copyright_License {
+
+  XCSoar Glide Computer - http://www.xcsoar.org/
+  Copyright (C) 2000-2012 The XCSoar Project
+  A detailed list of copyright holders can be found in the file "AUTHORS".
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+}
+ */
+
+/*
+ * Compares the packed R-tree used by #Airspaces with the kd-tree it
+ * replaced: query latency and memory usage with large sets of random
+ * airspaces from the test harness.  The results of both trees are
+ * checked against each other.
+ */
+
+#include "harness_airspace.hpp"
+#include "Airspace/AirspaceRTree.hpp"
+#include "Util/SliceAllocator.hpp"
+#include "OS/Clock.hpp"
+
+#include <kdtree++/kdtree.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+
+typedef KDTree::KDTree<4,
+                       Airspace,
+                       FlatBoundingBox::kd_get_bounds,
+                       FlatBoundingBox::kd_distance,
+                       std::less<FlatBoundingBox::kd_get_bounds::result_type>,
+                       SliceAllocator<KDTree::_Node<Airspace>, 256>
+                       > AirspaceKDTree;
+
+static const unsigned N_QUERIES = 2000;
+
+/**
+ * Calculates an order-independent checksum of the visited airspaces.
+ */
+struct ChecksumVisitor {
+  unsigned count;
+  uint32_t sum;
+
+  ChecksumVisitor():count(0), sum(0) {}
+
+  void operator()(const Airspace &as) {
+    ++count;
+    sum += (uint32_t)(uintptr_t)as.GetAirspace();
+  }
+};
+
+struct AlwaysTrue {
+  bool operator()(const Airspace &as) const {
+    return true;
+  }
+};
+
+static bool
+Run(Airspaces &airspaces, const GeoPoint &center)
+{
+  const TaskProjection &projection = airspaces.GetProjection();
+
+  AirspaceKDTree kd_tree;
+  std::vector<Airspace> items;
+  items.reserve(airspaces.size());
+  for (auto it = airspaces.begin(), end = airspaces.end(); it != end; ++it) {
+    kd_tree.insert(*it);
+    items.push_back(*it);
+  }
+  kd_tree.optimise();
+
+  AirspaceRTree r_tree;
+  r_tree.Build(items);
+
+  /* random query locations in and around the airspaces, with a
+     search radius between 0 and 20 km */
+  std::vector<GeoPoint> locations;
+  std::vector<fixed> ranges;
+  for (unsigned i = 0; i < N_QUERIES; ++i) {
+    GeoPoint location = center;
+    location.longitude += Angle::Degrees(fixed((rand() % 1600 - 800) / 1000.0));
+    location.latitude += Angle::Degrees(fixed((rand() % 1600 - 800) / 1000.0));
+    locations.push_back(location);
+    ranges.push_back(fixed(i % 4 == 0 ? 0 : rand() % 20000));
+  }
+
+  ChecksumVisitor kd_result;
+  uint64_t start = MonotonicClockUS();
+  for (unsigned i = 0; i < N_QUERIES; ++i) {
+    const Airspace target(locations[i], projection);
+    const int range = projection.project_range(locations[i], ranges[i]);
+    kd_tree.visit_within_range(target, -range, kd_result);
+  }
+  const unsigned kd_us = MonotonicClockUS() - start;
+
+  ChecksumVisitor r_result;
+  start = MonotonicClockUS();
+  for (unsigned i = 0; i < N_QUERIES; ++i) {
+    const Airspace target(locations[i], projection, ranges[i]);
+    r_tree.VisitOverlapping(target, r_result);
+  }
+  const unsigned r_us = MonotonicClockUS() - start;
+
+  /* verify the nearest search with a linear scan */
+  unsigned nearest_errors = 0;
+  for (unsigned i = 0; i < N_QUERIES / 10; ++i) {
+    const Airspace target(locations[i], projection);
+
+    unsigned expected = UINT_MAX;
+    for (auto it = r_tree.begin(), end = r_tree.end(); it != end; ++it)
+      expected = std::min(expected, it->Distance(target));
+
+    unsigned distance = UINT_MAX;
+    if (r_tree.FindNearest(target, UINT_MAX, AlwaysTrue(), distance) == NULL ||
+        distance != expected)
+      ++nearest_errors;
+  }
+
+  const size_t kd_bytes = kd_tree.size() * sizeof(KDTree::_Node<Airspace>);
+  const size_t r_bytes = r_tree.GetMemoryUsage();
+
+  printf("airspaces=%u queries=%u results=%u\n"
+         "  kdtree: query_us=%u bytes=%u\n"
+         "  rtree:  query_us=%u bytes=%u\n",
+         (unsigned)r_tree.size(), N_QUERIES, r_result.count,
+         kd_us, (unsigned)kd_bytes,
+         r_us, (unsigned)r_bytes);
+
+  if (kd_result.count != r_result.count || kd_result.sum != r_result.sum) {
+    printf("  MISMATCH: kdtree found %u airspaces\n", kd_result.count);
+    return false;
+  }
+
+  if (nearest_errors > 0) {
+    printf("  %u wrong nearest airspaces\n", nearest_errors);
+    return false;
+  }
+
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  return run_with_random_airspaces(Run, { 1000, 10000, 40000 })
+    ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,93 @@
+/*
+Copyright_License {
+
+  XCSoar Glide Computer - http://www.xcsoar.org/
+  Copyright (C) 2000-2012 The XCSoar Project
+  A detailed list of copyright holders can be found in the file "AUTHORS".
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+}
+*/
+
+/*
+ * Measures the speed of LabelBlock with thousands of random label
+ * candidates on a 800x480 screen, as they occur when many waypoints
+ * and towns are visible.  It also verifies that no two accepted
+ * labels overlap.
+ */
+
+#include "Screen/LabelBlock.hpp"
+#include "OS/Clock.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static const unsigned N_CANDIDATES = 5000;
+static const unsigned N_FRAMES = 1000;
+
+static bool
+Overlaps(const PixelRect &a, const PixelRect &b)
+{
+  return a.left < b.right && a.right > b.left &&
+    a.top < b.bottom && a.bottom > b.top;
+}
+
+int main(int argc, char **argv)
+{
+  PixelRect *candidates = new PixelRect[N_CANDIDATES];
+  srand(42);
+  for (unsigned i = 0; i < N_CANDIDATES; ++i) {
+    PixelRect &rc = candidates[i];
+    /* some labels stick out of the screen */
+    rc.left = rand() % 840 - 40;
+    rc.top = rand() % 500 - 20;
+    rc.right = rc.left + 30 + rand() % 120;
+    rc.bottom = rc.top + 12 + rand() % 8;
+  }
+
+  bool *accepted = new bool[N_CANDIDATES];
+
+  LabelBlock *block = new LabelBlock();
+
+  unsigned n_accepted = 0;
+  const uint64_t start = MonotonicClockUS();
+  for (unsigned frame = 0; frame < N_FRAMES; ++frame) {
+    block->reset();
+
+    n_accepted = 0;
+    for (unsigned i = 0; i < N_CANDIDATES; ++i) {
+      accepted[i] = block->check(candidates[i]);
+      if (accepted[i])
+        ++n_accepted;
+    }
+  }
+  const unsigned duration_us = MonotonicClockUS() - start;
+
+  unsigned n_overlaps = 0;
+  for (unsigned i = 0; i < N_CANDIDATES; ++i)
+    if (accepted[i])
+      for (unsigned j = 0; j < i; ++j)
+        if (accepted[j] && Overlaps(candidates[i], candidates[j]))
+          ++n_overlaps;
+
+  printf("candidates=%u accepted=%u frame_us=%u overlaps=%u\n",
+         N_CANDIDATES, n_accepted, duration_us / N_FRAMES, n_overlaps);
+
+  delete block;
+  delete[] accepted;
+  delete[] candidates;
+
+  return n_overlaps == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
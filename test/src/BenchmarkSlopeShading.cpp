@@ -0,0 +1,186 @@
+/*
+Copyright_License {
+
+  XCSoar Glide Computer - http://www.xcsoar.org/
+  Copyright (C) 2000-2012 The XCSoar Project
+  A detailed list of copyright holders can be found in the file "AUTHORS".
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+}
+*/
+
+/*
+ * Compares the SSE2 or NEON slope shading kernel with the scalar
+ * implementation, and measures the speed of both.  The input files
+ * are height matrix dumps written by RunHeightMatrix.
+ */
+
+#include "Terrain/SlopeShader.hpp"
+#include "OS/Clock.hpp"
+#include "Util/Macros.hpp"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct Dump {
+  unsigned width, height;
+  short *data;
+};
+
+static bool
+LoadDump(const char *path, Dump &dump)
+{
+  FILE *file = fopen(path, "rb");
+  if (file == NULL)
+    return false;
+
+  uint32_t header[2];
+  bool success = fread(header, sizeof(header), 1, file) == 1 &&
+    header[0] > 0 && header[0] <= 4096 &&
+    header[1] > 0 && header[1] <= 4096;
+  if (success) {
+    dump.width = header[0];
+    dump.height = header[1];
+
+    const size_t size = dump.width * dump.height;
+    dump.data = new short[size];
+    success = fread(dump.data, sizeof(*dump.data), size, file) == size;
+    if (!success)
+      delete[] dump.data;
+  }
+
+  fclose(file);
+  return success;
+}
+
+/**
+ * Shade the whole matrix, the same way RasterRenderer does.
+ */
+static void
+Shade(const SlopeShader &shading, const Dump &dump, uint16_t *dest,
+      bool scalar)
+{
+  const unsigned q = shading.quantisation;
+  const short *src = dump.data;
+
+  for (unsigned y = 0; y < dump.height;
+       ++y, src += dump.width, dest += dump.width) {
+    const unsigned row_plus_index = y < dump.height - q
+      ? q : dump.height - 1 - y;
+    const unsigned row_minus_index = y >= q ? q : y;
+
+    if (scalar)
+      shading.ShadeRowScalar(src, dump.width,
+                             row_minus_index, row_plus_index, dest);
+    else
+      shading.ShadeRow(src, dump.width,
+                       row_minus_index, row_plus_index, dest);
+  }
+}
+
+static unsigned
+Benchmark(const SlopeShader &shading, const Dump &dump, uint16_t *dest,
+          bool scalar, unsigned n)
+{
+  const uint64_t start = MonotonicClockUS();
+  for (unsigned i = 0; i < n; ++i)
+    Shade(shading, dump, dest, scalar);
+  return (MonotonicClockUS() - start) / n;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s DUMP ...\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  static const unsigned quantisations[] = { 1, 2, 3, 7 };
+  static const unsigned slope_factors[] = { 1, 35, 400, 2999 };
+  static const int contrasts[] = { 64, 160, 255 };
+  static const double azimuths[] = { 0, 45, 135, 200, 315 };
+
+  bool success = true;
+
+  for (int a = 1; a < argc; ++a) {
+    Dump dump;
+    if (!LoadDump(argv[a], dump)) {
+      fprintf(stderr, "Failed to load %s\n", argv[a]);
+      return EXIT_FAILURE;
+    }
+
+    const size_t size = dump.width * dump.height;
+    uint16_t *expected = new uint16_t[size];
+    uint16_t *actual = new uint16_t[size];
+
+    unsigned n_checked = 0, n_mismatches = 0;
+
+    SlopeShader shading;
+    shading.height_scale = 4;
+
+    for (unsigned i = 0; i < ARRAY_SIZE(quantisations); ++i) {
+      shading.quantisation = quantisations[i];
+
+      for (unsigned j = 0; j < ARRAY_SIZE(slope_factors); ++j) {
+        shading.height_slope_factor = slope_factors[j];
+
+        for (unsigned k = 0; k < ARRAY_SIZE(contrasts); ++k) {
+          shading.contrast = contrasts[k];
+
+          for (unsigned l = 0; l < ARRAY_SIZE(azimuths); ++l) {
+            const double elevation = (10.0 + 20.0 * l) * M_PI / 180;
+            const double azimuth = azimuths[l] * M_PI / 180;
+            shading.sx = (int)(255 * cos(elevation) * -sin(azimuth));
+            shading.sy = (int)(255 * cos(elevation) * -cos(azimuth));
+            shading.sz = (int)(255 * sin(elevation));
+
+            Shade(shading, dump, expected, true);
+            Shade(shading, dump, actual, false);
+
+            ++n_checked;
+            if (memcmp(expected, actual, size * sizeof(*actual)) != 0)
+              ++n_mismatches;
+          }
+        }
+      }
+    }
+
+    shading.quantisation = 2;
+    shading.height_slope_factor = 35;
+    shading.contrast = 160;
+    shading.sx = 0;
+    shading.sy = -97;
+    shading.sz = 236;
+
+    const unsigned n = 50;
+    const unsigned scalar_us = Benchmark(shading, dump, actual, true, n);
+    const unsigned vector_us = Benchmark(shading, dump, actual, false, n);
+
+    printf("%s: %ux%u checked=%u mismatches=%u scalar_us=%u vector_us=%u\n",
+           argv[a], dump.width, dump.height, n_checked, n_mismatches,
+           scalar_us, vector_us);
+
+    if (n_mismatches > 0)
+      success = false;
+
+    delete[] expected;
+    delete[] actual;
+    delete[] dump.data;
+  }
+
+  return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,438 @@
+/*
+Copyright_License {
+
+  XCSoar Glide Computer - http://www.xcsoar.org/
+  Copyright (C) 2000-2012 The XCSoar Project
+  A detailed list of copyright holders can be found in the file "AUTHORS".
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+}
+*/
+
+/*
+ * Measures the speed of the whole terrain subsystem with a map file:
+ * loading, tile decoding, height queries, intersection searches and
+ * rendering at several zoom levels.
+ *
+ * The results are printed as "key=value" lines, one per line, so two
+ * runs (e.g. of two releases) can be compared with diff or a script.
+ * All inputs are generated from a fixed seed; the checksums must not
+ * differ between two builds.
+ *
+ * If a cache directory is specified, the warm load time is measured
+ * with the overview and the decoded tiles restored from a #FileCache
+ * in that directory.
+ *
+ * If the map contains a raw DEM ("terrain.dem", see TerrainToDEM),
+ * its load time is measured, too, and its heights are compared with
+ * the JPEG2000 ones.
+ */
+
+#include "Terrain/RasterMap.hpp"
+#include "Terrain/HeightMatrix.hpp"
+#include "Terrain/RasterRenderer.hpp"
+#include "Projection/WindowProjection.hpp"
+#include "Screen/Layout.hpp"
+#include "Screen/Ramp.hpp"
+#include "IO/FileCache.hpp"
+#include "Geo/Math.hpp"
+#include "OS/PathName.hpp"
+#include "OS/Clock.hpp"
+#include "Compatibility/path.h"
+#include "Operation/Operation.hpp"
+#include "Thread/ThreadPool.hpp"
+#include "Util/Macros.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <tchar.h>
+#include <algorithm>
+
+int Layout::scale = 1;
+unsigned Layout::scale_1024 = 1024;
+
+static const unsigned N_QUERIES = 200000;
+static const unsigned N_RAYS = 5000;
+static const unsigned N_FRAMES = 10;
+
+/**
+ * The radius of the area around the map center where tiles are
+ * loaded [m].
+ */
+static const fixed TILE_RADIUS(50000);
+
+/**
+ * The map radii for the rendering tests [m].
+ */
+static const unsigned frame_radii[] = { 5000, 20000, 50000, 150000 };
+
+static const ColorRamp color_ramp[NUM_COLOR_RAMP_LEVELS] = {
+  {0,           0x70, 0xc0, 0xa7},
+  {250,         0xca, 0xe7, 0xb9},
+  {500,         0xf4, 0xea, 0xaf},
+  {750,         0xdc, 0xb2, 0x82},
+  {1000,        0xca, 0x8e, 0x72},
+  {1250,        0xde, 0xc8, 0xbd},
+  {1500,        0xe3, 0xe4, 0xe9},
+  {1750,        0xdb, 0xd9, 0xef},
+  {2000,        0xce, 0xcd, 0xf5},
+  {2250,        0xc2, 0xc1, 0xfa},
+  {2500,        0xb7, 0xb9, 0xff},
+  {5000,        0xb7, 0xb9, 0xff},
+  {6000,        0xb7, 0xb9, 0xff}
+};
+
+static void
+Print(const char *key, uint64_t value)
+{
+  printf("%s=%llu\n", key, (unsigned long long)value);
+}
+
+/**
+ * Calculate a rate per second, and avoid the division by zero.
+ */
+static uint64_t
+PerSecond(uint64_t count, uint64_t us)
+{
+  return us > 0 ? count * 1000000 / us : 0;
+}
+
+/**
+ * Returns a pseudo-random location within the area where tiles are
+ * loaded.
+ */
+static GeoPoint
+RandomLocation(const GeoPoint &center)
+{
+  GeoPoint location = center;
+  location.longitude += Angle::Degrees(fixed((rand() % 6001 - 3000) * 0.0001));
+  location.latitude += Angle::Degrees(fixed((rand() % 6001 - 3000) * 0.0001));
+  return location;
+}
+
+/**
+ * Open the map and load the tiles around its center.  Prints the
+ * load time and tile statistics with the specified key prefix.
+ */
+static RasterMap *
+LoadMap(const TCHAR *jp2_path, const TCHAR *j2w_path, FileCache *cache,
+        const char *prefix)
+{
+  char key[64];
+
+  NullOperationEnvironment operation;
+  uint64_t start = MonotonicClockUS();
+  RasterMap *map = new RasterMap(jp2_path, j2w_path, cache, operation);
+  if (!map->isMapLoaded()) {
+    delete map;
+    return NULL;
+  }
+
+  snprintf(key, sizeof(key), "%s_load_us", prefix);
+  Print(key, MonotonicClockUS() - start);
+
+  start = MonotonicClockUS();
+  do {
+    map->SetViewCenter(map->GetMapCenter(), TILE_RADIUS);
+  } while (map->IsDirty());
+  const uint64_t tiles_us = MonotonicClockUS() - start;
+
+  const RasterTileCache::Statistics stats = map->GetTileStatistics();
+
+  snprintf(key, sizeof(key), "%s_tiles_us", prefix);
+  Print(key, tiles_us);
+  snprintf(key, sizeof(key), "%s_tiles", prefix);
+  Print(key, stats.resident_tiles);
+  snprintf(key, sizeof(key), "%s_tiles_restored", prefix);
+  Print(key, stats.restored);
+  snprintf(key, sizeof(key), "%s_decode_us", prefix);
+  Print(key, stats.decode_us);
+  snprintf(key, sizeof(key), "%s_decode_tiles_per_s", prefix);
+  Print(key, PerSecond(stats.resident_tiles, stats.decode_us));
+  snprintf(key, sizeof(key), "%s_decode_kpixels_per_s", prefix);
+  Print(key, PerSecond(stats.resident_bytes / sizeof(short) / 1000,
+                       stats.decode_us));
+
+  return map;
+}
+
+static void
+BenchmarkHeights(const RasterMap &map)
+{
+  GeoPoint *locations = new GeoPoint[N_QUERIES];
+  srand(42);
+  for (unsigned i = 0; i < N_QUERIES; ++i)
+    locations[i] = RandomLocation(map.GetMapCenter());
+
+  uint32_t checksum = 0;
+  uint64_t start = MonotonicClockUS();
+  for (unsigned i = 0; i < N_QUERIES; ++i)
+    checksum = checksum * 31 + (uint16_t)map.GetHeight(locations[i]);
+  const uint64_t height_us = MonotonicClockUS() - start;
+
+  start = MonotonicClockUS();
+  for (unsigned i = 0; i < N_QUERIES; ++i)
+    checksum = checksum * 31 +
+      (uint16_t)map.GetInterpolatedHeight(locations[i]);
+  const uint64_t interpolated_us = MonotonicClockUS() - start;
+
+  Print("height_queries_per_s", PerSecond(N_QUERIES, height_us));
+  Print("interpolated_height_queries_per_s",
+        PerSecond(N_QUERIES, interpolated_us));
+  Print("height_checksum", checksum);
+
+  delete[] locations;
+}
+
+/**
+ * @return false if the two maps return different heights
+ */
+static bool
+CompareHeights(const RasterMap &a, const RasterMap &b)
+{
+  srand(44);
+  for (unsigned i = 0; i < N_QUERIES; ++i) {
+    const GeoPoint location = RandomLocation(a.GetMapCenter());
+    if (a.GetHeight(location) != b.GetHeight(location))
+      return false;
+  }
+
+  return true;
+}
+
+static void
+BenchmarkIntersection(const RasterMap &map)
+{
+  /* random rays up to 50 km long with a glide ratio of 1:40, like
+     BenchmarkTerrainIntersection */
+  GeoPoint *origins = new GeoPoint[N_RAYS];
+  GeoPoint *destinations = new GeoPoint[N_RAYS];
+  short *heights = new short[N_RAYS];
+  short *glides = new short[N_RAYS];
+
+  srand(43);
+  for (unsigned i = 0; i < N_RAYS; ++i) {
+    origins[i] = RandomLocation(map.GetMapCenter());
+
+    const fixed distance = fixed(1000 + rand() % 49000);
+    destinations[i] =
+      FindLatitudeLongitude(origins[i], Angle::Degrees(fixed(rand() % 360)),
+                            distance);
+
+    short h_terrain = map.GetHeight(origins[i]);
+    if (RasterBuffer::IsSpecial(h_terrain))
+      h_terrain = 0;
+
+    heights[i] = h_terrain + rand() % 1500;
+    glides[i] = (short)(distance / 40);
+  }
+
+  uint32_t checksum = 0;
+  const uint64_t start = MonotonicClockUS();
+  for (unsigned i = 0; i < N_RAYS; ++i) {
+    GeoPoint intx;
+    short h;
+    if (map.FirstIntersection(destinations[i], heights[i] - glides[i],
+                              origins[i], heights[i], glides[i],
+                              5000, 150, intx, h))
+      checksum = checksum * 31 + (uint16_t)h;
+    else
+      checksum = checksum * 31;
+  }
+  const uint64_t us = MonotonicClockUS() - start;
+
+  Print("intersection_rays_per_s", PerSecond(N_RAYS, us));
+  Print("intersection_checksum", checksum);
+
+  delete[] origins;
+  delete[] destinations;
+  delete[] heights;
+  delete[] glides;
+}
+
+/**
+ * Add a pixel to the checksum.  Unused bits are skipped, because
+ * they are not initialised.
+ */
+static uint32_t
+HashColor(uint32_t hash, const BGRColor &color)
+{
+#if defined(HAVE_GLES) || (!defined(ENABLE_SDL) && defined(_WIN32_WCE))
+  return hash * 31 + color.value;
+#else
+  return ((hash * 31 + color.r) * 31 + color.g) * 31 + color.b;
+#endif
+}
+
+/**
+ * @return false if the parallel HeightMatrix::Fill() result differs
+ * from the sequential one
+ */
+static bool
+BenchmarkFrames(const RasterMap &map)
+{
+  RasterRenderer renderer;
+  renderer.ColorTable(color_ramp, true, 4, 2);
+
+  HeightMatrix matrix, parallel_matrix;
+  ThreadPool &pool = GetSharedThreadPool();
+  bool success = true;
+
+  for (unsigned i = 0; i < ARRAY_SIZE(frame_radii); ++i) {
+    WindowProjection projection;
+    projection.SetScreenSize(640, 480);
+    projection.SetScaleFromRadius(fixed(frame_radii[i]));
+    projection.SetGeoLocation(map.GetMapCenter());
+    projection.SetScreenOrigin(320, 240);
+    projection.UpdateScreenBounds();
+
+    /* the minimum of several runs is less sensitive to system
+       load than the average */
+    uint64_t fill_us = UINT64_MAX;
+    for (unsigned j = 0; j < N_FRAMES; ++j) {
+      const uint64_t start = MonotonicClockUS();
+      matrix.Fill(map, projection, renderer.GetQuantisation(), true);
+      fill_us = std::min(fill_us, MonotonicClockUS() - start);
+    }
+
+    uint64_t parallel_fill_us = UINT64_MAX;
+    for (unsigned j = 0; j < N_FRAMES; ++j) {
+      const uint64_t start = MonotonicClockUS();
+      parallel_matrix.Fill(map, projection, renderer.GetQuantisation(), true,
+                           &pool);
+      parallel_fill_us = std::min(parallel_fill_us,
+                                  MonotonicClockUS() - start);
+    }
+
+    if (memcmp(matrix.GetData(), parallel_matrix.GetData(),
+               matrix.GetWidth() * matrix.GetHeight() * sizeof(short)) != 0)
+      success = false;
+
+    renderer.ScanMap(map, projection);
+
+    uint64_t image_us = UINT64_MAX;
+    for (unsigned j = 0; j < N_FRAMES; ++j) {
+      const uint64_t start = MonotonicClockUS();
+      renderer.GenerateImage(true, 4, 64, 192, Angle::Degrees(fixed(45)));
+      image_us = std::min(image_us, MonotonicClockUS() - start);
+    }
+
+    const RawBitmap &image = renderer.GetImage();
+    uint32_t checksum = 0;
+    for (unsigned y = 0; y < renderer.GetHeight(); ++y) {
+      const BGRColor *row = image.GetRow(y);
+      for (unsigned x = 0; x < renderer.GetWidth(); ++x)
+        checksum = HashColor(checksum, row[x]);
+    }
+
+    char key[64];
+    snprintf(key, sizeof(key), "frame_%ukm_fill_us", frame_radii[i] / 1000);
+    Print(key, fill_us);
+    snprintf(key, sizeof(key), "frame_%ukm_parallel_fill_us",
+             frame_radii[i] / 1000);
+    Print(key, parallel_fill_us);
+    snprintf(key, sizeof(key), "frame_%ukm_image_us", frame_radii[i] / 1000);
+    Print(key, image_us);
+    snprintf(key, sizeof(key), "frame_%ukm_image_checksum",
+             frame_radii[i] / 1000);
+    Print(key, checksum);
+  }
+
+  Print("threads", pool.GetConcurrency());
+  return success;
+}
+
+static int
+RunBenchmarks(const char *map_path, const char *cache_path)
+{
+  TCHAR jp2_path[4096];
+  _tcscpy(jp2_path, PathName(map_path));
+  _tcscat(jp2_path, _T(DIR_SEPARATOR_S) _T("terrain.jp2"));
+
+  TCHAR j2w_path[4096];
+  _tcscpy(j2w_path, PathName(map_path));
+  _tcscat(j2w_path, _T(DIR_SEPARATOR_S) _T("terrain.j2w"));
+
+  TCHAR dem_path[4096];
+  _tcscpy(dem_path, PathName(map_path));
+  _tcscat(dem_path, _T(DIR_SEPARATOR_S) _T("terrain.dem"));
+
+  RasterMap *map = LoadMap(jp2_path, j2w_path, NULL, "cold");
+  if (map == NULL) {
+    fprintf(stderr, "failed to load map\n");
+    return EXIT_FAILURE;
+  }
+
+  if (RasterTileCache::IsRawDEM(NarrowPathName(dem_path))) {
+    RasterMap *dem = LoadMap(dem_path, j2w_path, NULL, "dem");
+    const bool equal = dem != NULL && CompareHeights(*map, *dem);
+    delete dem;
+
+    if (!equal) {
+      fprintf(stderr, "raw DEM differs\n");
+      delete map;
+      return EXIT_FAILURE;
+    }
+  }
+
+  FileCache *cache = NULL;
+  if (cache_path != NULL) {
+    delete map;
+
+    cache = new FileCache(PathName(cache_path));
+
+    /* fill the cache, then load again from it */
+    map = LoadMap(jp2_path, j2w_path, cache, "prime");
+    if (map != NULL) {
+      delete map;
+      map = LoadMap(jp2_path, j2w_path, cache, "warm");
+    }
+
+    if (map == NULL) {
+      fprintf(stderr, "failed to load map from cache\n");
+      delete cache;
+      return EXIT_FAILURE;
+    }
+  }
+
+  BenchmarkHeights(*map);
+  BenchmarkIntersection(*map);
+  const bool success = BenchmarkFrames(*map);
+
+  delete map;
+  delete cache;
+
+  if (!success) {
+    fprintf(stderr, "parallel HeightMatrix::Fill() differs\n");
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc != 2 && argc != 3) {
+    fprintf(stderr, "Usage: %s PATH [CACHE_DIR]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  InitialiseSharedThreadPool();
+  const int result = RunBenchmarks(argv[1], argc >= 3 ? argv[2] : NULL);
+  DeinitialiseSharedThreadPool();
+  return result;
+}
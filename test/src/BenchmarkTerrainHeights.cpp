@@ -0,0 +1,107 @@
+/*
+Copyright_License {
+
+  XCSoar Glide Computer - http://www.xcsoar.org/
+  Copyright (C) 2000-2012 The XCSoar Project
+  A detailed list of copyright holders can be found in the file "AUTHORS".
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+}
+*/
+
+/*
+ * Compares RasterMap::GetHeights() with a loop of
+ * RasterMap::GetHeight() calls, and measures the speed of both.
+ */
+
+#include "Terrain/RasterMap.hpp"
+#include "OS/PathName.hpp"
+#include "OS/Clock.hpp"
+#include "Compatibility/path.h"
+#include "Operation/Operation.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tchar.h>
+
+static const unsigned N_POINTS = 100000;
+static const unsigned N_RUNS = 20;
+
+int main(int argc, char **argv)
+{
+  if (argc != 2) {
+    fprintf(stderr, "Usage: %s PATH\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  const char *map_path = argv[1];
+
+  TCHAR jp2_path[4096];
+  _tcscpy(jp2_path, PathName(map_path));
+  _tcscat(jp2_path, _T(DIR_SEPARATOR_S) _T("terrain.jp2"));
+
+  TCHAR j2w_path[4096];
+  _tcscpy(j2w_path, PathName(map_path));
+  _tcscat(j2w_path, _T(DIR_SEPARATOR_S) _T("terrain.j2w"));
+
+  NullOperationEnvironment operation;
+  RasterMap map(jp2_path, j2w_path, NULL, operation);
+  if (!map.isMapLoaded()) {
+    fprintf(stderr, "failed to load map\n");
+    return EXIT_FAILURE;
+  }
+
+  do {
+    map.SetViewCenter(map.GetMapCenter(), fixed(50000));
+  } while (map.IsDirty());
+
+  /* a random walk around the map center, similar to the locations
+     queried by the route planner */
+  GeoPoint *locations = new GeoPoint[N_POINTS];
+  GeoPoint location = map.GetMapCenter();
+  srand(42);
+  for (unsigned i = 0; i < N_POINTS; ++i) {
+    location.longitude += Angle::Degrees(fixed((rand() % 201 - 100) * 0.0001));
+    location.latitude += Angle::Degrees(fixed((rand() % 201 - 100) * 0.0001));
+    locations[i] = location;
+  }
+
+  short *expected = new short[N_POINTS];
+  short *actual = new short[N_POINTS];
+
+  uint64_t start = MonotonicClockUS();
+  for (unsigned run = 0; run < N_RUNS; ++run)
+    for (unsigned i = 0; i < N_POINTS; ++i)
+      expected[i] = map.GetHeight(locations[i]);
+  const unsigned single_us = (MonotonicClockUS() - start) / N_RUNS;
+
+  start = MonotonicClockUS();
+  for (unsigned run = 0; run < N_RUNS; ++run)
+    map.GetHeights(locations, actual, N_POINTS);
+  const unsigned batch_us = (MonotonicClockUS() - start) / N_RUNS;
+
+  const bool success =
+    memcmp(expected, actual, N_POINTS * sizeof(*actual)) == 0;
+
+  printf("points=%u single_us=%u batch_us=%u %s\n",
+         N_POINTS, single_us, batch_us, success ? "ok" : "MISMATCH");
+
+  delete[] locations;
+  delete[] expected;
+  delete[] actual;
+
+  return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,152 @@
+/*
+Copyright_License {
+
+  XCSoar Glide Computer - http://www.xcsoar.org/
+  Copyright (C) 2000-2012 The XCSoar Project
+  A detailed list of copyright holders can be found in the file "AUTHORS".
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+}
+*/
+
+/*
+ * Measures the speed of RasterMap::FirstIntersection() and
+ * RasterMap::Intersection() with random rays, similar to the ones
+ * cast by the route planner.  The printed checksum covers all
+ * results, and can be compared between two builds.
+ */
+
+#include "Terrain/RasterMap.hpp"
+#include "Geo/Math.hpp"
+#include "OS/PathName.hpp"
+#include "OS/Clock.hpp"
+#include "Compatibility/path.h"
+#include "Operation/Operation.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <tchar.h>
+
+static const unsigned N_RAYS = 20000;
+
+struct Ray {
+  GeoPoint origin, destination;
+  short h_origin, h_destination, h_glide;
+};
+
+static uint32_t
+Hash(uint32_t hash, int value)
+{
+  return hash * 31 + (uint32_t)value;
+}
+
+static uint32_t
+Hash(uint32_t hash, const GeoPoint &location)
+{
+  hash = Hash(hash, (int)(location.longitude.Degrees() * 1000000));
+  return Hash(hash, (int)(location.latitude.Degrees() * 1000000));
+}
+
+int main(int argc, char **argv)
+{
+  if (argc != 2) {
+    fprintf(stderr, "Usage: %s PATH\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  const char *map_path = argv[1];
+
+  TCHAR jp2_path[4096];
+  _tcscpy(jp2_path, PathName(map_path));
+  _tcscat(jp2_path, _T(DIR_SEPARATOR_S) _T("terrain.jp2"));
+
+  TCHAR j2w_path[4096];
+  _tcscpy(j2w_path, PathName(map_path));
+  _tcscat(j2w_path, _T(DIR_SEPARATOR_S) _T("terrain.j2w"));
+
+  NullOperationEnvironment operation;
+  RasterMap map(jp2_path, j2w_path, NULL, operation);
+  if (!map.isMapLoaded()) {
+    fprintf(stderr, "failed to load map\n");
+    return EXIT_FAILURE;
+  }
+
+  do {
+    map.SetViewCenter(map.GetMapCenter(), fixed(50000));
+  } while (map.IsDirty());
+
+  /* random rays up to 50 km long near the map center, starting
+     between 0 and 1500 m above the terrain, with a glide ratio of
+     1:40 */
+  Ray *rays = new Ray[N_RAYS];
+  srand(42);
+  for (unsigned i = 0; i < N_RAYS; ++i) {
+    Ray &ray = rays[i];
+    GeoPoint origin = map.GetMapCenter();
+    origin.longitude += Angle::Degrees(fixed((rand() % 2001 - 1000) * 0.001));
+    origin.latitude += Angle::Degrees(fixed((rand() % 2001 - 1000) * 0.001));
+
+    const fixed distance = fixed(1000 + rand() % 49000);
+    ray.origin = origin;
+    ray.destination = FindLatitudeLongitude(origin,
+                                            Angle::Degrees(fixed(rand() % 360)),
+                                            distance);
+
+    short h_terrain = map.GetHeight(origin);
+    if (RasterBuffer::IsSpecial(h_terrain))
+      h_terrain = 0;
+
+    ray.h_origin = h_terrain + rand() % 1500;
+    ray.h_glide = (short)(distance / 40);
+    ray.h_destination = ray.h_origin - ray.h_glide;
+  }
+
+  uint32_t hash = 0;
+  unsigned n_intersections = 0;
+
+  /* like the route planner, FirstIntersection() walks from the low
+     end of the glide towards the high end */
+  uint64_t start = MonotonicClockUS();
+  for (unsigned i = 0; i < N_RAYS; ++i) {
+    const Ray &ray = rays[i];
+    GeoPoint intx;
+    short h = 0;
+    if (map.FirstIntersection(ray.destination, ray.h_destination,
+                              ray.origin, ray.h_origin,
+                              ray.h_glide, 5000, 150, intx, h)) {
+      ++n_intersections;
+      hash = Hash(Hash(hash, intx), h);
+    } else
+      hash = Hash(hash, 0);
+  }
+  const unsigned first_us = MonotonicClockUS() - start;
+
+  start = MonotonicClockUS();
+  for (unsigned i = 0; i < N_RAYS; ++i) {
+    const Ray &ray = rays[i];
+    hash = Hash(hash, map.Intersection(ray.origin, ray.h_origin,
+                                       ray.h_glide, ray.destination));
+  }
+  const unsigned intersection_us = MonotonicClockUS() - start;
+
+  printf("rays=%u intersecting=%u first_intersection_us=%u intersection_us=%u "
+         "checksum=%08x\n",
+         N_RAYS, n_intersections, first_us, intersection_us, (unsigned)hash);
+
+  delete[] rays;
+
+  return EXIT_SUCCESS;
+}
@@ -70,5 +70,14 @@ int main(int argc, char **argv)
                     1000);
   } while (rtc.IsDirty());
 
+  const RasterTileCache::Statistics stats = rtc.GetStatistics();
+  printf("hits = %u, misses = %u, restored = %u, evictions = %u\n"
+         "prefetched = %u, prefetch hits = %u\n"
+         "decode = %u ms, resident = %u tiles, %u kB\n",
+         stats.hits, stats.misses, stats.restored, stats.evictions,
+         stats.prefetched, stats.prefetch_hits,
+         (unsigned)(stats.decode_us / 1000),
+         stats.resident_tiles, (unsigned)(stats.resident_bytes >> 10));
+
   return EXIT_SUCCESS;
 }
@@ -21,18 +21,86 @@ Copyright_License {
 }
 */
 
+/*
+ * Parses an airspace file.  If a cache directory is specified, the
+ * airspaces are also written to the binary cache and loaded back from
+ * it; both are compared, and the timings are printed.
+ */
+
 #include "Airspace/AirspaceParser.hpp"
+#include "Airspace/AirspaceCache.hpp"
 #include "Engine/Airspace/Airspaces.hpp"
+#include "Engine/Airspace/AbstractAirspace.hpp"
+#include "Geo/GeoBounds.hpp"
 #include "IO/FileLineReader.hpp"
+#include "IO/FileCache.hpp"
 #include "Operation/Operation.hpp"
+#include "OS/PathName.hpp"
+#include "OS/Clock.hpp"
 
 #include <stdio.h>
+#include <stdint.h>
 #include <tchar.h>
 
+static bool
+Equals(const AirspaceAltitude &a, const AirspaceAltitude &b)
+{
+  return a.type == b.type && a.altitude == b.altitude &&
+    a.flight_level == b.flight_level &&
+    a.altitude_above_terrain == b.altitude_above_terrain;
+}
+
+static bool
+Equals(const AbstractAirspace &a, const AbstractAirspace &b)
+{
+  if (a.GetShape() != b.GetShape() || a.GetType() != b.GetType() ||
+      _tcscmp(a.GetName(), b.GetName()) != 0 ||
+      a.GetRadio() != b.GetRadio() ||
+      !a.GetDays().equals(b.GetDays()) ||
+      !Equals(a.GetBase(), b.GetBase()) || !Equals(a.GetTop(), b.GetTop()))
+    return false;
+
+  const SearchPointVector &pa = a.GetPoints(), &pb = b.GetPoints();
+  if (pa.size() != pb.size())
+    return false;
+
+  for (unsigned i = 0; i < pa.size(); ++i)
+    if (pa[i].get_location() != pb[i].get_location())
+      return false;
+
+  /* the cached interior index must give the same results */
+  const GeoBounds bounds = a.GetGeoBounds();
+  for (unsigned i = 0; i <= 8; ++i) {
+    for (unsigned j = 0; j <= 8; ++j) {
+      const GeoPoint p(bounds.west + (bounds.east - bounds.west) * i / 8,
+                       bounds.south + (bounds.north - bounds.south) * j / 8);
+      if (a.Inside(p) != b.Inside(p))
+        return false;
+    }
+  }
+
+  return true;
+}
+
+static bool
+Equals(const Airspaces &a, const Airspaces &b)
+{
+  const std::deque<AbstractAirspace *> &pa = a.GetPending();
+  const std::deque<AbstractAirspace *> &pb = b.GetPending();
+  if (pa.size() != pb.size())
+    return false;
+
+  for (unsigned i = 0; i < pa.size(); ++i)
+    if (!Equals(*pa[i], *pb[i]))
+      return false;
+
+  return true;
+}
+
 int main(int argc, char **argv)
 {
-  if (argc != 2) {
-    fprintf(stderr, "Usage: %s PATH\n", argv[0]);
+  if (argc != 2 && argc != 3) {
+    fprintf(stderr, "Usage: %s PATH [CACHE]\n", argv[0]);
     return 1;
   }
 
@@ -46,11 +114,47 @@ int main(int argc, char **argv)
   AirspaceParser parser(airspaces);
 
   NullOperationEnvironment operation;
+  uint64_t start = MonotonicClockUS();
   if (!parser.Parse(reader, operation)) {
     fprintf(stderr, "Failed to parse input file\n");
     return 1;
   }
 
+  const unsigned parse_us = MonotonicClockUS() - start;
+
+  if (argc == 3) {
+    const PathName path(argv[1]), cache_path(argv[2]);
+    FileCache cache(cache_path);
+    if (!SaveAirspaceCache(airspaces, 0, cache, _T("airspace"), path)) {
+      fprintf(stderr, "Failed to write the cache\n");
+      return 1;
+    }
+
+    Airspaces cached;
+    start = MonotonicClockUS();
+    if (!LoadAirspaceCache(cached, cache, _T("airspace"), path)) {
+      fprintf(stderr, "Failed to load the cache\n");
+      return 1;
+    }
+
+    const unsigned load_us = MonotonicClockUS() - start;
+
+    if (!Equals(airspaces, cached)) {
+      fprintf(stderr, "The cached airspaces differ\n");
+      return 1;
+    }
+
+    start = MonotonicClockUS();
+    cached.Optimise();
+    const unsigned optimise_us = MonotonicClockUS() - start;
+
+    printf("airspaces=%u\n"
+           "  parse: us=%u\n"
+           "  cache: us=%u\n"
+           "  tree:  us=%u\n",
+           cached.size(), parse_us, load_us, optimise_us);
+  }
+
   printf("OK\n");
 
   return 0;
@@ -30,14 +30,15 @@ Copyright_License {
 #include "Operation/Operation.hpp"
 
 #include <stdio.h>
+#include <stdint.h>
 #include <tchar.h>
 
 unsigned Layout::scale_1024 = 1024;
 
 int main(int argc, char **argv)
 {
-  if (argc != 2) {
-    fprintf(stderr, "Usage: %s PATH\n", argv[0]);
+  if (argc != 2 && argc != 3) {
+    fprintf(stderr, "Usage: %s PATH [DUMP]\n", argv[0]);
     return 1;
   }
 
@@ -73,5 +74,27 @@ int main(int argc, char **argv)
   HeightMatrix matrix;
   matrix.Fill(map, projection, 1, false);
 
+  if (argc >= 3) {
+    /* write the matrix to a file, which can be used as input for
+       BenchmarkSlopeShading */
+    FILE *file = fopen(argv[2], "wb");
+    if (file == NULL) {
+      fprintf(stderr, "Failed to create %s\n", argv[2]);
+      return EXIT_FAILURE;
+    }
+
+    const uint32_t header[2] = { matrix.GetWidth(), matrix.GetHeight() };
+    const size_t size = matrix.GetWidth() * matrix.GetHeight();
+    if (fwrite(header, sizeof(header), 1, file) != 1 ||
+        fwrite(matrix.GetData(), sizeof(*matrix.GetData()),
+               size, file) != size) {
+      fprintf(stderr, "Failed to write %s\n", argv[2]);
+      fclose(file);
+      return EXIT_FAILURE;
+    }
+
+    fclose(file);
+  }
+
   return EXIT_SUCCESS;
 }
@@ -174,7 +174,7 @@ LoadFiles(ComputerSettings &settings)
   NullOperationEnvironment operation;
 
   topography = new TopographyStore();
-  LoadConfiguredTopography(*topography, operation);
+  LoadConfiguredTopography(*topography, NULL, operation);
 
   terrain = RasterTerrain::OpenTerrain(NULL, operation);
 
@@ -0,0 +1,95 @@
+/*
+Copyright_License {
+
+  XCSoar Glide Computer - http://www.xcsoar.org/
+  Copyright (C) 2000-2012 The XCSoar Project
+  A detailed list of copyright holders can be found in the file "AUTHORS".
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+}
+*/
+
+/*
+ * This program converts the JPEG2000 terrain of a map file to the raw
+ * DEM format (see Terrain/RawDEM.hpp), which loads faster.  The
+ * result may be added to the map file as "terrain.dem"; it should be
+ * stored without zip compression (e.g. "zip -0"), or else each tile
+ * access must inflate the file from the beginning.
+ */
+
+#include "Terrain/RasterTileCache.hpp"
+#include "OS/PathName.hpp"
+#include "OS/Clock.hpp"
+#include "Compatibility/path.h"
+#include "Operation/Operation.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tchar.h>
+
+int main(int argc, char **argv)
+{
+  bool compress = false;
+  if (argc == 4 && strcmp(argv[3], "--zlib") == 0)
+    compress = true;
+  else if (argc != 3) {
+    fprintf(stderr, "Usage: %s PATH OUTPUT.dem [--zlib]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  const char *map_path = argv[1];
+  const char *output_path = argv[2];
+
+  char jp2_path[4096];
+  strcpy(jp2_path, map_path);
+  strcat(jp2_path, DIR_SEPARATOR_S "terrain.jp2");
+
+  TCHAR j2w_path[4096];
+  _tcscpy(j2w_path, PathName(map_path));
+  _tcscat(j2w_path, _T(DIR_SEPARATOR_S) _T("terrain.j2w"));
+
+  NullOperationEnvironment operation;
+  RasterTileCache rtc;
+  if (!rtc.LoadOverview(jp2_path, j2w_path, operation)) {
+    fprintf(stderr, "LoadOverview failed\n");
+    return EXIT_FAILURE;
+  }
+
+  FILE *file = fopen(output_path, "wb");
+  if (file == NULL) {
+    perror(output_path);
+    return EXIT_FAILURE;
+  }
+
+  const uint64_t start = MonotonicClockUS();
+  bool success = rtc.SaveRawDEM(jp2_path, file, compress);
+  const unsigned duration_ms = (MonotonicClockUS() - start) / 1000;
+
+  fseek(file, 0, SEEK_END);
+  const long size = ftell(file);
+  if (fclose(file) != 0)
+    success = false;
+
+  if (!success) {
+    fprintf(stderr, "Failed to write %s\n", output_path);
+    remove(output_path);
+    return EXIT_FAILURE;
+  }
+
+  printf("%ux%u pixels, %ld bytes, %u ms\n",
+         rtc.GetWidth(), rtc.GetHeight(), size, duration_ms);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,166 @@
+/*
+Copyright_License {
+
+  XCSoar Glide Computer - http://www.xcsoar.org/
+  Copyright (C) 2000-2012 The XCSoar Project
+  A detailed list of copyright holders can be found in the file "AUTHORS".
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+}
+*/
+
+#include "Terrain/RasterMap.hpp"
+#include "Terrain/HeightMatrix.hpp"
+#include "Projection/WindowProjection.hpp"
+#include "Operation/Operation.hpp"
+#include "Util/Macros.hpp"
+#include "TestUtil.hpp"
+
+#include <vector>
+#include <stdlib.h>
+#include <tchar.h>
+
+static WindowProjection
+MakeProjection(const GeoPoint &location)
+{
+  WindowProjection projection;
+  projection.SetScreenSize(320, 240);
+  projection.SetScaleFromRadius(fixed(30000));
+  projection.SetGeoLocation(location);
+  projection.SetScreenOrigin(160, 120);
+  projection.UpdateScreenBounds();
+  return projection;
+}
+
+/**
+ * Drag the map by the specified number of cells.
+ */
+static void
+Pan(WindowProjection &projection, int dx, int dy, unsigned q)
+{
+  const RasterPoint &origin = projection.GetScreenOrigin();
+  projection = MakeProjection(projection.ScreenToGeo(origin.x + dx * (int)q,
+                                                     origin.y + dy * (int)q));
+}
+
+/**
+ * Pan the map, and check the result of HeightMatrix::Update().
+ *
+ * @param exact true if Update() must give exactly the same matrix as
+ * Fill()
+ */
+static void
+TestPan(const RasterMap &map, WindowProjection &projection,
+        HeightMatrix &matrix, int dx, int dy,
+        unsigned q, bool interpolate, bool exact)
+{
+  const std::vector<short> old(matrix.GetData(), matrix.GetDataEnd());
+
+  Pan(projection, dx, dy, q);
+  matrix.Update(map, projection, q, interpolate);
+
+  HeightMatrix filled;
+  filled.Fill(map, projection, q, interpolate);
+
+  const int width = filled.GetWidth(), height = filled.GetHeight();
+  ok1((int)matrix.GetWidth() == width && (int)matrix.GetHeight() == height);
+
+  /* the cells which were visible before must have been moved by
+     exactly the pan distance */
+  const short *data = matrix.GetData();
+  unsigned moved_errors = 0;
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      const int old_x = x + dx, old_y = y + dy;
+      if (old_x >= 0 && old_x < width && old_y >= 0 && old_y < height &&
+          data[y * width + x] != old[old_y * width + old_x])
+        ++moved_errors;
+    }
+  }
+
+  ok1(moved_errors == 0);
+
+  /* compare with Fill(); RasterMap::ScanLine() interpolates the
+     sample locations between the end points of the scanned run, so
+     the cells of a shorter run may hit a neighbouring raster pixel,
+     and Update() keeps the samples of a grid which may be up to one
+     pixel away from the new one; this does not happen when only whole
+     rows have been moved since the last Fill() */
+  unsigned differences = 0, large_differences = 0;
+  for (const short *a = matrix.GetData(), *b = filled.GetData(),
+         *end = matrix.GetDataEnd(); a != end; ++a, ++b) {
+    if (*a != *b) {
+      ++differences;
+      if (abs(*a - *b) > 10)
+        ++large_differences;
+    }
+  }
+
+  if (exact)
+    ok1(differences == 0);
+  else
+    ok1(differences * 4 < (unsigned)(width * height) &&
+        large_differences * 100 < (unsigned)(width * height));
+}
+
+static void
+TestPans(const RasterMap &map, unsigned q, bool interpolate)
+{
+  static const int vertical_steps[][2] = {
+    { 0, 4 }, { 0, -2 }, { 0, 1 },
+  };
+
+  static const int steps[][2] = {
+    { 3, 0 }, { -5, 0 }, { 0, 4 }, { 7, -6 }, { -1, 1 }, { -9, -3 },
+  };
+
+  WindowProjection projection = MakeProjection(map.GetMapCenter());
+  HeightMatrix matrix;
+
+  matrix.Fill(map, projection, q, interpolate);
+  for (unsigned i = 0; i < ARRAY_SIZE(vertical_steps); ++i)
+    TestPan(map, projection, matrix,
+            vertical_steps[i][0], vertical_steps[i][1],
+            q, interpolate, true);
+
+  matrix.Fill(map, projection, q, interpolate);
+  for (unsigned i = 0; i < ARRAY_SIZE(steps); ++i)
+    TestPan(map, projection, matrix, steps[i][0], steps[i][1],
+            q, interpolate, false);
+}
+
+int main(int argc, char **argv)
+{
+  NullOperationEnvironment operation;
+  RasterMap map(_T("test/data/benalla9.xcm/terrain.jp2"),
+                _T("test/data/benalla9.xcm/terrain.j2w"), NULL, operation);
+  if (!map.isMapLoaded()) {
+    fprintf(stderr, "failed to load map\n");
+    return EXIT_FAILURE;
+  }
+
+  do {
+    map.SetViewCenter(map.GetMapCenter(), fixed(50000));
+  } while (map.IsDirty());
+
+  plan_tests(4 * 9 * 3);
+
+  TestPans(map, 1, false);
+  TestPans(map, 2, true);
+  TestPans(map, 4, false);
+  TestPans(map, 4, true);
+
+  return exit_status();
+}
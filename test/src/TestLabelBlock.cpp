@@ -0,0 +1,184 @@
+/* Copyright_License {
+
+  XCSoar Glide Computer - http://www.xcsoar.org/
+  Copyright (C) 2000-2012 The XCSoar Project
+  A detailed list of copyright holders can be found in the file "AUTHORS".
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+}
+*/
+
+
+#include "Screen/LabelBlock.hpp"
+#include "TestUtil.hpp"
+
+/* the size of one grid cell, see LabelBlock */
+static const int CELL_WIDTH = 128, CELL_HEIGHT = 32;
+
+static PixelRect
+MakeRect(int left, int top, int width, int height)
+{
+  PixelRect rc;
+  rc.left = left;
+  rc.top = top;
+  rc.right = left + width;
+  rc.bottom = top + height;
+  return rc;
+}
+
+/**
+ * Returns a label which covers exactly one grid cell.  The cells of
+ * different indices are disjoint and below the area used by
+ * MakeBigLabel().
+ */
+static PixelRect
+MakeSmallLabel(unsigned i)
+{
+  return MakeRect((i % 16) * CELL_WIDTH, 4096 + (i / 16) * CELL_HEIGHT,
+                  CELL_WIDTH, CELL_HEIGHT);
+}
+
+/**
+ * Returns a label which covers exactly 4x4 grid cells, the maximum
+ * number of cells per label.
+ */
+static PixelRect
+MakeBigLabel(unsigned i)
+{
+  return MakeRect((i % 8) * 4 * CELL_WIDTH, (i / 8) * 4 * CELL_HEIGHT,
+                  4 * CELL_WIDTH, 4 * CELL_HEIGHT);
+}
+
+static void
+TestOverlap()
+{
+  LabelBlock block;
+
+  ok1(block.check(MakeRect(10, 10, 100, 20)));
+
+  /* the same rectangle and partial overlaps are rejected */
+  ok1(!block.check(MakeRect(10, 10, 100, 20)));
+  ok1(!block.check(MakeRect(60, 20, 100, 20)));
+  ok1(!block.check(MakeRect(0, 0, 20, 20)));
+  ok1(!block.check(MakeRect(50, 15, 5, 5)));
+
+  /* crossing into the next grid cell */
+  ok1(!block.check(MakeRect(100, 25, 100, 20)));
+
+  /* the right and bottom edges are exclusive */
+  ok1(block.check(MakeRect(110, 10, 100, 20)));
+  ok1(block.check(MakeRect(10, 30, 100, 20)));
+
+  /* far away, and at negative coordinates */
+  ok1(block.check(MakeRect(1000, 1000, 100, 20)));
+  ok1(block.check(MakeRect(-200, -100, 100, 20)));
+  ok1(!block.check(MakeRect(-150, -90, 100, 20)));
+
+  ok1(!block.IsFull());
+
+  /* reset() forgets all labels */
+  block.reset();
+  ok1(block.check(MakeRect(10, 10, 100, 20)));
+  ok1(block.check(MakeRect(1000, 1000, 100, 20)));
+}
+
+static void
+TestTooManyCells()
+{
+  LabelBlock block;
+
+  /* 5x4 cells */
+  ok1(!block.check(MakeRect(0, 0, 5 * CELL_WIDTH, 4 * CELL_HEIGHT)));
+
+  /* 4x4 cells */
+  ok1(block.check(MakeBigLabel(0)));
+}
+
+static void
+TestLabelLimit()
+{
+  LabelBlock block;
+
+  unsigned n_accepted = 0;
+  for (unsigned i = 0; i < LabelBlock::MAX_LABELS - 1; ++i)
+    if (block.check(MakeSmallLabel(i)))
+      ++n_accepted;
+
+  ok1(n_accepted == LabelBlock::MAX_LABELS - 1);
+  ok1(!block.IsFull());
+
+  ok1(block.check(MakeSmallLabel(LabelBlock::MAX_LABELS - 1)));
+  ok1(block.IsFull());
+  ok1(!block.check(MakeSmallLabel(LabelBlock::MAX_LABELS)));
+
+  block.reset();
+  ok1(!block.IsFull());
+  ok1(block.check(MakeSmallLabel(LabelBlock::MAX_LABELS)));
+}
+
+static void
+TestReferenceLimit()
+{
+  const unsigned n_big = LabelBlock::MAX_REFERENCES /
+    LabelBlock::MAX_CELLS_PER_LABEL;
+
+  LabelBlock block;
+
+  /* the big labels exhaust the cell references long before the
+     label limit is reached */
+  unsigned n_accepted = 0;
+  for (unsigned i = 0; i < n_big; ++i)
+    if (block.check(MakeBigLabel(i)))
+      ++n_accepted;
+
+  ok1(n_accepted == n_big);
+  ok1(n_big < LabelBlock::MAX_LABELS);
+  ok1(block.IsFull());
+  ok1(!block.check(MakeSmallLabel(0)));
+
+  /* fill all but one reference */
+  block.reset();
+  n_accepted = 0;
+  for (unsigned i = 0; i < n_big - 1; ++i)
+    if (block.check(MakeBigLabel(i)))
+      ++n_accepted;
+  for (unsigned i = 0; i < LabelBlock::MAX_CELLS_PER_LABEL - 1; ++i)
+    if (block.check(MakeSmallLabel(i)))
+      ++n_accepted;
+
+  ok1(n_accepted == n_big - 1 + LabelBlock::MAX_CELLS_PER_LABEL - 1);
+  ok1(!block.IsFull());
+
+  /* a free label which needs two references does not fit, but one
+     which needs a single reference does */
+  const int y = 160 * CELL_HEIGHT;
+  ok1(!block.check(MakeRect(0, y, 2 * CELL_WIDTH, CELL_HEIGHT)));
+  ok1(!block.IsFull());
+  ok1(block.check(MakeRect(0, y, CELL_WIDTH, CELL_HEIGHT)));
+  ok1(block.IsFull());
+  ok1(!block.check(MakeRect(CELL_WIDTH, y, CELL_WIDTH, CELL_HEIGHT)));
+}
+
+int main(int argc, char **argv)
+{
+  plan_tests(34);
+
+  TestOverlap();
+  TestTooManyCells();
+  TestLabelLimit();
+  TestReferenceLimit();
+
+  return exit_status();
+}
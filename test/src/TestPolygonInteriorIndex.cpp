@@ -0,0 +1,291 @@
+/* Copyright_License {
+
+  XCSoar Glide Computer - http://www.xcsoar.org/
+  Copyright (C) 2000-2012 The XCSoar Project
+  A detailed list of copyright holders can be found in the file "AUTHORS".
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+}
+*/
+
+
+#include "Geo/ConvexHull/PolygonInteriorIndex.hpp"
+#include "Geo/ConvexHull/PolygonInterior.hpp"
+#include "TestUtil.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#include <math.h>
+#include <stdlib.h>
+
+typedef std::vector<SearchPoint> Polygon;
+
+struct Vertex {
+  double x, y;
+};
+
+static GeoPoint
+MakeGeoPoint(double x, double y)
+{
+  /* a box of about 100 km near Dortmund */
+  return GeoPoint(Angle::Degrees(fixed(7 + x / 10)),
+                  Angle::Degrees(fixed(51 + y / 10)));
+}
+
+/**
+ * Build a closed polygon from the specified corners.  Each edge is
+ * split into the given number of parts, which adds collinear
+ * vertices and makes the polygon big enough to be indexed.
+ */
+static Polygon
+MakePolygon(const Vertex *corners, unsigned n, unsigned parts)
+{
+  Polygon V;
+  for (unsigned i = 0; i < n; ++i) {
+    const Vertex &a = corners[i], &b = corners[(i + 1) % n];
+    for (unsigned j = 0; j < parts; ++j) {
+      const double t = (double)j / parts;
+      V.push_back(MakeGeoPoint(a.x + (b.x - a.x) * t,
+                               a.y + (b.y - a.y) * t));
+    }
+  }
+
+  V.push_back(V.front());
+  return V;
+}
+
+/**
+ * A star with 20 spikes: concave at every second vertex.
+ */
+static Polygon
+MakeStar()
+{
+  Vertex corners[40];
+  for (unsigned i = 0; i < 40; ++i) {
+    const double angle = i * M_PI / 20;
+    const double radius = i % 2 == 0 ? 5 : 1.5;
+    corners[i].x = radius * cos(angle);
+    corners[i].y = radius * sin(angle);
+  }
+
+  return MakePolygon(corners, 40, 1);
+}
+
+/**
+ * Scale the polygon towards its first vertex.  A small polygon is
+ * only a few grid units wide, and tests the margin around its edges.
+ */
+static Polygon
+Shrink(const Polygon &V, double factor)
+{
+  const GeoPoint origin = V.front().get_location();
+
+  Polygon result;
+  for (auto i = V.begin(), end = V.end(); i != end; ++i) {
+    const GeoPoint &p = i->get_location();
+    result.push_back(GeoPoint(origin.longitude +
+                              (p.longitude - origin.longitude) * fixed(factor),
+                              origin.latitude +
+                              (p.latitude - origin.latitude) * fixed(factor)));
+  }
+
+  return result;
+}
+
+/**
+ * A comb with 10 teeth and narrow gaps between them.
+ */
+static Polygon
+MakeComb()
+{
+  Vertex corners[42];
+  unsigned n = 0;
+  corners[n++] = { 0, 0 };
+  corners[n++] = { 10, 0 };
+  for (unsigned i = 10; i > 0; --i) {
+    corners[n++] = { double(i), 3 };
+    corners[n++] = { i - 0.5, 3 };
+    corners[n++] = { i - 0.5, 1 };
+    corners[n++] = { i - 1., 1 };
+  }
+
+  return MakePolygon(corners, n, 1);
+}
+
+/**
+ * Two squares which touch each other at one vertex.
+ */
+static Polygon
+MakeFigureEight()
+{
+  static const Vertex corners[] = {
+    { 0, 0 }, { 1, 0 }, { 1, 1 }, { 2, 1 },
+    { 2, 2 }, { 1, 2 }, { 1, 1 }, { 0, 1 },
+  };
+
+  return MakePolygon(corners, 8, 5);
+}
+
+/**
+ * A square with a slit of zero width: the polygon touches itself
+ * along an edge.
+ */
+static Polygon
+MakeSlit()
+{
+  static const Vertex corners[] = {
+    { 0, 0 }, { 2, 0 }, { 2, 2 }, { 1, 2 },
+    { 1, 0.5 }, { 1, 2 }, { 0, 2 },
+  };
+
+  return MakePolygon(corners, 7, 6);
+}
+
+static double
+Random(double min, double max)
+{
+  return min + (max - min) * (rand() % 10001) / 10000;
+}
+
+/**
+ * Random points in the bounds of the polygon and around it.
+ */
+static std::vector<GeoPoint>
+MakeRandomPoints(const Polygon &V)
+{
+  GeoPoint p = V.front().get_location();
+  double west = p.longitude.Degrees(), east = west;
+  double south = p.latitude.Degrees(), north = south;
+  for (auto i = V.begin(), end = V.end(); i != end; ++i) {
+    p = i->get_location();
+    west = std::min(west, (double)p.longitude.Degrees());
+    east = std::max(east, (double)p.longitude.Degrees());
+    south = std::min(south, (double)p.latitude.Degrees());
+    north = std::max(north, (double)p.latitude.Degrees());
+  }
+
+  const double margin_x = (east - west) / 10, margin_y = (north - south) / 10;
+
+  std::vector<GeoPoint> points;
+  for (unsigned i = 0; i < 5000; ++i) {
+    const double x = Random(west - margin_x, east + margin_x);
+    const double y = Random(south - margin_y, north + margin_y);
+    points.push_back(GeoPoint(Angle::Degrees(fixed(x)),
+                              Angle::Degrees(fixed(y))));
+  }
+
+  return points;
+}
+
+/**
+ * The vertices, the edge midpoints, points very close to them, and
+ * points on the horizontal and vertical lines through the vertices.
+ */
+static std::vector<GeoPoint>
+MakeBoundaryPoints(const Polygon &V)
+{
+  const Angle epsilon = Angle::Degrees(fixed(1e-7));
+
+  std::vector<GeoPoint> points;
+  for (unsigned i = 0; i + 1 < V.size(); ++i) {
+    const GeoPoint &a = V[i].get_location(), &b = V[i + 1].get_location();
+    const GeoPoint middle = a.Interpolate(b, fixed_half);
+
+    points.push_back(a);
+    points.push_back(middle);
+
+    for (int dx = -1; dx <= 1; ++dx)
+      for (int dy = -1; dy <= 1; ++dy)
+        if (dx != 0 || dy != 0)
+          points.push_back(GeoPoint(middle.longitude + epsilon * dx,
+                                    middle.latitude + epsilon * dy));
+
+    const GeoPoint c = V[rand() % V.size()].get_location();
+    points.push_back(GeoPoint(a.longitude, c.latitude));
+    points.push_back(GeoPoint(c.longitude, a.latitude));
+  }
+
+  return points;
+}
+
+static unsigned
+CountMismatches(const PolygonInteriorIndex &index, const Polygon &V,
+                const std::vector<GeoPoint> &points, unsigned &n_inside)
+{
+  unsigned n_mismatches = 0;
+  n_inside = 0;
+  for (auto i = points.begin(), end = points.end(); i != end; ++i) {
+    const bool expected = PolygonInterior(*i, V);
+    n_inside += expected;
+    if (index.IsInside(*i, V) != expected)
+      ++n_mismatches;
+  }
+
+  return n_mismatches;
+}
+
+static void
+TestPolygon(const Polygon &V)
+{
+  PolygonInteriorIndex index;
+  index.Build(V);
+  ok1(index.IsDefined());
+  if (!index.IsDefined()) {
+    skip(3, 0, "not indexed");
+    return;
+  }
+
+  unsigned n_inside;
+  const std::vector<GeoPoint> random = MakeRandomPoints(V);
+  ok1(CountMismatches(index, V, random, n_inside) == 0);
+  ok1(n_inside > 0 && n_inside < random.size());
+
+  const std::vector<GeoPoint> boundary = MakeBoundaryPoints(V);
+  ok1(CountMismatches(index, V, boundary, n_inside) == 0);
+}
+
+static void
+TestSmall()
+{
+  static const Vertex corners[] = {
+    { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 },
+  };
+
+  PolygonInteriorIndex index;
+  index.Build(MakePolygon(corners, 4, 1));
+  ok1(!index.IsDefined());
+
+  index.Build(MakePolygon(corners, 4, 10));
+  ok1(index.IsDefined());
+  index.Clear();
+  ok1(!index.IsDefined());
+}
+
+int main(int argc, char **argv)
+{
+  plan_tests(23);
+
+  srand(42);
+
+  TestPolygon(MakeStar());
+  TestPolygon(Shrink(MakeStar(), 1e-4));
+  TestPolygon(MakeComb());
+  TestPolygon(MakeFigureEight());
+  TestPolygon(MakeSlit());
+  TestSmall();
+
+  return exit_status();
+}
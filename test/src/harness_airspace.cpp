@@ -31,6 +31,10 @@
 #include "Airspace/AirspaceSoonestSort.hpp"
 #include "Geo/GeoVector.hpp"
 #include "Formatter/AirspaceFormatter.hpp"
+#include "Navigation/Aircraft.hpp"
+#include "Geo/Math.hpp"
+
+#include <math.h>
 
 static void
 airspace_random_properties(AbstractAirspace& as)
@@ -105,6 +109,63 @@ void setup_airspaces(Airspaces& airspaces, const GeoPoint& center, const unsigne
 
 }
 
+bool
+run_with_random_airspaces(bool (*run)(Airspaces &airspaces,
+                                      const GeoPoint &center),
+                          std::initializer_list<unsigned> sizes)
+{
+  const GeoPoint center(Angle::Degrees(fixed(7)), Angle::Degrees(fixed(51)));
+
+  srand(42);
+
+  bool success = true;
+  for (auto i = sizes.begin(), end = sizes.end(); i != end; ++i) {
+    Airspaces airspaces;
+    setup_airspaces(airspaces, center, *i);
+    success &= run(airspaces, center);
+  }
+
+  return success;
+}
+
+void
+start_airspace_flight(AircraftState &state, const GeoPoint &center)
+{
+  state.Reset();
+  state.flying = true;
+  state.location = center;
+  state.location.longitude -= Angle::Degrees(fixed(0.5));
+  state.ground_speed = state.true_airspeed = state.indicated_airspeed =
+    fixed(30);
+  state.altitude = fixed(1500);
+}
+
+bool
+is_airspace_flight_circling(unsigned t)
+{
+  return t % 600 >= 400 && t % 600 < 520;
+}
+
+void
+advance_airspace_flight(AircraftState &state, unsigned t)
+{
+  const fixed last_altitude = state.altitude;
+
+  state.time = fixed(t);
+
+  if (is_airspace_flight_circling(t))
+    state.track = (state.track + Angle::Degrees(fixed(18))).AsBearing();
+  else
+    state.track = Angle::Degrees(fixed(90 + 40 * sin(t / 300.)));
+
+  state.location = FindLatitudeLongitude(state.location, state.track,
+                                         state.ground_speed);
+
+  state.altitude = fixed(1500 + 1000 * sin(t / 500.));
+  state.altitude_agl = state.altitude;
+  state.vario = state.netto_vario = state.altitude - last_altitude;
+}
+
 
 class AirspaceVisitorPrint: 
   public AirspaceVisitor {
@@ -28,11 +28,48 @@
 #include "Airspace/AirspacePolygon.hpp"
 #include "Airspace/AirspaceVisitor.hpp"
 #include "Airspace/AirspaceWarningManager.hpp"
+#include "Compiler.h"
+
+#include <initializer_list>
+
+struct AircraftState;
 
 extern AirspaceWarningManager *airspace_warnings;
 
 void setup_airspaces(Airspaces& airspaces, const GeoPoint &center, const unsigned n=150);
 
+/**
+ * Calls the function with a new set of random airspaces (see
+ * setup_airspaces()) for each of the specified sizes.  The random
+ * number generator is seeded first, so the airspaces and all random
+ * numbers drawn by the function are reproducible.
+ *
+ * @return true if all calls returned true
+ */
+bool run_with_random_airspaces(bool (*run)(Airspaces &airspaces,
+                                           const GeoPoint &center),
+                               std::initializer_list<unsigned> sizes);
+
+/**
+ * Initialise the aircraft for a flight through the random airspaces:
+ * half a degree west of the center, at 30 m/s.
+ */
+void start_airspace_flight(AircraftState &state, const GeoPoint &center);
+
+/**
+ * Is the aircraft circling at time t [s] of the flight?  It cruises
+ * with a slowly varying track, and circles for two minutes every ten
+ * minutes.
+ */
+gcc_const
+bool is_airspace_flight_circling(unsigned t);
+
+/**
+ * Move the aircraft to its state at time t [s] of the flight, one
+ * second after the current state.
+ */
+void advance_airspace_flight(AircraftState &state, unsigned t);
+
 void scan_airspaces(const AircraftState state, 
                     const Airspaces& airspaces,
                     const AirspaceAircraftPerformance& perf,
@@ -0,0 +1,117 @@
+/* Copyright_License {
+
+  XCSoar Glide Computer - http://www.xcsoar.org/
+  Copyright (C) 2000-2012 The XCSoar Project
+  A detailed list of copyright holders can be found in the file "AUTHORS".
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+}
+*/
+
+
+/*
+ * Flies a simulated aircraft through random airspaces and checks that
+ * the coherent mode of #AirspaceWarningManager produces the same
+ * warnings as the plain mode.
+ */
+
+#include "harness_airspace.hpp"
+#include "test_debug.hpp"
+#include "Task/Stats/TaskStats.hpp"
+#include "GlideSolvers/GlidePolar.hpp"
+
+#include <stdio.h>
+
+static const unsigned N_STEPS = 2400;
+
+static bool
+Equals(const AirspaceWarningManager &a, const AirspaceWarningManager &b)
+{
+  if (a.size() != b.size())
+    return false;
+
+  for (auto i = a.begin(), j = b.begin(), end = a.end(); i != end; ++i, ++j)
+    if (&i->GetAirspace() != &j->GetAirspace() ||
+        i->GetWarningState() != j->GetWarningState() ||
+        i->GetSolution().elapsed_time != j->GetSolution().elapsed_time ||
+        i->GetSolution().distance != j->GetSolution().distance)
+      return false;
+
+  return true;
+}
+
+static bool
+test_coherent(Airspaces &airspaces, const GeoPoint &center)
+{
+  AirspaceWarningConfig config;
+  config.SetDefaults();
+
+  AirspaceWarningManager plain(airspaces), coherent(airspaces);
+  plain.SetCoherent(false);
+  plain.SetConfig(config);
+  coherent.SetConfig(config);
+
+  const GlidePolar glide_polar(fixed_one);
+  TaskStats task_stats;
+  task_stats.reset();
+
+  AircraftState state;
+  start_airspace_flight(state, center);
+
+  plain.Reset(state);
+  coherent.Reset(state);
+
+  unsigned n_tested = 0, n_warnings = 0, n_mismatches = 0;
+
+  for (unsigned t = 1; t <= N_STEPS; ++t) {
+    advance_airspace_flight(state, t);
+    const bool circling = is_airspace_flight_circling(t);
+
+    const bool plain_changed = plain.Update(state, glide_polar, task_stats,
+                                            circling, 1);
+    const bool coherent_changed = coherent.Update(state, glide_polar,
+                                                  task_stats, circling, 1);
+
+    n_tested += coherent.GetCorridor().GetTestedCount();
+    n_warnings += plain.size();
+
+    if (plain_changed != coherent_changed || !Equals(plain, coherent))
+      ++n_mismatches;
+  }
+
+  if (verbose)
+    printf("# airspaces=%u warnings=%u tested/update=%u mismatches=%u\n",
+           airspaces.size(), n_warnings, n_tested / N_STEPS, n_mismatches);
+
+  /* the flight must actually cause warnings, and the corridor must
+     actually skip airspaces, or the comparison proves nothing */
+  ok1(n_warnings > 0);
+  ok1(n_tested / N_STEPS < airspaces.size());
+  ok1(n_mismatches == 0);
+
+  return n_mismatches == 0;
+}
+
+int main(int argc, char** argv)
+{
+  if (!ParseArgs(argc, argv))
+    return 0;
+
+  plan_tests(6);
+
+  run_with_random_airspaces(test_coherent, { 200, 1000 });
+
+  return exit_status();
+}
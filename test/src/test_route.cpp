@@ -134,6 +134,9 @@ test_route(const unsigned n_airspaces, const RasterMap& map)
     route.UpdatePolar(settings, polar, polar, wind);
     route.SetTerrain(&map);
     RoutePlannerConfig config;
+    config.SetDefaults();
+    // the destinations are only 100 m above the terrain
+    config.safety_height_terrain = fixed_zero;
     config.mode = RoutePlannerConfig::Mode::BOTH;
 
     bool sol = false;